@@ -19,6 +19,7 @@ namespace dxvk {
     m_flags     (ContextFlags),
     m_staging   (Device, StagingBufferSize),
     m_csFlags   (CsFlags),
+    m_csAllocator(pParent->GetCsChunkPool(), CsFlags),
     m_csChunk   (AllocCsChunk()) {
     // Create local allocation cache with the same properties
     // that we will use for common dynamic buffer types
@@ -3171,7 +3172,7 @@ namespace dxvk {
 
   template<typename ContextType>
   DxvkCsChunkRef D3D11CommonContext<ContextType>::AllocCsChunk() {
-    return m_parent->AllocCsChunk(m_csFlags);
+    return m_csAllocator.allocChunk();
   }
 
 
@@ -3597,9 +3598,15 @@ namespace dxvk {
     const D3D11CommonShader*    pShaderModule) {
     uint64_t oldUavMask = m_state.lazy.bindingsUsed[ShaderStage].uavMask;
 
-    if (pShaderModule) {
+    // This may wait for asynchronous shader translation. Treat
+    // shaders that failed to translate as if no shader was bound.
+    Rc<DxvkShader> shader;
+
+    if (pShaderModule)
+      shader = pShaderModule->GetShader();
+
+    if (shader != nullptr) {
       auto buffer = pShaderModule->GetIcb();
-      auto shader = pShaderModule->GetShader();
 
       if (unlikely(shader->needsLibraryCompile()))
         m_device->requestCompileShader(shader);
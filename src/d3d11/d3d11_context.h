@@ -795,6 +795,7 @@ namespace dxvk {
     D3D11CmdType                m_csDataType = D3D11CmdType::None;
 
     DxvkCsChunkFlags            m_csFlags;
+    DxvkCsChunkAllocator        m_csAllocator;
     DxvkCsChunkRef              m_csChunk;
     DxvkCsDataBlock*            m_csData = nullptr;
 
@@ -1163,6 +1164,8 @@ namespace dxvk {
       }
 
       if (unlikely(!m_csChunk->push(command))) {
+        m_csAllocator.trackChunk(m_csChunk);
+
         GetTypedContext()->EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
 
@@ -1180,6 +1183,8 @@ namespace dxvk {
       m_csData = m_csChunk->pushCmd<M, Cmd>(command, count);
 
       if (unlikely(!m_csData)) {
+        m_csAllocator.trackChunk(m_csChunk);
+
         GetTypedContext()->EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
 
@@ -1197,6 +1202,8 @@ namespace dxvk {
         m_csData = nullptr;
         m_csDataType = D3D11CmdType::None;
 
+        m_csAllocator.trackChunk(m_csChunk);
+
         GetTypedContext()->EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
       }
@@ -106,7 +106,7 @@ namespace dxvk {
     void InjectCs(
             DxvkCsQueue                 Queue,
             Fn&&                        Command) {
-      auto chunk = AllocCsChunk();
+      auto chunk = m_parent->AllocCsChunk(m_csFlags);
       chunk->push(std::move(Command));
 
       InjectCsChunk(Queue, std::move(chunk), false);
@@ -47,6 +47,8 @@ namespace dxvk {
     m_d3d11Formats      (m_dxvkDevice),
     m_d3d11Options      (m_dxvkDevice->instance()->config()),
     m_dxbcOptions       (m_dxvkDevice, m_d3d11Options),
+    m_csChunkPool       (m_dxvkDevice.ptr()),
+    m_shaderModules     (m_dxvkDevice.ptr()),
     m_maxFeatureLevel   (GetMaxFeatureLevel(m_dxvkDevice->instance(), m_dxvkDevice->adapter())),
     m_deviceFeatures    (m_dxvkDevice->instance(), m_dxvkDevice->adapter(), m_d3d11Options, m_featureLevel) {
     m_initializer = new D3D11Initializer(this);
@@ -56,6 +58,9 @@ namespace dxvk {
   
   
   D3D11Device::~D3D11Device() {
+    // Shader translation workers may still use the initializer
+    m_shaderModules.StopWorkers();
+
     delete m_d3d10Device;
     m_context = nullptr;
     delete m_initializer;
@@ -2033,8 +2038,20 @@ namespace dxvk {
     if (FAILED(hr))
       return hr;
 
+    // Feature checks require the translated shader. Only wait for
+    // asynchronously translated shaders if the device lacks any
+    // feature that a shader of this stage can require, since the
+    // checks cannot fail otherwise.
+    if (commonShader.IsAsync() && !NeedsShaderFeatureChecks(ShaderKey.type())) {
+      *pShaderModule = std::move(commonShader);
+      return S_OK;
+    }
+
     auto shader = commonShader.GetShader();
 
+    if (shader == nullptr)
+      return E_INVALIDARG;
+
     if (shader->flags().test(DxvkShaderFlag::ExportsStencilRef)
      && !m_dxvkDevice->features().extShaderStencilExport)
       return E_INVALIDARG;
@@ -2057,6 +2074,29 @@ namespace dxvk {
   }
 
 
+  bool D3D11Device::NeedsShaderFeatureChecks(
+          VkShaderStageFlagBits   Stage) const {
+    const auto& features = m_dxvkDevice->features();
+
+    if (!features.core.features.shaderResourceResidency)
+      return true;
+
+    if (Stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+      return !features.extShaderStencilExport
+          || !m_dxvkDevice->properties().extConservativeRasterization.fullyCoveredFragmentShaderInputVariable;
+    }
+
+    if (Stage == VK_SHADER_STAGE_VERTEX_BIT
+     || Stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT
+     || Stage == VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT) {
+      return !features.vk12.shaderOutputViewportIndex
+          || !features.vk12.shaderOutputLayer;
+    }
+
+    return false;
+  }
+
+
   HRESULT D3D11Device::GetFormatSupportFlags(DXGI_FORMAT Format, UINT* pFlags1, UINT* pFlags2) const {
     const DXGI_VK_FORMAT_INFO fmtMapping = LookupFormat(Format, DXGI_VK_FORMAT_MODE_ANY);
 
@@ -456,6 +456,10 @@ namespace dxvk {
       DxvkCsChunk* chunk = m_csChunkPool.allocChunk(flags);
       return DxvkCsChunkRef(chunk, &m_csChunkPool);
     }
+
+    DxvkCsChunkPool* GetCsChunkPool() {
+      return &m_csChunkPool;
+    }
     
     const D3D11Options* GetOptions() const {
       return &m_d3d11Options;
@@ -526,6 +530,9 @@ namespace dxvk {
             size_t                  BytecodeLength,
             ID3D11ClassLinkage*     pClassLinkage,
       const DxbcModuleInfo*         pModuleInfo);
+
+    bool NeedsShaderFeatureChecks(
+            VkShaderStageFlagBits   Stage) const;
     
     HRESULT GetFormatSupportFlags(
             DXGI_FORMAT             Format,
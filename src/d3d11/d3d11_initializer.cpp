@@ -12,7 +12,8 @@ namespace dxvk {
     m_device(pParent->GetDXVKDevice()),
     m_stagingBuffer(m_device, StagingBufferSize),
     m_stagingSignal(new sync::Fence(0)),
-    m_csChunk(m_parent->AllocCsChunk(DxvkCsChunkFlag::SingleUse)) {
+    m_csAllocator(pParent->GetCsChunkPool(), DxvkCsChunkFlag::SingleUse),
+    m_csChunk(m_csAllocator.allocChunk()) {
 
   }
 
@@ -394,8 +395,10 @@ namespace dxvk {
 
 
   void D3D11Initializer::FlushCsChunkLocked() {
+    m_csAllocator.trackChunk(m_csChunk);
+
     m_parent->GetContext()->InjectCsChunk(DxvkCsQueue::HighPriority, std::move(m_csChunk), false);
-    m_csChunk = m_parent->AllocCsChunk(DxvkCsChunkFlag::SingleUse);
+    m_csChunk = m_csAllocator.allocChunk();
   }
 
 
@@ -77,6 +77,7 @@ namespace dxvk {
     size_t            m_transferCommands  = 0;
 
     dxvk::mutex       m_csMutex;
+    DxvkCsChunkAllocator m_csAllocator;
     DxvkCsChunkRef    m_csChunk;
 
     void InitDeviceLocalBuffer(
@@ -110,6 +110,10 @@ namespace dxvk {
     /// can negatively affect performance.
     bool reproducibleCommandStream = false;
 
+    /// Translate shaders on worker threads and only wait
+    /// for the result when the shader is first used
+    bool asyncShaderTranslation = false;
+
     /// Shader dump path
     std::string shaderDumpPath;
   };
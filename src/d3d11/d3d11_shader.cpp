@@ -1,34 +1,79 @@
 #include "d3d11_device.h"
 #include "d3d11_shader.h"
 
+#include "../util/util_singleton.h"
+
 namespace dxvk {
+
+  static Singleton<DxvkShaderCache> g_shaderCache;
+
+  /**
+   * \brief D3D11 data stored in shader cache entries
+   *
+   * Followed by the immediate constant buffer data.
+   */
+  struct D3D11ShaderCacheData {
+    DxbcBindingMask bindings;
+    uint32_t        icbSize;
+    uint32_t        reserved;
+  };
+
   
   D3D11CommonShader:: D3D11CommonShader() { }
   D3D11CommonShader::~D3D11CommonShader() { }
+
+
+  D3D11CommonShader::D3D11CommonShader(
+    const Rc<D3D11ShaderTask>& Task)
+  : m_task(Task) { }
   
   
   D3D11CommonShader::D3D11CommonShader(
-          D3D11Device*    pDevice,
-    const DxvkShaderKey*  pShaderKey,
-    const DxbcModuleInfo* pDxbcModuleInfo,
-    const void*           pShaderBytecode,
-          size_t          BytecodeLength) {
+          D3D11Device*      pDevice,
+    const DxvkShaderKey*    pShaderKey,
+    const DxbcModuleInfo*   pDxbcModuleInfo,
+    const void*             pShaderBytecode,
+          size_t            BytecodeLength,
+          DxvkShaderCache*  pShaderCache) {
     const std::string name = pShaderKey->toString();
+
+    // If requested by the user, dump both the raw DXBC
+    // shader and the compiled SPIR-V module to a file.
+    const std::string& dumpPath = pDevice->GetOptions()->shaderDumpPath;
+
+    // Skip translation if the shader is in the shader cache.
+    // Dumping shaders requires the DXBC module, so the cache
+    // is only used if shader dumps are disabled.
+    DxvkShaderKey cacheKey;
+
+    if (pShaderCache && dumpPath.empty()) {
+      cacheKey = GetCacheKey(pShaderKey, pDxbcModuleInfo);
+
+      if (LoadFromCache(pDevice, pShaderKey, pShaderCache, cacheKey))
+        return;
+    } else {
+      pShaderCache = nullptr;
+    }
+
     Logger::debug(str::format("Compiling shader ", name));
     
     DxbcReader reader(
       reinterpret_cast<const char*>(pShaderBytecode),
       BytecodeLength);
     
-    // If requested by the user, dump both the raw DXBC
-    // shader and the compiled SPIR-V module to a file.
-    const std::string& dumpPath = pDevice->GetOptions()->shaderDumpPath;
-    
     if (dumpPath.size() != 0) {
       reader.store(std::ofstream(str::topath(str::format(dumpPath, "/", name, ".dxbc").c_str()).c_str(),
         std::ios_base::binary | std::ios_base::trunc));
     }
 
+    // Measure translation time if requested
+    DxvkShaderLog* shaderLog = pDevice->GetDXVKDevice()->getShaderLog();
+
+    high_resolution_clock::time_point t0;
+
+    if (unlikely(shaderLog))
+      t0 = high_resolution_clock::now();
+
     // Error out if the shader is invalid
     DxbcModule module(reader);
     auto programInfo = module.programInfo();
@@ -49,6 +94,9 @@ namespace dxvk {
       ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
       : module.compile                 (*pDxbcModuleInfo, name);
     m_shader->setShaderKey(*pShaderKey);
+
+    if (unlikely(shaderLog))
+      shaderLog->logShader(m_shader, BytecodeLength, high_resolution_clock::now() - t0);
     
     if (dumpPath.size() != 0) {
       std::ofstream dumpStream(
@@ -61,23 +109,8 @@ namespace dxvk {
     // Create shader constant buffer if necessary
     auto icb = module.icbInfo();
 
-    if (icb.size) {
-      DxvkBufferCreateInfo info = { };
-      info.size   = align(icb.size, 256u);
-      info.usage  = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-                  | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-                  | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-      info.stages = util::pipelineStages(m_shader->info().stage);
-      info.access = VK_ACCESS_UNIFORM_READ_BIT
-                  | VK_ACCESS_TRANSFER_READ_BIT
-                  | VK_ACCESS_TRANSFER_WRITE_BIT;
-      info.debugName = "Icb";
-
-      m_buffer = pDevice->GetDXVKDevice()->createBuffer(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-      // Upload immediate constant buffer to VRAM
-      pDevice->InitShaderIcb(this, icb.size, icb.data);
-    }
+    if (icb.size)
+      CreateIcb(pDevice, icb.size, icb.data);
 
     pDevice->GetDXVKDevice()->registerShader(m_shader);
 
@@ -86,11 +119,168 @@ namespace dxvk {
 
     if (bindings)
       m_bindings = *bindings;
+
+    if (pShaderCache)
+      StoreToCache(pShaderCache, cacheKey, icb);
+  }
+
+
+  bool D3D11CommonShader::LoadFromCache(
+          D3D11Device*      pDevice,
+    const DxvkShaderKey*    pShaderKey,
+          DxvkShaderCache*  pShaderCache,
+    const DxvkShaderKey&    CacheKey) {
+    Rc<DxvkDevice> dxvkDevice = pDevice->GetDXVKDevice();
+
+    DxvkShaderCacheEntry entry;
+    D3D11ShaderCacheData data = { };
+
+    bool found = pShaderCache->lookup(CacheKey, entry)
+      && entry.data.size() >= sizeof(data);
+
+    if (found) {
+      std::memcpy(&data, entry.data.data(), sizeof(data));
+      found = entry.data.size() == sizeof(data) + data.icbSize;
+    }
+
+    if (!found) {
+      dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheMisses, 1);
+      return false;
+    }
+
+    m_shader = std::move(entry.shader);
+    m_shader->setShaderKey(*pShaderKey);
+
+    if (data.icbSize)
+      CreateIcb(pDevice, data.icbSize, &entry.data[sizeof(data)]);
+
+    dxvkDevice->registerShader(m_shader);
+
+    m_bindings = data.bindings;
+
+    dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheHits, 1);
+    dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheBytesSaved, entry.codeSize);
+    return true;
+  }
+
+
+  void D3D11CommonShader::StoreToCache(
+          DxvkShaderCache*  pShaderCache,
+    const DxvkShaderKey&    CacheKey,
+    const DxbcIcbInfo&      Icb) {
+    D3D11ShaderCacheData data = { };
+    data.bindings = m_bindings;
+    data.icbSize  = uint32_t(Icb.size);
+
+    std::vector<uint8_t> entryData(sizeof(data) + Icb.size);
+    std::memcpy(&entryData[0], &data, sizeof(data));
+
+    if (Icb.size)
+      std::memcpy(&entryData[sizeof(data)], Icb.data, Icb.size);
+
+    pShaderCache->store(CacheKey, m_shader, std::move(entryData));
+  }
+
+
+  void D3D11CommonShader::CreateIcb(
+          D3D11Device*      pDevice,
+          size_t            IcbSize,
+    const void*             pIcbData) {
+    DxvkBufferCreateInfo info = { };
+    info.size   = align(IcbSize, 256u);
+    info.usage  = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+                | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    info.stages = util::pipelineStages(m_shader->info().stage);
+    info.access = VK_ACCESS_UNIFORM_READ_BIT
+                | VK_ACCESS_TRANSFER_READ_BIT
+                | VK_ACCESS_TRANSFER_WRITE_BIT;
+    info.debugName = "Icb";
+
+    m_buffer = pDevice->GetDXVKDevice()->createBuffer(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // Upload immediate constant buffer to VRAM
+    pDevice->InitShaderIcb(this, IcbSize, pIcbData);
+  }
+
+
+  DxvkShaderKey D3D11CommonShader::GetCacheKey(
+    const DxvkShaderKey*    pShaderKey,
+    const DxbcModuleInfo*   pDxbcModuleInfo) {
+    // The cache key must cover everything that may affect the
+    // generated code. Since the cache file is invalidated when
+    // DXVK gets updated, only the values need to be hashed.
+    std::vector<uint8_t> data;
+
+    auto add = [&data] (const auto& value) {
+      auto bytes = reinterpret_cast<const uint8_t*>(&value);
+      data.insert(data.end(), bytes, bytes + sizeof(value));
+    };
+
+    for (uint32_t i = 0; i < 5; i++)
+      add(pShaderKey->sha1().dword(i));
+
+    const DxbcOptions& options = pDxbcModuleInfo->options;
+    add(options.useDepthClipWorkaround);
+    add(options.supportsTypedUavLoadR32);
+    add(options.supportsRawAccessChains);
+    add(options.zeroInitWorkgroupMemory);
+    add(options.invariantPosition);
+    add(options.forceVolatileTgsmAccess);
+    add(options.forceComputeUavBarriers);
+    add(options.disableMsaa);
+    add(options.forceSampleRateShading);
+    add(options.enableSampleShadingInterlock);
+    add(options.supportsTightIcbPacking);
+    add(options.needsPointSizeExport);
+    add(options.optimizeSpirv);
+    add(options.floatControl.raw());
+    add(options.minSsboAlignment);
+
+    if (pDxbcModuleInfo->tess)
+      add(pDxbcModuleInfo->tess->maxTessFactor);
+
+    if (pDxbcModuleInfo->xfb) {
+      const DxbcXfbInfo* xfb = pDxbcModuleInfo->xfb;
+      add(xfb->entryCount);
+
+      for (uint32_t i = 0; i < xfb->entryCount; i++) {
+        const DxbcXfbEntry& e = xfb->entries[i];
+
+        if (e.semanticName)
+          data.insert(data.end(), e.semanticName, e.semanticName + std::strlen(e.semanticName) + 1);
+
+        add(e.semanticIndex);
+        add(e.componentIndex);
+        add(e.componentCount);
+        add(e.streamId);
+        add(e.bufferId);
+        add(e.offset);
+      }
+
+      add(xfb->strides);
+      add(xfb->rasterizedStream);
+    }
+
+    return DxvkShaderKey(VkShaderStageFlagBits(pShaderKey->type()),
+      Sha1Hash::compute(data.data(), data.size()));
   }
 
   
-  D3D11ShaderModuleSet:: D3D11ShaderModuleSet() { }
-  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() { }
+  D3D11ShaderModuleSet::D3D11ShaderModuleSet(DxvkDevice* pDevice) {
+    if (DxvkShaderCache::isEnabled(pDevice))
+      m_shaderCache = g_shaderCache.acquire("d3d11");
+  }
+
+
+  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() {
+    StopWorkers();
+
+    if (m_shaderCache != nullptr) {
+      m_shaderCache = nullptr;
+      g_shaderCache.release();
+    }
+  }
   
   
   HRESULT D3D11ShaderModuleSet::GetShaderModule(
@@ -102,41 +292,305 @@ namespace dxvk {
           D3D11CommonShader*  pShader) {
     // Use the shader's unique key for the lookup
     { std::unique_lock<dxvk::mutex> lock(m_mutex);
-      
-      auto entry = m_modules.find(*pShaderKey);
-      if (entry != m_modules.end()) {
-        *pShader = entry->second;
-        return S_OK;
+      dxvk::high_resolution_clock::time_point t0;
+      bool waited = false;
+
+      while (true) {
+        auto entry = m_modules.find(*pShaderKey);
+
+        if (entry != m_modules.end()) {
+          if (waited) {
+            auto t1 = dxvk::high_resolution_clock::now();
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+            Rc<DxvkDevice> dxvkDevice = pDevice->GetDXVKDevice();
+            dxvkDevice->addStatCtr(DxvkStatCounter::ShaderDedupCount, 1);
+            dxvkDevice->addStatCtr(DxvkStatCounter::ShaderDedupTicks, us.count());
+          }
+
+          *pShader = entry->second;
+          return S_OK;
+        }
+
+        // If another thread is already compiling the same shader, wait
+        // for it rather than translating the shader again. If that fails,
+        // we will try to compile the shader ourselves and report the error.
+        if (m_pending.find(*pShaderKey) == m_pending.end())
+          break;
+
+        if (!waited)
+          t0 = dxvk::high_resolution_clock::now();
+
+        waited = true;
+
+        m_cond.wait(lock, [this, pShaderKey] {
+          return m_pending.find(*pShaderKey) == m_pending.end();
+        });
       }
+
+      m_pending.insert(*pShaderKey);
     }
+
+    PendingShader pending(this, pShaderKey);
     
     // This shader has not been compiled yet, so we have to create a
     // new module. This takes a while, so we won't lock the structure.
+    // With asynchronous translation enabled, only validate the shader
+    // here and defer the actual work to a worker thread. Stream output
+    // info references app memory, so those shaders are always compiled
+    // synchronously.
     D3D11CommonShader module;
+    Rc<D3D11ShaderTask> task;
+    HRESULT hr = S_OK;
     
     try {
-      module = D3D11CommonShader(pDevice, pShaderKey,
-        pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+      if (pDevice->GetOptions()->asyncShaderTranslation && !pDxbcModuleInfo->xfb) {
+        ValidateShader(pShaderKey, pShaderBytecode, BytecodeLength);
+
+        task = new D3D11ShaderTask(pDevice, pShaderKey,
+          pDxbcModuleInfo, pShaderBytecode, BytecodeLength,
+          m_shaderCache.ptr());
+
+        module = D3D11CommonShader(task);
+      } else {
+        module = D3D11CommonShader(pDevice, pShaderKey,
+          pDxbcModuleInfo, pShaderBytecode, BytecodeLength,
+          m_shaderCache.ptr());
+      }
     } catch (const DxvkError& e) {
       Logger::err(e.message());
-      return E_INVALIDARG;
+      hr = E_INVALIDARG;
     }
     
-    // Insert the new module into the lookup table. If another thread
-    // has compiled the same shader in the meantime, we should return
-    // that object instead and discard the newly created module.
-    { std::unique_lock<dxvk::mutex> lock(m_mutex);
-      
-      auto status = m_modules.insert({ *pShaderKey, module });
-      if (!status.second) {
-        *pShader = status.first->second;
-        return S_OK;
-      }
-    }
+    // Insert the new module into the lookup table and wake
+    // up any threads waiting for the same shader. Threads
+    // only wait on pending shaders, so this is the only
+    // place where a given key can be inserted.
+    pending.Complete(SUCCEEDED(hr) ? &module : nullptr);
+
+    if (FAILED(hr))
+      return hr;
+
+    if (task != nullptr)
+      EnqueueTask(task);
     
     *pShader = std::move(module);
     return S_OK;
   }
+
+
+  D3D11ShaderModuleSet::PendingShader::PendingShader(
+          D3D11ShaderModuleSet* pSet,
+    const DxvkShaderKey*        pShaderKey)
+  : m_set(pSet), m_key(pShaderKey) {
+
+  }
+
+
+  D3D11ShaderModuleSet::PendingShader::~PendingShader() {
+    if (!m_completed)
+      Complete(nullptr);
+  }
+
+
+  void D3D11ShaderModuleSet::PendingShader::Complete(
+    const D3D11CommonShader*    pModule) {
+    { std::unique_lock<dxvk::mutex> lock(m_set->m_mutex);
+
+      if (pModule)
+        m_set->m_modules.insert({ *m_key, *pModule });
+
+      m_set->m_pending.erase(*m_key);
+    }
+
+    m_set->m_cond.notify_all();
+    m_completed = true;
+  }
+
+
+  void D3D11ShaderModuleSet::StopWorkers() {
+    { std::unique_lock<dxvk::mutex> lock(m_workerMutex);
+      m_workersStopped = true;
+      m_workerCond.notify_all();
+    }
+
+    for (auto& worker : m_workers)
+      worker.join();
+
+    m_workers.clear();
+
+    // Nothing can use queued shaders anymore at this point,
+    // but make sure that nobody waits on them indefinitely.
+    while (!m_workerQueue.empty()) {
+      m_workerQueue.front()->Cancel();
+      m_workerQueue.pop();
+    }
+  }
+
+
+  void D3D11ShaderModuleSet::EnqueueTask(
+    const Rc<D3D11ShaderTask>& Task) {
+    std::unique_lock<dxvk::mutex> lock(m_workerMutex);
+
+    if (unlikely(m_workersStopped)) {
+      lock.unlock();
+      Task->Run();
+      return;
+    }
+
+    if (unlikely(m_workers.empty())) {
+      // Leave some room for the application's own threads
+      uint32_t workerCount = dxvk::thread::hardware_concurrency() / 2;
+      workerCount = std::clamp(workerCount, 1u, 8u);
+
+      for (uint32_t i = 0; i < workerCount; i++)
+        m_workers.emplace_back([this] { RunWorker(); });
+
+      Logger::info(str::format("D3D11: Using ", workerCount, " shader translation threads"));
+    }
+
+    m_workerQueue.push(Task);
+    m_workerCond.notify_one();
+  }
+
+
+  void D3D11ShaderModuleSet::RunWorker() {
+    env::setThreadName("dxvk-d3d11-shader");
+
+    while (true) {
+      Rc<D3D11ShaderTask> task;
+
+      { std::unique_lock<dxvk::mutex> lock(m_workerMutex);
+
+        m_workerCond.wait(lock, [this] {
+          return m_workersStopped || !m_workerQueue.empty();
+        });
+
+        if (m_workersStopped)
+          return;
+
+        task = std::move(m_workerQueue.front());
+        m_workerQueue.pop();
+      }
+
+      task->Run();
+    }
+  }
+
+
+  void D3D11ShaderModuleSet::ValidateShader(
+    const DxvkShaderKey*      pShaderKey,
+    const void*               pShaderBytecode,
+          size_t              BytecodeLength) {
+    // Only parse the chunk headers here, which is enough
+    // to perform the same checks as the regular path.
+    DxbcReader reader(
+      reinterpret_cast<const char*>(pShaderBytecode),
+      BytecodeLength);
+
+    DxbcModule module(reader);
+    auto programInfo = module.programInfo();
+
+    if (!programInfo)
+      throw DxvkError("Invalid shader binary.");
+
+    if (programInfo->shaderStage() != pShaderKey->type())
+      throw DxvkError("Mismatching shader type.");
+  }
+
+
+  D3D11ShaderTask::D3D11ShaderTask(
+          D3D11Device*      pDevice,
+    const DxvkShaderKey*    pShaderKey,
+    const DxbcModuleInfo*   pDxbcModuleInfo,
+    const void*             pShaderBytecode,
+          size_t            BytecodeLength,
+          DxvkShaderCache*  pShaderCache)
+  : m_device      (pDevice),
+    m_shaderKey   (*pShaderKey),
+    m_moduleInfo  (*pDxbcModuleInfo),
+    m_bytecode    (reinterpret_cast<const char*>(pShaderBytecode),
+                   reinterpret_cast<const char*>(pShaderBytecode) + BytecodeLength),
+    m_shaderCache (pShaderCache) {
+    if (m_moduleInfo.tess) {
+      m_tess = *m_moduleInfo.tess;
+      m_moduleInfo.tess = &m_tess;
+    }
+
+    m_moduleInfo.xfb = nullptr;
+  }
+
+
+  D3D11ShaderTask::~D3D11ShaderTask() {
+
+  }
+
+
+  void D3D11ShaderTask::Run() {
+    if (TryBegin())
+      Execute();
+  }
+
+
+  void D3D11ShaderTask::Cancel() {
+    if (!TryBegin())
+      return;
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+    m_state.store(State::Done, std::memory_order_release);
+    m_cond.notify_all();
+  }
+
+
+  bool D3D11ShaderTask::TryBegin() {
+    State expected = State::Queued;
+
+    return m_state.compare_exchange_strong(expected,
+      State::Running, std::memory_order_acquire);
+  }
+
+
+  void D3D11ShaderTask::Execute() {
+    try {
+      m_result = D3D11CommonShader(m_device, &m_shaderKey,
+        &m_moduleInfo, m_bytecode.data(), m_bytecode.size(),
+        m_shaderCache);
+    } catch (const DxvkError& e) {
+      Logger::err(str::format("Failed to translate shader ", m_shaderKey.toString(), ": ", e.message()));
+    }
+
+    // The bytecode is no longer needed at this point
+    m_bytecode = std::vector<char>();
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+    m_state.store(State::Done, std::memory_order_release);
+    m_cond.notify_all();
+  }
+
+
+  const D3D11CommonShader& D3D11ShaderTask::WaitForResult() {
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    // If no worker has picked up the task yet, translate the
+    // shader on the calling thread rather than waiting for it.
+    if (TryBegin()) {
+      Execute();
+    } else {
+      std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+      m_cond.wait(lock, [this] {
+        return m_state.load(std::memory_order_acquire) == State::Done;
+      });
+    }
+
+    auto t1 = dxvk::high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+    Rc<DxvkDevice> dxvkDevice = m_device->GetDXVKDevice();
+    dxvkDevice->addStatCtr(DxvkStatCounter::ShaderAsyncStallCount, 1);
+    dxvkDevice->addStatCtr(DxvkStatCounter::ShaderAsyncStallTicks, us.count());
+    return m_result;
+  }
   
 
   D3D11ExtShader::D3D11ExtShader(
@@ -173,6 +627,10 @@ namespace dxvk {
           SIZE_T*                 pCodeSize,
           void*                   pCode) {
     auto shader = m_shader->GetShader();
+
+    if (shader == nullptr)
+      return E_FAIL;
+
     auto code = shader->getRawCode();
 
     HRESULT hr = S_OK;
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <mutex>
+#include <queue>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "../dxbc/dxbc_module.h"
 #include "../dxvk/dxvk_device.h"
+#include "../dxvk/dxvk_shader_cache.h"
 
 #include "../d3d10/d3d10_shader.h"
 
@@ -18,6 +21,7 @@
 namespace dxvk {
   
   class D3D11Device;
+  class D3D11ShaderTask;
 
   /**
    * \brief Common shader object
@@ -25,6 +29,11 @@ namespace dxvk {
    * Stores the compiled SPIR-V shader and the SHA-1
    * hash of the original DXBC shader, which can be
    * used to identify the shader.
+   *
+   * If the shader is translated asynchronously, all
+   * getters will block until translation is complete.
+   * If translation failed or was cancelled, the shader
+   * is \c nullptr and the name is an empty string.
    */
   class D3D11CommonShader {
     
@@ -32,29 +41,42 @@ namespace dxvk {
     
     D3D11CommonShader();
     D3D11CommonShader(
-            D3D11Device*    pDevice,
-      const DxvkShaderKey*  pShaderKey,
-      const DxbcModuleInfo* pDxbcModuleInfo,
-      const void*           pShaderBytecode,
-            size_t          BytecodeLength);
+            D3D11Device*      pDevice,
+      const DxvkShaderKey*    pShaderKey,
+      const DxbcModuleInfo*   pDxbcModuleInfo,
+      const void*             pShaderBytecode,
+            size_t            BytecodeLength,
+            DxvkShaderCache*  pShaderCache);
+    D3D11CommonShader(
+      const Rc<D3D11ShaderTask>& Task);
     ~D3D11CommonShader();
 
     Rc<DxvkShader> GetShader() const {
-      return m_shader;
+      return GetResult().m_shader;
     }
 
     DxvkBufferSlice GetIcb() const {
-      return m_buffer != nullptr
-        ? DxvkBufferSlice(m_buffer)
+      const auto& result = GetResult();
+
+      return result.m_buffer != nullptr
+        ? DxvkBufferSlice(result.m_buffer)
         : DxvkBufferSlice();
     }
     
     std::string GetName() const {
-      return m_shader->debugName();
+      const auto& result = GetResult();
+
+      return result.m_shader != nullptr
+        ? result.m_shader->debugName()
+        : std::string();
     }
 
     DxbcBindingMask GetBindingMask() const {
-      return m_bindings;
+      return GetResult().m_bindings;
+    }
+
+    bool IsAsync() const {
+      return m_task != nullptr;
     }
 
   private:
@@ -64,9 +86,120 @@ namespace dxvk {
 
     DxbcBindingMask m_bindings = { };
 
+    Rc<D3D11ShaderTask> m_task;
+
+    const D3D11CommonShader& GetResult() const;
+
+    bool LoadFromCache(
+            D3D11Device*      pDevice,
+      const DxvkShaderKey*    pShaderKey,
+            DxvkShaderCache*  pShaderCache,
+      const DxvkShaderKey&    CacheKey);
+
+    void StoreToCache(
+            DxvkShaderCache*  pShaderCache,
+      const DxvkShaderKey&    CacheKey,
+      const DxbcIcbInfo&      Icb);
+
+    void CreateIcb(
+            D3D11Device*      pDevice,
+            size_t            IcbSize,
+      const void*             pIcbData);
+
+    static DxvkShaderKey GetCacheKey(
+      const DxvkShaderKey*    pShaderKey,
+      const DxbcModuleInfo*   pDxbcModuleInfo);
+
   };
 
 
+  /**
+   * \brief Asynchronous shader translation
+   *
+   * Stores a copy of everything needed to translate a shader
+   * on a worker thread. The first thread that needs the result
+   * either waits for the worker, or translates the shader itself
+   * if no worker has picked up the task yet.
+   */
+  class D3D11ShaderTask : public RcObject {
+
+  public:
+
+    D3D11ShaderTask(
+            D3D11Device*      pDevice,
+      const DxvkShaderKey*    pShaderKey,
+      const DxbcModuleInfo*   pDxbcModuleInfo,
+      const void*             pShaderBytecode,
+            size_t            BytecodeLength,
+            DxvkShaderCache*  pShaderCache);
+
+    ~D3D11ShaderTask();
+
+    /**
+     * \brief Translates the shader
+     *
+     * Does nothing if another thread has
+     * already started translating the shader.
+     */
+    void Run();
+
+    /**
+     * \brief Cancels translation
+     *
+     * Used when the device is destroyed before the task
+     * was executed. The result will be an empty shader.
+     */
+    void Cancel();
+
+    /**
+     * \brief Retrieves translated shader
+     *
+     * Blocks until translation is complete. If translation
+     * failed, the returned object will not hold a shader.
+     * \returns Translated shader
+     */
+    const D3D11CommonShader& GetResult() {
+      if (likely(m_state.load(std::memory_order_acquire) == State::Done))
+        return m_result;
+
+      return WaitForResult();
+    }
+
+  private:
+
+    enum class State : uint32_t {
+      Queued,
+      Running,
+      Done,
+    };
+
+    D3D11Device*              m_device;
+    DxvkShaderKey             m_shaderKey;
+    DxbcModuleInfo            m_moduleInfo;
+    DxbcTessInfo              m_tess = { };
+    std::vector<char>         m_bytecode;
+    DxvkShaderCache*          m_shaderCache;
+
+    dxvk::mutex               m_mutex;
+    dxvk::condition_variable  m_cond;
+    std::atomic<State>        m_state = { State::Queued };
+
+    D3D11CommonShader         m_result;
+
+    bool TryBegin();
+
+    void Execute();
+
+    const D3D11CommonShader& WaitForResult();
+
+  };
+
+
+  inline const D3D11CommonShader& D3D11CommonShader::GetResult() const {
+    return likely(m_task == nullptr) ? *this : m_task->GetResult();
+  }
+
+
   /**
    * \brief Extended shader interface
    */
@@ -177,14 +310,16 @@ namespace dxvk {
    * 
    * Some applications may compile the same shader multiple
    * times, so we should cache the resulting shader modules
-   * and reuse them rather than creating new ones. This
-   * class is thread-safe.
+   * and reuse them rather than creating new ones. Shaders
+   * that are not in this set are looked up in the persistent
+   * shader cache before translating them. This class is
+   * thread-safe.
    */
   class D3D11ShaderModuleSet {
     
   public:
     
-    D3D11ShaderModuleSet();
+    D3D11ShaderModuleSet(DxvkDevice* pDevice);
     ~D3D11ShaderModuleSet();
     
     HRESULT GetShaderModule(
@@ -194,15 +329,77 @@ namespace dxvk {
       const void*               pShaderBytecode,
             size_t              BytecodeLength,
             D3D11CommonShader*  pShader);
+
+    /**
+     * \brief Stops shader translation workers
+     *
+     * Must be called before the device is destroyed.
+     * Shaders that are still queued will be left empty.
+     */
+    void StopWorkers();
     
   private:
+
+    /**
+     * \brief Pending shader
+     *
+     * Removes a key from the set of pending shaders and wakes up
+     * threads waiting for it once the shader is complete, or when
+     * going out of scope if creating the shader module throws.
+     */
+    class PendingShader {
+
+    public:
+
+      PendingShader(
+              D3D11ShaderModuleSet* pSet,
+        const DxvkShaderKey*        pShaderKey);
+
+      ~PendingShader();
+
+      PendingShader             (const PendingShader&) = delete;
+      PendingShader& operator = (const PendingShader&) = delete;
+
+      void Complete(
+        const D3D11CommonShader*    pModule);
+
+    private:
+
+      D3D11ShaderModuleSet* m_set;
+      const DxvkShaderKey*  m_key;
+      bool                  m_completed = false;
+
+    };
     
+    Rc<DxvkShaderCache> m_shaderCache;
+
+    dxvk::mutex                         m_workerMutex;
+    dxvk::condition_variable            m_workerCond;
+    std::queue<Rc<D3D11ShaderTask>>     m_workerQueue;
+    std::vector<dxvk::thread>           m_workers;
+    bool                                m_workersStopped = false;
+
     dxvk::mutex m_mutex;
+    dxvk::condition_variable m_cond;
     
     std::unordered_map<
       DxvkShaderKey,
       D3D11CommonShader,
       DxvkHash, DxvkEq> m_modules;
+
+    std::unordered_set<
+      DxvkShaderKey,
+      DxvkHash, DxvkEq> m_pending;
+
+    void EnqueueTask(
+      const Rc<D3D11ShaderTask>& Task);
+
+    void RunWorker();
+
+    static void ValidateShader(
+      const DxvkShaderKey*      pShaderKey,
+      const void*               pShaderBytecode,
+            size_t              BytecodeLength);
     
   };
   
@@ -127,6 +127,7 @@ namespace dxvk {
 
     Rc<hud::HudLatencyItem>       m_latencyHud;
     Rc<hud::HudRenderLatencyItem> m_renderLatencyHud;
+    Rc<hud::HudLatencyHistogramItem> m_latencyHistogramHud;
 
     Rc<DxvkImageView> GetBackBufferView();
 
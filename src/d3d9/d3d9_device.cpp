@@ -55,8 +55,10 @@ namespace dxvk {
     , m_multithread        ( BehaviorFlags & D3DCREATE_MULTITHREADED )
     , m_isSWVP             ( (BehaviorFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING) ? true : false )
     , m_isD3D8Compatible   ( pParent->IsD3D8Compatible() )
+    , m_csChunkPool        ( dxvkDevice.ptr() )
+    , m_csAllocator        ( &m_csChunkPool, DxvkCsChunkFlag::SingleUse )
     , m_csThread           ( dxvkDevice, dxvkDevice->createContext() )
-    , m_csChunk            ( AllocCsChunk() )
+    , m_csChunk            ( m_csAllocator.allocChunk() )
     , m_submissionFence    ( new sync::Fence() )
     , m_flushTracker       ( GetMaxFlushType() )
     , m_d3d9Interop        ( this )
@@ -93,6 +95,9 @@ namespace dxvk {
 
     m_dxsoOptions = DxsoOptions(this, m_d3d9Options);
 
+    // Start loading cached fixed-function shaders early
+    m_ffModules.Initialize(this);
+
     // Check if VK_EXT_robustness2 is supported, so we can optimize the number of constants we need to copy.
     // Also check the required alignments.
     const bool supportsRobustness2 = m_dxvkDevice->features().extRobustness2.robustBufferAccess2;
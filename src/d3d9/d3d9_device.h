@@ -1177,13 +1177,19 @@ namespace dxvk {
       return DxvkCsChunkRef(chunk, &m_csChunkPool);
     }
 
+    DxvkCsChunkPool* GetCsChunkPool() {
+      return &m_csChunkPool;
+    }
+
   private:
 
     template<bool AllowFlush = true, typename Cmd>
     void EmitCs(Cmd&& command, bool disableFlush=false) {
       if (unlikely(!m_csChunk->push(command))) {
+        m_csAllocator.trackChunk(m_csChunk);
+
         EmitCsChunk(std::move(m_csChunk));
-        m_csChunk = AllocCsChunk();
+        m_csChunk = m_csAllocator.allocChunk();
 
         if constexpr (AllowFlush)
           if (!disableFlush)
@@ -1197,8 +1203,10 @@ namespace dxvk {
 
     void FlushCsChunk() {
       if (likely(!m_csChunk->empty())) {
+        m_csAllocator.trackChunk(m_csChunk);
+
         EmitCsChunk(std::move(m_csChunk));
-        m_csChunk = AllocCsChunk();
+        m_csChunk = m_csAllocator.allocChunk();
       }
     }
 
@@ -1589,6 +1597,7 @@ namespace dxvk {
     D3D9ViewportInfo                m_viewportInfo;
 
     DxvkCsChunkPool                 m_csChunkPool;
+    DxvkCsChunkAllocator            m_csAllocator;
     DxvkCsThread                    m_csThread;
     DxvkCsChunkRef                  m_csChunk;
     uint64_t                        m_csSeqNum = 0ull;
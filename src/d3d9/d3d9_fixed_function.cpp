@@ -8,6 +8,8 @@
 
 #include "../spirv/spirv_module.h"
 
+#include "../util/util_singleton.h"
+
 #include <cfloat>
 
 namespace dxvk {
@@ -2487,40 +2489,74 @@ namespace dxvk {
   }
 
 
+  static Singleton<DxvkShaderCache> g_ffShaderCache;
+
+
   D3D9FFShader::D3D9FFShader(
           D3D9DeviceEx*         pDevice,
-    const D3D9FFShaderKeyVS&    Key) {
-    Sha1Hash hash = Sha1Hash::compute(&Key, sizeof(Key));
-    DxvkShaderKey shaderKey = { VK_SHADER_STAGE_VERTEX_BIT, hash };
+    const D3D9FFShaderKeyVS&    Key,
+          DxvkShaderCache*      pShaderCache) {
+    Create(pDevice, Key, pShaderCache);
+  }
 
-    std::string name = str::format("FF_", shaderKey.toString());
 
-    D3D9FFShaderCompiler compiler(
-      pDevice->GetDXVKDevice(),
-      Key, name,
-      pDevice->GetOptions());
+  D3D9FFShader::D3D9FFShader(
+          D3D9DeviceEx*         pDevice,
+    const D3D9FFShaderKeyFS&    Key,
+          DxvkShaderCache*      pShaderCache) {
+    Create(pDevice, Key, pShaderCache);
+  }
 
-    m_shader = compiler.compile();
-    m_isgn   = compiler.isgn();
 
-    Dump(pDevice, Key, name);
+  template <typename T>
+  D3D9FFShader::D3D9FFShader(
+          DxvkDevice*           pDevice,
+    const T&                    Key,
+    const DxvkShaderCacheEntry& Entry) {
+    m_shader = Entry.shader;
+    std::memcpy(&m_isgn, &Entry.data[sizeof(T)], sizeof(m_isgn));
 
-    m_shader->setShaderKey(shaderKey);
-    pDevice->GetDXVKDevice()->registerShader(m_shader);
+    Register(pDevice, Key);
   }
 
 
-  D3D9FFShader::D3D9FFShader(
+  template <typename T>
+  void D3D9FFShader::Create(
           D3D9DeviceEx*         pDevice,
-    const D3D9FFShaderKeyFS&    Key) {
+    const T&                    Key,
+          DxvkShaderCache*      pShaderCache) {
+    Rc<DxvkDevice> dxvkDevice = pDevice->GetDXVKDevice();
+
+    // Dumping shaders requires actually compiling them,
+    // so only use the cache if shader dumps are disabled.
+    if (!pDevice->GetOptions()->shaderDumpPath.empty())
+      pShaderCache = nullptr;
+
+    DxvkShaderKey cacheKey;
+
+    if (pShaderCache) {
+      cacheKey = GetCacheKey(Key, D3D9FixedFunctionOptions(pDevice->GetOptions()));
+
+      DxvkShaderCacheEntry entry;
+
+      if (pShaderCache->lookup(cacheKey, entry) && IsValidCacheEntry<T>(entry)) {
+        dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheHits, 1);
+        dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheBytesSaved, entry.codeSize);
+
+        *this = D3D9FFShader(dxvkDevice.ptr(), Key, entry);
+        return;
+      }
+
+      dxvkDevice->addStatCtr(DxvkStatCounter::ShaderCacheMisses, 1);
+    }
+
     Sha1Hash hash = Sha1Hash::compute(&Key, sizeof(Key));
-    DxvkShaderKey shaderKey = { VK_SHADER_STAGE_FRAGMENT_BIT, hash };
+    DxvkShaderKey shaderKey = { T::Stage, hash };
 
     std::string name = str::format("FF_", shaderKey.toString());
 
     D3D9FFShaderCompiler compiler(
-      pDevice->GetDXVKDevice(),
-      Key, name,
+      dxvkDevice, Key, name,
       pDevice->GetOptions());
 
     m_shader = compiler.compile();
@@ -2528,10 +2564,62 @@ namespace dxvk {
 
     Dump(pDevice, Key, name);
 
+    if (pShaderCache)
+      pShaderCache->store(cacheKey, m_shader, GetCacheData(Key));
+
+    Register(dxvkDevice.ptr(), Key);
+  }
+
+
+  template <typename T>
+  void D3D9FFShader::Register(
+          DxvkDevice*           pDevice,
+    const T&                    Key) {
+    Sha1Hash hash = Sha1Hash::compute(&Key, sizeof(Key));
+    DxvkShaderKey shaderKey = { T::Stage, hash };
+
     m_shader->setShaderKey(shaderKey);
-    pDevice->GetDXVKDevice()->registerShader(m_shader);
+    pDevice->registerShader(m_shader);
   }
 
+
+  template <typename T>
+  std::vector<uint8_t> D3D9FFShader::GetCacheData(
+    const T&                    Key) const {
+    // Store the fixed-function key so that cached shaders
+    // can be loaded without the application requesting them
+    std::vector<uint8_t> data(sizeof(Key) + sizeof(m_isgn));
+    std::memcpy(&data[0], &Key, sizeof(Key));
+    std::memcpy(&data[sizeof(Key)], &m_isgn, sizeof(m_isgn));
+    return data;
+  }
+
+
+  template <typename T>
+  DxvkShaderKey D3D9FFShader::GetCacheKey(
+    const T&                        Key,
+    const D3D9FixedFunctionOptions& Options) {
+    std::array<Sha1Data, 4> chunks = {{
+      { &Key,                           sizeof(Key) },
+      { &Options.invariantPosition,     sizeof(Options.invariantPosition) },
+      { &Options.forceSampleRateShading, sizeof(Options.forceSampleRateShading) },
+      { &Options.drefScaling,           sizeof(Options.drefScaling) },
+    }};
+
+    return DxvkShaderKey(T::Stage,
+      Sha1Hash::compute(chunks.size(), chunks.data()));
+  }
+
+
+  template <typename T>
+  bool D3D9FFShader::IsValidCacheEntry(
+    const DxvkShaderCacheEntry&     Entry) {
+    return Entry.shader != nullptr
+        && Entry.shader->info().stage == T::Stage
+        && Entry.data.size() == sizeof(T) + sizeof(DxsoIsgn);
+  }
+
+
   template <typename T>
   void D3D9FFShader::Dump(D3D9DeviceEx* pDevice, const T& Key, const std::string& Name) {
     const std::string& dumpPath = pDevice->GetOptions()->shaderDumpPath;
@@ -2546,40 +2634,155 @@ namespace dxvk {
   }
 
 
+  D3D9FFShaderModuleSet::D3D9FFShaderModuleSet() {
+
+  }
+
+
+  D3D9FFShaderModuleSet::~D3D9FFShaderModuleSet() {
+    m_stopPreload.store(true);
+
+    if (m_preloadThread.joinable())
+      m_preloadThread.join();
+
+    if (m_shaderCache != nullptr) {
+      m_shaderCache = nullptr;
+      g_ffShaderCache.release();
+    }
+  }
+
+
+  void D3D9FFShaderModuleSet::Initialize(
+          D3D9DeviceEx*         pDevice) {
+    Rc<DxvkDevice> dxvkDevice = pDevice->GetDXVKDevice();
+
+    if (!DxvkShaderCache::isEnabled(dxvkDevice.ptr()))
+      return;
+
+    m_shaderCache = g_ffShaderCache.acquire("d3d9ff");
+
+    if (!pDevice->GetOptions()->shaderDumpPath.empty())
+      return;
+
+    m_preloadThread = dxvk::thread([
+      this,
+      cDevice   = dxvkDevice,
+      cOptions  = D3D9FixedFunctionOptions(pDevice->GetOptions())
+    ] {
+      PreloadShaders(cDevice, cOptions);
+    });
+  }
+
+
   D3D9FFShader D3D9FFShaderModuleSet::GetShaderModule(
           D3D9DeviceEx*         pDevice,
     const D3D9FFShaderKeyVS&    ShaderKey) {
-    // Use the shader's unique key for the lookup
-    auto entry = m_vsModules.find(ShaderKey);
-    if (entry != m_vsModules.end())
-      return entry->second;
-    
-    D3D9FFShader shader(
-      pDevice, ShaderKey);
+    return GetShaderModule(pDevice, ShaderKey, m_vsModules, m_vsPending);
+  }
 
-    m_vsModules.insert({ShaderKey, shader});
 
-    return shader;
+  D3D9FFShader D3D9FFShaderModuleSet::GetShaderModule(
+          D3D9DeviceEx*         pDevice,
+    const D3D9FFShaderKeyFS&    ShaderKey) {
+    return GetShaderModule(pDevice, ShaderKey, m_fsModules, m_fsPending);
   }
 
 
+  template <typename T, typename Map, typename Set>
   D3D9FFShader D3D9FFShaderModuleSet::GetShaderModule(
           D3D9DeviceEx*         pDevice,
-    const D3D9FFShaderKeyFS&    ShaderKey) {
-    // Use the shader's unique key for the lookup
-    auto entry = m_fsModules.find(ShaderKey);
-    if (entry != m_fsModules.end())
-      return entry->second;
-    
-    D3D9FFShader shader(
-      pDevice, ShaderKey);
+    const T&                    ShaderKey,
+          Map&                  Modules,
+          Set&                  Pending) {
+    // Use the shader's unique key for the lookup. If the preload
+    // thread is currently loading the same shader, wait for it
+    // rather than compiling and registering the shader again.
+    { std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+      m_cond.wait(lock, [&Pending, &ShaderKey] {
+        return Pending.find(ShaderKey) == Pending.end();
+      });
+
+      auto entry = Modules.find(ShaderKey);
+      if (entry != Modules.end())
+        return entry->second;
+
+      Pending.insert(ShaderKey);
+    }
 
-    m_fsModules.insert({ShaderKey, shader});
+    PendingShader<T, Map, Set> pending(this, ShaderKey, Modules, Pending);
+
+    // Don't hold the lock while compiling, the preload
+    // thread may add shaders to the set in the meantime.
+    D3D9FFShader shader(
+      pDevice, ShaderKey, m_shaderCache.ptr());
 
+    pending.Complete(&shader);
     return shader;
   }
 
 
+  void D3D9FFShaderModuleSet::PreloadShaders(
+    const Rc<DxvkDevice>&             Device,
+    const D3D9FixedFunctionOptions&   Options) {
+    env::setThreadName("dxvk-ff-cache");
+
+    uint32_t count = 0;
+
+    for (const auto& key : m_shaderCache->getKeys()) {
+      if (m_stopPreload.load())
+        return;
+
+      if (key.type() == VK_SHADER_STAGE_VERTEX_BIT)
+        count += PreloadShader<D3D9FFShaderKeyVS>(Device.ptr(), Options, key, m_vsModules, m_vsPending) ? 1 : 0;
+      else if (key.type() == VK_SHADER_STAGE_FRAGMENT_BIT)
+        count += PreloadShader<D3D9FFShaderKeyFS>(Device.ptr(), Options, key, m_fsModules, m_fsPending) ? 1 : 0;
+    }
+
+    Logger::info(str::format("D3D9: Loaded ", count, " fixed-function shaders from cache"));
+  }
+
+
+  template <typename T, typename Map, typename Set>
+  bool D3D9FFShaderModuleSet::PreloadShader(
+          DxvkDevice*                 pDevice,
+    const D3D9FixedFunctionOptions&   Options,
+    const DxvkShaderKey&              CacheKey,
+          Map&                        Modules,
+          Set&                        Pending) {
+    DxvkShaderCacheEntry entry;
+
+    if (!m_shaderCache->lookup(CacheKey, entry) || !D3D9FFShader::IsValidCacheEntry<T>(entry))
+      return false;
+
+    T key;
+    std::memcpy(&key, entry.data.data(), sizeof(key));
+
+    // The cache may contain shaders generated with different
+    // options, e.g. if the configuration file was changed.
+    if (!D3D9FFShader::GetCacheKey(key, Options).eq(CacheKey))
+      return false;
+
+    // Skip shaders that already exist or that the
+    // application is currently compiling on its own
+    { std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      if (Modules.find(key) != Modules.end()
+       || Pending.find(key) != Pending.end())
+        return false;
+
+      Pending.insert(key);
+    }
+
+    PendingShader<T, Map, Set> pending(this, key, Modules, Pending);
+
+    D3D9FFShader shader(pDevice, key, entry);
+
+    pending.Complete(&shader);
+    return true;
+  }
+
+
   size_t D3D9FFShaderKeyHash::operator () (const D3D9FFShaderKeyVS& key) const {
     DxvkHashState state;
 
@@ -5,10 +5,12 @@
 #include "d3d9_caps.h"
 
 #include "../dxvk/dxvk_shader.h"
+#include "../dxvk/dxvk_shader_cache.h"
 
 #include "../dxso/dxso_isgn.h"
 
 #include <unordered_map>
+#include <unordered_set>
 
 namespace dxvk {
 
@@ -141,6 +143,8 @@ namespace dxvk {
   };
 
   struct D3D9FFShaderKeyVS {
+    static constexpr VkShaderStageFlagBits Stage = VK_SHADER_STAGE_VERTEX_BIT;
+
     D3D9FFShaderKeyVS() {
       // memcmp safety
       std::memset(&Data, 0, sizeof(Data));
@@ -183,6 +187,8 @@ namespace dxvk {
   };
 
   struct D3D9FFShaderKeyFS {
+    static constexpr VkShaderStageFlagBits Stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+
     D3D9FFShaderKeyFS() {
       // memcmp safety
       std::memset(Stages, 0, sizeof(Stages));
@@ -218,11 +224,19 @@ namespace dxvk {
 
     D3D9FFShader(
             D3D9DeviceEx*         pDevice,
-      const D3D9FFShaderKeyVS&    Key);
+      const D3D9FFShaderKeyVS&    Key,
+            DxvkShaderCache*      pShaderCache);
 
     D3D9FFShader(
             D3D9DeviceEx*         pDevice,
-      const D3D9FFShaderKeyFS&    Key);
+      const D3D9FFShaderKeyFS&    Key,
+            DxvkShaderCache*      pShaderCache);
+
+    template <typename T>
+    D3D9FFShader(
+            DxvkDevice*           pDevice,
+      const T&                    Key,
+      const DxvkShaderCacheEntry& Entry);
 
     template <typename T>
     void Dump(D3D9DeviceEx* pDevice, const T& Key, const std::string& Name);
@@ -231,19 +245,80 @@ namespace dxvk {
       return m_shader;
     }
 
+    /**
+     * \brief Computes shader cache key
+     *
+     * Covers the fixed-function key as well as all
+     * options that may affect the generated code.
+     * \param [in] Key Fixed-function shader key
+     * \param [in] Options Fixed-function options
+     * \returns Shader cache key
+     */
+    template <typename T>
+    static DxvkShaderKey GetCacheKey(
+      const T&                        Key,
+      const D3D9FixedFunctionOptions& Options);
+
+    /**
+     * \brief Checks whether a cache entry is valid for a key type
+     *
+     * \param [in] Entry Shader cache entry
+     * \returns \c true if the entry stores a shader for the key type
+     */
+    template <typename T>
+    static bool IsValidCacheEntry(
+      const DxvkShaderCacheEntry&     Entry);
+
   private:
 
     Rc<DxvkShader> m_shader;
 
     DxsoIsgn       m_isgn;
 
+    template <typename T>
+    void Create(
+            D3D9DeviceEx*         pDevice,
+      const T&                    Key,
+            DxvkShaderCache*      pShaderCache);
+
+    template <typename T>
+    void Register(
+            DxvkDevice*           pDevice,
+      const T&                    Key);
+
+    template <typename T>
+    std::vector<uint8_t> GetCacheData(
+      const T&                    Key) const;
+
   };
 
 
+  /**
+   * \brief Fixed-function shader module set
+   *
+   * Generated shaders are stored in a persistent shader
+   * cache. On device creation, all compatible shaders in
+   * that cache are loaded on a background thread, so that
+   * they are available and registered with the state cache
+   * before the application first needs them.
+   */
   class D3D9FFShaderModuleSet : public RcObject {
 
   public:
 
+    D3D9FFShaderModuleSet();
+
+    ~D3D9FFShaderModuleSet();
+
+    /**
+     * \brief Opens the shader cache
+     *
+     * Starts loading cached shaders in the background.
+     * \param [in] pDevice The device
+     */
+    void Initialize(
+            D3D9DeviceEx*         pDevice);
+
     D3D9FFShader GetShaderModule(
             D3D9DeviceEx*         pDevice,
       const D3D9FFShaderKeyVS&    ShaderKey);
@@ -253,15 +328,75 @@ namespace dxvk {
       const D3D9FFShaderKeyFS&    ShaderKey);
 
     UINT GetVSCount() const {
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
       return m_vsModules.size();
     }
 
     UINT GetFSCount() const {
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
       return m_fsModules.size();
     }
 
   private:
 
+    /**
+     * \brief Pending shader
+     *
+     * Removes a key from the set of pending shaders and wakes up
+     * threads waiting for it once the shader is complete, or when
+     * going out of scope if creating the shader throws.
+     */
+    template <typename T, typename Map, typename Set>
+    class PendingShader {
+
+    public:
+
+      PendingShader(
+              D3D9FFShaderModuleSet*  pSet,
+        const T&                      ShaderKey,
+              Map&                    Modules,
+              Set&                    Pending)
+      : m_set(pSet), m_key(ShaderKey), m_modules(Modules), m_pending(Pending) { }
+
+      ~PendingShader() {
+        if (!m_completed)
+          Complete(nullptr);
+      }
+
+      PendingShader             (const PendingShader&) = delete;
+      PendingShader& operator = (const PendingShader&) = delete;
+
+      void Complete(const D3D9FFShader* pShader) {
+        { std::lock_guard<dxvk::mutex> lock(m_set->m_mutex);
+
+          if (pShader)
+            m_modules.insert({ m_key, *pShader });
+
+          m_pending.erase(m_key);
+        }
+
+        m_set->m_cond.notify_all();
+        m_completed = true;
+      }
+
+    private:
+
+      D3D9FFShaderModuleSet*  m_set;
+      const T&                m_key;
+      Map&                    m_modules;
+      Set&                    m_pending;
+      bool                    m_completed = false;
+
+    };
+
+    Rc<DxvkShaderCache> m_shaderCache;
+
+    std::atomic<bool>   m_stopPreload = { false };
+    dxvk::thread        m_preloadThread;
+
+    mutable dxvk::mutex       m_mutex;
+    dxvk::condition_variable  m_cond;
+
     std::unordered_map<
       D3D9FFShaderKeyVS,
       D3D9FFShader,
@@ -272,6 +407,35 @@ namespace dxvk {
       D3D9FFShader,
       D3D9FFShaderKeyHash, D3D9FFShaderKeyEq> m_fsModules;
 
+    // Keys of shaders that are currently being compiled
+    // or loaded, so that no shader is created twice
+    std::unordered_set<
+      D3D9FFShaderKeyVS,
+      D3D9FFShaderKeyHash, D3D9FFShaderKeyEq> m_vsPending;
+
+    std::unordered_set<
+      D3D9FFShaderKeyFS,
+      D3D9FFShaderKeyHash, D3D9FFShaderKeyEq> m_fsPending;
+
+    template <typename T, typename Map, typename Set>
+    D3D9FFShader GetShaderModule(
+            D3D9DeviceEx*         pDevice,
+      const T&                    ShaderKey,
+            Map&                  Modules,
+            Set&                  Pending);
+
+    void PreloadShaders(
+      const Rc<DxvkDevice>&             Device,
+      const D3D9FixedFunctionOptions&   Options);
+
+    template <typename T, typename Map, typename Set>
+    bool PreloadShader(
+            DxvkDevice*                 pDevice,
+      const D3D9FixedFunctionOptions&   Options,
+      const DxvkShaderKey&              CacheKey,
+            Map&                        Modules,
+            Set&                        Pending);
+
   };
 
 
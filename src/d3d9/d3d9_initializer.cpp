@@ -9,7 +9,8 @@ namespace dxvk {
     D3D9DeviceEx*             pParent)
   : m_parent(pParent),
     m_device(pParent->GetDXVKDevice()),
-    m_csChunk(m_parent->AllocCsChunk()) {
+    m_csAllocator(pParent->GetCsChunkPool(), DxvkCsChunkFlag::SingleUse),
+    m_csChunk(m_csAllocator.allocChunk()) {
 
   }
 
@@ -183,8 +184,10 @@ namespace dxvk {
 
 
   void D3D9Initializer::FlushCsChunkLocked() {
+    m_csAllocator.trackChunk(m_csChunk);
+
     m_parent->InjectCsChunk(std::move(m_csChunk), false);
-    m_csChunk = m_parent->AllocCsChunk();
+    m_csChunk = m_csAllocator.allocChunk();
   }
 
 }
@@ -54,6 +54,15 @@ namespace dxvk {
     const D3D9ConstantLayout& constantLayout = ShaderStage == VK_SHADER_STAGE_VERTEX_BIT
       ? pDevice->GetVertexConstantLayout()
       : pDevice->GetPixelConstantLayout();
+
+    // Measure translation time if requested
+    DxvkShaderLog* shaderLog = pDevice->GetDXVKDevice()->getShaderLog();
+
+    high_resolution_clock::time_point t0;
+
+    if (unlikely(shaderLog))
+      t0 = high_resolution_clock::now();
+
     m_shader       = pModule->compile(*pDxsoModuleInfo, name, AnalysisInfo, constantLayout);
     m_isgn         = pModule->isgn();
     m_usedSamplers = pModule->usedSamplers();
@@ -74,6 +83,9 @@ namespace dxvk {
 
     m_shader->setShaderKey(Key);
 
+    if (unlikely(shaderLog))
+      shaderLog->logShader(m_shader, bytecodeLength, high_resolution_clock::now() - t0);
+
     if (dumpPath.size() != 0) {
       std::ofstream dumpStream(
         str::topath(str::format(dumpPath, "/", name, ".spv").c_str()).c_str(),
@@ -927,6 +927,9 @@ namespace dxvk {
     if (m_renderLatencyHud)
       m_renderLatencyHud->updateLatencyTracker(m_latencyTracker);
 
+    if (m_latencyHistogramHud)
+      m_latencyHistogramHud->updateLatencyTracker(m_latencyTracker);
+
     // Rotate swap chain buffers so that the back
     // buffer at index 0 becomes the front buffer.
     uint32_t rotatingBufferCount = m_backBuffers.size();
@@ -1078,6 +1081,7 @@ namespace dxvk {
         if (framePacer) {
           int32_t fpsItemPos = hud->getItemPos<hud::HudFpsItem>();
           m_renderLatencyHud = hud->addItem<hud::HudRenderLatencyItem>("renderlatency", fpsItemPos+1);
+          m_latencyHistogramHud = hud->addItem<hud::HudLatencyHistogramItem>("latencyhistogram", -1);
         }
       }
 
@@ -186,6 +186,7 @@ namespace dxvk {
     Rc<hud::HudClientApiItem>     m_apiHud;
     Rc<hud::HudLatencyItem>       m_latencyHud;
     Rc<hud::HudRenderLatencyItem> m_renderLatencyHud;
+    Rc<hud::HudLatencyHistogramItem> m_latencyHistogramHud;
 
     std::optional<VkHdrMetadataEXT> m_hdrMetadata;
     bool m_unlockAdditionalFormats = false;
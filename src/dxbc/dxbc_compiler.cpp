@@ -258,7 +258,12 @@ namespace dxvk {
         info.xfbStrides[i] = m_moduleInfo.xfb->strides[i];
     }
 
-    return new DxvkShader(info, m_module.compile());
+    SpirvCodeBuffer code = m_module.compile();
+
+    if (m_moduleInfo.options.optimizeSpirv)
+      code = SpirvOptimizer(std::move(code)).optimize();
+
+    return new DxvkShader(info, std::move(code));
   }
   
   
@@ -40,6 +40,7 @@ namespace dxvk {
     forceSampleRateShading   = options.forceSampleRateShading;
     enableSampleShadingInterlock = device->features().extFragmentShaderInterlock.fragmentShaderSampleInterlock;
     supportsTightIcbPacking  = device->features().vk12.uniformBufferStandardLayout;
+    optimizeSpirv            = device->config().optimizeSpirv;
 
     // Qcom just breaks for no reason if we export point size,
     // even in an environment where doing so is required.
@@ -60,6 +60,9 @@ namespace dxvk {
     /// Whether exporting point size is required
     bool needsPointSizeExport = true;
 
+    /// Run SPIR-V optimization passes
+    bool optimizeSpirv = false;
+
     /// Float control flags
     DxbcFloatControlFlags floatControl;
 
@@ -235,7 +235,12 @@ namespace dxvk {
     if (m_programInfo.type() == DxsoProgramTypes::PixelShader)
       info.flatShadingInputs = m_ps.flatShadingMask;
 
-    return new DxvkShader(info, m_module.compile());
+    SpirvCodeBuffer code = m_module.compile();
+
+    if (m_moduleInfo.options.optimizeSpirv)
+      code = SpirvOptimizer(std::move(code)).optimize();
+
+    return new DxvkShader(info, std::move(code));
   }
 
   void DxsoCompiler::emitInit() {
@@ -9,6 +9,7 @@
 #include "../d3d9/d3d9_constant_layout.h"
 #include "../d3d9/d3d9_spec_constants.h"
 #include "../spirv/spirv_module.h"
+#include "../spirv/spirv_optimizer.h"
 
 namespace dxvk {
 
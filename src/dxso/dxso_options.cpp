@@ -30,6 +30,8 @@ namespace dxvk {
     robustness2Supported = devFeatures.extRobustness2.robustBufferAccess2;
 
     drefScaling         = options.drefScaling;
+
+    optimizeSpirv       = device->config().optimizeSpirv;
   }
 
 }
\ No newline at end of file
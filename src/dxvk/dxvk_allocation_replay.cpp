@@ -0,0 +1,720 @@
+#include <algorithm>
+#include <cstring>
+
+#include "dxvk_allocation_replay.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Fake memory backend for allocation replays
+   *
+   * Provides the memory properties stored in a trace, as well as a
+   * minimal set of Vulkan device functions that hand out fake handles
+   * and only track the amount of memory allocated per heap. Memory
+   * allocations fail once the heap is full.
+   */
+  class DxvkAllocationReplayBackend : public DxvkMemoryBackend {
+
+  public:
+
+    DxvkAllocationReplayBackend(
+      const DxvkAllocationTraceHeader&      header,
+      const DxvkOptions&                    options);
+
+    ~DxvkAllocationReplayBackend();
+
+    /// Address returned for mapped memory. Nothing ever reads
+    /// or writes mapped memory, so this is never dereferenced.
+    static constexpr uintptr_t FakeMapAddress = uintptr_t(1u) << (sizeof(uintptr_t) * 8u - 4u);
+
+    DxvkDevice* device() const override {
+      return nullptr;
+    }
+
+    Rc<vk::DeviceFn> vkd() const override {
+      return m_vkd;
+    }
+
+    const DxvkDeviceFeatures& features() const override {
+      return m_features;
+    }
+
+    const DxvkDeviceInfo& properties() const override {
+      return m_properties;
+    }
+
+    const DxvkOptions& config() const override {
+      return m_options;
+    }
+
+    DxvkDebugFlags debugFlags() const override {
+      return DxvkDebugFlags();
+    }
+
+    DxvkSharingModeInfo getSharingMode() const override {
+      return DxvkSharingModeInfo();
+    }
+
+    VkPhysicalDeviceMemoryProperties memoryProperties() const override {
+      return m_memoryProperties;
+    }
+
+    DxvkAdapterMemoryInfo getMemoryHeapInfo() const override;
+
+    void getMemoryBudget(
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT& budget) const override;
+
+    bool matchesDriver(
+            VkDriverIdKHR       driver) const override {
+      return false;
+    }
+
+    void notifyMemoryStats(
+            uint32_t            heap,
+            int64_t             allocated,
+            int64_t             used) override {
+
+    }
+
+    high_resolution_clock::time_point now() const override {
+      return m_time;
+    }
+
+    /**
+     * \brief Sets current time
+     * \param [in] time Current trace time
+     */
+    void setTime(high_resolution_clock::time_point time) {
+      m_time = time;
+    }
+
+    /**
+     * \brief Queries total amount of memory allocated
+     * \returns Allocated memory across all heaps
+     */
+    VkDeviceSize getAllocatedMemory() const;
+
+    /**
+     * \brief Queries number of memory objects allocated
+     * \returns Total number of allocated memory objects
+     */
+    uint64_t getMemoryObjectsAllocated() const {
+      return m_memoryObjectsAllocated;
+    }
+
+    /**
+     * \brief Queries number of memory objects freed
+     * \returns Total number of freed memory objects
+     */
+    uint64_t getMemoryObjectsFreed() const {
+      return m_memoryObjectsFreed;
+    }
+
+  private:
+
+    struct Memory {
+      uint32_t      heapIndex = 0u;
+      VkDeviceSize  size      = 0u;
+    };
+
+    Rc<vk::DeviceFn>                  m_vkd;
+
+    DxvkDeviceFeatures                m_features = { };
+    DxvkDeviceInfo                    m_properties = { };
+    DxvkOptions                       m_options;
+
+    VkPhysicalDeviceMemoryProperties  m_memoryProperties = { };
+
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heapBudgets = { };
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heapAllocated = { };
+
+    high_resolution_clock::time_point m_time;
+
+    uint64_t                          m_nextHandle = 0u;
+    uint64_t                          m_memoryObjectsAllocated = 0u;
+    uint64_t                          m_memoryObjectsFreed = 0u;
+
+    std::unordered_map<uint64_t, Memory>        m_memory;
+    std::unordered_map<uint64_t, VkDeviceSize>  m_buffers;
+
+    template<typename T>
+    T createHandle() {
+      uint64_t id = ++m_nextHandle;
+
+      T handle = T();
+      std::memcpy(&handle, &id, sizeof(handle));
+      return handle;
+    }
+
+    template<typename T>
+    static uint64_t getHandleId(T handle) {
+      uint64_t id = 0u;
+      std::memcpy(&id, &handle, sizeof(handle));
+      return id;
+    }
+
+    static DxvkAllocationReplayBackend* fromDevice(VkDevice device) {
+      return reinterpret_cast<DxvkAllocationReplayBackend*>(device);
+    }
+
+    static PFN_vkVoidFunction VKAPI_CALL getInstanceProcAddr(
+            VkInstance                    instance,
+      const char*                         name);
+
+    static PFN_vkVoidFunction VKAPI_CALL getDeviceProcAddr(
+            VkDevice                      device,
+      const char*                         name);
+
+    static VkResult VKAPI_CALL allocateMemory(
+            VkDevice                      device,
+      const VkMemoryAllocateInfo*         pAllocateInfo,
+      const VkAllocationCallbacks*        pAllocator,
+            VkDeviceMemory*               pMemory);
+
+    static void VKAPI_CALL freeMemory(
+            VkDevice                      device,
+            VkDeviceMemory                memory,
+      const VkAllocationCallbacks*        pAllocator);
+
+    static VkResult VKAPI_CALL mapMemory(
+            VkDevice                      device,
+            VkDeviceMemory                memory,
+            VkDeviceSize                  offset,
+            VkDeviceSize                  size,
+            VkMemoryMapFlags              flags,
+            void**                        ppData);
+
+    static void VKAPI_CALL unmapMemory(
+            VkDevice                      device,
+            VkDeviceMemory                memory);
+
+    static VkResult VKAPI_CALL createBuffer(
+            VkDevice                      device,
+      const VkBufferCreateInfo*           pCreateInfo,
+      const VkAllocationCallbacks*        pAllocator,
+            VkBuffer*                     pBuffer);
+
+    static void VKAPI_CALL destroyBuffer(
+            VkDevice                      device,
+            VkBuffer                      buffer,
+      const VkAllocationCallbacks*        pAllocator);
+
+    static void VKAPI_CALL getBufferMemoryRequirements2(
+            VkDevice                      device,
+      const VkBufferMemoryRequirementsInfo2* pInfo,
+            VkMemoryRequirements2*        pMemoryRequirements);
+
+    static void VKAPI_CALL getDeviceBufferMemoryRequirements(
+            VkDevice                      device,
+      const VkDeviceBufferMemoryRequirements* pInfo,
+            VkMemoryRequirements2*        pMemoryRequirements);
+
+    static VkResult VKAPI_CALL bindBufferMemory(
+            VkDevice                      device,
+            VkBuffer                      buffer,
+            VkDeviceMemory                memory,
+            VkDeviceSize                  memoryOffset);
+
+    void getBufferRequirements(
+            VkDeviceSize                  size,
+            VkMemoryRequirements2&        requirements) const;
+
+  };
+
+
+  DxvkAllocationReplayBackend::DxvkAllocationReplayBackend(
+    const DxvkAllocationTraceHeader&      header,
+    const DxvkOptions&                    options)
+  : m_options(options), m_time(std::chrono::seconds(1)) {
+    // Nothing ever reads or writes mapped memory
+    m_options.zeroMappedMemory = false;
+
+    // Avoid creating temporary buffers to query memory requirements,
+    // and let the allocator query budgets that we track ourselves.
+    m_features.vk13.maintenance4 = VK_TRUE;
+    m_features.extMemoryBudget = VK_TRUE;
+
+    m_memoryProperties.memoryTypeCount = std::min(header.memoryTypeCount, uint32_t(VK_MAX_MEMORY_TYPES));
+    m_memoryProperties.memoryHeapCount = std::min(header.memoryHeapCount, uint32_t(VK_MAX_MEMORY_HEAPS));
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+      auto& heap = m_memoryProperties.memoryHeaps[i];
+      heap.size = header.memoryHeaps[i].size;
+
+      m_heapBudgets[i] = header.memoryHeaps[i].budget;
+    }
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+      auto& type = m_memoryProperties.memoryTypes[i];
+      type.heapIndex = std::min(header.memoryTypes[i].heapIndex, m_memoryProperties.memoryHeapCount - 1u);
+      type.propertyFlags = header.memoryTypes[i].propertyFlags;
+
+      if (type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        m_memoryProperties.memoryHeaps[type.heapIndex].flags |= VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    // The device handle is never dereferenced, use it to
+    // find the backend from within the device functions.
+    Rc<vk::LibraryLoader> library = new vk::LibraryLoader(&getInstanceProcAddr);
+    Rc<vk::InstanceLoader> instance = new vk::InstanceLoader(library, false, VK_NULL_HANDLE);
+
+    m_vkd = new vk::DeviceFn(instance, false, reinterpret_cast<VkDevice>(this));
+  }
+
+
+  DxvkAllocationReplayBackend::~DxvkAllocationReplayBackend() {
+
+  }
+
+
+  DxvkAdapterMemoryInfo DxvkAllocationReplayBackend::getMemoryHeapInfo() const {
+    DxvkAdapterMemoryInfo info = { };
+    info.heapCount = m_memoryProperties.memoryHeapCount;
+
+    for (uint32_t i = 0; i < info.heapCount; i++) {
+      info.heaps[i].heapFlags = m_memoryProperties.memoryHeaps[i].flags;
+      info.heaps[i].heapSize = m_memoryProperties.memoryHeaps[i].size;
+      info.heaps[i].memoryBudget = m_heapBudgets[i];
+      info.heaps[i].memoryAllocated = m_heapAllocated[i];
+    }
+
+    return info;
+  }
+
+
+  void DxvkAllocationReplayBackend::getMemoryBudget(
+          VkPhysicalDeviceMemoryBudgetPropertiesEXT& budget) const {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+      budget.heapBudget[i] = m_heapBudgets[i];
+      budget.heapUsage[i] = m_heapAllocated[i];
+    }
+  }
+
+
+  VkDeviceSize DxvkAllocationReplayBackend::getAllocatedMemory() const {
+    VkDeviceSize allocated = 0u;
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+      allocated += m_heapAllocated[i];
+
+    return allocated;
+  }
+
+
+  PFN_vkVoidFunction VKAPI_CALL DxvkAllocationReplayBackend::getInstanceProcAddr(
+          VkInstance                    instance,
+    const char*                         name) {
+    if (!std::strcmp(name, "vkGetDeviceProcAddr"))
+      return reinterpret_cast<PFN_vkVoidFunction>(&getDeviceProcAddr);
+
+    return nullptr;
+  }
+
+
+  PFN_vkVoidFunction VKAPI_CALL DxvkAllocationReplayBackend::getDeviceProcAddr(
+          VkDevice                      device,
+    const char*                         name) {
+    static const std::array<std::pair<const char*, PFN_vkVoidFunction>, 9> s_functions = {{
+      { "vkAllocateMemory",                     reinterpret_cast<PFN_vkVoidFunction>(&allocateMemory) },
+      { "vkBindBufferMemory",                   reinterpret_cast<PFN_vkVoidFunction>(&bindBufferMemory) },
+      { "vkCreateBuffer",                       reinterpret_cast<PFN_vkVoidFunction>(&createBuffer) },
+      { "vkDestroyBuffer",                      reinterpret_cast<PFN_vkVoidFunction>(&destroyBuffer) },
+      { "vkFreeMemory",                         reinterpret_cast<PFN_vkVoidFunction>(&freeMemory) },
+      { "vkGetBufferMemoryRequirements2",       reinterpret_cast<PFN_vkVoidFunction>(&getBufferMemoryRequirements2) },
+      { "vkGetDeviceBufferMemoryRequirements",  reinterpret_cast<PFN_vkVoidFunction>(&getDeviceBufferMemoryRequirements) },
+      { "vkMapMemory",                          reinterpret_cast<PFN_vkVoidFunction>(&mapMemory) },
+      { "vkUnmapMemory",                        reinterpret_cast<PFN_vkVoidFunction>(&unmapMemory) },
+    }};
+
+    for (const auto& f : s_functions) {
+      if (!std::strcmp(name, f.first))
+        return f.second;
+    }
+
+    return nullptr;
+  }
+
+
+  VkResult VKAPI_CALL DxvkAllocationReplayBackend::allocateMemory(
+          VkDevice                      device,
+    const VkMemoryAllocateInfo*         pAllocateInfo,
+    const VkAllocationCallbacks*        pAllocator,
+          VkDeviceMemory*               pMemory) {
+    auto backend = fromDevice(device);
+
+    if (pAllocateInfo->memoryTypeIndex >= backend->m_memoryProperties.memoryTypeCount)
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    Memory memory = { };
+    memory.heapIndex = backend->m_memoryProperties.memoryTypes[pAllocateInfo->memoryTypeIndex].heapIndex;
+    memory.size = pAllocateInfo->allocationSize;
+
+    auto& allocated = backend->m_heapAllocated[memory.heapIndex];
+
+    if (allocated + memory.size > backend->m_memoryProperties.memoryHeaps[memory.heapIndex].size)
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    allocated += memory.size;
+
+    *pMemory = backend->createHandle<VkDeviceMemory>();
+    backend->m_memory.insert({ getHandleId(*pMemory), memory });
+    backend->m_memoryObjectsAllocated += 1u;
+    return VK_SUCCESS;
+  }
+
+
+  void VKAPI_CALL DxvkAllocationReplayBackend::freeMemory(
+          VkDevice                      device,
+          VkDeviceMemory                memory,
+    const VkAllocationCallbacks*        pAllocator) {
+    auto backend = fromDevice(device);
+    auto entry = backend->m_memory.find(getHandleId(memory));
+
+    if (entry == backend->m_memory.end())
+      return;
+
+    backend->m_heapAllocated[entry->second.heapIndex] -= entry->second.size;
+    backend->m_memoryObjectsFreed += 1u;
+    backend->m_memory.erase(entry);
+  }
+
+
+  VkResult VKAPI_CALL DxvkAllocationReplayBackend::mapMemory(
+          VkDevice                      device,
+          VkDeviceMemory                memory,
+          VkDeviceSize                  offset,
+          VkDeviceSize                  size,
+          VkMemoryMapFlags              flags,
+          void**                        ppData) {
+    auto backend = fromDevice(device);
+    auto entry = backend->m_memory.find(getHandleId(memory));
+
+    if (entry == backend->m_memory.end())
+      return VK_ERROR_MEMORY_MAP_FAILED;
+
+    // The allocator only needs a non-null pointer to compute
+    // suballocation addresses, so avoid backing it with memory.
+    *ppData = reinterpret_cast<void*>(FakeMapAddress + uintptr_t(offset));
+    return VK_SUCCESS;
+  }
+
+
+  void VKAPI_CALL DxvkAllocationReplayBackend::unmapMemory(
+          VkDevice                      device,
+          VkDeviceMemory                memory) {
+
+  }
+
+
+  VkResult VKAPI_CALL DxvkAllocationReplayBackend::createBuffer(
+          VkDevice                      device,
+    const VkBufferCreateInfo*           pCreateInfo,
+    const VkAllocationCallbacks*        pAllocator,
+          VkBuffer*                     pBuffer) {
+    auto backend = fromDevice(device);
+
+    *pBuffer = backend->createHandle<VkBuffer>();
+    backend->m_buffers.insert({ getHandleId(*pBuffer), pCreateInfo->size });
+    return VK_SUCCESS;
+  }
+
+
+  void VKAPI_CALL DxvkAllocationReplayBackend::destroyBuffer(
+          VkDevice                      device,
+          VkBuffer                      buffer,
+    const VkAllocationCallbacks*        pAllocator) {
+    fromDevice(device)->m_buffers.erase(getHandleId(buffer));
+  }
+
+
+  void VKAPI_CALL DxvkAllocationReplayBackend::getBufferMemoryRequirements2(
+          VkDevice                      device,
+    const VkBufferMemoryRequirementsInfo2* pInfo,
+          VkMemoryRequirements2*        pMemoryRequirements) {
+    auto backend = fromDevice(device);
+    auto entry = backend->m_buffers.find(getHandleId(pInfo->buffer));
+
+    backend->getBufferRequirements(entry != backend->m_buffers.end()
+      ? entry->second : VkDeviceSize(0u), *pMemoryRequirements);
+  }
+
+
+  void VKAPI_CALL DxvkAllocationReplayBackend::getDeviceBufferMemoryRequirements(
+          VkDevice                      device,
+    const VkDeviceBufferMemoryRequirements* pInfo,
+          VkMemoryRequirements2*        pMemoryRequirements) {
+    fromDevice(device)->getBufferRequirements(
+      pInfo->pCreateInfo->size, *pMemoryRequirements);
+  }
+
+
+  VkResult VKAPI_CALL DxvkAllocationReplayBackend::bindBufferMemory(
+          VkDevice                      device,
+          VkBuffer                      buffer,
+          VkDeviceMemory                memory,
+          VkDeviceSize                  memoryOffset) {
+    return VK_SUCCESS;
+  }
+
+
+  void DxvkAllocationReplayBackend::getBufferRequirements(
+          VkDeviceSize                  size,
+          VkMemoryRequirements2&        requirements) const {
+    // Buffers are supported on all memory types
+    requirements.memoryRequirements.size = size;
+    requirements.memoryRequirements.alignment = 256u;
+    requirements.memoryRequirements.memoryTypeBits = uint32_t((uint64_t(1u) << m_memoryProperties.memoryTypeCount) - 1u);
+  }
+
+
+
+
+  DxvkAllocationReplayResource::DxvkAllocationReplayResource(
+          DxvkMemoryAllocator&            allocator,
+    const VkMemoryRequirements&           requirements,
+          VkMemoryPropertyFlags           properties)
+  : m_allocator(&allocator), m_requirements(requirements), m_properties(properties) {
+    m_allocator->registerResource(this);
+  }
+
+
+  DxvkAllocationReplayResource::~DxvkAllocationReplayResource() {
+    m_allocator->unregisterResource(this);
+  }
+
+
+  DxvkAllocationInfo DxvkAllocationReplayResource::getAllocationInfo() const {
+    DxvkAllocationInfo info = { };
+    info.resourceCookie = cookie();
+    info.properties = m_properties;
+    return info;
+  }
+
+
+  DxvkSparsePageTable* DxvkAllocationReplayResource::getSparsePageTable() {
+    return nullptr;
+  }
+
+
+  Rc<DxvkResourceAllocation> DxvkAllocationReplayResource::relocateStorage(
+          DxvkAllocationModes             mode) {
+    DxvkAllocationInfo info = getAllocationInfo();
+    info.mode = mode;
+
+    return m_allocator->allocateMemory(m_requirements, info);
+  }
+
+
+  void DxvkAllocationReplayResource::setDebugName(const char* name) {
+
+  }
+
+
+  const char* DxvkAllocationReplayResource::getDebugName() const {
+    return "";
+  }
+
+
+
+
+  DxvkAllocationReplay::DxvkAllocationReplay(
+    const DxvkAllocationTraceHeader&      header,
+    const DxvkOptions&                    options) {
+    auto backend = std::make_unique<DxvkAllocationReplayBackend>(header, options);
+    m_backend = backend.get();
+
+    m_allocator = std::make_unique<DxvkMemoryAllocator>(std::move(backend));
+
+    // Cached allocations are always host-visible, use one
+    // local cache with and one without device-local memory
+    m_caches[0] = m_allocator->createAllocationCache(0u,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    m_caches[1] = m_allocator->createAllocationCache(0u,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+
+  DxvkAllocationReplay::~DxvkAllocationReplay() {
+    // Release all allocations before the allocator goes away
+    m_resources.clear();
+
+    for (auto& cache : m_caches)
+      cache = DxvkLocalAllocationCache();
+  }
+
+
+  void DxvkAllocationReplay::execute(
+    const DxvkAllocationTraceRecord&      record) {
+    // Weight fragmentation by the time the allocator spent in its current state
+    if (!m_stats.eventCount)
+      m_firstTime = record.timestamp;
+
+    if (record.timestamp > m_time) {
+      m_fragmentationTime += double(record.timestamp - m_time) * m_fragmentation;
+      m_time = record.timestamp;
+    }
+
+    m_stats.eventCount += 1u;
+
+    auto t0 = high_resolution_clock::now();
+
+    m_backend->setTime(high_resolution_clock::time_point(std::chrono::seconds(1))
+      + std::chrono::nanoseconds(m_time));
+
+    // Run the periodic clean-up and defragmentation tasks,
+    // the allocator decides on its own whether they are due.
+    m_allocator->performTimedTasks();
+
+    if (record.event == DxvkAllocationTraceEvent::Submit) {
+      m_stats.submissionCount += 1u;
+
+      relocateResources();
+    } else if (record.event == DxvkAllocationTraceEvent::Free) {
+      m_resources.erase(record.handle);
+    } else if (record.memoryType == 0xffu) {
+      m_stats.traceFailureCount += 1u;
+    } else {
+      VkMemoryRequirements requirements = { };
+      requirements.size = record.size;
+      requirements.alignment = std::max<uint64_t>(record.alignment, 1u);
+      requirements.memoryTypeBits = record.memoryTypeBits;
+
+      VkMemoryPropertyFlags properties = 0u;
+
+      if (record.flags.test(DxvkAllocationTraceFlag::HostVisible))
+        properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+      if (record.flags.test(DxvkAllocationTraceFlag::DeviceLocal))
+        properties |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+      Rc<DxvkAllocationReplayResource> resource = new DxvkAllocationReplayResource(
+        *m_allocator, requirements, properties);
+
+      Rc<DxvkResourceAllocation> storage = allocate(record, *resource);
+
+      if (storage) {
+        resource->assignStorage(std::move(storage));
+
+        m_resources.insert_or_assign(record.handle, std::move(resource));
+        m_stats.allocationCount += 1u;
+      } else {
+        m_stats.replayFailureCount += 1u;
+      }
+    }
+
+    m_stats.allocatorTime += high_resolution_clock::now() - t0;
+
+    updateStats();
+  }
+
+
+  DxvkAllocationReplayStats DxvkAllocationReplay::getStats() const {
+    DxvkAllocationReplayStats stats = m_stats;
+
+    if (m_time > m_firstTime)
+      stats.averageFragmentation = m_fragmentationTime / double(m_time - m_firstTime);
+
+    DxvkDefragStats defragStats = m_allocator->getDefragStats();
+    stats.relocatedCount = defragStats.relocatedCount;
+    stats.relocatedBytes = defragStats.relocatedBytes;
+
+    DxvkSharedAllocationCacheStats cacheStats = m_allocator->getAllocationCacheStats();
+    stats.cacheRequestCount = cacheStats.requestCount;
+    stats.cacheMissCount = cacheStats.missCount;
+
+    stats.memoryObjectsAllocated = m_backend->getMemoryObjectsAllocated();
+    stats.memoryObjectsFreed = m_backend->getMemoryObjectsFreed();
+    return stats;
+  }
+
+
+  Rc<DxvkResourceAllocation> DxvkAllocationReplay::allocate(
+    const DxvkAllocationTraceRecord&      record,
+          DxvkAllocationReplayResource&   resource) {
+    DxvkAllocationInfo allocationInfo = resource.getAllocationInfo();
+
+    if (record.flags.test(DxvkAllocationTraceFlag::NoAllocation))
+      allocationInfo.mode.set(DxvkAllocationMode::NoAllocation);
+
+    switch (record.event) {
+      case DxvkAllocationTraceEvent::Allocate:
+        return m_allocator->allocateMemory(resource.getMemoryRequirements(), allocationInfo);
+
+      case DxvkAllocationTraceEvent::AllocateDedicated: {
+        VkMemoryDedicatedAllocateInfo dedicatedInfo = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+        return m_allocator->allocateDedicatedMemory(resource.getMemoryRequirements(), allocationInfo, &dedicatedInfo);
+      }
+
+      case DxvkAllocationTraceEvent::AllocateCached: {
+        // Goes through the local and shared allocation caches
+        uint32_t cacheIndex = record.flags.test(DxvkAllocationTraceFlag::DeviceLocal) ? 1u : 0u;
+
+        VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufferInfo.size = record.size;
+
+        return m_allocator->createBufferResource(bufferInfo, allocationInfo, &m_caches[cacheIndex]);
+      }
+
+      case DxvkAllocationTraceEvent::Free:
+      case DxvkAllocationTraceEvent::Submit:
+        break;
+    }
+
+    return nullptr;
+  }
+
+
+  void DxvkAllocationReplay::relocateResources() {
+    // Matches the per-submission limit used by contexts
+    constexpr static uint32_t MaxRelocationsPerSubmission = 128u;
+
+    auto resourceList = m_allocator->pollRelocationList(MaxRelocationsPerSubmission);
+
+    if (resourceList.empty())
+      return;
+
+    auto t0 = high_resolution_clock::now();
+
+    VkDeviceSize relocatedSize = 0u;
+    uint32_t relocatedCount = 0u;
+
+    for (const auto& e : resourceList) {
+      auto storage = e.resource->relocateStorage(e.mode);
+
+      if (!storage)
+        continue;
+
+      relocatedSize += storage->getMemoryInfo().size;
+      relocatedCount += 1u;
+
+      // All resources in the list were created by this replay. The old
+      // storage is released here, which is when the copy would complete.
+      static_cast<DxvkAllocationReplayResource*>(e.resource.ptr())->assignStorage(std::move(storage));
+    }
+
+    m_allocator->notifyRelocation(relocatedSize, relocatedCount,
+      high_resolution_clock::now() - t0);
+  }
+
+
+  void DxvkAllocationReplay::updateStats() {
+    VkDeviceSize committed = m_backend->getAllocatedMemory();
+    VkDeviceSize used = 0u;
+
+    for (uint32_t i = 0; i < m_backend->memoryProperties().memoryHeapCount; i++)
+      used += m_allocator->getMemoryStats(i).memoryUsed;
+
+    used = std::min(used, committed);
+
+    m_fragmentation = committed
+      ? double(committed - used) / double(committed)
+      : 0.0;
+
+    if (committed > m_stats.peakCommitted) {
+      m_stats.peakCommitted = committed;
+      m_stats.peakUsed = used;
+      m_stats.peakFragmentation = m_fragmentation;
+    }
+  }
+
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+
+#include "dxvk_allocation_trace.h"
+#include "dxvk_memory.h"
+#include "dxvk_sparse.h"
+
+namespace dxvk {
+
+  class DxvkAllocationReplayBackend;
+
+  /**
+   * \brief Allocation replay statistics
+   */
+  struct DxvkAllocationReplayStats {
+    /// Number of records in the trace
+    uint64_t eventCount           = 0u;
+    /// Number of context submissions in the trace
+    uint64_t submissionCount      = 0u;
+    /// Number of replayed allocations
+    uint64_t allocationCount      = 0u;
+    /// Number of allocations that failed in the trace
+    uint64_t traceFailureCount    = 0u;
+    /// Number of allocations that failed during replay
+    uint64_t replayFailureCount   = 0u;
+    /// Number of Vulkan memory objects allocated and freed
+    uint64_t memoryObjectsAllocated = 0u;
+    uint64_t memoryObjectsFreed   = 0u;
+    /// Peak amount of device memory allocated
+    uint64_t peakCommitted        = 0u;
+    /// Amount of memory used by resources at peak
+    uint64_t peakUsed             = 0u;
+    /// Fraction of allocated memory not used by
+    /// any resource at the point of peak usage
+    double   peakFragmentation    = 0.0;
+    /// Average fraction of allocated memory not used
+    /// by any resource, weighted by trace time
+    double   averageFragmentation = 0.0;
+    /// Number of resources and bytes relocated by defragmentation
+    uint64_t relocatedCount       = 0u;
+    uint64_t relocatedBytes       = 0u;
+    /// Shared allocation cache requests and misses
+    uint64_t cacheRequestCount    = 0u;
+    uint64_t cacheMissCount       = 0u;
+    /// Time spent in the memory allocator
+    high_resolution_clock::duration allocatorTime = { };
+  };
+
+
+  /**
+   * \brief Replayed resource
+   *
+   * Paged resource that owns a single allocation, so that the
+   * allocator can find it by its cookie and queue it up for
+   * relocation like any buffer or image.
+   */
+  class DxvkAllocationReplayResource : public DxvkPagedResource {
+
+  public:
+
+    DxvkAllocationReplayResource(
+            DxvkMemoryAllocator&            allocator,
+      const VkMemoryRequirements&           requirements,
+            VkMemoryPropertyFlags           properties);
+
+    ~DxvkAllocationReplayResource();
+
+    /**
+     * \brief Allocation info for this resource
+     * \returns Allocation info
+     */
+    DxvkAllocationInfo getAllocationInfo() const;
+
+    /**
+     * \brief Memory requirements
+     * \returns Memory requirements
+     */
+    const VkMemoryRequirements& getMemoryRequirements() const {
+      return m_requirements;
+    }
+
+    /**
+     * \brief Assigns backing storage
+     *
+     * \param [in] storage New backing storage
+     * \returns Previous backing storage
+     */
+    Rc<DxvkResourceAllocation> assignStorage(
+            Rc<DxvkResourceAllocation>&&    storage) {
+      return std::exchange(m_storage, std::move(storage));
+    }
+
+    DxvkSparsePageTable* getSparsePageTable() override;
+
+    Rc<DxvkResourceAllocation> relocateStorage(
+            DxvkAllocationModes             mode) override;
+
+    void setDebugName(const char* name) override;
+
+    const char* getDebugName() const override;
+
+  private:
+
+    DxvkMemoryAllocator*        m_allocator;
+    VkMemoryRequirements        m_requirements;
+    VkMemoryPropertyFlags       m_properties;
+
+    Rc<DxvkResourceAllocation>  m_storage;
+
+  };
+
+
+  /**
+   * \brief Allocation replay
+   *
+   * Replays an allocation trace against the memory allocator, running
+   * on top of a fake Vulkan device that only accounts for the amount
+   * of memory allocated per heap. Memory types and heaps are taken
+   * from the trace, and time-based policies follow trace time.
+   *
+   * Resources queued up for defragmentation are relocated at the
+   * submission markers in the trace, which is where contexts would
+   * relocate them. Not thread-safe, records must be replayed in order.
+   */
+  class DxvkAllocationReplay {
+
+  public:
+
+    DxvkAllocationReplay(
+      const DxvkAllocationTraceHeader&      header,
+      const DxvkOptions&                    options);
+
+    ~DxvkAllocationReplay();
+
+    /**
+     * \brief Replays a single record
+     *
+     * Frees of unknown handles are ignored, as are allocations
+     * that failed in the trace, since the trace will contain the
+     * allocation that was performed as a fallback.
+     * \param [in] record Allocation record
+     */
+    void execute(
+      const DxvkAllocationTraceRecord&      record);
+
+    /**
+     * \brief Queries replay statistics
+     * \returns Statistics for all records replayed so far
+     */
+    DxvkAllocationReplayStats getStats() const;
+
+  private:
+
+    DxvkAllocationReplayBackend*          m_backend = nullptr;
+    std::unique_ptr<DxvkMemoryAllocator>  m_allocator;
+
+    std::array<DxvkLocalAllocationCache, 2> m_caches;
+
+    std::unordered_map<uint64_t, Rc<DxvkAllocationReplayResource>> m_resources;
+
+    uint64_t                      m_time          = 0u;
+    uint64_t                      m_firstTime     = 0u;
+
+    double                        m_fragmentationTime = 0.0;
+    double                        m_fragmentation = 0.0;
+
+    DxvkAllocationReplayStats     m_stats;
+
+    Rc<DxvkResourceAllocation> allocate(
+      const DxvkAllocationTraceRecord&      record,
+            DxvkAllocationReplayResource&   resource);
+
+    void relocateResources();
+
+    void updateStats();
+
+  };
+
+}
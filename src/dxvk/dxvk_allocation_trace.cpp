@@ -0,0 +1,89 @@
+#include <atomic>
+#include <cstring>
+
+#include "dxvk_allocation_trace.h"
+
+namespace dxvk {
+
+  DxvkAllocationTrace::DxvkAllocationTrace(
+    const std::string&                    path,
+    const DxvkAllocationTraceHeader&      header)
+  : m_startTime(high_resolution_clock::now()) {
+    m_file = std::ofstream(str::topath(path.c_str()).c_str(),
+      std::ios_base::binary | std::ios_base::trunc);
+
+    if (!m_file) {
+      Logger::err(str::format("Allocation trace: Failed to open ", path));
+      return;
+    }
+
+    DxvkAllocationTraceHeader fileHeader = header;
+    fileHeader.recordSize = sizeof(DxvkAllocationTraceRecord);
+
+    m_file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+  }
+
+
+  DxvkAllocationTrace::~DxvkAllocationTrace() {
+    if (m_file)
+      Logger::info(str::format("Allocation trace: Recorded ", m_recordCount, " events"));
+  }
+
+
+  void DxvkAllocationTrace::record(
+          DxvkAllocationTraceRecord       record) {
+    std::lock_guard lock(m_mutex);
+
+    // Take the timestamp while holding the lock so
+    // that records are written in timestamp order
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      high_resolution_clock::now() - m_startTime).count();
+
+    m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_recordCount += 1u;
+  }
+
+
+  bool DxvkAllocationTrace::read(
+    const std::string&                    path,
+          DxvkAllocationTraceHeader&      header,
+          std::vector<DxvkAllocationTraceRecord>& records) {
+    std::ifstream in(str::topath(path.c_str()).c_str(), std::ios_base::binary);
+
+    DxvkAllocationTraceHeader expected;
+
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version != expected.version
+     || header.recordSize != sizeof(DxvkAllocationTraceRecord)
+     || !header.memoryHeapCount) {
+      Logger::err(str::format("Allocation trace: Invalid trace file ", path));
+      return false;
+    }
+
+    DxvkAllocationTraceRecord record;
+
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+      records.push_back(record);
+
+    return true;
+  }
+
+
+  std::unique_ptr<DxvkAllocationTrace> DxvkAllocationTrace::createFromEnv(
+    const DxvkAllocationTraceHeader&      header) {
+    static std::atomic<uint32_t> s_traceCount = { 0u };
+
+    std::string path = env::getEnvVar("DXVK_ALLOCATION_TRACE");
+
+    if (path.empty())
+      return nullptr;
+
+    // Each device has its own allocator, give them distinct files
+    path = env::getIndexedFilePath(path, s_traceCount++);
+
+    Logger::info(str::format("Allocation trace: ", path));
+    return std::make_unique<DxvkAllocationTrace>(path, header);
+  }
+
+}
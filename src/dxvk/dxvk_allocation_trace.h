@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dxvk_include.h"
+
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Allocation trace event
+   */
+  enum class DxvkAllocationTraceEvent : uint8_t {
+    /// Regular allocation, may be suballocated or dedicated
+    Allocate          = 0,
+    /// Allocation that requires dedicated memory
+    AllocateDedicated = 1,
+    /// Buffer allocation served from a local allocation cache
+    AllocateCached    = 2,
+    /// Allocation freed
+    Free              = 3,
+    /// Context submission, which is when queued
+    /// resources get relocated by defragmentation
+    Submit            = 4,
+  };
+
+
+  /**
+   * \brief Allocation trace flags
+   */
+  enum class DxvkAllocationTraceFlag : uint32_t {
+    /// Allocation requested host-visible memory
+    HostVisible       = 0,
+    /// Allocation requested device-local memory
+    DeviceLocal       = 1,
+    /// Allocation owns its device memory
+    Dedicated         = 2,
+    /// Allocation must not create new device memory
+    NoAllocation      = 3,
+
+    eFlagEnum
+  };
+
+  using DxvkAllocationTraceFlags = Flags<DxvkAllocationTraceFlag>;
+
+
+  /**
+   * \brief Allocation trace memory type
+   *
+   * Stores the properties of a memory type as well as the
+   * chunk sizes the allocator used for that memory type.
+   */
+  struct DxvkAllocationTraceMemoryType {
+    uint32_t heapIndex            = 0u;
+    uint32_t propertyFlags        = 0u;
+    uint64_t deviceMaxChunkSize   = 0u;
+    uint64_t mappedMaxChunkSize   = 0u;
+    uint64_t mappedNextChunkSize  = 0u;
+  };
+
+
+  /**
+   * \brief Allocation trace memory heap
+   */
+  struct DxvkAllocationTraceMemoryHeap {
+    uint64_t size                 = 0u;
+    uint64_t budget               = 0u;
+  };
+
+
+  /**
+   * \brief Allocation trace file header
+   *
+   * Trace files consist of this header followed by
+   * tightly packed, fixed-size allocation records.
+   */
+  struct DxvkAllocationTraceHeader {
+    constexpr static uint32_t MaxMemoryTypes = 32u;
+    constexpr static uint32_t MaxMemoryHeaps = 16u;
+
+    char     magic[8]             = { 'D', 'X', 'V', 'K', 'M', 'E', 'M', '\0' };
+    uint32_t version              = 2;
+    uint32_t recordSize           = 0;
+    uint32_t memoryTypeCount      = 0;
+    uint32_t memoryHeapCount      = 0;
+    uint64_t minChunkSize         = 0;
+    std::array<DxvkAllocationTraceMemoryType, MaxMemoryTypes> memoryTypes = { };
+    std::array<DxvkAllocationTraceMemoryHeap, MaxMemoryHeaps> memoryHeaps = { };
+  };
+
+
+  /**
+   * \brief Allocation trace record
+   *
+   * The handle uniquely identifies an allocation while it is
+   * alive, and is used to match allocations to their frees.
+   * Failed allocations use a memory type index of \c 0xff.
+   */
+  struct DxvkAllocationTraceRecord {
+    DxvkAllocationTraceEvent  event;
+    uint8_t                   memoryType;
+    uint16_t                  reserved0;
+    DxvkAllocationTraceFlags  flags;
+    uint32_t                  memoryTypeBits;
+    uint32_t                  reserved1;
+    uint64_t                  timestamp;
+    uint64_t                  handle;
+    uint64_t                  size;
+    uint64_t                  alignment;
+  };
+
+
+  /**
+   * \brief Allocation trace
+   *
+   * Records every allocation and free performed by the memory
+   * allocator, along with its memory requirements, as well as
+   * context submissions to a binary trace file. Traces can be
+   * replayed against the memory allocator without a Vulkan
+   * device in order to tune chunk sizes and allocation policies,
+   * see \ref DxvkAllocationReplay.
+   *
+   * Enabled by setting \c DXVK_ALLOCATION_TRACE to a file path.
+   */
+  class DxvkAllocationTrace {
+
+  public:
+
+    DxvkAllocationTrace(
+      const std::string&                    path,
+      const DxvkAllocationTraceHeader&      header);
+
+    ~DxvkAllocationTrace();
+
+    /**
+     * \brief Records an event
+     *
+     * Sets the timestamp and writes the record to the file.
+     * \param [in] record Allocation record
+     */
+    void record(
+            DxvkAllocationTraceRecord       record);
+
+    /**
+     * \brief Reads an allocation trace
+     *
+     * \param [in] path Trace file
+     * \param [out] header Trace file header
+     * \param [out] records All records in the trace
+     * \returns \c true on success
+     */
+    static bool read(
+      const std::string&                    path,
+            DxvkAllocationTraceHeader&      header,
+            std::vector<DxvkAllocationTraceRecord>& records);
+
+    /**
+     * \brief Creates allocation trace
+     *
+     * \param [in] header Memory properties of the device
+     * \returns Allocation trace if enabled, or \c nullptr
+     */
+    static std::unique_ptr<DxvkAllocationTrace> createFromEnv(
+      const DxvkAllocationTraceHeader&      header);
+
+  private:
+
+    dxvk::mutex                       m_mutex;
+    std::ofstream                     m_file;
+
+    high_resolution_clock::time_point m_startTime;
+    uint64_t                          m_recordCount = 0u;
+
+  };
+
+}
@@ -9,7 +9,7 @@
 namespace dxvk {
 
   DxvkPageAllocator::DxvkPageAllocator() {
-
+    m_bins.fill(-1);
   }
 
 
@@ -27,60 +27,26 @@ namespace dxvk {
 
 
   int32_t DxvkPageAllocator::allocPages(uint32_t count, uint32_t alignment) {
-    int32_t index = searchFreeList(count);
-
-    while (index--) {
-      PageRange entry = m_freeList[index];
-
-      // The chunk index is the same regardless of alignment.
-      // Skip chunk if it does not accept new allocations.
-      uint32_t chunkIndex = entry.index >> ChunkPageBits;
-
-      if (unlikely(m_chunks[chunkIndex].disabled))
-        continue;
-
-      if (likely(!(entry.index & (alignment - 1u)))) {
-        // If the current free range is sufficiently aligned, we can use
-        // it as-is and simply modify the remaining free list entry.
-        uint32_t pageIndex = entry.index;
-
-        entry.index += count;
-        entry.count -= count;
-
-        insertFreeRange(entry, index);
-
-        m_chunks[chunkIndex].pagesUsed += count;
-        return pageIndex;
-      } else {
-        // Apply alignment and skip if the free range is too small.
-        uint32_t pageIndex = align(entry.index, alignment);
-
-        if (pageIndex + count > entry.index + entry.count)
-          continue;
-
-        // Insert free range before the first allocated page,
-        // guaranteed to be non-empty at this point.
-        PageRange prevRange = { };
-        prevRange.index = entry.index;
-        prevRange.count = pageIndex - entry.index;
+    uint32_t pageIndex = 0u;
+    int32_t rangeIndex = findFreeRange(count, alignment, pageIndex);
 
-        insertFreeRange(prevRange, index);
+    if (unlikely(rangeIndex < 0))
+      return -1;
 
-        // Insert free range after the last allocated page.
-        PageRange nextRange = { };
-        nextRange.index = pageIndex + count;
-        nextRange.count = entry.index + entry.count - nextRange.index;
+    PageRange range = m_freeRanges[rangeIndex];
+    removeFreeRange(rangeIndex);
 
-        if (nextRange.count)
-          insertFreeRange(nextRange, -1);
+    // Insert free ranges before the first and after
+    // the last allocated page, if they are non-empty.
+    if (pageIndex > range.index)
+      addFreeRange(range.index, pageIndex - range.index);
 
-        m_chunks[chunkIndex].pagesUsed += count;
+    if (pageIndex + count < range.index + range.count)
+      addFreeRange(pageIndex + count, range.index + range.count - pageIndex - count);
 
-        return pageIndex;
-      }
-    }
-
-    return -1;    
+    uint32_t chunkIndex = pageIndex >> ChunkPageBits;
+    m_chunks[chunkIndex].pagesUsed += count;
+    return int32_t(pageIndex);
   }
 
 
@@ -104,49 +70,21 @@ namespace dxvk {
     if ((index + count) & ChunkPageMask)
       nextRange = m_freeListLutByPage[index + count];
 
-    if (prevRange < 0) {
-      if (nextRange < 0) {
-        // No adjacent range, need to insert a new one
-        PageRange range = { };
-        range.index = index;
-        range.count = count;
-
-        insertFreeRange(range, -1);
-      } else {
-        // One adjacent range after the current one
-        PageRange range = m_freeList[nextRange];
-        range.index = index;
-        range.count += count;
+    uint32_t first = index;
+    uint32_t last = index + count;
 
-        insertFreeRange(range, nextRange);
-      }
-    } else if (nextRange < 0) {
-        // One adjacent range before the current one
-      PageRange range = m_freeList[prevRange];
-      range.count += count;
+    if (prevRange >= 0) {
+      first = m_freeRanges[prevRange].index;
+      removeFreeRange(prevRange);
+    }
 
-      insertFreeRange(range, prevRange);
-    } else {
-      // Two adjacent ranges, need to merge with both
-      // and replace one while removing the other.
-      PageRange prev = m_freeList[prevRange];
-      PageRange next = m_freeList[nextRange];
-
-      PageRange mergedRange = { };
-      mergedRange.index = prev.index;
-      mergedRange.count = next.index + next.count - prev.index;
-
-      PageRange emptyRange = { };
-
-      // Remove the range at the higher index, then replace the one at the
-      // lower index with the merged range. The order is important here since
-      // having overlapping entries in the free list would cause issues for
-      // the look-up table, and using the correct indices is important since
-      // the index for the second operation could otherwise be invalidated.
-      insertFreeRange(emptyRange, std::max(prevRange, nextRange));
-      insertFreeRange(mergedRange, std::min(prevRange, nextRange));
+    if (nextRange >= 0) {
+      last = m_freeRanges[nextRange].index + m_freeRanges[nextRange].count;
+      removeFreeRange(nextRange);
     }
 
+    addFreeRange(first, last - first);
+
     uint32_t chunkIndex = index >> ChunkPageBits;
     return !(m_chunks[chunkIndex].pagesUsed -= count);
   }
@@ -159,6 +97,7 @@ namespace dxvk {
       chunkIndex = m_chunks.size();
 
       m_freeListLutByPage.resize((chunkIndex + 1u) << ChunkPageBits, -1);
+      m_freeListMasks.resize((chunkIndex + 1u) * MasksPerChunk);
       m_chunks.emplace_back();
     }
 
@@ -170,40 +109,48 @@ namespace dxvk {
     chunk.nextChunk = -1;
     chunk.disabled = false;
 
-    PageRange pageRange = { };
-    pageRange.index = uint32_t(chunkIndex) << ChunkPageBits;
-    pageRange.count = chunk.pageCount;
-
-    insertFreeRange(pageRange, -1);
+    if (chunk.pageCount)
+      addFreeRange(uint32_t(chunkIndex) << ChunkPageBits, chunk.pageCount);
 
     return uint32_t(chunkIndex);
   }
 
 
   void DxvkPageAllocator::removeChunk(uint32_t chunkIndex) {
+    int32_t rangeIndex = m_freeListLutByPage[chunkIndex << ChunkPageBits];
+
+    if (rangeIndex >= 0)
+      removeFreeRange(rangeIndex);
+
     auto& chunk = m_chunks[chunkIndex];
     chunk.pageCount = 0u;
     chunk.pagesUsed = 0u;
     chunk.nextChunk = std::exchange(m_freeChunk, int32_t(chunkIndex));
     chunk.disabled = true;
-
-    uint32_t pageIndex = chunkIndex << ChunkPageBits;
-
-    PageRange pageRange = { };
-    pageRange.index = pageIndex;
-    pageRange.count = 0;
-
-    insertFreeRange(pageRange, m_freeListLutByPage[pageIndex]);
   }
 
 
   void DxvkPageAllocator::killChunk(uint32_t chunkIndex) {
+    if (m_chunks[chunkIndex].disabled)
+      return;
+
+    forEachFreeRange(chunkIndex, [this] (int32_t rangeIndex) {
+      unlinkFreeRange(rangeIndex);
+    });
+
     m_chunks[chunkIndex].disabled = true;
   }
 
 
   void DxvkPageAllocator::reviveChunk(uint32_t chunkIndex) {
+    if (!m_chunks[chunkIndex].disabled)
+      return;
+
     m_chunks[chunkIndex].disabled = false;
+
+    forEachFreeRange(chunkIndex, [this] (int32_t rangeIndex) {
+      linkFreeRange(rangeIndex);
+    });
   }
 
 
@@ -212,7 +159,7 @@ namespace dxvk {
 
     for (uint32_t i = 0; i < m_chunks.size(); i++) {
       if (m_chunks[i].pageCount && m_chunks[i].disabled) {
-        m_chunks[i].disabled = false;
+        reviveChunk(i);
         count += 1u;
       }
     }
@@ -234,12 +181,10 @@ namespace dxvk {
     if (lastCount)
       pageMask[fullCount] = (1u << lastCount) - 1u;
 
-    // Iterate over free list and set all pages included
-    // in the current chunk to 0.
-    for (PageRange range : m_freeList) {
-      if ((range.index >> ChunkPageBits) != chunkIndex)
-        continue;
-
+    // Iterate over free ranges in the chunk and set all
+    // pages included in any of them to 0.
+    forEachFreeRange(chunkIndex, [this, pageMask] (int32_t rangeIndex) {
+      PageRange range = m_freeRanges[rangeIndex];
       range.index &= ChunkPageMask;
 
       uint32_t index = range.index / 32u;
@@ -262,99 +207,199 @@ namespace dxvk {
         if (range.count)
           pageMask[index++] &= ~0u << range.count;
       }
+    });
+  }
+
+
+  int32_t DxvkPageAllocator::findFreeRange(uint32_t count, uint32_t alignment, uint32_t& pageIndex) const {
+    // Any free range in a bin at or above the search bin is large enough
+    // to hold the allocation, so try the smallest such bin first. If the
+    // range is not sufficiently aligned, look for a range that is large
+    // enough to be aligned as necessary.
+    int32_t bin = findBin(computeSearchBinIndex(count));
+
+    if (likely(bin >= 0)) {
+      const auto& range = m_freeRanges[m_bins[bin]];
+      pageIndex = align(range.index, alignment);
+
+      if (likely(pageIndex + count <= range.index + range.count))
+        return m_bins[bin];
     }
+
+    uint32_t maxBin = computeSearchBinIndex(count + alignment - 1u);
+
+    if (alignment > 1u && (bin = findBin(maxBin)) >= 0) {
+      pageIndex = align(m_freeRanges[m_bins[bin]].index, alignment);
+      return m_bins[bin];
+    }
+
+    // Otherwise, check all ranges in bins that may contain suitable
+    // ranges individually. This is slow, but only happens when we
+    // are about to run out of memory anyway.
+    bin = findBin(computeBinIndex(count));
+
+    while (bin >= 0 && uint32_t(bin) < maxBin) {
+      for (int32_t i = m_bins[bin]; i >= 0; i = m_freeRanges[i].next) {
+        const auto& range = m_freeRanges[i];
+        pageIndex = align(range.index, alignment);
+
+        if (pageIndex + count <= range.index + range.count)
+          return i;
+      }
+
+      bin = findBin(bin + 1u);
+    }
+
+    return -1;
   }
 
 
-  int32_t DxvkPageAllocator::searchFreeList(uint32_t count) {
-    // Find the insertion index of a free list entry with the given page count.
-    // All entries with an index lower than but not equal to the return value
-    // will have a page count greater than or equal to count.
-    if (unlikely(m_freeList.empty()))
-      return 0u;
+  int32_t DxvkPageAllocator::findBin(uint32_t minBin) const {
+    if (unlikely(minBin >= BinCount))
+      return -1;
 
-    // Do a binary search, but optimize for the common
-    // case where we request a small page count
-    uint32_t lo = 0u;
-    uint32_t hi = m_freeList.size();
+    uint32_t fl = minBin / SlCount;
+    uint32_t sl = minBin % SlCount;
 
-    if (count <= m_freeList.back().count)
-      return int32_t(hi);
+    uint32_t slMask = m_slMasks[fl] & (~0u << sl);
 
-    while (lo < hi) {
-      uint32_t mid = (lo + hi) / 2u;
+    if (!slMask) {
+      uint32_t flMask = m_flMask & (~0u << (fl + 1u));
 
-      if (count <= m_freeList[mid].count)
-        lo = mid + 1;
-      else
-        hi = mid;
+      if (!flMask)
+        return -1;
+
+      fl = bit::tzcnt(flMask);
+      slMask = m_slMasks[fl];
     }
 
-    return int32_t(lo);
+    return int32_t(fl * SlCount + bit::tzcnt(slMask));
   }
 
 
-  void DxvkPageAllocator::addLutEntry(const PageRange& range, int32_t index) {
-    m_freeListLutByPage[range.index] = index;
-    m_freeListLutByPage[range.index + range.count - 1u] = index;
+  void DxvkPageAllocator::addFreeRange(uint32_t index, uint32_t count) {
+    int32_t rangeIndex = m_freeRange;
+
+    if (rangeIndex < 0) {
+      rangeIndex = int32_t(m_freeRanges.size());
+      m_freeRanges.emplace_back();
+    } else {
+      m_freeRange = m_freeRanges[rangeIndex].next;
+    }
+
+    auto& range = m_freeRanges[rangeIndex];
+    range.index = index;
+    range.count = count;
+    range.prev = -1;
+    range.next = -1;
+
+    m_freeListLutByPage[index] = rangeIndex;
+    m_freeListLutByPage[index + count - 1u] = rangeIndex;
+
+    m_freeListMasks[index / 64u] |= uint64_t(1u) << (index % 64u);
+
+    if (likely(!m_chunks[index >> ChunkPageBits].disabled))
+      linkFreeRange(rangeIndex);
   }
 
 
-  void DxvkPageAllocator::removeLutEntry(const PageRange& range) {
+  void DxvkPageAllocator::removeFreeRange(int32_t rangeIndex) {
+    auto& range = m_freeRanges[rangeIndex];
+
+    if (likely(!m_chunks[range.index >> ChunkPageBits].disabled))
+      unlinkFreeRange(rangeIndex);
+
     m_freeListLutByPage[range.index] = -1;
     m_freeListLutByPage[range.index + range.count - 1u] = -1;
+
+    m_freeListMasks[range.index / 64u] &= ~(uint64_t(1u) << (range.index % 64u));
+
+    range.prev = -1;
+    range.next = std::exchange(m_freeRange, rangeIndex);
   }
 
 
-  void DxvkPageAllocator::insertFreeRange(PageRange newRange, int32_t currentIndex) {
-    size_t count = m_freeList.size();
-    size_t index = size_t(currentIndex);
+  void DxvkPageAllocator::linkFreeRange(int32_t rangeIndex) {
+    auto& range = m_freeRanges[rangeIndex];
+    uint32_t bin = computeBinIndex(range.count);
 
-    if (unlikely(currentIndex < 0)) {
-      m_freeList.emplace_back();
-      index = count++;
-    }
+    range.prev = -1;
+    range.next = std::exchange(m_bins[bin], rangeIndex);
 
-    // Remove old range from the LUT since it gets replaced
-    PageRange oldRange = m_freeList[index];
+    if (range.next >= 0)
+      m_freeRanges[range.next].prev = rangeIndex;
 
-    if (likely(oldRange.count))
-      removeLutEntry(oldRange);
+    m_flMask |= 1u << (bin / SlCount);
+    m_slMasks[bin / SlCount] |= 1u << (bin % SlCount);
+  }
 
-    // Move range within the free list until the proper ordering
-    // is restored again and update LUT entries for all ranges we
-    // move in the process.
-    if (newRange.count < oldRange.count) {
-      while (index + 1u < count) {
-        PageRange next = m_freeList[index + 1u];
 
-        if (newRange.count >= next.count)
-          break;
+  void DxvkPageAllocator::unlinkFreeRange(int32_t rangeIndex) {
+    auto& range = m_freeRanges[rangeIndex];
 
-        addLutEntry(next, index);
-        m_freeList[index++] = next;
-      }
-    } else if (newRange.count > oldRange.count) {
-      while (index) {
-        PageRange prev = m_freeList[index - 1u];
+    if (range.next >= 0)
+      m_freeRanges[range.next].prev = range.prev;
 
-        if (newRange.count <= prev.count)
-          break;
+    if (range.prev >= 0) {
+      m_freeRanges[range.prev].next = range.next;
+    } else {
+      uint32_t bin = computeBinIndex(range.count);
+      m_bins[bin] = range.next;
 
-        addLutEntry(prev, index);
-        m_freeList[index--] = prev;
+      if (range.next < 0) {
+        if (!(m_slMasks[bin / SlCount] &= ~(1u << (bin % SlCount))))
+          m_flMask &= ~(1u << (bin / SlCount));
       }
     }
 
-    if (newRange.count) {
-      m_freeList[index] = newRange;
-      addLutEntry(newRange, index);
-    } else {
-      m_freeList.pop_back();
+    range.prev = -1;
+    range.next = -1;
+  }
+
+
+  template<typename Fn>
+  void DxvkPageAllocator::forEachFreeRange(uint32_t chunkIndex, const Fn& fn) const {
+    for (uint32_t i = 0; i < MasksPerChunk; i++) {
+      uint64_t mask = m_freeListMasks[chunkIndex * MasksPerChunk + i];
+
+      while (mask) {
+        uint32_t pageIndex = (chunkIndex << ChunkPageBits) + i * 64u + bit::tzcnt(mask);
+        fn(m_freeListLutByPage[pageIndex]);
+
+        mask &= mask - 1u;
+      }
     }
   }
 
 
+  uint32_t DxvkPageAllocator::computeBinIndex(uint32_t count) {
+    // Ranges smaller than the number of second-level bins get
+    // their own bin, everything else is divided into evenly
+    // spaced bins between two powers of two.
+    uint32_t log = 31u - bit::lzcnt(count);
+
+    if (log < SlBits)
+      return count;
+
+    uint32_t fl = log - SlBits + 1u;
+    uint32_t sl = (count >> (log - SlBits)) - SlCount;
+
+    return std::min(fl * SlCount + sl, BinCount);
+  }
+
+
+  uint32_t DxvkPageAllocator::computeSearchBinIndex(uint32_t count) {
+    // Round up to the next bin boundary, so that
+    // any range in the resulting bin is large enough
+    uint32_t log = 31u - bit::lzcnt(count);
+
+    if (log >= SlBits)
+      count += (1u << (log - SlBits)) - 1u;
+
+    return computeBinIndex(count);
+  }
+
+
 
   DxvkPoolAllocator::DxvkPoolAllocator(DxvkPageAllocator& pageAllocator)
   : m_pageAllocator(&pageAllocator) {
@@ -13,11 +13,16 @@ namespace dxvk {
   /**
    * \brief Page allocator
    *
-   * Implements a best-fit allocation strategy for coarse allocations
-   * using an ordered free list. While allocating and freeing memory
-   * are both linear in the worst case, minimum-size allocations can
-   * generally be performed in constant time, with larger allocations
-   * getting gradually slower.
+   * Implements a good-fit allocation strategy for coarse allocations
+   * using a two-level segregated free list. Free ranges are sorted
+   * into size classes, and bit masks of non-empty size classes allow
+   * finding a suitable free range in constant time. Only if no size
+   * class is guaranteed to satisfy an allocation will ranges that
+   * may or may not be large enough be checked individually, so that
+   * allocations still succeed whenever any free range is suitable.
+   *
+   * Free ranges of disabled chunks are removed from the size classes,
+   * and are tracked with a bit mask per chunk instead.
    */
   class DxvkPageAllocator {
 
@@ -180,6 +185,20 @@ namespace dxvk {
 
   private:
 
+    /// Number of second-level size classes per power of two. Free ranges
+    /// smaller than this get their own size class.
+    constexpr static uint32_t SlBits = 3u;
+    constexpr static uint32_t SlCount = 1u << SlBits;
+
+    /// Number of first-level size classes. Free ranges can at most
+    /// be as large as a chunk.
+    constexpr static uint32_t FlCount = ChunkPageBits - SlBits + 2u;
+
+    constexpr static uint32_t BinCount = FlCount * SlCount;
+
+    /// Number of 64-bit masks needed to store one bit per page in a chunk
+    constexpr static uint32_t MasksPerChunk = (1u << ChunkPageBits) / 64u;
+
     struct ChunkInfo {
       uint32_t  pageCount = 0u;
       uint32_t  pagesUsed = 0u;
@@ -190,21 +209,41 @@ namespace dxvk {
     struct PageRange {
       uint32_t  index = 0u;
       uint32_t  count = 0u;
+      int32_t   prev  = -1;
+      int32_t   next  = -1;
     };
 
-    std::vector<PageRange>  m_freeList;
+    std::vector<PageRange>  m_freeRanges;
+    int32_t                 m_freeRange = -1;
+
     std::vector<int32_t>    m_freeListLutByPage;
+    std::vector<uint64_t>   m_freeListMasks;
+
+    uint32_t                            m_flMask = 0u;
+    std::array<uint32_t, FlCount>       m_slMasks = { };
+    std::array<int32_t, BinCount>       m_bins;
 
     std::vector<ChunkInfo>  m_chunks;
     int32_t                 m_freeChunk = -1;
 
-    int32_t searchFreeList(uint32_t count);
+    int32_t findFreeRange(uint32_t count, uint32_t alignment, uint32_t& pageIndex) const;
+
+    int32_t findBin(uint32_t minBin) const;
+
+    void addFreeRange(uint32_t index, uint32_t count);
+
+    void removeFreeRange(int32_t rangeIndex);
+
+    void linkFreeRange(int32_t rangeIndex);
+
+    void unlinkFreeRange(int32_t rangeIndex);
 
-    void addLutEntry(const PageRange& range, int32_t index);
+    template<typename Fn>
+    void forEachFreeRange(uint32_t chunkIndex, const Fn& fn) const;
 
-    void removeLutEntry(const PageRange& range);
+    static uint32_t computeBinIndex(uint32_t count);
 
-    void insertFreeRange(PageRange newRange, int32_t currentIndex);
+    static uint32_t computeSearchBinIndex(uint32_t count);
 
   };
 
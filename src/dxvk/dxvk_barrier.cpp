@@ -7,9 +7,7 @@ namespace dxvk {
     // implement and allows us to use 0 as an invalid node index.
     m_nodes.emplace_back();
 
-    // Pre-allocate root nodes for the implicit hash table
-    for (uint32_t i = 0; i < 2u * HashTableSize; i++)
-      allocateNode();
+    m_entries.resize(MinTableSize);
   }
 
 
@@ -21,32 +19,245 @@ namespace dxvk {
   bool DxvkBarrierTracker::findRange(
     const DxvkAddressRange&           range,
           DxvkAccess                  accessType) const {
-    uint32_t rootIndex = computeRootIndex(range, accessType);
-    uint32_t nodeIndex = findNode(range, rootIndex);
+    const Entry* entry = findEntry(computeKey(range, accessType));
 
-    if (likely(!nodeIndex || range.accessOp == DxvkAccessOp::None))
-      return nodeIndex;
+    if (likely(!entry))
+      return false;
+
+    DxvkAddressRange found = { };
+
+    if (likely(!entry->tree)) {
+      uint32_t mask = findInlineRanges(*entry, range);
+
+      if (likely(!mask || range.accessOp == DxvkAccessOp::None))
+        return mask;
+
+      uint32_t index = bit::tzcnt(mask);
+
+      found.resource = range.resource;
+      found.accessOp = entry->accessOps[index];
+      found.rangeStart = entry->rangeStarts[index];
+      found.rangeEnd = entry->rangeEnds[index];
+    } else {
+      uint32_t nodeIndex = findNode(range, entry->tree);
+
+      if (likely(!nodeIndex || range.accessOp == DxvkAccessOp::None))
+        return nodeIndex;
+
+      found = m_nodes[nodeIndex].addressRange;
+    }
 
     // If we are checking for a specific order-invariant store
     // op, the op must have been the only op used to access the
     // resource, and the tracked range must cover the requested
     // range in its entirety so we can rule out that other parts
     // of the resource have been accessed in a different way.
-    const auto& node = m_nodes[nodeIndex];
-
-    if (node.addressRange.accessOp != range.accessOp)
+    if (found.accessOp != range.accessOp)
       return true;
 
-    return !node.addressRange.contains(range);
+    return !found.contains(range);
   }
 
 
   void DxvkBarrierTracker::insertRange(
     const DxvkAddressRange&           range,
           DxvkAccess                  accessType) {
+    Entry& entry = getEntry(computeKey(range, accessType));
+
+    if (likely(!entry.tree))
+      insertInlineRange(entry, range);
+    else
+      insertTreeRange(range, entry.tree);
+  }
+
+
+  void DxvkBarrierTracker::clear() {
+    // Free overflow trees. Subtrees get freed lazily
+    // when the root node gets allocated again.
+    for (auto rootIndex : m_trees)
+      freeNode(rootIndex);
+
+    m_trees.clear();
+
+    // Invalidate all hash table entries at once. If the generation
+    // counter wraps around, we need to reset all entries manually.
+    if (!(++m_generation)) {
+      for (auto& entry : m_entries)
+        entry.generation = 0u;
+
+      m_generation = 1u;
+    }
+
+    m_entryCount = 0u;
+  }
+
+
+  const DxvkBarrierTracker::Entry* DxvkBarrierTracker::findEntry(
+          uint64_t                    key) const {
+    uint32_t mask = uint32_t(m_entries.size()) - 1u;
+    uint32_t index = computeHash(key) & mask;
+
+    // Entries from previous generations are treated as empty. Since
+    // entries never get removed individually, we can stop the search
+    // at the first one that is not valid.
+    while (true) {
+      const Entry& entry = m_entries[index];
+
+      if (entry.generation != m_generation)
+        return nullptr;
+
+      if (entry.key == key)
+        return &entry;
+
+      index = (index + 1u) & mask;
+    }
+  }
+
+
+  DxvkBarrierTracker::Entry& DxvkBarrierTracker::getEntry(
+          uint64_t                    key) {
+    // Keep the load factor low so that probe sequences stay short
+    if (unlikely(2u * (m_entryCount + 1u) > m_entries.size()))
+      growTable();
+
+    uint32_t mask = uint32_t(m_entries.size()) - 1u;
+    uint32_t index = computeHash(key) & mask;
+
+    while (true) {
+      Entry& entry = m_entries[index];
+
+      if (entry.generation != m_generation) {
+        entry.key = key;
+        entry.generation = m_generation;
+        entry.tree = 0u;
+        entry.count = 0u;
+
+        m_entryCount += 1u;
+        return entry;
+      }
+
+      if (entry.key == key)
+        return entry;
+
+      index = (index + 1u) & mask;
+    }
+  }
+
+
+  void DxvkBarrierTracker::growTable() {
+    std::vector<Entry> oldEntries(m_entries.size() * 2u);
+    std::swap(oldEntries, m_entries);
+
+    uint32_t mask = uint32_t(m_entries.size()) - 1u;
+
+    for (const auto& oldEntry : oldEntries) {
+      if (oldEntry.generation != m_generation)
+        continue;
+
+      uint32_t index = computeHash(oldEntry.key) & mask;
+
+      while (m_entries[index].generation == m_generation)
+        index = (index + 1u) & mask;
+
+      m_entries[index] = oldEntry;
+    }
+  }
+
+
+  void DxvkBarrierTracker::insertInlineRange(
+          Entry&                      entry,
+    const DxvkAddressRange&           range) {
+    uint32_t mask = findInlineRanges(entry, range);
+
+    if (likely(!mask)) {
+      // No overlap, insert the range while keeping the array
+      // sorted. Fall back to a tree if the entry is full.
+      if (unlikely(entry.count == InlineRangeCount)) {
+        convertToTree(entry, range);
+        return;
+      }
+
+      uint32_t index = entry.count;
+
+      while (index && entry.rangeStarts[index - 1u] > range.rangeStart) {
+        entry.accessOps[index] = entry.accessOps[index - 1u];
+        entry.rangeStarts[index] = entry.rangeStarts[index - 1u];
+        entry.rangeEnds[index] = entry.rangeEnds[index - 1u];
+        index -= 1u;
+      }
+
+      entry.accessOps[index] = range.accessOp;
+      entry.rangeStarts[index] = range.rangeStart;
+      entry.rangeEnds[index] = range.rangeEnd;
+
+      entry.count += 1u;
+      return;
+    }
+
+    // Since stored ranges are sorted and disjoint, all ranges overlapping
+    // the new one are adjacent. Merge them into the first one, and reset
+    // the access op if there are any conflicts.
+    uint32_t lo = bit::tzcnt(mask);
+    uint32_t hi = 31u - bit::lzcnt(mask);
+
+    DxvkAccessOp accessOp = range.accessOp;
+    uint64_t rangeStart = std::min(range.rangeStart, entry.rangeStarts[lo]);
+    uint64_t rangeEnd = std::max(range.rangeEnd, entry.rangeEnds[hi]);
+
+    for (uint32_t i = lo; i <= hi; i++) {
+      if (entry.accessOps[i] != accessOp)
+        accessOp = DxvkAccessOp::None;
+    }
+
+    entry.accessOps[lo] = accessOp;
+    entry.rangeStarts[lo] = rangeStart;
+    entry.rangeEnds[lo] = rangeEnd;
+
+    if (unlikely(hi > lo)) {
+      uint32_t dst = lo + 1u;
+
+      for (uint32_t src = hi + 1u; src < entry.count; src++) {
+        entry.accessOps[dst] = entry.accessOps[src];
+        entry.rangeStarts[dst] = entry.rangeStarts[src];
+        entry.rangeEnds[dst] = entry.rangeEnds[src];
+        dst += 1u;
+      }
+
+      entry.count = dst;
+    }
+  }
+
+
+  void DxvkBarrierTracker::convertToTree(
+          Entry&                      entry,
+    const DxvkAddressRange&           range) {
+    // Node allocation does not invalidate the entry itself,
+    // so we can safely keep using the reference here.
+    uint32_t rootIndex = allocateNode();
+    m_trees.push_back(rootIndex);
+
+    m_nodes[rootIndex].addressRange = range;
+
+    for (uint32_t i = 0; i < entry.count; i++) {
+      DxvkAddressRange inlineRange;
+      inlineRange.resource = range.resource;
+      inlineRange.accessOp = entry.accessOps[i];
+      inlineRange.rangeStart = entry.rangeStarts[i];
+      inlineRange.rangeEnd = entry.rangeEnds[i];
+
+      insertNode(inlineRange, rootIndex);
+    }
+
+    entry.tree = rootIndex;
+    entry.count = 0u;
+  }
+
+
+  void DxvkBarrierTracker::insertTreeRange(
+    const DxvkAddressRange&           range,
+          uint32_t                    rootIndex) {
     // If we can just insert the node with no conflicts,
     // we don't have to do anything.
-    uint32_t rootIndex = computeRootIndex(range, accessType);
     uint32_t nodeIndex = insertNode(range, rootIndex);
 
     if (likely(!nodeIndex))
@@ -103,7 +314,14 @@ namespace dxvk {
       if (mergedRange.accessOp != node.addressRange.accessOp)
         mergedRange.accessOp = DxvkAccessOp::None;
 
-      removeNode(nodeIndex, rootIndex);
+      // If we removed the last node, reinitialize the root
+      // node with the merged range and reset its red-ness.
+      if (removeNode(nodeIndex, rootIndex)) {
+        auto& root = m_nodes[rootIndex];
+        root.header = 0u;
+        root.addressRange = mergedRange;
+        return;
+      }
 
       nodeIndex = findNode(range, rootIndex);
     }
@@ -112,27 +330,6 @@ namespace dxvk {
   }
 
 
-  void DxvkBarrierTracker::clear() {
-    m_rootMaskValid = 0u;
-
-    while (m_rootMaskSubtree) {
-      // Free subtrees if any, but keep the root node intact
-      uint32_t rootIndex = bit::tzcnt(m_rootMaskSubtree) + 1u;
-
-      auto& root = m_nodes[rootIndex];
-
-      if (root.header) {
-        freeNode(root.child(0));
-        freeNode(root.child(1));
-
-        root.header = 0u;
-      }
-
-      m_rootMaskSubtree &= m_rootMaskSubtree - 1u;
-    }
-  }
-
-
   uint32_t DxvkBarrierTracker::allocateNode() {
     if (!m_free.empty()) {
       uint32_t nodeIndex = m_free.back();
@@ -163,13 +360,6 @@ namespace dxvk {
   uint32_t DxvkBarrierTracker::findNode(
     const DxvkAddressRange&           range,
           uint32_t                    rootIndex) const {
-    // Check if the given root is valid at all
-    uint64_t rootBit = uint64_t(1u) << (rootIndex - 1u);
-
-    if (!(m_rootMaskValid & rootBit))
-      return false;
-
-    // Traverse search tree normally
     uint32_t nodeIndex = rootIndex;
 
     while (nodeIndex) {
@@ -188,61 +378,46 @@ namespace dxvk {
   uint32_t DxvkBarrierTracker::insertNode(
     const DxvkAddressRange&           range,
           uint32_t                    rootIndex) {
-    // Check if the given root is valid at all
-    uint64_t rootBit = uint64_t(1u) << (rootIndex - 1u);
-
-    if (!(m_rootMaskValid & rootBit)) {
-      m_rootMaskValid |= rootBit;
-
-      // Update root node as necessary. Also reset
-      // its red-ness if we set it during deletion.
-      auto& node = m_nodes[rootIndex];
-      node.header = 0;
-      node.addressRange = range;
-      return 0;
-    } else {
-      // Traverse tree and abort if we find any range
-      // overlapping the one we're trying to insert.
-      uint32_t parentIndex = rootIndex;
-      uint32_t childIndex = 0u;
+    // Traverse tree and abort if we find any range
+    // overlapping the one we're trying to insert.
+    uint32_t parentIndex = rootIndex;
+    uint32_t childIndex = 0u;
 
-      while (true) {
-        auto& parent = m_nodes[parentIndex];
+    while (true) {
+      auto& parent = m_nodes[parentIndex];
 
-        if (parent.addressRange.overlaps(range))
-          return parentIndex;
+      if (parent.addressRange.overlaps(range))
+        return parentIndex;
 
-        childIndex = parent.addressRange.lt(range);
+      childIndex = parent.addressRange.lt(range);
 
-        if (!parent.child(childIndex))
-          break;
+      if (!parent.child(childIndex))
+        break;
 
-        parentIndex = parent.child(childIndex);
-      }
+      parentIndex = parent.child(childIndex);
+    }
 
-      // Create and insert new node into the tree
-      uint32_t nodeIndex = allocateNode();
+    // Create and insert new node into the tree
+    uint32_t nodeIndex = allocateNode();
 
-      auto& parent = m_nodes[parentIndex];
-      parent.setChild(childIndex, nodeIndex);
+    auto& parent = m_nodes[parentIndex];
+    parent.setChild(childIndex, nodeIndex);
 
-      auto& node = m_nodes[nodeIndex];
-      node.setRed(true);
-      node.setParent(parentIndex);
-      node.addressRange = range;
+    auto& node = m_nodes[nodeIndex];
+    node.setRed(true);
+    node.setParent(parentIndex);
+    node.addressRange = range;
 
-      // Only do the fixup to maintain red-black properties if
-      // we haven't marked the root node as red in a deletion.
-      if (parentIndex != rootIndex && !m_nodes[rootIndex].isRed())
-        rebalancePostInsert(nodeIndex, rootIndex);
+    // Only do the fixup to maintain red-black properties if
+    // we haven't marked the root node as red in a deletion.
+    if (parentIndex != rootIndex && !m_nodes[rootIndex].isRed())
+      rebalancePostInsert(nodeIndex, rootIndex);
 
-      m_rootMaskSubtree |= rootBit;
-      return 0u;
-    }
+    return 0u;
   }
 
 
-  void DxvkBarrierTracker::removeNode(
+  bool DxvkBarrierTracker::removeNode(
           uint32_t                    nodeIndex,
           uint32_t                    rootIndex) {
     auto& node = m_nodes[nodeIndex];
@@ -259,7 +434,7 @@ namespace dxvk {
         childIndex = m_nodes[childIndex].child(0);
 
       node.addressRange = m_nodes[childIndex].addressRange;
-      removeNode(childIndex, rootIndex);
+      return removeNode(childIndex, rootIndex);
     } else {
       // Deletion is expected to be exceptionally rare, to the point of
       // being irrelevant in practice since it can only ever happen if an
@@ -305,13 +480,12 @@ namespace dxvk {
         node.header = 0;
         freeNode(nodeIndex);
       } else {
-        // Removing root with no children, mark tree as invalid
-        uint64_t rootBit = uint64_t(1u) << (rootIndex - 1u);
-
-        m_rootMaskSubtree &= ~rootBit;
-        m_rootMaskValid &= ~rootBit;
+        // Removing root with no children, the tree is now empty
+        return true;
       }
     }
+
+    return false;
   }
 
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <utility>
 #include <vector>
 
@@ -102,12 +103,14 @@ namespace dxvk {
   /**
    * \brief Barrier tracker
    *
-   * Provides a two-part hash table for read and written resource
-   * ranges, which is backed by binary trees to handle individual
-   * address ranges as well as collisions.
+   * Provides an open-addressed hash table for read and written resource
+   * ranges. Each entry stores a small sorted array of disjoint ranges
+   * that can be searched without branching, and only falls back to a
+   * binary tree if a resource is accessed in many disjoint ranges.
    */
   class DxvkBarrierTracker {
-    constexpr static uint32_t HashTableSize = 32u;
+    constexpr static uint32_t InlineRangeCount = 4u;
+    constexpr static uint32_t MinTableSize = 64u;
   public:
 
     DxvkBarrierTracker();
@@ -147,16 +150,51 @@ namespace dxvk {
      * \returns \c true if the tracker is empty.
      */
     bool empty() const {
-      return !m_rootMaskValid;
+      return !m_entryCount;
     }
 
   private:
 
-    uint64_t m_rootMaskValid = 0u;
-    uint64_t m_rootMaskSubtree = 0u;
+    /// Hash table entry. Ranges are stored in separate arrays in
+    /// order to allow checking all of them at once. Only the first
+    /// \c count ranges are valid, any others must be masked out.
+    struct Entry {
+      uint64_t  key         = 0u;
+      uint32_t  generation  = 0u;
+      uint32_t  tree        = 0u;
+      uint32_t  count       = 0u;
+      std::array<DxvkAccessOp, InlineRangeCount> accessOps = { };
+      std::array<uint64_t, InlineRangeCount> rangeStarts = { };
+      std::array<uint64_t, InlineRangeCount> rangeEnds = { };
+    };
+
+    std::vector<Entry>                m_entries;
+    uint32_t                          m_entryCount = 0u;
+    uint32_t                          m_generation = 1u;
 
     std::vector<DxvkBarrierTreeNode>  m_nodes;
     std::vector<uint32_t>             m_free;
+    std::vector<uint32_t>             m_trees;
+
+    const Entry* findEntry(
+            uint64_t                    key) const;
+
+    Entry& getEntry(
+            uint64_t                    key);
+
+    void growTable();
+
+    void insertInlineRange(
+            Entry&                      entry,
+      const DxvkAddressRange&           range);
+
+    void convertToTree(
+            Entry&                      entry,
+      const DxvkAddressRange&           range);
+
+    void insertTreeRange(
+      const DxvkAddressRange&           range,
+            uint32_t                    rootIndex);
 
     uint32_t allocateNode();
 
@@ -170,7 +208,7 @@ namespace dxvk {
       const DxvkAddressRange&           range,
             uint32_t                    rootIndex);
 
-    void removeNode(
+    bool removeNode(
             uint32_t                    nodeIndex,
             uint32_t                    rootIndex);
 
@@ -186,17 +224,31 @@ namespace dxvk {
             uint32_t                    nodeIndex,
             uint32_t                    rootIndex);
 
-    static uint32_t computeRootIndex(
+    static uint32_t findInlineRanges(
+      const Entry&                      entry,
+      const DxvkAddressRange&           range) {
+      uint32_t mask = 0u;
+
+      for (uint32_t i = 0; i < InlineRangeCount; i++) {
+        mask |= uint32_t(entry.rangeEnds[i] >= range.rangeStart
+                      && entry.rangeStarts[i] <= range.rangeEnd) << i;
+      }
+
+      // Unused slots may hold stale ranges that overlap the
+      // given range, so only consider the ones in use.
+      return mask & ((1u << entry.count) - 1u);
+    }
+
+    static uint64_t computeKey(
       const DxvkAddressRange&           range,
             DxvkAccess                  access) {
-      // TODO revisit once we use internal allocation
-      // objects or resource cookies here.
-      size_t hash = uint64_t(range.resource) * 93887;
-             hash ^= (hash >> 16);
-
-      // Reserve the upper half of the implicit hash table for written
-      // ranges, and add 1 because 0 refers to the actual null node.
-      return 1u + (hash % HashTableSize) + (access == DxvkAccess::Write ? HashTableSize : 0u);
+      return (uint64_t(range.resource) << 1u) | uint64_t(access == DxvkAccess::Write);
+    }
+
+    static uint32_t computeHash(
+            uint64_t                    key) {
+      uint64_t hash = key * 0x9e3779b97f4a7c15ull;
+      return uint32_t(hash >> 32u);
     }
 
   };
@@ -27,6 +27,16 @@ namespace dxvk {
       m_info.debugName = nullptr;
     }
 
+    // Descriptor buffers reference buffer resources by address
+    constexpr VkBufferUsageFlags descriptorUsage =
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+      VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT |
+      VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+
+    if ((m_info.usage & descriptorUsage) && device->canUseDescriptorBuffer())
+      m_info.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
     // Create and assign actual buffer resource
     assignStorage(allocateStorage());
   }
@@ -136,4 +146,28 @@ namespace dxvk {
     return str::format(vk::isValidDebugName(name) ? name : "Buffer", " (", cookie(), ")");
   }
 
+
+  const void* DxvkBufferView::createDescriptorData(
+          VkDescriptorType            type,
+          size_t                      size) {
+    auto vk = m_buffer->m_vkd;
+
+    VkDescriptorAddressInfoEXT addressInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
+    addressInfo.address = m_buffer->gpuAddress() + m_key.offset;
+    addressInfo.range = m_key.size;
+    addressInfo.format = m_key.format;
+
+    VkDescriptorGetInfoEXT info = { VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT };
+    info.type = type;
+
+    if (type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
+      info.data.pStorageTexelBuffer = &addressInfo;
+    else
+      info.data.pUniformTexelBuffer = &addressInfo;
+
+    void* data = m_descriptors.store(getDescriptorIndex(type), m_buffer->m_version);
+    vk->vkGetDescriptorEXT(vk->device(), &info, size, data);
+    return data;
+  }
+
 }
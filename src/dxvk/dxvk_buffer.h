@@ -135,6 +135,20 @@ namespace dxvk {
       return lookupFormatInfo(m_key.format);
     }
 
+    /**
+     * \brief Retrieves raw descriptor for descriptor buffers
+     *
+     * Lazily creates the descriptor from the buffer address, so
+     * no Vulkan buffer view is required. Must only be used if
+     * the device uses descriptor buffers.
+     * \param [in] type Uniform or storage texel buffer
+     * \param [in] size Descriptor size for the given type
+     * \returns Pointer to raw descriptor data
+     */
+    const void* getDescriptorData(
+            VkDescriptorType            type,
+            size_t                      size);
+
   private:
 
     DxvkBuffer*       m_buffer  = nullptr;
@@ -143,6 +157,16 @@ namespace dxvk {
     uint32_t          m_version = 0u;
     VkBufferView      m_handle  = VK_NULL_HANDLE;
 
+    DxvkDescriptorCache<2> m_descriptors;
+
+    const void* createDescriptorData(
+            VkDescriptorType            type,
+            size_t                      size);
+
+    static uint32_t getDescriptorIndex(VkDescriptorType type) {
+      return type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER ? 1u : 0u;
+    }
+
   };
 
 
@@ -678,6 +702,18 @@ namespace dxvk {
   }
 
 
+  inline const void* DxvkBufferView::getDescriptorData(
+          VkDescriptorType            type,
+          size_t                      size) {
+    const void* data = m_descriptors.find(getDescriptorIndex(type), m_buffer->m_version);
+
+    if (likely(data))
+      return data;
+
+    return createDescriptorData(type, size);
+  }
+
+
   inline DxvkBufferSliceHandle DxvkBufferView::getSliceHandle() const {
     return m_buffer->getSliceHandle(m_key.offset, m_key.size);
   }
@@ -447,6 +447,12 @@ namespace dxvk {
 
     m_descriptorPools.clear();
 
+    // Recycle descriptor heaps
+    for (const auto& descriptorHeaps : m_descriptorHeaps)
+      descriptorHeaps.second->recycleDescriptorHeap(descriptorHeaps.first);
+
+    m_descriptorHeaps.clear();
+
     // Release pipelines
     for (auto pipeline : m_pipelines)
       pipeline->releasePipeline();
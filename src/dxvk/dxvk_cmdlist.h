@@ -5,6 +5,7 @@
 #include "dxvk_bind_mask.h"
 #include "dxvk_buffer.h"
 #include "dxvk_descriptor.h"
+#include "dxvk_descriptor_heap.h"
 #include "dxvk_fence.h"
 #include "dxvk_gpu_event.h"
 #include "dxvk_gpu_query.h"
@@ -528,6 +529,15 @@ namespace dxvk {
     }
 
 
+    void cmdBindDescriptorBuffers(
+            DxvkCmdBuffer             cmdBuffer,
+            uint32_t                  bufferCount,
+      const VkDescriptorBufferBindingInfoEXT* bindingInfos) {
+      m_vkd->vkCmdBindDescriptorBuffersEXT(getCmdBuffer(cmdBuffer),
+        bufferCount, bindingInfos);
+    }
+
+
     void cmdBindIndexBuffer(
             VkBuffer                buffer,
             VkDeviceSize            offset,
@@ -989,6 +999,19 @@ namespace dxvk {
     }
 
 
+    void cmdSetDescriptorBufferOffsets(
+            DxvkCmdBuffer           cmdBuffer,
+            VkPipelineBindPoint     pipeline,
+            VkPipelineLayout        pipelineLayout,
+            uint32_t                firstSet,
+            uint32_t                setCount,
+      const uint32_t*               bufferIndices,
+      const VkDeviceSize*           offsets) {
+      m_vkd->vkCmdSetDescriptorBufferOffsetsEXT(getCmdBuffer(cmdBuffer),
+        pipeline, pipelineLayout, firstSet, setCount, bufferIndices, offsets);
+    }
+
+
     void cmdSetEvent(
             VkEvent                 event,
       const VkDependencyInfo*       dependencyInfo) {
@@ -1160,6 +1183,13 @@ namespace dxvk {
     }
 
 
+    void trackDescriptorHeap(
+      const Rc<DxvkDescriptorHeap>&       heap,
+      const Rc<DxvkDescriptorManager>&    manager) {
+      m_descriptorHeaps.push_back({ heap, manager });
+    }
+
+
     void setTrackingId(uint64_t id) {
       m_trackingId = id;
     }
@@ -1195,6 +1225,10 @@ namespace dxvk {
       Rc<DxvkDescriptorPool>,
       Rc<DxvkDescriptorManager>>> m_descriptorPools;
 
+    std::vector<std::pair<
+      Rc<DxvkDescriptorHeap>,
+      Rc<DxvkDescriptorManager>>> m_descriptorHeaps;
+
     std::vector<DxvkGraphicsPipeline*> m_pipelines;
 
     force_inline VkCommandBuffer getCmdBuffer() const {
@@ -115,6 +115,9 @@ namespace dxvk {
     info.layout               = m_bindings->getPipelineLayout(false);
     info.basePipelineIndex    = -1;
 
+    if (m_device->canUseDescriptorBuffer())
+      info.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkResult vr = vk->vkCreateComputePipelines(vk->device(),
           VK_NULL_HANDLE, 1, &info, nullptr, &pipeline);
@@ -59,6 +59,13 @@ namespace dxvk {
     // Add a fast path to query debug utils support
     if (m_device->debugFlags().test(DxvkDebugFlag::Capture))
       m_features.set(DxvkContextFeature::DebugUtils);
+
+    // Write shader resource descriptors to descriptor buffer
+    // memory instead of allocating descriptor sets if enabled
+    if (m_device->canUseDescriptorBuffer()) {
+      m_features.set(DxvkContextFeature::DescriptorBuffer);
+      initDescriptorBuffer();
+    }
   }
   
   
@@ -74,6 +81,9 @@ namespace dxvk {
     if (m_descriptorPool == nullptr)
       m_descriptorPool = m_descriptorManager->getDescriptorPool();
 
+    if (m_features.test(DxvkContextFeature::DescriptorBuffer) && m_descriptorHeap == nullptr)
+      m_descriptorHeap = m_descriptorManager->getDescriptorHeap();
+
     this->beginCurrentCommands();
   }
   
@@ -90,6 +100,13 @@ namespace dxvk {
       m_descriptorPool = m_descriptorManager->getDescriptorPool();
     }
 
+    // Heap memory is allocated linearly and can only be reused once
+    // the GPU is done with this submission, so always swap it out
+    if (m_descriptorHeap != nullptr) {
+      m_cmd->trackDescriptorHeap(m_descriptorHeap, m_descriptorManager);
+      m_descriptorHeap = m_descriptorManager->getDescriptorHeap();
+    }
+
     if (unlikely(m_features.test(DxvkContextFeature::DebugUtils))) {
       // Make sure to emit the submission reason always at the very end
       if (reason && reason->pLabelName && reason->pLabelName[0])
@@ -2842,7 +2859,8 @@ namespace dxvk {
 
     if (m_state.gp.state.ds.enableDepthBoundsTest() != depthBounds.enableDepthBounds) {
       m_state.gp.state.ds.setEnableDepthBoundsTest(depthBounds.enableDepthBounds);
-      m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+      m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                  DxvkContextFlag::GpDirtyPipelineHash);
     }
   }
   
@@ -2862,7 +2880,8 @@ namespace dxvk {
       ia.primitiveRestart(),
       ia.patchVertexCount());
     
-    m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+    m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                DxvkContextFlag::GpDirtyPipelineHash);
   }
   
   
@@ -2873,6 +2892,7 @@ namespace dxvk {
     const DxvkVertexInput*     bindings) {
     m_flags.set(
       DxvkContextFlag::GpDirtyPipelineState,
+      DxvkContextFlag::GpDirtyPipelineHash,
       DxvkContextFlag::GpDirtyVertexBuffers);
 
     for (uint32_t i = 0; i < bindingCount; i++) {
@@ -2936,7 +2956,8 @@ namespace dxvk {
       rs.lineMode());
 
     if (!m_state.gp.state.rs.eq(rsInfo)) {
-      m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+      m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                  DxvkContextFlag::GpDirtyPipelineHash);
 
       // Since depth bias enable is only dynamic for base pipelines,
       // it is applied as part of the dynamic depth-stencil state
@@ -2956,6 +2977,7 @@ namespace dxvk {
 
     m_flags.set(
       DxvkContextFlag::GpDirtyPipelineState,
+      DxvkContextFlag::GpDirtyPipelineHash,
       DxvkContextFlag::GpDirtyMultisampleState);
   }
   
@@ -2990,6 +3012,7 @@ namespace dxvk {
 
     m_flags.set(
       DxvkContextFlag::GpDirtyPipelineState,
+      DxvkContextFlag::GpDirtyPipelineHash,
       DxvkContextFlag::GpDirtyDepthStencilState);
   }
   
@@ -3000,7 +3023,8 @@ namespace dxvk {
       lo.logicOp(),
       m_state.gp.state.om.feedbackLoop());
     
-    m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+    m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                DxvkContextFlag::GpDirtyPipelineHash);
   }
   
   
@@ -3017,7 +3041,8 @@ namespace dxvk {
       blendMode.alphaBlendOp(),
       blendMode.writeMask());
 
-    m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+    m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                DxvkContextFlag::GpDirtyPipelineHash);
   }
 
 
@@ -5939,6 +5964,9 @@ namespace dxvk {
       renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
 
       m_cmd->beginSecondaryCommandBuffer(inheritance);
+
+      // Descriptor buffer bindings are not inherited
+      m_descriptorHeapAddress = 0u;
     } else {
       // Begin rendering right away on regular GPUs
       m_cmd->cmdBeginRendering(&renderingInfo);
@@ -5988,6 +6016,13 @@ namespace dxvk {
       auto& renderingInfo = m_state.om.renderingInfo.rendering;
       m_cmd->cmdBeginRendering(&renderingInfo);
       m_cmd->cmdExecuteCommands(1, &cmdBuffer);
+
+      // Executing the secondary command buffer invalidates descriptor
+      // buffer bindings, which also affects bound compute descriptors
+      if (m_features.test(DxvkContextFeature::DescriptorBuffer)) {
+        m_descriptorHeapAddress = 0u;
+        m_descriptorState.dirtyStages(VK_SHADER_STAGE_COMPUTE_BIT);
+      }
     }
 
     // End actual rendering command
@@ -6216,8 +6251,16 @@ namespace dxvk {
       ? DxvkContextFlag::GpDynamicRasterizerState
       : DxvkContextFlag::GpDirtyRasterizerState);
 
+    // Only rehash the state vector if it actually changed, since
+    // rebinding the pipeline for a new render pass is common.
+    if (m_flags.test(DxvkContextFlag::GpDirtyPipelineHash)) {
+      m_state.gp.stateHash = m_state.gp.state.hash();
+      m_flags.clr(DxvkContextFlag::GpDirtyPipelineHash);
+    }
+
     // Retrieve and bind actual Vulkan pipeline handle
-    auto pipelineInfo = m_state.gp.pipeline->getPipelineHandle(m_state.gp.state);
+    auto pipelineInfo = m_state.gp.pipeline->getPipelineHandle(
+      m_state.gp.state, m_state.gp.stateHash);
 
     if (unlikely(!pipelineInfo.handle))
       return false;
@@ -6313,6 +6356,9 @@ namespace dxvk {
 
     scState.mask = newMask;
 
+    if (BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+      m_flags.set(DxvkContextFlag::GpDirtyPipelineHash);
+
     auto flag = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS
       ? DxvkContextFlag::GpDirtySpecConstants
       : DxvkContextFlag::CpDirtySpecConstants;
@@ -6334,7 +6380,8 @@ namespace dxvk {
 
     if (BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS) {
       m_flags.clr(DxvkContextFlag::GpDirtySpecConstants);
-      m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+      m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                  DxvkContextFlag::GpDirtyPipelineHash);
     } else {
       m_flags.clr(DxvkContextFlag::CpDirtySpecConstants);
       m_flags.set(DxvkContextFlag::CpDirtyPipelineState);
@@ -6604,15 +6651,303 @@ namespace dxvk {
   }
 
 
+  template<VkPipelineBindPoint BindPoint>
+  void DxvkContext::updateDescriptorBufferBindings(const DxvkBindingLayoutObjects* layout) {
+    const auto& bindings = layout->layout();
+
+    bool independentSets = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS
+                        && m_flags.test(DxvkContextFlag::GpIndependentSets);
+
+    uint32_t layoutSetMask = layout->getSetMask();
+    uint32_t dirtySetMask = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS
+      ? m_descriptorState.getDirtyGraphicsSets()
+      : m_descriptorState.getDirtyComputeSets();
+    dirtySetMask &= layoutSetMask;
+
+    // Make sure all dirty sets fit into the current heap chunk. If the
+    // heap address changes, we need to rebind the heap, which in turn
+    // invalidates all set offsets for both bind points.
+    while (true) {
+      VkDeviceSize reserveSize = 0u;
+
+      for (auto setIndex : bit::BitMask(dirtySetMask))
+        reserveSize += m_descriptorHeap->computeAllocationSize(layout->getSetMemorySize(setIndex));
+
+      m_descriptorHeap->reserve(reserveSize);
+
+      if (likely(m_descriptorHeap->getBaseAddress() == m_descriptorHeapAddress))
+        break;
+
+      VkDescriptorBufferBindingInfoEXT bindingInfo = m_descriptorHeap->getBindingInfo();
+      m_cmd->cmdBindDescriptorBuffers(DxvkCmdBuffer::ExecBuffer, 1, &bindingInfo);
+
+      m_descriptorHeapAddress = bindingInfo.address;
+      m_descriptorState.dirtyStages(BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS
+        ? VkShaderStageFlags(VK_SHADER_STAGE_COMPUTE_BIT)
+        : VkShaderStageFlags(VK_SHADER_STAGE_ALL_GRAPHICS));
+
+      dirtySetMask = layoutSetMask;
+    }
+
+    std::array<uint32_t, DxvkDescriptorSets::SetCount> bufferIndices = { };
+    std::array<VkDeviceSize, DxvkDescriptorSets::SetCount> setOffsets = { };
+
+    for (auto setIndex : bit::BitMask(dirtySetMask)) {
+      uint32_t bindingCount = bindings.getBindingCount(setIndex);
+
+      setOffsets[setIndex] = m_descriptorHeap->alloc(layout->getSetMemorySize(setIndex));
+      char* setData = m_descriptorHeap->mapPtr(setOffsets[setIndex]);
+
+      for (uint32_t j = 0; j < bindingCount; j++) {
+        const auto& binding = bindings.getBinding(setIndex, j);
+
+        void* descriptorData = setData + layout->getBindingOffset(setIndex, j);
+        size_t descriptorSize = m_descriptorSizes[binding.descriptorType];
+
+        // Descriptor to copy, or null if it was written directly
+        const void* descriptor = m_nullDescriptors[binding.descriptorType].data;
+
+        switch (binding.descriptorType) {
+          case VK_DESCRIPTOR_TYPE_SAMPLER: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            if (res.sampler != nullptr) {
+              descriptor = res.sampler->getDescriptorData();
+
+              m_cmd->track(res.sampler);
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            VkImageView viewHandle = VK_NULL_HANDLE;
+
+            if (res.imageView != nullptr)
+              viewHandle = res.imageView->handle(binding.viewType);
+
+            if (viewHandle) {
+              if (likely(!res.imageView->isMultisampled() || binding.isMultisampled)) {
+                descriptor = res.imageView->getDescriptorData(binding.descriptorType, binding.viewType, descriptorSize);
+
+                if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || unlikely(res.imageView->hasGfxStores()))
+                  accessImage(DxvkCmdBuffer::ExecBuffer, *res.imageView, util::pipelineStages(binding.stage), binding.access, DxvkAccessOp::None);
+
+                m_cmd->track(res.imageView->image(), DxvkAccess::Read);
+              } else {
+                auto view = m_implicitResolves.getResolveView(*res.imageView, m_trackingId);
+
+                if (view->handle(binding.viewType))
+                  descriptor = view->getDescriptorData(binding.descriptorType, binding.viewType, descriptorSize);
+
+                m_cmd->track(view->image(), DxvkAccess::Read);
+              }
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            VkImageView viewHandle = VK_NULL_HANDLE;
+
+            if (res.imageView != nullptr)
+              viewHandle = res.imageView->handle(binding.viewType);
+
+            if (viewHandle) {
+              descriptor = res.imageView->getDescriptorData(binding.descriptorType, binding.viewType, descriptorSize);
+
+              if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || res.imageView->hasGfxStores())
+                accessImage(DxvkCmdBuffer::ExecBuffer, *res.imageView, util::pipelineStages(binding.stage), binding.access, binding.accessOp);
+
+              m_cmd->track(res.imageView->image(), (binding.access & vk::AccessWriteMask)
+                ? DxvkAccess::Write : DxvkAccess::Read);
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            VkImageView viewHandle = VK_NULL_HANDLE;
+
+            if (res.imageView != nullptr && res.sampler != nullptr)
+              viewHandle = res.imageView->handle(binding.viewType);
+
+            if (viewHandle) {
+              // Combined descriptors depend on both the view and the
+              // sampler, so they cannot be cached on either object
+              VkDescriptorImageInfo imageInfo = { };
+              imageInfo.sampler = res.sampler->handle();
+
+              if (likely(!res.imageView->isMultisampled() || binding.isMultisampled)) {
+                imageInfo.imageView = viewHandle;
+                imageInfo.imageLayout = res.imageView->defaultLayout();
+
+                if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || unlikely(res.imageView->hasGfxStores()))
+                  accessImage(DxvkCmdBuffer::ExecBuffer, *res.imageView, util::pipelineStages(binding.stage), binding.access, DxvkAccessOp::None);
+
+                m_cmd->track(res.imageView->image(), DxvkAccess::Read);
+              } else {
+                auto view = m_implicitResolves.getResolveView(*res.imageView, m_trackingId);
+
+                imageInfo.imageView = view->handle(binding.viewType);
+                imageInfo.imageLayout = view->defaultLayout();
+
+                m_cmd->track(view->image(), DxvkAccess::Read);
+              }
+
+              m_cmd->track(res.sampler);
+
+              VkDescriptorDataEXT data = { };
+              data.pCombinedImageSampler = &imageInfo;
+
+              writeDescriptor(binding.descriptorType, data, descriptorData);
+              descriptor = nullptr;
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            if (res.bufferView != nullptr) {
+              descriptor = res.bufferView->getDescriptorData(binding.descriptorType, descriptorSize);
+
+              if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || unlikely(res.bufferView->buffer()->hasGfxStores()))
+                accessBuffer(DxvkCmdBuffer::ExecBuffer, *res.bufferView, util::pipelineStages(binding.stage), binding.access, DxvkAccessOp::None);
+
+              m_cmd->track(res.bufferView->buffer(), DxvkAccess::Read);
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            if (res.bufferView != nullptr) {
+              descriptor = res.bufferView->getDescriptorData(binding.descriptorType, descriptorSize);
+
+              if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || res.bufferView->buffer()->hasGfxStores())
+                accessBuffer(DxvkCmdBuffer::ExecBuffer, *res.bufferView, util::pipelineStages(binding.stage), binding.access, binding.accessOp);
+
+              m_cmd->track(res.bufferView->buffer(), (binding.access & vk::AccessWriteMask)
+                ? DxvkAccess::Write : DxvkAccess::Read);
+            }
+          } break;
+
+          case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+          case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+            const auto& res = m_rc[binding.resourceBinding];
+
+            VkDeviceAddress address = 0u;
+
+            if (res.bufferSlice.length())
+              address = res.bufferSlice.buffer()->gpuAddress();
+
+            if (address) {
+              // Buffer ranges change far too often to be worth caching
+              VkDescriptorAddressInfoEXT addressInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
+              addressInfo.address = address + res.bufferSlice.offset();
+              addressInfo.range = res.bufferSlice.length();
+
+              VkDescriptorDataEXT data = { };
+
+              if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                data.pUniformBuffer = &addressInfo;
+
+                if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || unlikely(res.bufferSlice.buffer()->hasGfxStores()))
+                  accessBuffer(DxvkCmdBuffer::ExecBuffer, res.bufferSlice, util::pipelineStages(binding.stage), binding.access, DxvkAccessOp::None);
+
+                m_cmd->track(res.bufferSlice.buffer(), DxvkAccess::Read);
+              } else {
+                data.pStorageBuffer = &addressInfo;
+
+                if (BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE || unlikely(res.bufferSlice.buffer()->hasGfxStores()))
+                  accessBuffer(DxvkCmdBuffer::ExecBuffer, res.bufferSlice, util::pipelineStages(binding.stage), binding.access, binding.accessOp);
+
+                m_cmd->track(res.bufferSlice.buffer(), (binding.access & vk::AccessWriteMask)
+                  ? DxvkAccess::Write : DxvkAccess::Read);
+              }
+
+              writeDescriptor(binding.descriptorType, data, descriptorData);
+              descriptor = nullptr;
+            }
+          } break;
+
+          default:
+            break;
+        }
+
+        if (descriptor)
+          std::memcpy(descriptorData, descriptor, descriptorSize);
+      }
+
+      // If the next set is not dirty, set offsets for all previously
+      // written sets in one go in order to reduce api call overhead.
+      if (!(((dirtySetMask >> 1) >> setIndex) & 1u)) {
+        uint32_t firstSet = bit::tzcnt(dirtySetMask);
+        dirtySetMask &= (~1u) << setIndex;
+
+        m_cmd->cmdSetDescriptorBufferOffsets(DxvkCmdBuffer::ExecBuffer,
+          BindPoint, layout->getPipelineLayout(independentSets),
+          firstSet, setIndex - firstSet + 1,
+          &bufferIndices[firstSet], &setOffsets[firstSet]);
+      }
+    }
+  }
+
+
+  void DxvkContext::initDescriptorBuffer() {
+    VkSampler dummySampler = m_common->dummyResources().samplerHandle();
+
+    for (uint32_t i = 0; i < m_descriptorSizes.size(); i++) {
+      auto type = VkDescriptorType(i);
+
+      m_descriptorSizes[i] = m_device->getDescriptorSize(type);
+
+      // Samplers cannot be null, use the dummy sampler instead.
+      // All other descriptor types can use null descriptors.
+      VkDescriptorImageInfo imageInfo = { };
+      imageInfo.sampler = dummySampler;
+
+      VkDescriptorDataEXT data = { };
+
+      if (type == VK_DESCRIPTOR_TYPE_SAMPLER)
+        data.pSampler = &dummySampler;
+      else if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+        data.pCombinedImageSampler = &imageInfo;
+
+      writeDescriptor(type, data, m_nullDescriptors[i].data);
+    }
+  }
+
+
+  void DxvkContext::writeDescriptor(
+          VkDescriptorType        type,
+    const VkDescriptorDataEXT&    data,
+          void*                   dst) {
+    auto vk = m_device->vkd();
+
+    VkDescriptorGetInfoEXT info = { VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT };
+    info.type = type;
+    info.data = data;
+
+    vk->vkGetDescriptorEXT(vk->device(), &info, m_descriptorSizes[type], dst);
+  }
+
+
   void DxvkContext::updateComputeShaderResources() {
-    this->updateResourceBindings<VK_PIPELINE_BIND_POINT_COMPUTE>(m_state.cp.pipeline->getBindings());
+    if (m_features.test(DxvkContextFeature::DescriptorBuffer))
+      this->updateDescriptorBufferBindings<VK_PIPELINE_BIND_POINT_COMPUTE>(m_state.cp.pipeline->getBindings());
+    else
+      this->updateResourceBindings<VK_PIPELINE_BIND_POINT_COMPUTE>(m_state.cp.pipeline->getBindings());
 
     m_descriptorState.clearStages(VK_SHADER_STAGE_COMPUTE_BIT);
   }
   
   
   void DxvkContext::updateGraphicsShaderResources() {
-    this->updateResourceBindings<VK_PIPELINE_BIND_POINT_GRAPHICS>(m_state.gp.pipeline->getBindings());
+    if (m_features.test(DxvkContextFeature::DescriptorBuffer))
+      this->updateDescriptorBufferBindings<VK_PIPELINE_BIND_POINT_GRAPHICS>(m_state.gp.pipeline->getBindings());
+    else
+      this->updateResourceBindings<VK_PIPELINE_BIND_POINT_GRAPHICS>(m_state.gp.pipeline->getBindings());
 
     m_descriptorState.clearStages(VK_SHADER_STAGE_ALL_GRAPHICS);
   }
@@ -6648,7 +6983,8 @@ namespace dxvk {
         m_state.gp.state.omSwizzle[i] = DxvkOmAttachmentSwizzle(mapping);
       }
 
-      m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+      m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                  DxvkContextFlag::GpDirtyPipelineHash);
     } else if (m_flags.test(DxvkContextFlag::GpRenderPassNeedsFlush)) {
       // End render pass to flush pending resolves
       this->spillRenderPass(true);
@@ -6950,7 +7286,8 @@ namespace dxvk {
 
         if (m_state.gp.state.ilBindings[i].stride() != stride) {
           m_state.gp.state.ilBindings[i].setStride(stride);
-          m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+          m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                      DxvkContextFlag::GpDirtyPipelineHash);
         }
       }
 
@@ -7881,17 +8218,19 @@ namespace dxvk {
 
 
   void DxvkContext::relocateQueuedResources() {
-    // Limit the number and size of resources to process per submission to
-    // something reasonable. We don't know if we are transferring over PCIe.
+    // Limit the number of resources to process per submission to something
+    // reasonable. The total size is limited by the allocator depending on
+    // memory pressure, since we don't know if we are transferring over PCIe.
     constexpr static uint32_t MaxRelocationsPerSubmission = 128u;
-    constexpr static uint32_t MaxRelocatedMemoryPerSubmission = 16u << 20;
 
-    auto resourceList = m_common->memoryManager().pollRelocationList(
-      MaxRelocationsPerSubmission, MaxRelocatedMemoryPerSubmission);
+    auto& memoryManager = m_common->memoryManager();
+    auto resourceList = memoryManager.pollRelocationList(MaxRelocationsPerSubmission);
 
     if (resourceList.empty())
       return;
 
+    auto t0 = high_resolution_clock::now();
+
     if (unlikely(m_features.test(DxvkContextFeature::DebugUtils))) {
       m_cmd->cmdBeginDebugUtilsLabel(DxvkCmdBuffer::ExecBuffer,
         vk::makeLabel(0xc0a2f0, "Memory defrag"));
@@ -7900,6 +8239,8 @@ namespace dxvk {
     std::vector<DxvkRelocateBufferInfo> bufferInfos;
     std::vector<DxvkRelocateImageInfo> imageInfos;
 
+    VkDeviceSize relocatedSize = 0u;
+
     // Iterate over resource list and try to create and assign new allocations
     // for them based on the mode selected by the allocator. Failures here are
     // not fatal, but may lead to weird behaviour down the line - ignore for now.
@@ -7909,6 +8250,8 @@ namespace dxvk {
       if (!storage)
         continue;
 
+      relocatedSize += storage->getMemoryInfo().size;
+
       Rc<DxvkImage> image = dynamic_cast<DxvkImage*>(e.resource.ptr());
       Rc<DxvkBuffer> buffer = dynamic_cast<DxvkBuffer*>(e.resource.ptr());
 
@@ -7923,8 +8266,10 @@ namespace dxvk {
       }
     }
 
-    if (bufferInfos.empty() && imageInfos.empty())
+    if (bufferInfos.empty() && imageInfos.empty()) {
+      memoryManager.notifyRelocation(0u, 0u, high_resolution_clock::now() - t0);
       return;
+    }
 
     // If there are any resources to relocate, we have to stall the transfer
     // queue so that subsequent resource uploads do not overlap with resource
@@ -7935,6 +8280,10 @@ namespace dxvk {
 
     m_cmd->setSubmissionBarrier();
 
+    memoryManager.notifyRelocation(relocatedSize,
+      bufferInfos.size() + imageInfos.size(),
+      high_resolution_clock::now() - t0);
+
     if (unlikely(m_features.test(DxvkContextFeature::DebugUtils)))
       m_cmd->cmdEndDebugUtilsLabel(DxvkCmdBuffer::ExecBuffer);
   }
@@ -8090,6 +8439,7 @@ namespace dxvk {
       DxvkContextFlag::GpDirtyFramebuffer,
       DxvkContextFlag::GpDirtyPipeline,
       DxvkContextFlag::GpDirtyPipelineState,
+      DxvkContextFlag::GpDirtyPipelineHash,
       DxvkContextFlag::GpDirtyVertexBuffers,
       DxvkContextFlag::GpDirtyIndexBuffer,
       DxvkContextFlag::GpDirtyXfbBuffers,
@@ -8108,6 +8458,8 @@ namespace dxvk {
       VK_SHADER_STAGE_ALL_GRAPHICS |
       VK_SHADER_STAGE_COMPUTE_BIT);
 
+    m_descriptorHeapAddress = 0u;
+
     m_state.gp.pipeline = nullptr;
     m_state.cp.pipeline = nullptr;
 
@@ -164,7 +164,8 @@ namespace dxvk {
 
       if (unlikely(m_state.gp.state.om.feedbackLoop() != feedbackLoop)) {
         m_state.gp.state.om.setFeedbackLoop(feedbackLoop);
-        m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+        m_flags.set(DxvkContextFlag::GpDirtyPipelineState,
+                    DxvkContextFlag::GpDirtyPipelineHash);
       }
 
       this->resetRenderPassOps(
@@ -1402,6 +1403,12 @@ namespace dxvk {
     Rc<DxvkDescriptorPool>  m_descriptorPool;
     Rc<DxvkDescriptorManager> m_descriptorManager;
 
+    Rc<DxvkDescriptorHeap>  m_descriptorHeap;
+    VkDeviceAddress         m_descriptorHeapAddress = 0u;
+
+    std::array<uint32_t, 8>           m_descriptorSizes = { };
+    std::array<DxvkDescriptorData, 8> m_nullDescriptors = { };
+
     DxvkBarrierBatch        m_sdmaAcquires;
     DxvkBarrierBatch        m_sdmaBarriers;
     DxvkBarrierBatch        m_initAcquires;
@@ -1722,6 +1729,16 @@ namespace dxvk {
     template<VkPipelineBindPoint BindPoint>
     void updateResourceBindings(const DxvkBindingLayoutObjects* layout);
 
+    template<VkPipelineBindPoint BindPoint>
+    void updateDescriptorBufferBindings(const DxvkBindingLayoutObjects* layout);
+
+    void initDescriptorBuffer();
+
+    void writeDescriptor(
+            VkDescriptorType        type,
+      const VkDescriptorDataEXT&    data,
+            void*                   dst);
+
     void updateComputeShaderResources();
     void updateGraphicsShaderResources();
 
@@ -30,6 +30,7 @@ namespace dxvk {
     GpDirtyFramebuffer,         ///< Framebuffer binding is out of date
     GpDirtyPipeline,            ///< Graphics pipeline binding is out of date
     GpDirtyPipelineState,       ///< Graphics pipeline needs to be recompiled
+    GpDirtyPipelineHash,        ///< Graphics pipeline state hash is out of date
     GpDirtyVertexBuffers,       ///< Vertex buffer bindings are out of date
     GpDirtyIndexBuffer,         ///< Index buffer binding are out of date
     GpDirtyXfbBuffers,          ///< Transform feedback buffer bindings are out of date
@@ -77,6 +78,7 @@ namespace dxvk {
     IndexBufferRobustness,
     DebugUtils,
     DirectMultiDraw,
+    DescriptorBuffer,
     FeatureCount
   };
 
@@ -159,6 +161,7 @@ namespace dxvk {
   struct DxvkGraphicsPipelineState {
     DxvkGraphicsPipelineShaders   shaders;
     DxvkGraphicsPipelineStateInfo state;
+    size_t                        stateHash = 0;
     DxvkGraphicsPipelineFlags     flags;
     DxvkGraphicsPipeline*         pipeline = nullptr;
     DxvkSpecConstantState         constants;
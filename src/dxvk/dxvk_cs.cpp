@@ -1,14 +1,21 @@
+#include <new>
+
 #include "dxvk_cs.h"
 
 namespace dxvk {
   
-  DxvkCsChunk::DxvkCsChunk() {
-    
+  DxvkCsChunk::DxvkCsChunk(uint32_t sizeClass)
+  : m_capacity  (DxvkCsChunkSizes[sizeClass]),
+    m_sizeClass (sizeClass),
+    m_data      (static_cast<char*>(::operator new(m_capacity, std::align_val_t(CACHE_LINE_SIZE)))) {
+
   }
   
   
   DxvkCsChunk::~DxvkCsChunk() {
     this->reset();
+
+    ::operator delete(m_data, std::align_val_t(CACHE_LINE_SIZE));
   }
   
   
@@ -23,15 +30,24 @@ namespace dxvk {
     if (m_flags.test(DxvkCsChunkFlag::SingleUse)) {
       m_commandOffset = 0;
       
-      while (cmd != nullptr) {
-        auto next = cmd->next();
-        cmd->exec(ctx);
-        cmd->~DxvkCsCmd();
-        cmd = next;
+      if (m_needsDestroy) {
+        while (cmd != nullptr) {
+          auto next = cmd->next();
+          cmd->exec(ctx);
+          cmd->destroy();
+          cmd = next;
+        }
+      } else {
+        while (cmd != nullptr) {
+          cmd->exec(ctx);
+          cmd = cmd->next();
+        }
       }
 
       m_head = nullptr;
-      m_next = &m_head;
+      m_tail = nullptr;
+
+      m_needsDestroy = false;
     } else {
       while (cmd != nullptr) {
         cmd->exec(ctx);
@@ -42,46 +58,63 @@ namespace dxvk {
   
   
   void DxvkCsChunk::reset() {
-    auto cmd = m_head;
+    if (m_needsDestroy) {
+      auto cmd = m_head;
 
-    while (cmd != nullptr) {
-      auto next = cmd->next();
-      cmd->~DxvkCsCmd();
-      cmd = next;
+      while (cmd != nullptr) {
+        auto next = cmd->next();
+        cmd->destroy();
+        cmd = next;
+      }
     }
     
     m_head = nullptr;
-    m_next = &m_head;
+    m_tail = nullptr;
+
+    m_needsDestroy = false;
+    m_overflow = false;
 
     m_commandOffset = 0;
   }
   
   
-  DxvkCsChunkPool::DxvkCsChunkPool() {
+  DxvkCsChunkPool::DxvkCsChunkPool(DxvkDevice* device)
+  : m_device(device) {
     
   }
   
   
   DxvkCsChunkPool::~DxvkCsChunkPool() {
-    for (DxvkCsChunk* chunk : m_chunks)
-      delete chunk;
+    for (auto& list : m_freeLists) {
+      DxvkCsChunk* chunk = list.head;
+
+      while (chunk) {
+        DxvkCsChunk* next = chunk->m_nextFree;
+        delete chunk;
+        chunk = next;
+      }
+    }
   }
   
   
   DxvkCsChunk* DxvkCsChunkPool::allocChunk(DxvkCsChunkFlags flags) {
+    uint32_t sizeClass = DxvkCsChunkSizeClassDefault;
+
+    // Only remove the first chunk from the list. Since the
+    // list is locked, this is safe against concurrent users.
+    auto& list = m_freeLists[sizeClass];
     DxvkCsChunk* chunk = nullptr;
 
-    { std::lock_guard<dxvk::mutex> lock(m_mutex);
-      
-      if (m_chunks.size() != 0) {
-        chunk = m_chunks.back();
-        m_chunks.pop_back();
-      }
+    { std::lock_guard<sync::Spinlock> lock(list.mutex);
+      chunk = list.head;
+
+      if (chunk)
+        list.head = std::exchange(chunk->m_nextFree, nullptr);
     }
-    
+
     if (!chunk)
-      chunk = new DxvkCsChunk();
-    
+      chunk = createChunk(sizeClass);
+
     chunk->init(flags);
     return chunk;
   }
@@ -89,9 +122,110 @@ namespace dxvk {
   
   void DxvkCsChunkPool::freeChunk(DxvkCsChunk* chunk) {
     chunk->reset();
-    
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-    m_chunks.push_back(chunk);
+
+    returnChunks(chunk->sizeClass(), chunk, chunk);
+  }
+
+
+  DxvkCsChunk* DxvkCsChunkPool::createChunk(uint32_t sizeClass) {
+    DxvkCsChunk* chunk = new DxvkCsChunk(sizeClass);
+
+    // Chunks are never freed while the pool is alive, so
+    // this is effectively the high-water mark of all chunks
+    // that were in use at the same time
+    m_device->addStatCtr(DxvkStatCounter::CsChunkPoolBytes, chunk->capacity());
+    return chunk;
+  }
+
+
+  void DxvkCsChunkPool::returnChunks(
+          uint32_t          sizeClass,
+          DxvkCsChunk*      head,
+          DxvkCsChunk*      tail) {
+    auto& list = m_freeLists[sizeClass];
+
+    std::lock_guard<sync::Spinlock> lock(list.mutex);
+    tail->m_nextFree = list.head;
+    list.head = head;
+  }
+
+
+  DxvkCsChunkAllocator::DxvkCsChunkAllocator(
+          DxvkCsChunkPool*  pool,
+          DxvkCsChunkFlags  flags)
+  : m_pool(pool), m_flags(flags) {
+
+  }
+
+
+  DxvkCsChunkAllocator::~DxvkCsChunkAllocator() {
+    for (uint32_t i = 0; i < DxvkCsChunkSizeClassCount; i++) {
+      DxvkCsChunk* head = m_freeLists[i];
+
+      if (head) {
+        DxvkCsChunk* tail = head;
+
+        while (tail->m_nextFree)
+          tail = tail->m_nextFree;
+
+        m_pool->returnChunks(i, head, tail);
+      }
+    }
+  }
+
+
+  DxvkCsChunkRef DxvkCsChunkAllocator::allocChunk() {
+    uint32_t sizeClass = m_sizeClass;
+
+    // Commands that did not fit into the previous chunk must fit
+    // into the next one, which is only guaranteed for chunks of
+    // at least the default size.
+    if (m_lastOverflow)
+      sizeClass = std::max(sizeClass, DxvkCsChunkSizeClassDefault);
+
+    DxvkCsChunk* chunk = m_freeLists[sizeClass];
+
+    if (!chunk)
+      chunk = m_pool->takeChunks(sizeClass);
+
+    if (chunk)
+      m_freeLists[sizeClass] = chunk->m_nextFree;
+    else
+      chunk = m_pool->createChunk(sizeClass);
+
+    chunk->m_nextFree = nullptr;
+    chunk->init(m_flags);
+    return DxvkCsChunkRef(chunk, m_pool);
+  }
+
+
+  void DxvkCsChunkAllocator::trackChunk(
+    const DxvkCsChunkRef&   chunk) {
+    m_lastOverflow = chunk->overflowed();
+
+    m_windowChunks += 1u;
+    m_windowOverflows += m_lastOverflow ? 1u : 0u;
+    m_windowBytes += chunk->size();
+
+    if (m_windowChunks < WindowSize)
+      return;
+
+    // Use larger chunks if most chunks get submitted because they
+    // are full, and smaller chunks if chunks mostly get flushed while
+    // they would still fit into a smaller chunk at less than half
+    // its capacity. This trades chunk memory for submission overhead.
+    size_t avgBytes = m_windowBytes / m_windowChunks;
+
+    if (2u * m_windowOverflows > m_windowChunks) {
+      if (m_sizeClass + 1u < DxvkCsChunkSizeClassCount)
+        m_sizeClass += 1u;
+    } else if (m_sizeClass && 2u * avgBytes < DxvkCsChunkSizes[m_sizeClass - 1u]) {
+      m_sizeClass -= 1u;
+    }
+
+    m_windowChunks = 0u;
+    m_windowOverflows = 0u;
+    m_windowBytes = 0u;
   }
   
   
@@ -115,18 +249,30 @@ namespace dxvk {
   
   
   uint64_t DxvkCsThread::dispatchChunk(DxvkCsChunkRef&& chunk) {
-    uint64_t seq;
+    // Only the calling thread ever writes the dispatch counter
+    uint64_t seq = m_seqDispatch.load(std::memory_order_relaxed) + 1u;
 
-    { std::unique_lock<dxvk::mutex> lock(m_mutex);
-      seq = ++m_queueOrdered.seqDispatch;
+    // If the ring is full, wait for the worker to take the chunk
+    // that currently occupies the slot. This should only happen
+    // if the application is far ahead of the worker thread.
+    if (unlikely(seq > DxvkCsChunkRing::Capacity)) {
+      uint64_t seqFree = seq - DxvkCsChunkRing::Capacity;
 
-      auto& entry = m_queueOrdered.queue.emplace_back();
-      entry.chunk = std::move(chunk);
-      entry.seq = seq;
+      if (m_seqOrdered.load(std::memory_order_acquire) < seqFree)
+        waitForCounter(m_seqOrdered, seqFree);
+    }
 
+    m_ringOrdered.store(seq, std::move(chunk));
+    m_seqDispatch.store(seq);
+
+    // The worker sets the idle flag before checking the dispatch
+    // counter, so we will either see the flag here, or the worker
+    // will see the new chunk. Only lock if we actually need to.
+    if (unlikely(m_isIdle.load())) {
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
       m_condOnAdd.notify_one();
     }
-    
+
     return seq;
   }
 
@@ -144,21 +290,23 @@ namespace dxvk {
       entry.chunk = std::move(chunk);
       entry.seq = timeline;
 
-      m_condOnAdd.notify_one();
+      // Ordered chunks must be executed after any chunk that has
+      // already been dispatched, but before any subsequent ones.
+      if (queue == DxvkCsQueue::Ordered)
+        entry.order = m_seqDispatch.load(std::memory_order_acquire);
 
-      if (queue == DxvkCsQueue::HighPriority) {
-        // Worker will check this flag after executing any
-        // chunk without causing additional lock contention
-        m_hasHighPrio.store(true, std::memory_order_release);
-      }
+      // Worker will check this flag after executing any
+      // chunk without causing additional lock contention
+      getFlag(queue).store(true, std::memory_order_release);
+
+      m_condOnAdd.notify_one();
     }
 
     if (synchronize) {
-      std::unique_lock<dxvk::mutex> lock(m_counterMutex);
+      auto& counter = getCounter(queue);
 
-      m_condOnSync.wait(lock, [this, queue, timeline] {
-        return getCounter(queue).load(std::memory_order_acquire) >= timeline;
-      });
+      if (counter.load(std::memory_order_acquire) < timeline)
+        waitForCounter(counter, timeline);
     }
   }
 
@@ -171,15 +319,11 @@ namespace dxvk {
       // happens while another thread is submitting then there is
       // an inherent race anyway
       if (seq == SynchronizeAll)
-        seq = m_queueOrdered.seqDispatch;
+        seq = m_seqDispatch.load(std::memory_order_acquire);
 
       auto t0 = dxvk::high_resolution_clock::now();
 
-      { std::unique_lock<dxvk::mutex> lock(m_counterMutex);
-        m_condOnSync.wait(lock, [this, seq] {
-          return m_seqOrdered.load(std::memory_order_acquire) >= seq;
-        });
-      }
+      waitForCounter(m_seqOrdered, seq);
 
       auto t1 = dxvk::high_resolution_clock::now();
       auto ticks = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
@@ -188,85 +332,167 @@ namespace dxvk {
       m_device->addStatCtr(DxvkStatCounter::CsSyncTicks, ticks.count());
     }
   }
-  
-  
+
+
+  void DxvkCsThread::waitForCounter(
+    const std::atomic<uint64_t>&  counter,
+          uint64_t                seq) {
+    std::unique_lock<dxvk::mutex> lock(m_counterMutex);
+
+    // The worker checks the waiter count after updating a
+    // counter, and will only lock and notify if it is non-zero
+    m_syncWaiters += 1u;
+
+    m_condOnSync.wait(lock, [&counter, seq] {
+      return counter.load() >= seq;
+    });
+
+    m_syncWaiters -= 1u;
+  }
+
+
+  void DxvkCsThread::signalCounter(
+          std::atomic<uint64_t>&  counter,
+          uint64_t                seq) {
+    counter.store(seq);
+
+    // Use a separate mutex for the chunk counter, this will only
+    // ever be contested if synchronization is actually necessary.
+    // Different waiters may wait for different counters, so wake
+    // them all up in that case.
+    if (unlikely(m_syncWaiters.load())) {
+      std::lock_guard<dxvk::mutex> lock(m_counterMutex);
+      m_condOnSync.notify_all();
+    }
+  }
+
+
+  void DxvkCsThread::executeChunk(
+    const DxvkCsChunkRef&         chunk) {
+    m_context->addStatCtr(DxvkStatCounter::CsChunkCount, 1);
+    m_context->addStatCtr(DxvkStatCounter::CsChunkBytesUsed, chunk->size());
+    m_context->addStatCtr(DxvkStatCounter::CsChunkBytesTotal, chunk->capacity());
+
+    chunk->executeAll(m_context.ptr());
+  }
+
+
   void DxvkCsThread::threadFunc() {
     env::setThreadName("dxvk-cs");
 
-    // Local chunk queues, we use two queues and swap between
-    // them in order to potentially reduce lock contention.
-    std::vector<DxvkCsQueuedChunk> ordered;
+    // Number of times to poll for new chunks before going to
+    // sleep. Chunks tend to arrive in bursts, and waking up a
+    // sleeping thread is expensive compared to a short spin.
+    constexpr uint32_t SpinCount = 2000u;
+
+    // Local queues for injected chunks, we swap them with the
+    // shared queues in order to potentially reduce lock contention.
+    std::vector<DxvkCsQueuedChunk> injected;
     std::vector<DxvkCsQueuedChunk> highPrio;
 
-    try {
-      while (!m_stopped.load()) {
-        { std::unique_lock<dxvk::mutex> lock(m_mutex);
+    size_t injectedIndex = 0u;
+    size_t highPrioIndex = 0u;
 
-          auto pred = [this] { return
-              !m_queueOrdered.queue.empty()
-              || !m_queueHighPrio.queue.empty()
-              || m_stopped.load();
-          };
+    uint64_t seqExecuted = 0u;
 
-          if (unlikely(!pred())) {
-            auto t0 = dxvk::high_resolution_clock::now();
+    auto fetchChunks = [] (
+            std::vector<DxvkCsQueuedChunk>& local,
+            size_t&                         index,
+            std::vector<DxvkCsQueuedChunk>& shared) {
+      if (index == local.size()) {
+        local.clear();
+        index = 0u;
+
+        std::swap(local, shared);
+      } else {
+        for (auto& entry : shared)
+          local.push_back(std::move(entry));
+
+        shared.clear();
+      }
+    };
 
-            m_condOnAdd.wait(lock, [&] {
-              return pred();
-            });
+    auto hasWork = [this, &seqExecuted] {
+      return m_seqDispatch.load() > seqExecuted
+          || m_hasHighPrio.load()
+          || m_hasInjected.load()
+          || m_stopped.load();
+    };
 
-            auto t1 = dxvk::high_resolution_clock::now();
-            m_device->addStatCtr(DxvkStatCounter::CsIdleTicks, std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
-          }
+    try {
+      while (!m_stopped.load()) {
+        if (m_hasHighPrio.load(std::memory_order_acquire)
+         || m_hasInjected.load(std::memory_order_acquire)) {
+          std::unique_lock<dxvk::mutex> lock(m_mutex);
 
-          std::swap(ordered, m_queueOrdered.queue);
-          std::swap(highPrio, m_queueHighPrio.queue);
+          fetchChunks(highPrio, highPrioIndex, m_queueHighPrio.queue);
+          fetchChunks(injected, injectedIndex, m_queueInjected.queue);
 
           m_hasHighPrio.store(false, std::memory_order_release);
+          m_hasInjected.store(false, std::memory_order_release);
         }
 
-        size_t orderedIndex = 0u;
-        size_t highPrioIndex = 0u;
+        // Drain high-priority queue first
+        if (highPrioIndex < highPrio.size()) {
+          auto& entry = highPrio[highPrioIndex++];
+          executeChunk(entry.chunk);
 
-        while (highPrioIndex < highPrio.size() || orderedIndex < ordered.size()) {
-          // Re-fill local high-priority queue if the app has queued anything up
-          // in the meantime, we want to reduce possible synchronization delays.
-          if (highPrioIndex >= highPrio.size() && m_hasHighPrio.load(std::memory_order_acquire)) {
-            highPrio.clear();
-            highPrioIndex = 0u;
+          if (entry.seq)
+            signalCounter(m_seqHighPrio, entry.seq);
 
-            std::unique_lock<dxvk::mutex> lock(m_mutex);
-            std::swap(highPrio, m_queueHighPrio.queue);
+          // Immediately free the chunk to release
+          // references to any resources held by it
+          entry.chunk = DxvkCsChunkRef();
+          continue;
+        }
 
-            m_hasHighPrio.store(false, std::memory_order_release);
-          }
+        // Execute injected chunks before the first chunk
+        // that was dispatched after they were injected
+        if (injectedIndex < injected.size() && injected[injectedIndex].order <= seqExecuted) {
+          auto& entry = injected[injectedIndex++];
+          executeChunk(entry.chunk);
 
-          // Drain high-priority queue first
-          bool isHighPrio = highPrioIndex < highPrio.size();
-          auto& entry = isHighPrio ? highPrio[highPrioIndex++] : ordered[orderedIndex++];
+          if (entry.seq)
+            signalCounter(m_seqInjected, entry.seq);
 
-          m_context->addStatCtr(DxvkStatCounter::CsChunkCount, 1);
+          entry.chunk = DxvkCsChunkRef();
+          continue;
+        }
 
-          entry.chunk->executeAll(m_context.ptr());
+        if (seqExecuted < m_seqDispatch.load(std::memory_order_acquire)) {
+          // Take the chunk out of the ring so that the slot
+          // can be reused once we signal the sequence number
+          DxvkCsChunkRef chunk = m_ringOrdered.take(++seqExecuted);
+          executeChunk(chunk);
 
-          if (entry.seq) {
-            // Use a separate mutex for the chunk counter, this will only
-            // ever be contested if synchronization is actually necessary.
-            std::lock_guard lock(m_counterMutex);
+          signalCounter(m_seqOrdered, seqExecuted);
+          chunk = DxvkCsChunkRef();
+          continue;
+        }
 
-            auto& counter = isHighPrio ? m_seqHighPrio : m_seqOrdered;
-            counter.store(entry.seq, std::memory_order_release);
+        // Nothing to do, spin for a while and
+        // then go to sleep until new work arrives
+        auto t0 = dxvk::high_resolution_clock::now();
+        bool ready = false;
 
-            m_condOnSync.notify_one();
-          }
+        for (uint32_t i = 0; i < SpinCount && !ready; i++) {
+          sync::pause();
+          ready = hasWork();
+        }
 
-          // Immediately free the chunk to release
-          // references to any resources held by it
-          entry.chunk = DxvkCsChunkRef();
+        if (!ready) {
+          std::unique_lock<dxvk::mutex> lock(m_mutex);
+          m_isIdle.store(true);
+
+          m_condOnAdd.wait(lock, [&] {
+            return hasWork();
+          });
+
+          m_isIdle.store(false);
         }
 
-        ordered.clear();
-        highPrio.clear();
+        auto t1 = dxvk::high_resolution_clock::now();
+        m_device->addStatCtr(DxvkStatCounter::CsIdleTicks, std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
       }
     } catch (const DxvkError& e) {
       Logger::err("Exception on CS thread!");
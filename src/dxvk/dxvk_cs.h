@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
@@ -12,19 +13,46 @@
 
 namespace dxvk {
 
-  constexpr static size_t DxvkCsChunkSize = 16384;
+  /**
+   * \brief Chunk size classes
+   *
+   * Chunks are allocated in one of a few fixed sizes, chosen
+   * based on how full recently submitted chunks were. Any single
+   * command recorded by the front-ends must fit into an empty
+   * chunk of the default size.
+   */
+  constexpr static uint32_t DxvkCsChunkSizeClassCount   = 3u;
+  constexpr static uint32_t DxvkCsChunkSizeClassDefault = 1u;
+
+  constexpr static std::array<size_t, DxvkCsChunkSizeClassCount> DxvkCsChunkSizes = {{
+    4096u, 16384u, 65536u,
+  }};
 
   /**
    * \brief Command stream operation
    * 
    * An abstract representation of an operation
    * that can be recorded into a command list.
+   *
+   * Commands are not polymorphic objects. Instead, each
+   * command stores a pair of function pointers to execute
+   * and destroy it, as well as the distance to the next
+   * command in the chunk. The destroy function is \c nullptr
+   * for trivially destructible commands, which allows chunks
+   * to skip the destruction pass entirely in many cases.
    */
   class DxvkCsCmd {
 
   public:
 
-    virtual ~DxvkCsCmd() { }
+    using ExecFn    = void (*) (DxvkCsCmd*, DxvkContext*);
+    using DestroyFn = void (*) (DxvkCsCmd*);
+
+    DxvkCsCmd(ExecFn exec, DestroyFn destroy)
+    : m_exec(exec), m_destroy(destroy) { }
+
+    DxvkCsCmd             (const DxvkCsCmd&) = delete;
+    DxvkCsCmd& operator = (const DxvkCsCmd&) = delete;
 
     /**
      * \brief Retrieves next command in a command chain
@@ -34,28 +62,57 @@ namespace dxvk {
      * \returns Pointer the next command
      */
     DxvkCsCmd* next() const {
-      return m_next;
+      if (!m_size)
+        return nullptr;
+
+      return reinterpret_cast<DxvkCsCmd*>(
+        reinterpret_cast<uintptr_t>(this) + m_size);
     }
 
     /**
-     * \brief Retrieves pointer to next chain
+     * \brief Sets next command in the command chain
      *
-     * Used to chain commands.
-     * \returns Pointer the next command
+     * The next command must be located after this
+     * one in memory, and within the same chunk.
+     * \param [in] next Next command
+     */
+    void setNext(DxvkCsCmd* next) {
+      m_size = uint32_t(reinterpret_cast<uintptr_t>(next)
+                      - reinterpret_cast<uintptr_t>(this));
+    }
+
+    /**
+     * \brief Checks whether the command needs to be destroyed
+     * \returns \c true if the destroy function must be called
      */
-    DxvkCsCmd** chain() {
-      return &m_next;
+    bool needsDestroy() const {
+      return m_destroy != nullptr;
     }
 
     /**
      * \brief Executes embedded commands
      * \param [in] ctx The target context
      */
-    virtual void exec(DxvkContext* ctx) = 0;
+    void exec(DxvkContext* ctx) {
+      m_exec(this, ctx);
+    }
+
+    /**
+     * \brief Destroys command
+     *
+     * The command must not be accessed
+     * in any way after this call.
+     */
+    void destroy() {
+      if (m_destroy)
+        m_destroy(this);
+    }
 
   private:
 
-    DxvkCsCmd* m_next = nullptr;
+    ExecFn    m_exec;
+    DestroyFn m_destroy;
+    uint32_t  m_size = 0u;
 
   };
   
@@ -72,18 +129,23 @@ namespace dxvk {
   public:
     
     DxvkCsTypedCmd(T&& cmd)
-    : m_command(std::move(cmd)) { }
+    : DxvkCsCmd(&execCmd, std::is_trivially_destructible_v<T> ? nullptr : &destroyCmd),
+      m_command(std::move(cmd)) { }
     
     DxvkCsTypedCmd             (DxvkCsTypedCmd&&) = delete;
     DxvkCsTypedCmd& operator = (DxvkCsTypedCmd&&) = delete;
     
-    void exec(DxvkContext* ctx) {
-      m_command(ctx);
-    }
-    
   private:
     
     T m_command;
+
+    static void execCmd(DxvkCsCmd* cmd, DxvkContext* ctx) {
+      static_cast<DxvkCsTypedCmd*>(cmd)->m_command(ctx);
+    }
+
+    static void destroyCmd(DxvkCsCmd* cmd) {
+      static_cast<DxvkCsTypedCmd*>(cmd)->~DxvkCsTypedCmd();
+    }
     
   };
 
@@ -146,7 +208,9 @@ namespace dxvk {
   public:
 
     DxvkCsDataCmd(T&& cmd)
-    : m_command(std::move(cmd)) { }
+    : DxvkCsCmd(&execCmd, std::is_trivially_destructible_v<T>
+                       && std::is_trivially_destructible_v<M> ? nullptr : &destroyCmd),
+      m_command(std::move(cmd)) { }
 
     ~DxvkCsDataCmd() {
       auto data = reinterpret_cast<M*>(m_data.first());
@@ -158,11 +222,6 @@ namespace dxvk {
     DxvkCsDataCmd             (DxvkCsDataCmd&&) = delete;
     DxvkCsDataCmd& operator = (DxvkCsDataCmd&&) = delete;
 
-    void exec(DxvkContext* ctx) {
-      // No const here so that the function can move objects efficiently
-      m_command(ctx, reinterpret_cast<M*>(m_data.first()), m_data.count());
-    }
-
     DxvkCsDataBlock* data() {
       return &m_data;
     }
@@ -173,6 +232,16 @@ namespace dxvk {
     T               m_command;
     DxvkCsDataBlock m_data;
 
+    static void execCmd(DxvkCsCmd* cmd, DxvkContext* ctx) {
+      // No const here so that the function can move objects efficiently
+      auto self = static_cast<DxvkCsDataCmd*>(cmd);
+      self->m_command(ctx, reinterpret_cast<M*>(self->m_data.first()), self->m_data.count());
+    }
+
+    static void destroyCmd(DxvkCsCmd* cmd) {
+      static_cast<DxvkCsDataCmd*>(cmd)->~DxvkCsDataCmd();
+    }
+
   };
   
   
@@ -194,12 +263,51 @@ namespace dxvk {
    * Stores a list of commands.
    */
   class DxvkCsChunk : public RcObject {
-
+    friend class DxvkCsChunkPool;
+    friend class DxvkCsChunkAllocator;
   public:
 
-    DxvkCsChunk();
+    DxvkCsChunk(uint32_t sizeClass);
     ~DxvkCsChunk();
 
+    DxvkCsChunk             (const DxvkCsChunk&) = delete;
+    DxvkCsChunk& operator = (const DxvkCsChunk&) = delete;
+
+    /**
+     * \brief Size class of the chunk
+     * \returns Size class index
+     */
+    uint32_t sizeClass() const {
+      return m_sizeClass;
+    }
+
+    /**
+     * \brief Total command storage size
+     * \returns Chunk capacity, in bytes
+     */
+    size_t capacity() const {
+      return m_capacity;
+    }
+
+    /**
+     * \brief Used command storage size
+     * \returns Number of bytes used by commands
+     */
+    size_t size() const {
+      return m_commandOffset;
+    }
+
+    /**
+     * \brief Checks whether the chunk overflowed
+     *
+     * Set when a command or data allocation failed
+     * because the chunk did not have enough space.
+     * \returns \c true if the chunk ran out of space
+     */
+    bool overflowed() const {
+      return m_overflow;
+    }
+
     /**
      * \brief Checks whether the chunk is empty
      * \returns \c true if the chunk is empty
@@ -284,8 +392,10 @@ namespace dxvk {
     void* pushData(DxvkCsDataBlock* block, uint32_t count) {
       uint32_t dataSize = block->m_structSize * count;
 
-      if (unlikely(m_commandOffset + dataSize > DxvkCsChunkSize))
+      if (unlikely(m_commandOffset + dataSize > m_capacity)) {
+        m_overflow = true;
         return nullptr;
+      }
 
       void* ptr = &m_data[m_commandOffset];
       m_commandOffset += dataSize;
@@ -312,7 +422,8 @@ namespace dxvk {
     /**
      * \brief Resets chunk
      * 
-     * Destroys all recorded commands and
+     * Destroys all recorded commands, unless
+     * none of them need to be destroyed, and
      * marks the chunk itself as empty, so
      * that it can be reused later.
      */
@@ -321,22 +432,30 @@ namespace dxvk {
   private:
     
     size_t m_commandOffset = 0;
+    size_t m_capacity      = 0;
     
     DxvkCsCmd*  m_head = nullptr;
-    DxvkCsCmd** m_next = &m_head;
+    DxvkCsCmd*  m_tail = nullptr;
 
     DxvkCsChunkFlags m_flags;
-    
-    alignas(64)
-    char m_data[DxvkCsChunkSize];
+
+    uint32_t m_sizeClass    = 0u;
+    bool     m_needsDestroy = false;
+    bool     m_overflow     = false;
+
+    DxvkCsChunk* m_nextFree = nullptr;
+
+    char* m_data = nullptr;
 
     template<typename T>
     void* alloc(size_t extra) {
       if (alignof(T) > alignof(DxvkCsCmd))
         m_commandOffset = dxvk::align(m_commandOffset, alignof(T));
 
-      if (unlikely(m_commandOffset + sizeof(T) + extra > DxvkCsChunkSize))
+      if (unlikely(m_commandOffset + sizeof(T) + extra > m_capacity)) {
+        m_overflow = true;
         return nullptr;
+      }
 
       void* result = &m_data[m_commandOffset];
       m_commandOffset += sizeof(T) + extra;
@@ -344,8 +463,13 @@ namespace dxvk {
     }
 
     void append(DxvkCsCmd* cmd) {
-      *m_next = cmd;
-      m_next = cmd->chain();
+      if (m_tail)
+        m_tail->setNext(cmd);
+      else
+        m_head = cmd;
+
+      m_tail = cmd;
+      m_needsDestroy |= cmd->needsDestroy();
     }
     
   };
@@ -357,12 +481,19 @@ namespace dxvk {
    * Implements a pool of CS chunks which can be
    * recycled. The goal is to reduce the number
    * of dynamic memory allocations.
+   *
+   * Free chunks are stored in one list per size class,
+   * each protected by a spin lock. Any thread can return
+   * chunks to the pool, but recording threads are expected
+   * to take chunks through a \ref DxvkCsChunkAllocator,
+   * which takes entire lists at once in order to keep
+   * lock contention low.
    */
   class DxvkCsChunkPool {
     
   public:
     
-    DxvkCsChunkPool();
+    DxvkCsChunkPool(DxvkDevice* device);
     ~DxvkCsChunkPool();
     
     DxvkCsChunkPool             (const DxvkCsChunkPool&) = delete;
@@ -371,8 +502,11 @@ namespace dxvk {
     /**
      * \brief Allocates a chunk
      * 
-     * Takes an existing chunk from the pool,
-     * or creates a new one if necessary.
+     * Takes an existing chunk of the default size from
+     * the pool, or creates a new one if necessary. This
+     * is thread-safe, but slower than allocating chunks
+     * through an allocator, and is meant to be used for
+     * one-off submissions.
      * \param [in] flags Chunk flags
      * \returns Allocated chunk object
      */
@@ -385,11 +519,52 @@ namespace dxvk {
      * \param [in] chunk Chunk to release
      */
     void freeChunk(DxvkCsChunk* chunk);
+
+    /**
+     * \brief Creates a new chunk
+     *
+     * \param [in] sizeClass Chunk size class
+     * \returns Newly created chunk
+     */
+    DxvkCsChunk* createChunk(uint32_t sizeClass);
+
+    /**
+     * \brief Takes all free chunks of a given size
+     *
+     * \param [in] sizeClass Chunk size class
+     * \returns Linked list of chunks, may be \c nullptr
+     */
+    DxvkCsChunk* takeChunks(uint32_t sizeClass) {
+      auto& list = m_freeLists[sizeClass];
+
+      std::lock_guard<sync::Spinlock> lock(list.mutex);
+      return std::exchange(list.head, nullptr);
+    }
+
+    /**
+     * \brief Returns a list of chunks
+     *
+     * All chunks must be reset and of the same size class.
+     * \param [in] sizeClass Chunk size class
+     * \param [in] head First chunk in the list
+     * \param [in] tail Last chunk in the list
+     */
+    void returnChunks(
+            uint32_t          sizeClass,
+            DxvkCsChunk*      head,
+            DxvkCsChunk*      tail);
     
   private:
     
-    dxvk::mutex               m_mutex;
-    std::vector<DxvkCsChunk*> m_chunks;
+    struct FreeList {
+      alignas(CACHE_LINE_SIZE)
+      sync::Spinlock  mutex;
+      DxvkCsChunk*    head = nullptr;
+    };
+
+    DxvkDevice* m_device;
+
+    std::array<FreeList, DxvkCsChunkSizeClassCount> m_freeLists;
     
   };
   
@@ -474,6 +649,67 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Chunk allocator
+   *
+   * Per-context front end to the chunk pool. Keeps a local
+   * cache of free chunks, and chooses the size of new chunks
+   * based on how full recently submitted chunks were. This is
+   * not thread-safe, each recording context or thread must use
+   * its own allocator.
+   */
+  class DxvkCsChunkAllocator {
+
+  public:
+
+    DxvkCsChunkAllocator(
+            DxvkCsChunkPool*  pool,
+            DxvkCsChunkFlags  flags);
+
+    ~DxvkCsChunkAllocator();
+
+    DxvkCsChunkAllocator             (const DxvkCsChunkAllocator&) = delete;
+    DxvkCsChunkAllocator& operator = (const DxvkCsChunkAllocator&) = delete;
+
+    /**
+     * \brief Allocates a chunk
+     *
+     * If the last tracked chunk overflowed, the returned
+     * chunk is guaranteed to be at least of the default
+     * size so that the failed command can be recorded.
+     * \returns Allocated chunk
+     */
+    DxvkCsChunkRef allocChunk();
+
+    /**
+     * \brief Records fill statistics of a chunk
+     *
+     * Must be called for chunks allocated from this
+     * allocator right before they get submitted.
+     * \param [in] chunk The chunk
+     */
+    void trackChunk(
+      const DxvkCsChunkRef&   chunk);
+
+  private:
+
+    constexpr static uint32_t WindowSize = 64u;
+
+    DxvkCsChunkPool*  m_pool;
+    DxvkCsChunkFlags  m_flags;
+
+    std::array<DxvkCsChunk*, DxvkCsChunkSizeClassCount> m_freeLists = { };
+
+    uint32_t  m_sizeClass       = DxvkCsChunkSizeClassDefault;
+    bool      m_lastOverflow    = false;
+
+    uint32_t  m_windowChunks    = 0u;
+    uint32_t  m_windowOverflows = 0u;
+    size_t    m_windowBytes     = 0u;
+
+  };
+
+
   /**
    * \brief Queue type
    */
@@ -485,10 +721,16 @@ namespace dxvk {
 
   /**
    * \brief Queued chunk entry
+   *
+   * For chunks injected into the ordered queue, \c order
+   * stores the sequence number of the last chunk that was
+   * dispatched before injection. The chunk will be executed
+   * after that chunk, but before any subsequent chunk.
    */
   struct DxvkCsQueuedChunk {
     DxvkCsChunkRef  chunk;
     uint64_t        seq;
+    uint64_t        order = 0u;
   };
 
 
@@ -504,6 +746,53 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Chunk ring
+   *
+   * Bounded single-producer, single-consumer ring buffer
+   * for chunks dispatched to the main timeline. The chunk
+   * with sequence number \c n is stored at slot \c n modulo
+   * the ring capacity. Synchronization is done entirely via
+   * the sequence counters of the CS thread: The producer must
+   * not reuse a slot before the consumer has taken its chunk,
+   * and the consumer must not take a chunk before the producer
+   * has published its sequence number.
+   */
+  class DxvkCsChunkRing {
+
+  public:
+
+    constexpr static uint64_t Capacity = 4096u;
+
+    /**
+     * \brief Stores chunk in the ring
+     *
+     * \param [in] seq Sequence number
+     * \param [in] chunk Chunk to store
+     */
+    void store(uint64_t seq, DxvkCsChunkRef&& chunk) {
+      m_chunks[seq % Capacity] = std::move(chunk);
+    }
+
+    /**
+     * \brief Takes chunk from the ring
+     *
+     * Leaves the slot empty so that the
+     * producer can reuse it afterwards.
+     * \param [in] seq Sequence number
+     * \returns The chunk
+     */
+    DxvkCsChunkRef take(uint64_t seq) {
+      return std::move(m_chunks[seq % Capacity]);
+    }
+
+  private:
+
+    std::array<DxvkCsChunkRef, Capacity> m_chunks;
+
+  };
+
+
   /**
    * \brief Command stream thread
    * 
@@ -526,6 +815,7 @@ namespace dxvk {
      * 
      * Can be used to efficiently play back large
      * command lists recorded on another thread.
+     * Must only be called from one thread at a time.
      * \param [in] chunk The chunk to dispatch
      * \returns Sequence number of the submission
      */
@@ -576,33 +866,60 @@ namespace dxvk {
 
     alignas(CACHE_LINE_SIZE)
     dxvk::mutex                 m_counterMutex;
+    dxvk::condition_variable    m_condOnSync;
+
+    std::atomic<uint32_t>       m_syncWaiters = { 0u };
 
     std::atomic<uint64_t>       m_seqHighPrio = { 0u };
+    std::atomic<uint64_t>       m_seqInjected = { 0u };
     std::atomic<uint64_t>       m_seqOrdered  = { 0u };
 
     std::atomic<bool>           m_stopped     = { false };
     std::atomic<bool>           m_hasHighPrio = { false };
+    std::atomic<bool>           m_hasInjected = { false };
+
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t>       m_seqDispatch = { 0u };
 
     alignas(CACHE_LINE_SIZE)
     dxvk::mutex                 m_mutex;
     dxvk::condition_variable    m_condOnAdd;
-    dxvk::condition_variable    m_condOnSync;
 
-    DxvkCsChunkQueue            m_queueOrdered;
+    std::atomic<bool>           m_isIdle      = { false };
+
+    DxvkCsChunkQueue            m_queueInjected;
     DxvkCsChunkQueue            m_queueHighPrio;
 
+    DxvkCsChunkRing             m_ringOrdered;
+
     dxvk::thread                m_thread;
 
     auto& getQueue(DxvkCsQueue which) {
       return which == DxvkCsQueue::Ordered
-        ? m_queueOrdered : m_queueHighPrio;
+        ? m_queueInjected : m_queueHighPrio;
     }
 
     auto& getCounter(DxvkCsQueue which) {
       return which == DxvkCsQueue::Ordered
-        ? m_seqOrdered : m_seqHighPrio;
+        ? m_seqInjected : m_seqHighPrio;
+    }
+
+    auto& getFlag(DxvkCsQueue which) {
+      return which == DxvkCsQueue::Ordered
+        ? m_hasInjected : m_hasHighPrio;
     }
 
+    void waitForCounter(
+      const std::atomic<uint64_t>&  counter,
+            uint64_t                seq);
+
+    void signalCounter(
+            std::atomic<uint64_t>&  counter,
+            uint64_t                seq);
+
+    void executeChunk(
+      const DxvkCsChunkRef&         chunk);
+
     void threadFunc();
     
   };
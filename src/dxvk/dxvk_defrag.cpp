@@ -0,0 +1,121 @@
+#include "dxvk_defrag.h"
+
+namespace dxvk {
+
+  DxvkDefragScheduler::DxvkDefragScheduler() {
+
+  }
+
+
+  DxvkDefragScheduler::~DxvkDefragScheduler() {
+
+  }
+
+
+  DxvkDefragPressure DxvkDefragScheduler::computePressure(
+          VkDeviceSize                  allocated,
+          VkDeviceSize                  budget) {
+    if (allocated > budget)
+      return DxvkDefragPressure::OverBudget;
+
+    // Start compacting memory more aggressively once less
+    // than an eighth of the budget is left, e.g. 1 GB on
+    // an 8 GB card, so that we never run into the limit.
+    if (allocated > budget - budget / 8u)
+      return DxvkDefragPressure::High;
+
+    return DxvkDefragPressure::Low;
+  }
+
+
+  bool DxvkDefragScheduler::shouldDefragment(
+    const DxvkPageAllocator&            allocator,
+          VkDeviceSize                  chunkSize,
+          DxvkDefragPressure            pressure) {
+    if (pressure == DxvkDefragPressure::OverBudget)
+      return true;
+
+    uint32_t pagesTotal = 0u;
+    uint32_t pagesUsed = 0u;
+
+    for (uint32_t i = 0; i < allocator.chunkCount(); i++) {
+      uint32_t used = allocator.pagesUsed(i);
+
+      if (used) {
+        pagesUsed += used;
+        pagesTotal += allocator.pageCount(i);
+      }
+    }
+
+    // Tolerate one chunk worth of unused memory, and some slack
+    // on top of that if we are not under memory pressure.
+    uint32_t pagesTolerated = uint32_t(chunkSize / DxvkPageAllocator::PageSize);
+
+    if (pressure == DxvkDefragPressure::Low)
+      pagesTolerated += pagesUsed / 8u;
+
+    return pagesUsed + pagesTolerated < pagesTotal;
+  }
+
+
+  VkDeviceSize DxvkDefragScheduler::getCopyBudget(
+          high_resolution_clock::time_point time) {
+    CopyLimits limits = getCopyLimits(m_pressure.load(std::memory_order_relaxed));
+
+    std::lock_guard lock(m_mutex);
+
+    if (m_lastRefill != high_resolution_clock::time_point()) {
+      int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastRefill).count();
+      m_tokens += int64_t((limits.bytesPerSecond * std::max<int64_t>(us, 0)) / 1'000'000u);
+    } else {
+      m_tokens = int64_t(limits.maxSubmissionSize);
+    }
+
+    m_tokens = std::min(m_tokens, int64_t(limits.maxSubmissionSize));
+    m_lastRefill = time;
+
+    return VkDeviceSize(std::max<int64_t>(m_tokens, 0));
+  }
+
+
+  void DxvkDefragScheduler::notifyRelocation(
+          VkDeviceSize                  size,
+          uint32_t                      count) {
+    { std::lock_guard lock(m_mutex);
+      m_tokens -= int64_t(size);
+    }
+
+    m_relocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    m_relocatedCount.fetch_add(count, std::memory_order_relaxed);
+  }
+
+
+  DxvkDefragStats DxvkDefragScheduler::getStats() const {
+    DxvkDefragStats stats;
+    stats.relocatedBytes = m_relocatedBytes.load(std::memory_order_relaxed);
+    stats.relocatedCount = m_relocatedCount.load(std::memory_order_relaxed);
+    stats.timeSpent = m_timeSpent.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+
+  DxvkDefragScheduler::CopyLimits DxvkDefragScheduler::getCopyLimits(
+          DxvkDefragPressure            pressure) {
+    // We don't know if copies go over PCIe, so be conservative unless
+    // we are about to run out of memory. Resources larger than the
+    // per-submission limit are still moved one at a time.
+    switch (pressure) {
+      case DxvkDefragPressure::Low:
+        return CopyLimits { 4ull << 20, 64ull << 20 };
+
+      case DxvkDefragPressure::High:
+        return CopyLimits { 16ull << 20, 256ull << 20 };
+
+      case DxvkDefragPressure::OverBudget:
+        return CopyLimits { 64ull << 20, 1024ull << 20 };
+    }
+
+    return CopyLimits { 0u, 0u };
+  }
+
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+
+#include "dxvk_allocator.h"
+#include "dxvk_include.h"
+
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Memory pressure level
+   *
+   * Determines how aggressively memory is defragmented,
+   * and how much data may be copied per submission.
+   */
+  enum class DxvkDefragPressure : uint32_t {
+    /// Heap is well within its budget
+    Low         = 0,
+    /// Heap is close to exceeding its budget
+    High        = 1,
+    /// Heap exceeds its budget
+    OverBudget  = 2,
+  };
+
+
+  /**
+   * \brief Defragmentation statistics
+   */
+  struct DxvkDefragStats {
+    /// Total number of bytes relocated
+    uint64_t relocatedBytes = 0u;
+    /// Total number of resources relocated
+    uint64_t relocatedCount = 0u;
+    /// CPU time spent on defragmentation, in microseconds
+    uint64_t timeSpent      = 0u;
+  };
+
+
+  /**
+   * \brief Defragmentation scheduler
+   *
+   * Implements the policy used to select chunks to defragment, as
+   * well as a token bucket that limits the copy bandwidth spent on
+   * relocating resources. The policy functions only operate on a
+   * page allocator, so that they can be used with the allocation
+   * replay as well as the actual memory allocator.
+   */
+  class DxvkDefragScheduler {
+
+  public:
+
+    DxvkDefragScheduler();
+
+    ~DxvkDefragScheduler();
+
+    /**
+     * \brief Computes memory pressure for a heap
+     *
+     * \param [in] allocated Memory allocated from the heap
+     * \param [in] budget Heap budget
+     * \returns Memory pressure level
+     */
+    static DxvkDefragPressure computePressure(
+            VkDeviceSize                  allocated,
+            VkDeviceSize                  budget);
+
+    /**
+     * \brief Checks whether a pool should be defragmented
+     *
+     * Only engages defragmentation if a significant amount of memory
+     * is wasted. The closer the heap is to its budget, the less waste
+     * is tolerated, and heaps over budget are always defragmented.
+     * \param [in] allocator Page allocator of the pool
+     * \param [in] chunkSize Desired chunk size of the pool
+     * \param [in] pressure Memory pressure of the heap
+     * \returns \c true if the pool should be defragmented
+     */
+    static bool shouldDefragment(
+      const DxvkPageAllocator&            allocator,
+            VkDeviceSize                  chunkSize,
+            DxvkDefragPressure            pressure);
+
+    /**
+     * \brief Picks chunk to relocate
+     *
+     * Selects the chunk that frees up the most memory per byte that
+     * needs to be copied, i.e. the chunk with the highest ratio of
+     * capacity to used pages, and marks that chunk as dead. Empty
+     * chunks are marked as dead as well so that resources do not get
+     * moved between otherwise unused chunks.
+     * \param [in] allocator Page allocator of the pool
+     * \param [in] relocationPending Whether resources from a
+     *    previously selected chunk are still being moved
+     * \param [in] canMove Function that takes a chunk index and
+     *    returns whether resources in that chunk can be moved
+     * \returns Chunk index, or -1 if no chunk should be relocated
+     */
+    template<typename Fn>
+    static int32_t pickChunk(
+            DxvkPageAllocator&            allocator,
+            bool                          relocationPending,
+      const Fn&                           canMove) {
+      int32_t chunkIndex = -1;
+
+      uint32_t chunkPages = 0u;
+      uint32_t chunkCapacity = 0u;
+
+      for (uint32_t i = 0; i < allocator.chunkCount(); i++) {
+        uint32_t pagesUsed = allocator.pagesUsed(i);
+
+        if (!pagesUsed) {
+          allocator.killChunk(i);
+          continue;
+        }
+
+        if (!canMove(i))
+          continue;
+
+        // If there's a non-empty chunk already marked as dead and we haven't
+        // finished moving resources around yet, killing another chunk would
+        // do more harm than good so wait for that to finish first.
+        if (!allocator.chunkIsAvailable(i)) {
+          if (relocationPending)
+            return -1;
+          continue;
+        }
+
+        // Compare capacity per used page, prefer smaller chunks on ties
+        uint32_t pageCount = allocator.pageCount(i);
+
+        uint64_t a = uint64_t(pageCount) * chunkPages;
+        uint64_t b = uint64_t(chunkCapacity) * pagesUsed;
+
+        if (chunkIndex < 0 || a > b || (a == b && pagesUsed < chunkPages)) {
+          chunkIndex = int32_t(i);
+          chunkPages = pagesUsed;
+          chunkCapacity = pageCount;
+        }
+      }
+
+      if (chunkIndex < 0)
+        return -1;
+
+      // Check if the remaining chunks in the pool have sufficient free
+      // space. This is not a strong guarantee that relocation will
+      // succeed, but the chance is reasonably high.
+      uint32_t freePages = 0u;
+
+      for (uint32_t i = 0; i < allocator.chunkCount(); i++) {
+        uint32_t pagesUsed = allocator.pagesUsed(i);
+
+        if (pagesUsed && allocator.chunkIsAvailable(i) && i != uint32_t(chunkIndex))
+          freePages += allocator.pageCount(i) - pagesUsed;
+      }
+
+      if (2u * freePages < 3u * chunkPages)
+        return -1;
+
+      // Only keep one non-empty dead chunk at a time in order to prevent
+      // defragmentation from locking itself up in a suboptimal state.
+      for (uint32_t i = 0; i < allocator.chunkCount(); i++) {
+        if (!allocator.chunkIsAvailable(i) && allocator.pagesUsed(i))
+          allocator.reviveChunk(i);
+      }
+
+      allocator.killChunk(chunkIndex);
+      return chunkIndex;
+    }
+
+    /**
+     * \brief Updates memory pressure
+     *
+     * Should be called periodically with the highest
+     * pressure level of any device-local heap.
+     * \param [in] pressure Memory pressure
+     */
+    void setPressure(
+            DxvkDefragPressure            pressure) {
+      m_pressure.store(pressure, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Queries copy budget for a submission
+     *
+     * Refills the bucket based on the time since the last call,
+     * at a rate that depends on the current memory pressure.
+     * \param [in] time Current time
+     * \returns Number of bytes that may be relocated
+     */
+    VkDeviceSize getCopyBudget(
+            high_resolution_clock::time_point time);
+
+    /**
+     * \brief Notifies relocated resources
+     *
+     * Consumes copy budget and updates statistics.
+     * \param [in] size Total size of relocated resources
+     * \param [in] count Number of relocated resources
+     */
+    void notifyRelocation(
+            VkDeviceSize                  size,
+            uint32_t                      count);
+
+    /**
+     * \brief Adds CPU time spent on defragmentation
+     * \param [in] time Time spent
+     */
+    void addTime(
+            high_resolution_clock::duration time) {
+      m_timeSpent.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(time).count(),
+        std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Queries statistics
+     * \returns Defragmentation statistics
+     */
+    DxvkDefragStats getStats() const;
+
+  private:
+
+    struct CopyLimits {
+      /// Maximum number of bytes per submission
+      VkDeviceSize maxSubmissionSize;
+      /// Sustained copy rate, in bytes per second
+      VkDeviceSize bytesPerSecond;
+    };
+
+    std::atomic<DxvkDefragPressure>   m_pressure = { DxvkDefragPressure::Low };
+
+    dxvk::mutex                       m_mutex;
+    high_resolution_clock::time_point m_lastRefill = { };
+    int64_t                           m_tokens = 0;
+
+    std::atomic<uint64_t>             m_relocatedBytes = { 0u };
+    std::atomic<uint64_t>             m_relocatedCount = { 0u };
+    std::atomic<uint64_t>             m_timeSpent      = { 0u };
+
+    static CopyLimits getCopyLimits(
+            DxvkDefragPressure            pressure);
+
+  };
+
+}
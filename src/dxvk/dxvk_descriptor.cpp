@@ -1,4 +1,5 @@
 #include "dxvk_descriptor.h"
+#include "dxvk_descriptor_heap.h"
 #include "dxvk_device.h"
 
 namespace dxvk {
@@ -272,6 +273,24 @@ namespace dxvk {
   }
 
 
+  Rc<DxvkDescriptorHeap> DxvkDescriptorManager::getDescriptorHeap() {
+    Rc<DxvkDescriptorHeap> heap = m_heaps.retrieveObject();
+
+    if (heap == nullptr)
+      heap = new DxvkDescriptorHeap(m_device);
+
+    return heap;
+  }
+
+
+  void DxvkDescriptorManager::recycleDescriptorHeap(
+    const Rc<DxvkDescriptorHeap>&     heap) {
+    heap->reset();
+
+    m_heaps.returnObject(heap);
+  }
+
+
   VkDescriptorPool DxvkDescriptorManager::createVulkanDescriptorPool() {
     auto vk = m_device->vkd();
 
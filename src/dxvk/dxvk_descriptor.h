@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "dxvk_include.h"
@@ -10,6 +11,7 @@
 namespace dxvk {
 
   class DxvkDevice;
+  class DxvkDescriptorHeap;
   class DxvkDescriptorManager;
   
   /**
@@ -23,6 +25,84 @@ namespace dxvk {
     VkDescriptorBufferInfo buffer;
     VkBufferView           texelBuffer;
   };
+
+
+  /**
+   * \brief Raw descriptor data
+   *
+   * Stores a single descriptor as returned by \c vkGetDescriptorEXT.
+   * Descriptor buffers are only used if all descriptor sizes reported
+   * by the device fit into this structure.
+   */
+  struct DxvkDescriptorData {
+    constexpr static size_t MaxSize = 256u;
+
+    alignas(16) char data[MaxSize];
+  };
+
+
+  /**
+   * \brief Descriptor data cache
+   *
+   * Caches raw descriptors for a view or sampler so that they can
+   * be written to descriptor buffer memory with a plain copy. Each
+   * entry is tagged with a key that identifies the exact view state
+   * the descriptor was created for. Storage is only allocated once
+   * a descriptor gets stored, so unused caches are cheap.
+   * \tparam N Number of entries
+   */
+  template<size_t N>
+  class DxvkDescriptorCache {
+    constexpr static uint64_t InvalidKey = ~0ull;
+  public:
+
+    DxvkDescriptorCache() {
+      m_keys.fill(InvalidKey);
+    }
+
+    /**
+     * \brief Looks up cached descriptor
+     *
+     * \param [in] index Entry index
+     * \param [in] key Expected key of the entry
+     * \returns Descriptor data, or \c nullptr if the
+     *    entry is empty or was created with another key
+     */
+    const void* find(uint32_t index, uint64_t key) const {
+      return likely(m_keys[index] == key)
+        ? m_data[index].data
+        : nullptr;
+    }
+
+    /**
+     * \brief Allocates storage for an entry
+     *
+     * The caller must fill in descriptor data.
+     * \param [in] index Entry index
+     * \param [in] key Key of the new entry
+     * \returns Pointer to descriptor storage
+     */
+    void* store(uint32_t index, uint64_t key) {
+      if (!m_data)
+        m_data = std::make_unique<DxvkDescriptorData[]>(N);
+
+      m_keys[index] = key;
+      return m_data[index].data;
+    }
+
+    /**
+     * \brief Invalidates all entries
+     */
+    void clear() {
+      m_keys.fill(InvalidKey);
+    }
+
+  private:
+
+    std::array<uint64_t, N>               m_keys;
+    std::unique_ptr<DxvkDescriptorData[]> m_data;
+
+  };
   
   
   /**
@@ -199,6 +279,21 @@ namespace dxvk {
     void recycleDescriptorPool(
       const Rc<DxvkDescriptorPool>&     pool);
 
+    /**
+     * \brief Retrieves or creates a descriptor heap
+     * \returns The descriptor heap
+     */
+    Rc<DxvkDescriptorHeap> getDescriptorHeap();
+
+    /**
+     * \brief Recycles descriptor heap
+     *
+     * Resets and recycles the given
+     * descriptor heap for future use.
+     */
+    void recycleDescriptorHeap(
+      const Rc<DxvkDescriptorHeap>&     heap);
+
     /**
      * \brief Creates a Vulkan descriptor pool
      *
@@ -223,6 +318,7 @@ namespace dxvk {
     DxvkDevice*                         m_device;
     uint32_t                            m_maxSets = 0;
     DxvkRecycler<DxvkDescriptorPool, 8> m_pools;
+    DxvkRecycler<DxvkDescriptorHeap, 8> m_heaps;
 
     dxvk::mutex                         m_mutex;
     std::array<VkDescriptorPool, 8>     m_vkPools;
@@ -0,0 +1,76 @@
+#include "dxvk_descriptor_heap.h"
+#include "dxvk_device.h"
+
+namespace dxvk {
+
+  DxvkDescriptorHeap::DxvkDescriptorHeap(
+          DxvkDevice*               device)
+  : m_device(device) {
+    m_alignment = std::max<VkDeviceSize>(1u,
+      device->properties().extDescriptorBuffer.descriptorBufferOffsetAlignment);
+  }
+
+
+  DxvkDescriptorHeap::~DxvkDescriptorHeap() {
+
+  }
+
+
+  VkDescriptorBufferBindingInfoEXT DxvkDescriptorHeap::getBindingInfo() const {
+    VkDescriptorBufferBindingInfoEXT result = { VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT };
+    result.address = m_baseAddress;
+    result.usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
+                 | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+    return result;
+  }
+
+
+  void DxvkDescriptorHeap::reset() {
+    // Chunks beyond the last one used are unlikely to be needed
+    // again any time soon, so don't keep the memory around
+    if (m_mapPtr)
+      m_chunks.resize(m_chunkIndex + 1u);
+
+    m_chunkIndex = 0u;
+    m_baseAddress = 0u;
+    m_mapPtr = nullptr;
+    m_offset = 0u;
+  }
+
+
+  void DxvkDescriptorHeap::nextChunk() {
+    useChunk(m_mapPtr ? m_chunkIndex + 1u : 0u);
+  }
+
+
+  void DxvkDescriptorHeap::useChunk(
+          size_t                    index) {
+    if (index == m_chunks.size())
+      m_chunks.push_back(createChunk());
+
+    const auto& chunk = m_chunks[index];
+
+    m_chunkIndex = index;
+    m_baseAddress = chunk->gpuAddress();
+    m_mapPtr = reinterpret_cast<char*>(chunk->mapPtr(0));
+    m_offset = 0u;
+  }
+
+
+  Rc<DxvkBuffer> DxvkDescriptorHeap::createChunk() {
+    DxvkBufferCreateInfo info;
+    info.size       = ChunkSize;
+    info.usage      = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
+                    | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT
+                    | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    info.stages     = m_device->getShaderPipelineStages();
+    info.access     = VK_ACCESS_SHADER_READ_BIT;
+    info.debugName  = "Descriptor heap";
+
+    return m_device->createBuffer(info,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+}
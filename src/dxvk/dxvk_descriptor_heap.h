@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+
+#include "dxvk_buffer.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Descriptor heap
+   *
+   * Linear allocator for descriptor buffer memory. Descriptor sets are
+   * written to host-visible buffer chunks by the CPU, and the heap is
+   * reset as a whole once the GPU is done using it. Whenever the heap
+   * switches to a different chunk, the base address changes and the
+   * heap needs to be bound to the command buffer again.
+   */
+  class DxvkDescriptorHeap : public RcObject {
+
+  public:
+
+    /// Size of a single heap chunk, in bytes
+    constexpr static VkDeviceSize ChunkSize = VkDeviceSize(2u) << 20;
+
+    DxvkDescriptorHeap(
+            DxvkDevice*               device);
+
+    ~DxvkDescriptorHeap();
+
+    /**
+     * \brief Queries base address of the current chunk
+     *
+     * Offsets returned by \ref alloc are relative to this.
+     * \returns Base address, or 0 if no chunk is active
+     */
+    VkDeviceAddress getBaseAddress() const {
+      return m_baseAddress;
+    }
+
+    /**
+     * \brief Queries binding info for the current chunk
+     * \returns Descriptor buffer binding info
+     */
+    VkDescriptorBufferBindingInfoEXT getBindingInfo() const;
+
+    /**
+     * \brief Computes aligned allocation size
+     *
+     * \param [in] size Descriptor set size
+     * \returns Amount of heap memory used by the set
+     */
+    VkDeviceSize computeAllocationSize(VkDeviceSize size) const {
+      return align(size, m_alignment);
+    }
+
+    /**
+     * \brief Reserves memory for subsequent allocations
+     *
+     * Switches to a new chunk if the current chunk cannot
+     * service allocations of the given total size. This
+     * may change the base address of the heap.
+     * \param [in] size Total allocation size, computed
+     *    via \ref computeAllocationSize.
+     */
+    void reserve(VkDeviceSize size) {
+      if (unlikely(!m_mapPtr || m_offset + size > ChunkSize))
+        nextChunk();
+    }
+
+    /**
+     * \brief Allocates descriptor memory
+     *
+     * Memory must have been reserved prior to this.
+     * \param [in] size Descriptor set size
+     * \returns Offset of the set relative to the base address
+     */
+    VkDeviceSize alloc(VkDeviceSize size) {
+      VkDeviceSize offset = m_offset;
+      m_offset += computeAllocationSize(size);
+      return offset;
+    }
+
+    /**
+     * \brief Retrieves pointer to mapped descriptor memory
+     *
+     * \param [in] offset Offset relative to the base address
+     * \returns Pointer to mapped memory
+     */
+    char* mapPtr(VkDeviceSize offset) const {
+      return m_mapPtr + offset;
+    }
+
+    /**
+     * \brief Resets heap
+     *
+     * Frees chunks that were not used since the previous
+     * reset, and rewinds to the start of the first chunk.
+     */
+    void reset();
+
+  private:
+
+    DxvkDevice*                 m_device;
+    VkDeviceSize                m_alignment   = 0u;
+
+    std::vector<Rc<DxvkBuffer>> m_chunks;
+    size_t                      m_chunkIndex  = 0u;
+
+    VkDeviceAddress             m_baseAddress = 0u;
+    char*                       m_mapPtr      = nullptr;
+    VkDeviceSize                m_offset      = 0u;
+
+    void nextChunk();
+
+    void useChunk(
+            size_t                    index);
+
+    Rc<DxvkBuffer> createChunk();
+
+  };
+
+}
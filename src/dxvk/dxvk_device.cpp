@@ -22,9 +22,15 @@ namespace dxvk {
     m_features          (features),
     m_properties        (adapter->devicePropertiesExt()),
     m_perfHints         (getPerfHints()),
+    m_descriptorBuffer  (determineDescriptorBufferSupport()),
     m_objects           (this),
-    m_submissionQueue   (this, queueCallback) {
-
+    m_submissionQueue   (this, queueCallback),
+    m_perfLog           (DxvkPerfLog::createFromEnv()),
+    m_shaderLog         (DxvkShaderLog::createFromEnv()) {
+    if (m_descriptorBuffer)
+      Logger::info("DXVK: Using descriptor buffers");
+    else if (m_options.enableDescriptorBuffer == Tristate::True)
+      Logger::warn("DXVK: Descriptor buffers not supported, using descriptor sets");
   }
   
   
@@ -116,6 +122,34 @@ namespace dxvk {
   }
 
 
+  size_t DxvkDevice::getDescriptorSize(VkDescriptorType type) const {
+    const auto& properties = m_properties.extDescriptorBuffer;
+
+    // Robust buffer access is always enabled, so we
+    // need to use the robust buffer descriptor sizes
+    switch (type) {
+      case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return properties.samplerDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        return properties.combinedImageSamplerDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        return properties.sampledImageDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        return properties.storageImageDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        return properties.robustUniformTexelBufferDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return properties.robustStorageTexelBufferDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        return properties.robustUniformBufferDescriptorSize;
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        return properties.robustStorageBufferDescriptorSize;
+      default:
+        return 0u;
+    }
+  }
+
+
   bool DxvkDevice::canUsePipelineCacheControl() const {
     // Don't bother with this unless the device also supports shader module
     // identifiers, since decoding and hashing the shaders is slow otherwise
@@ -293,6 +327,11 @@ namespace dxvk {
   }
 
 
+  DxvkDefragStats DxvkDevice::getMemoryDefragStats() {
+    return m_objects.memoryManager().getDefragStats();
+  }
+
+
   uint32_t DxvkDevice::getCurrentFrameId() const {
     return m_statCounters.getCtr(DxvkStatCounter::QueuePresentCount);
   }
@@ -342,8 +381,12 @@ namespace dxvk {
 
     m_submissionQueue.present(presentInfo, latencyInfo, status);
     
-    std::lock_guard<sync::Spinlock> statLock(m_statLock);
-    m_statCounters.addCtr(DxvkStatCounter::QueuePresentCount, 1);
+    { std::lock_guard<sync::Spinlock> statLock(m_statLock);
+      m_statCounters.addCtr(DxvkStatCounter::QueuePresentCount, 1);
+    }
+
+    if (unlikely(m_perfLog))
+      m_perfLog->logFrame(getStatCounters());
   }
 
 
@@ -466,6 +509,40 @@ namespace dxvk {
   }
 
 
+  bool DxvkDevice::determineDescriptorBufferSupport() const {
+    if (!m_features.extDescriptorBuffer.descriptorBuffer
+     || m_options.enableDescriptorBuffer != Tristate::True)
+      return false;
+
+    // Each heap chunk is bound as a single buffer containing both
+    // sampler and resource descriptors, so it must fit both ranges
+    const auto& properties = m_properties.extDescriptorBuffer;
+
+    if (properties.maxSamplerDescriptorBufferRange < DxvkDescriptorHeap::ChunkSize
+     || properties.maxResourceDescriptorBufferRange < DxvkDescriptorHeap::ChunkSize)
+      return false;
+
+    // Views and samplers cache descriptors in fixed-size storage
+    static const std::array<VkDescriptorType, 8> s_types = {
+      VK_DESCRIPTOR_TYPE_SAMPLER,
+      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+      VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    };
+
+    for (auto type : s_types) {
+      if (getDescriptorSize(type) > DxvkDescriptorData::MaxSize)
+        return false;
+    }
+
+    return true;
+  }
+
+
   void DxvkDevice::recycleCommandList(const Rc<DxvkCommandList>& cmdList) {
     m_recycledCommandLists.returnObject(cmdList);
   }
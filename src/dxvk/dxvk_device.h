@@ -15,6 +15,7 @@
 #include "dxvk_meta_clear.h"
 #include "dxvk_objects.h"
 #include "dxvk_options.h"
+#include "dxvk_perf_log.h"
 #include "dxvk_pipemanager.h"
 #include "dxvk_presenter.h"
 #include "dxvk_queue.h"
@@ -22,6 +23,7 @@
 #include "dxvk_renderpass.h"
 #include "dxvk_sampler.h"
 #include "dxvk_shader.h"
+#include "dxvk_shader_log.h"
 #include "dxvk_sparse.h"
 #include "dxvk_stats.h"
 #include "dxvk_unbound.h"
@@ -255,6 +257,26 @@ namespace dxvk {
      */
     bool canUseGraphicsPipelineLibrary() const;
 
+    /**
+     * \brief Checks whether descriptor buffers can be used
+     *
+     * If this is \c true, all shader resource bindings will
+     * use descriptor buffers instead of descriptor sets.
+     * \returns \c true if descriptor buffers are enabled
+     */
+    bool canUseDescriptorBuffer() const {
+      return m_descriptorBuffer;
+    }
+
+    /**
+     * \brief Queries descriptor size for descriptor buffers
+     *
+     * Only valid if descriptor buffers can be used.
+     * \param [in] type Descriptor type
+     * \returns Size of a single descriptor, in bytes
+     */
+    size_t getDescriptorSize(VkDescriptorType type) const;
+
     /**
      * \brief Checks whether pipeline creation cache control can be used
      * \returns \c true if all required features are supported.
@@ -439,6 +461,12 @@ namespace dxvk {
      */
     DxvkSharedAllocationCacheStats getMemoryAllocationStats(DxvkMemoryAllocationStats& stats);
 
+    /**
+     * \brief Queries memory defragmentation statistics
+     * \returns Defragmentation statistics
+     */
+    DxvkDefragStats getMemoryDefragStats();
+
     /**
      * \brief Queries sampler statistics
      * \returns Sampler stats
@@ -467,6 +495,17 @@ namespace dxvk {
       m_adapter->notifyMemoryStats(heap, allocated, used);
     }
 
+    /**
+     * \brief Queries shader translation log
+     *
+     * Client APIs must report translated shaders
+     * to the log if this returns a valid log.
+     * \returns Shader log, or \c nullptr
+     */
+    DxvkShaderLog* getShaderLog() const {
+      return m_shaderLog.get();
+    }
+
     /**
      * \brief Registers a shader
      * \param [in] shader Newly compiled shader
@@ -610,6 +649,7 @@ namespace dxvk {
     DxvkDeviceInfo              m_properties;
     
     DxvkDevicePerfHints         m_perfHints;
+    bool                        m_descriptorBuffer = false;
     DxvkObjects                 m_objects;
 
     sync::Spinlock              m_statLock;
@@ -619,7 +659,12 @@ namespace dxvk {
     
     DxvkSubmissionQueue         m_submissionQueue;
 
+    std::unique_ptr<DxvkPerfLog> m_perfLog;
+    std::unique_ptr<DxvkShaderLog> m_shaderLog;
+
     DxvkDevicePerfHints getPerfHints();
+
+    bool determineDescriptorBufferSupport() const;
     
     void recycleCommandList(
       const Rc<DxvkCommandList>& cmdList);
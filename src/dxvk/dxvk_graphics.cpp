@@ -244,6 +244,9 @@ namespace dxvk {
     info.pDynamicState        = &dyInfo;
     info.basePipelineIndex    = -1;
 
+    if (m_device->canUseDescriptorBuffer())
+      info.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     VkResult vr = vk->vkCreateGraphicsPipelines(vk->device(),
       VK_NULL_HANDLE, 1, &info, nullptr, &m_pipeline);
 
@@ -518,6 +521,9 @@ namespace dxvk {
     info.pDynamicState        = &dyInfo;
     info.basePipelineIndex    = -1;
 
+    if (m_device->canUseDescriptorBuffer())
+      info.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     VkResult vr = vk->vkCreateGraphicsPipelines(vk->device(),
       VK_NULL_HANDLE, 1, &info, nullptr, &m_pipeline);
 
@@ -1058,8 +1064,9 @@ namespace dxvk {
 
 
   DxvkGraphicsPipelineHandle DxvkGraphicsPipeline::getPipelineHandle(
-    const DxvkGraphicsPipelineStateInfo& state) {
-    DxvkGraphicsPipelineInstance* instance = this->findInstance(state);
+    const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash) {
+    DxvkGraphicsPipelineInstance* instance = this->findInstance(state, hash);
 
     if (unlikely(!instance)) {
       // Exit early if the state vector is invalid
@@ -1068,13 +1075,13 @@ namespace dxvk {
 
       // Prevent other threads from adding new instances and check again
       std::unique_lock<dxvk::mutex> lock(m_mutex);
-      instance = this->findInstance(state);
+      instance = this->findInstance(state, hash);
 
       if (!instance) {
         // Keep pipeline object locked, at worst we're going to stall
         // a state cache worker and the current thread needs priority.
         bool canCreateBasePipeline = this->canCreateBasePipeline(state);
-        instance = this->createInstance(state, canCreateBasePipeline);
+        instance = this->createInstance(state, hash, canCreateBasePipeline);
 
         // Unlock here since we may dispatch the pipeline to a worker,
         // which will then acquire it to increment the use counter.
@@ -1101,7 +1108,9 @@ namespace dxvk {
       return;
 
     // Try to find an existing instance that contains a base pipeline
-    DxvkGraphicsPipelineInstance* instance = this->findInstance(state);
+    size_t hash = state.hash();
+
+    DxvkGraphicsPipelineInstance* instance = this->findInstance(state, hash);
 
     if (!instance) {
       // Exit early if the state vector is invalid
@@ -1115,10 +1124,10 @@ namespace dxvk {
 
       // Prevent other threads from adding new instances and check again
       std::unique_lock<dxvk::mutex> lock(m_mutex);
-      instance = this->findInstance(state);
+      instance = this->findInstance(state, hash);
 
       if (!instance)
-        instance = this->createInstance(state, false);
+        instance = this->createInstance(state, hash, false);
     }
 
     // Exit if another thread is already compiling
@@ -1177,6 +1186,7 @@ namespace dxvk {
 
   DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::createInstance(
     const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash,
           bool                           doCreateBasePipeline) {
     VkPipeline baseHandle = VK_NULL_HANDLE;
     VkPipeline fastHandle = VK_NULL_HANDLE;
@@ -1193,18 +1203,16 @@ namespace dxvk {
       this->logPipelineState(LogLevel::Error, state);
 
     m_stats->numGraphicsPipelines += 1;
-    return &(*m_pipelines.emplace(state, baseHandle, fastHandle, computeAttachmentMask(state)));
+    return m_pipelines.emplace(hash, state, baseHandle, fastHandle, computeAttachmentMask(state));
   }
   
   
   DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::findInstance(
-    const DxvkGraphicsPipelineStateInfo& state) {
-    for (auto& instance : m_pipelines) {
-      if (instance.state == state)
-        return &instance;
-    }
-    
-    return nullptr;
+    const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash) {
+    return m_pipelines.find(hash, [&state] (const DxvkGraphicsPipelineInstance& instance) {
+      return instance.state == state;
+    });
   }
   
   
@@ -1425,6 +1433,9 @@ namespace dxvk {
     if (key.foState.feedbackLoop & VK_IMAGE_ASPECT_DEPTH_BIT)
       info.flags |= VK_PIPELINE_CREATE_DEPTH_STENCIL_ATTACHMENT_FEEDBACK_LOOP_BIT_EXT;
 
+    if (m_device->canUseDescriptorBuffer())
+      info.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkResult vr = vk->vkCreateGraphicsPipelines(vk->device(), VK_NULL_HANDLE, 1, &info, nullptr, &pipeline);
 
@@ -2,7 +2,7 @@
 
 #include <mutex>
 
-#include "../util/sync/sync_list.h"
+#include "../util/sync/sync_hashlist.h"
 
 #include "dxvk_bind_mask.h"
 #include "dxvk_constant_state.h"
@@ -556,10 +556,12 @@ namespace dxvk {
      * Retrieves a pipeline handle for the given pipeline
      * state. If necessary, a new pipeline will be created.
      * \param [in] state Pipeline state vector
+     * \param [in] hash Hash of the pipeline state vector
      * \returns Pipeline handle and handle type
      */
     DxvkGraphicsPipelineHandle getPipelineHandle(
-      const DxvkGraphicsPipelineStateInfo&    state);
+      const DxvkGraphicsPipelineStateInfo&    state,
+            size_t                            hash);
     
     /**
      * \brief Compiles a pipeline
@@ -624,7 +626,7 @@ namespace dxvk {
 
     alignas(CACHE_LINE_SIZE)
     dxvk::mutex                                   m_mutex;
-    sync::List<DxvkGraphicsPipelineInstance>      m_pipelines;
+    sync::HashList<DxvkGraphicsPipelineInstance, 64> m_pipelines;
     uint32_t                                      m_useCount = 0;
 
     std::unordered_map<
@@ -639,10 +641,12 @@ namespace dxvk {
 
     DxvkGraphicsPipelineInstance* createInstance(
       const DxvkGraphicsPipelineStateInfo& state,
+            size_t                         hash,
             bool                           doCreateBasePipeline);
     
     DxvkGraphicsPipelineInstance* findInstance(
-      const DxvkGraphicsPipelineStateInfo& state);
+      const DxvkGraphicsPipelineStateInfo& state,
+            size_t                         hash);
 
     bool canCreateBasePipeline(
       const DxvkGraphicsPipelineStateInfo& state) const;
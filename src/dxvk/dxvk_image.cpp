@@ -523,6 +523,32 @@ namespace dxvk {
   }
 
 
+  const void* DxvkImageView::createDescriptorData(
+          VkDescriptorType          type,
+          VkImageViewType           viewType,
+          size_t                    size) {
+    auto vk = m_image->m_vkd;
+
+    VkDescriptorImageInfo imageInfo = { };
+    imageInfo.imageView = handle(viewType);
+    imageInfo.imageLayout = type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+      ? VK_IMAGE_LAYOUT_GENERAL
+      : m_properties.layout;
+
+    VkDescriptorGetInfoEXT info = { VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT };
+    info.type = type;
+
+    if (type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+      info.data.pStorageImage = &imageInfo;
+    else
+      info.data.pSampledImage = &imageInfo;
+
+    void* data = m_descriptors.store(getDescriptorIndex(type), uint64_t(viewType));
+    vk->vkGetDescriptorEXT(vk->device(), &info, size, data);
+    return data;
+  }
+
+
   void DxvkImageView::updateViews() {
     // Latch updated image properties
     updateProperties();
@@ -533,6 +559,9 @@ namespace dxvk {
         m_views[i] = createView(VkImageViewType(i));
     }
 
+    // Cached descriptors reference the old views
+    m_descriptors.clear();
+
     m_version = m_image->m_version;
   }
 
@@ -254,6 +254,24 @@ namespace dxvk {
       return result;
     }
 
+    /**
+     * \brief Retrieves raw descriptor for descriptor buffers
+     *
+     * Lazily creates and caches the descriptor for the given view
+     * type. Sampled image descriptors use the default layout, and
+     * storage image descriptors use \c VK_IMAGE_LAYOUT_GENERAL.
+     * The view must be valid for the requested view type, and
+     * the device must use descriptor buffers.
+     * \param [in] type Sampled or storage image
+     * \param [in] viewType Exact view type
+     * \param [in] size Descriptor size for the given type
+     * \returns Pointer to raw descriptor data
+     */
+    const void* getDescriptorData(
+            VkDescriptorType          type,
+            VkImageViewType           viewType,
+            size_t                    size);
+
     /**
      * \brief Checks whether this view matches another
      *
@@ -322,8 +340,19 @@ namespace dxvk {
 
     std::array<VkImageView, ViewCount> m_views = { };
 
+    DxvkDescriptorCache<2> m_descriptors;
+
     VkImageView createView(VkImageViewType type) const;
 
+    const void* createDescriptorData(
+            VkDescriptorType          type,
+            VkImageViewType           viewType,
+            size_t                    size);
+
+    static uint32_t getDescriptorIndex(VkDescriptorType type) {
+      return type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ? 1u : 0u;
+    }
+
     void updateViews();
 
     void updateProperties();
@@ -804,6 +833,24 @@ namespace dxvk {
   }
 
 
+  inline const void* DxvkImageView::getDescriptorData(
+          VkDescriptorType          type,
+          VkImageViewType           viewType,
+          size_t                    size) {
+    viewType = viewType != VK_IMAGE_VIEW_TYPE_MAX_ENUM ? viewType : m_key.viewType;
+
+    if (unlikely(m_version < m_image->m_version))
+      updateViews();
+
+    const void* data = m_descriptors.find(getDescriptorIndex(type), uint64_t(viewType));
+
+    if (likely(data))
+      return data;
+
+    return createDescriptorData(type, viewType, size);
+  }
+
+
   inline bool DxvkImageView::hasGfxStores() const {
     return (m_properties.access & VK_ACCESS_SHADER_WRITE_BIT)
         && (m_image->hasGfxStores());
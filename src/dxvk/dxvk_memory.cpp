@@ -39,8 +39,8 @@ namespace dxvk {
   DxvkResourceBufferViewMap::DxvkResourceBufferViewMap(
           DxvkMemoryAllocator*        allocator,
           VkBuffer                    buffer)
-  : m_vkd(allocator->device()->vkd()), m_buffer(buffer),
-    m_passBufferUsage(allocator->device()->features().khrMaintenance5.maintenance5) {
+  : m_vkd(allocator->vkd()), m_buffer(buffer),
+    m_passBufferUsage(allocator->features().khrMaintenance5.maintenance5) {
 
   }
 
@@ -96,7 +96,7 @@ namespace dxvk {
   DxvkResourceImageViewMap::DxvkResourceImageViewMap(
           DxvkMemoryAllocator*        allocator,
           VkImage                     image)
-  : m_vkd(allocator->device()->vkd()), m_image(image) {
+  : m_vkd(allocator->vkd()), m_image(image) {
 
   }
 
@@ -151,7 +151,7 @@ namespace dxvk {
         delete m_bufferViews;
 
       if (unlikely(m_flags.test(DxvkAllocationFlag::OwnsBuffer))) {
-        auto vk = m_allocator->device()->vkd();
+        auto vk = m_allocator->vkd();
         vk->vkDestroyBuffer(vk->device(), m_buffer, nullptr);
       }
     }
@@ -161,13 +161,13 @@ namespace dxvk {
         delete m_imageViews;
 
       if (likely(m_flags.test(DxvkAllocationFlag::OwnsImage))) {
-        auto vk = m_allocator->device()->vkd();
+        auto vk = m_allocator->vkd();
         vk->vkDestroyImage(vk->device(), m_image, nullptr);
       }
     }
 
     if (unlikely(m_flags.test(DxvkAllocationFlag::OwnsMemory))) {
-      auto vk = m_allocator->device()->vkd();
+      auto vk = m_allocator->vkd();
       vk->vkFreeMemory(vk->device(), m_memory, nullptr);
 
       if (unlikely(m_sparsePageTable))
@@ -326,7 +326,7 @@ namespace dxvk {
     }
 
     if (!(--pool.listCount))
-      pool.drainTime = high_resolution_clock::now();
+      pool.drainTime = m_allocator->m_backend->now();
 
     // Extract allocations and mark list as free
     DxvkResourceAllocation* allocation = m_lists[listIndex].head;
@@ -521,9 +521,108 @@ namespace dxvk {
 
 
 
+  DxvkMemoryBackend::~DxvkMemoryBackend() {
+
+  }
+
+
+
+
+  DxvkDeviceMemoryBackend::DxvkDeviceMemoryBackend(DxvkDevice* device)
+  : m_device(device) {
+
+  }
+
+
+  DxvkDeviceMemoryBackend::~DxvkDeviceMemoryBackend() {
+
+  }
+
+
+  DxvkDevice* DxvkDeviceMemoryBackend::device() const {
+    return m_device;
+  }
+
+
+  Rc<vk::DeviceFn> DxvkDeviceMemoryBackend::vkd() const {
+    return m_device->vkd();
+  }
+
+
+  const DxvkDeviceFeatures& DxvkDeviceMemoryBackend::features() const {
+    return m_device->features();
+  }
+
+
+  const DxvkDeviceInfo& DxvkDeviceMemoryBackend::properties() const {
+    return m_device->properties();
+  }
+
+
+  const DxvkOptions& DxvkDeviceMemoryBackend::config() const {
+    return m_device->config();
+  }
+
+
+  DxvkDebugFlags DxvkDeviceMemoryBackend::debugFlags() const {
+    return m_device->debugFlags();
+  }
+
+
+  DxvkSharingModeInfo DxvkDeviceMemoryBackend::getSharingMode() const {
+    return m_device->getSharingMode();
+  }
+
+
+  VkPhysicalDeviceMemoryProperties DxvkDeviceMemoryBackend::memoryProperties() const {
+    return m_device->adapter()->memoryProperties();
+  }
+
+
+  DxvkAdapterMemoryInfo DxvkDeviceMemoryBackend::getMemoryHeapInfo() const {
+    return m_device->adapter()->getMemoryHeapInfo();
+  }
+
+
+  void DxvkDeviceMemoryBackend::getMemoryBudget(
+          VkPhysicalDeviceMemoryBudgetPropertiesEXT& budget) const {
+    VkPhysicalDeviceMemoryProperties2 memInfo = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2, &budget };
+
+    auto adapter = m_device->adapter();
+    adapter->vki()->vkGetPhysicalDeviceMemoryProperties2(adapter->handle(), &memInfo);
+  }
+
+
+  bool DxvkDeviceMemoryBackend::matchesDriver(
+          VkDriverIdKHR       driver) const {
+    return m_device->adapter()->matchesDriver(driver);
+  }
+
+
+  void DxvkDeviceMemoryBackend::notifyMemoryStats(
+          uint32_t            heap,
+          int64_t             allocated,
+          int64_t             used) {
+    m_device->notifyMemoryStats(heap, allocated, used);
+  }
+
+
+  high_resolution_clock::time_point DxvkDeviceMemoryBackend::now() const {
+    return high_resolution_clock::now();
+  }
+
+
+
+
   DxvkMemoryAllocator::DxvkMemoryAllocator(DxvkDevice* device)
-  : m_device(device), m_sharingModeInfo(m_device->getSharingMode()) {
-    VkPhysicalDeviceMemoryProperties memInfo = m_device->adapter()->memoryProperties();
+  : DxvkMemoryAllocator(std::make_unique<DxvkDeviceMemoryBackend>(device)) {
+
+  }
+
+
+  DxvkMemoryAllocator::DxvkMemoryAllocator(std::unique_ptr<DxvkMemoryBackend>&& backend)
+  : m_backend(std::move(backend)), m_sharingModeInfo(m_backend->getSharingMode()) {
+    VkPhysicalDeviceMemoryProperties memInfo = m_backend->memoryProperties();
 
     m_memTypeCount = memInfo.memoryTypeCount;
     m_memHeapCount = memInfo.memoryHeapCount;
@@ -556,18 +655,18 @@ namespace dxvk {
 
     determineMemoryTypesWithPropertyFlags();
 
-    if (device->features().core.features.sparseBinding)
-      m_sparseMemoryTypes = determineSparseMemoryTypes(device);
+    if (m_backend->features().core.features.sparseBinding)
+      m_sparseMemoryTypes = determineSparseMemoryTypes();
 
     determineBufferUsageFlagsPerMemoryType();
 
     updateMemoryHeapBudgets();
+
+    m_trace = DxvkAllocationTrace::createFromEnv(getAllocationTraceHeader());
   }
   
   
   DxvkMemoryAllocator::~DxvkMemoryAllocator() {
-    auto vk = m_device->vkd();
-
     // Free all resources that are still queued up for relocation
     // before destroying any allocator structures
     m_relocations.clear();
@@ -586,7 +685,7 @@ namespace dxvk {
     // Ensure adapter allocation statistics are consistent
     // when the deivce is being destroyed
     for (uint32_t i = 0; i < m_memHeapCount; i++) {
-      m_device->notifyMemoryStats(i,
+      m_backend->notifyMemoryStats(i,
         -m_adapterHeapStats[i].memoryAllocated,
         -m_adapterHeapStats[i].memoryUsed);
     }
@@ -598,6 +697,18 @@ namespace dxvk {
     const DxvkAllocationInfo&               allocationInfo) {
     std::lock_guard<dxvk::mutex> lock(m_mutex);
 
+    DxvkResourceAllocation* allocation = allocateMemoryLocked(requirements, allocationInfo);
+
+    if (unlikely(m_trace))
+      traceAllocation(DxvkAllocationTraceEvent::Allocate, requirements, allocationInfo, allocation);
+
+    return allocation;
+  }
+
+
+  DxvkResourceAllocation* DxvkMemoryAllocator::allocateMemoryLocked(
+    const VkMemoryRequirements&             requirements,
+    const DxvkAllocationInfo&               allocationInfo) {
     // Ensure the allocation size is also aligned
     VkDeviceSize size = align(requirements.size, requirements.alignment);
 
@@ -720,6 +831,19 @@ namespace dxvk {
     const void*                             next) {
     std::lock_guard<dxvk::mutex> lock(m_mutex);
 
+    DxvkResourceAllocation* allocation = allocateDedicatedMemoryLocked(requirements, allocationInfo, next);
+
+    if (unlikely(m_trace))
+      traceAllocation(DxvkAllocationTraceEvent::AllocateDedicated, requirements, allocationInfo, allocation);
+
+    return allocation;
+  }
+
+
+  DxvkResourceAllocation* DxvkMemoryAllocator::allocateDedicatedMemoryLocked(
+    const VkMemoryRequirements&             requirements,
+    const DxvkAllocationInfo&               allocationInfo,
+    const void*                             next) {
     DxvkDeviceMemory memory = { };
 
     for (auto typeIndex : bit::BitMask(requirements.memoryTypeBits & getMemoryTypeMask(allocationInfo.properties))) {
@@ -763,18 +887,22 @@ namespace dxvk {
          && (allocationInfo.properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
           allocation = allocationCache->allocateFromCache(createInfo.size);
 
-          if (likely(allocation))
-            return allocation;
-
           // If the cache is currently empty for the required allocation size,
           // make sure it's not. This will also initialize the shared caches
           // for any relevant memory pools as necessary.
-          if (refillAllocationCache(allocationCache, memoryRequirements, allocationInfo.properties))
-            return allocationCache->allocateFromCache(createInfo.size);
+          if (!allocation && refillAllocationCache(allocationCache, memoryRequirements, allocationInfo.properties))
+            allocation = allocationCache->allocateFromCache(createInfo.size);
+
+          if (likely(allocation)) {
+            if (unlikely(m_trace))
+              traceAllocation(DxvkAllocationTraceEvent::AllocateCached, memoryRequirements, allocationInfo, allocation.ptr());
+
+            return allocation;
+          }
         } else {
           // Do not suballocate buffers if debug mode is enabled in order
           // to allow the application to set meaningful debug names.
-          allowSuballocation = !m_device->debugFlags().test(DxvkDebugFlag::Capture);
+          allowSuballocation = !m_backend->debugFlags().test(DxvkDebugFlag::Capture);
         }
 
         // If there is at least one memory type that supports the required
@@ -821,7 +949,7 @@ namespace dxvk {
 
     // If we can't suballocate from an existing global buffer
     // for any reason, create a dedicated buffer resource.
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
     VkBuffer buffer = VK_NULL_HANDLE;
     VkResult vr = vk->vkCreateBuffer(vk->device(),
@@ -861,7 +989,7 @@ namespace dxvk {
       }
     } else {
       allocation = createAllocation(
-        new DxvkSparsePageTable(m_device, createInfo, buffer),
+        new DxvkSparsePageTable(m_backend->device(), createInfo, buffer),
         allocationInfo);
     }
 
@@ -902,7 +1030,7 @@ namespace dxvk {
     const VkImageCreateInfo&          createInfo,
     const DxvkAllocationInfo&         allocationInfo,
     const void*                       next) {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
     VkImage image = VK_NULL_HANDLE;
     VkResult vr = vk->vkCreateImage(vk->device(), &createInfo, nullptr, &image);
@@ -965,7 +1093,7 @@ namespace dxvk {
         if (createInfo.tiling == VK_IMAGE_TILING_OPTIMAL) {
           requirements.memoryRequirements.alignment = std::max(
             requirements.memoryRequirements.alignment,
-            m_device->properties().core.properties.limits.bufferImageGranularity);
+            m_backend->properties().core.properties.limits.bufferImageGranularity);
         }
 
         // Try to suballocate memory and fall back to system memory on error.
@@ -982,7 +1110,7 @@ namespace dxvk {
     } else {
       // Create a sparse page table and determine whether we need to allocate
       // actual memory for the metadata aspect of the image or not.
-      auto pageTable = std::make_unique<DxvkSparsePageTable>(m_device, createInfo, image);
+      auto pageTable = std::make_unique<DxvkSparsePageTable>(m_backend->device(), createInfo, image);
       auto pageProperties = pageTable->getProperties();
 
       if (pageProperties.metadataPageCount) {
@@ -1117,7 +1245,7 @@ namespace dxvk {
           DxvkMemoryType&       type,
           VkDeviceSize          size,
     const void*                 next) {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
     // If global buffers are enabled for this allocation, pad the allocation size
     // to a multiple of the global buffer alignment. This can happen when we create
@@ -1126,7 +1254,7 @@ namespace dxvk {
       size = align(size, GlobalBufferAlignment);
 
     // Preemptively free some unused allocations to reduce memory waste
-    freeEmptyChunksInHeap(*type.heap, size, high_resolution_clock::now());
+    freeEmptyChunksInHeap(*type.heap, size, m_backend->now());
 
     VkMemoryAllocateInfo memoryInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, next };
     memoryInfo.allocationSize = size;
@@ -1150,7 +1278,7 @@ namespace dxvk {
         priorityInfo.priority = 0.5f;
       }
 
-      if (m_device->features().extMemoryPriority.memoryPriority)
+      if (m_backend->features().extMemoryPriority.memoryPriority)
         priorityInfo.pNext = std::exchange(memoryInfo.pNext, &priorityInfo);
     }
 
@@ -1175,7 +1303,7 @@ namespace dxvk {
     }
 
     // Technically redundant if EXT_memory_priority is also supported, but this shouldn't hurt
-    if (m_device->features().extPageableDeviceLocalMemory.pageableDeviceLocalMemory)
+    if (m_backend->features().extPageableDeviceLocalMemory.pageableDeviceLocalMemory)
       vk->vkSetDeviceMemoryPriorityEXT(vk->device(), result.memory, priorityInfo.priority);
 
     // Create global buffer if the allocation supports it
@@ -1222,7 +1350,7 @@ namespace dxvk {
 
     result.cookie = ++m_nextCookie;
 
-    if (unlikely(m_device->debugFlags().test(DxvkDebugFlag::Capture)))
+    if (unlikely(m_backend->debugFlags().test(DxvkDebugFlag::Capture)))
       assignMemoryDebugName(result, type);
 
     type.stats.memoryAllocated += size;
@@ -1233,7 +1361,7 @@ namespace dxvk {
   void DxvkMemoryAllocator::assignMemoryDebugName(
     const DxvkDeviceMemory&     memory,
     const DxvkMemoryType&       type) {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
     const char* memoryType = "Unspecified memory";
 
@@ -1334,7 +1462,7 @@ namespace dxvk {
     if (chunk.memory.mapPtr) {
       allocation->m_mapPtr = reinterpret_cast<char*>(chunk.memory.mapPtr) + offset;
 
-      if (unlikely(m_device->config().zeroMappedMemory)) {
+      if (unlikely(m_backend->config().zeroMappedMemory)) {
         // Some games will not write mapped buffers and will break if
         // there is any stale data stored within. Clear when the allocation is
         // freed, so that subsequent allocations will receive cleared buffers.
@@ -1397,7 +1525,7 @@ namespace dxvk {
   void DxvkMemoryAllocator::freeDeviceMemory(
           DxvkMemoryType&       type,
           DxvkDeviceMemory      memory) {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
     vk->vkDestroyBuffer(vk->device(), memory.buffer, nullptr);
     vk->vkFreeMemory(vk->device(), memory.memory, nullptr);
 
@@ -1407,6 +1535,16 @@ namespace dxvk {
 
   void DxvkMemoryAllocator::freeAllocation(
           DxvkResourceAllocation* allocation) {
+    if (unlikely(m_trace) && allocation->m_type) {
+      DxvkAllocationTraceRecord record = { };
+      record.event = DxvkAllocationTraceEvent::Free;
+      record.memoryType = allocation->m_type->index;
+      record.handle = reinterpret_cast<uintptr_t>(allocation);
+      record.size = allocation->m_size;
+
+      m_trace->record(record);
+    }
+
     if (allocation->m_flags.test(DxvkAllocationFlag::ClearOnFree)) {
       if (allocation->m_mapPtr)
         bit::bclear(allocation->m_mapPtr, allocation->m_size);
@@ -1445,7 +1583,7 @@ namespace dxvk {
             uint32_t chunkIndex = allocation->m_address >> DxvkPageAllocator::ChunkAddressBits;
             pool.chunks[chunkIndex].canMove = true;
 
-            if (freeEmptyChunksInPool(*allocation->m_type, pool, 0, high_resolution_clock::now()))
+            if (freeEmptyChunksInPool(*allocation->m_type, pool, 0, m_backend->now()))
               updateMemoryHeapStats(allocation->m_type->properties.heapIndex);
           }
         }
@@ -1486,7 +1624,7 @@ namespace dxvk {
       allocation->m_type->stats.memoryUsed -= allocation->m_size;
 
       if (unlikely(pool.free(allocation->m_address, allocation->m_size))) {
-        if (freeEmptyChunksInPool(*allocation->m_type, pool, 0, high_resolution_clock::now()))
+        if (freeEmptyChunksInPool(*allocation->m_type, pool, 0, m_backend->now()))
           updateMemoryHeapStats(allocation->m_type->properties.heapIndex);
       }
 
@@ -1603,7 +1741,7 @@ namespace dxvk {
       if (memory.mapPtr)
         return;
 
-      auto vk = m_device->vkd();
+      auto vk = m_backend->vkd();
 
       VkResult vr = vk->vkMapMemory(vk->device(),
         memory.memory, 0, memory.size, 0, &memory.mapPtr);
@@ -1613,7 +1751,7 @@ namespace dxvk {
           "\n  size: ", memory.size, " bytes"));
       }
 
-      if (m_device->config().zeroMappedMemory)
+      if (m_backend->config().zeroMappedMemory)
         bit::bclear(memory.mapPtr, memory.size);
 
       Logger::debug(str::format("Mapped memory region 0x", std::hex,
@@ -1623,7 +1761,7 @@ namespace dxvk {
       if (!memory.mapPtr)
         return;
 
-      auto vk = m_device->vkd();
+      auto vk = m_backend->vkd();
       vk->vkUnmapMemory(vk->device(), memory.memory);
 
       Logger::debug(str::format("Unmapped memory region 0x", std::hex,
@@ -1769,9 +1907,8 @@ namespace dxvk {
   }
 
 
-  uint32_t DxvkMemoryAllocator::determineSparseMemoryTypes(
-          DxvkDevice*           device) const {
-    auto vk = device->vkd();
+  uint32_t DxvkMemoryAllocator::determineSparseMemoryTypes() const {
+    auto vk = m_backend->vkd();
 
     VkMemoryRequirements2 requirements = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
     uint32_t typeMask = ~0u;
@@ -1835,17 +1972,17 @@ namespace dxvk {
     // otherwise not be able to legally use formats that support one type of
     // texel buffer but not the other. Also lock index buffer usage since we
     // cannot explicitly specify a buffer range otherwise.
-    if (m_device->features().khrMaintenance5.maintenance5) {
+    if (m_backend->features().khrMaintenance5.maintenance5) {
       flags |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT
             |  VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
     }
 
-    if (m_device->features().extTransformFeedback.transformFeedback) {
+    if (m_backend->features().extTransformFeedback.transformFeedback) {
       flags |= VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_BUFFER_BIT_EXT
             |  VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_COUNTER_BUFFER_BIT_EXT;
     }
 
-    if (m_device->features().vk12.bufferDeviceAddress)
+    if (m_backend->features().vk12.bufferDeviceAddress)
       flags |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 
     // Check which individual flags are supported on each memory type. This is a
@@ -2010,9 +2147,9 @@ namespace dxvk {
   bool DxvkMemoryAllocator::getBufferMemoryRequirements(
     const VkBufferCreateInfo&     createInfo,
           VkMemoryRequirements2&  memoryRequirements) const {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
-    if (m_device->features().vk13.maintenance4) {
+    if (m_backend->features().vk13.maintenance4) {
       VkDeviceBufferMemoryRequirements info = { VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS };
       info.pCreateInfo = &createInfo;
 
@@ -2035,9 +2172,9 @@ namespace dxvk {
   bool DxvkMemoryAllocator::getImageMemoryRequirements(
     const VkImageCreateInfo&      createInfo,
           VkMemoryRequirements2&  memoryRequirements) const {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
-    if (m_device->features().vk13.maintenance4) {
+    if (m_backend->features().vk13.maintenance4) {
       VkDeviceImageMemoryRequirements info = { VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS };
       info.pCreateInfo = &createInfo;
 
@@ -2086,7 +2223,7 @@ namespace dxvk {
 
 
   VkDeviceAddress DxvkMemoryAllocator::getBufferDeviceAddress(VkBuffer buffer) const {
-    auto vk = m_device->vkd();
+    auto vk = m_backend->vkd();
 
     VkBufferDeviceAddressInfo bdaInfo = { VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
     bdaInfo.buffer = buffer;
@@ -2119,7 +2256,7 @@ namespace dxvk {
 
 
   void DxvkMemoryAllocator::logMemoryStats() const {
-    DxvkAdapterMemoryInfo memHeapInfo = m_device->adapter()->getMemoryHeapInfo();
+    DxvkAdapterMemoryInfo memHeapInfo = m_backend->getMemoryHeapInfo();
 
     std::stringstream sstr;
     sstr << "Heap  Size (MiB)  Allocated   Used        Reserved    Budget" << std::endl;
@@ -2132,7 +2269,7 @@ namespace dxvk {
            << std::setw(6) << (stats.memoryAllocated >> 20) << "      "
            << std::setw(6) << (stats.memoryUsed >> 20) << "      ";
 
-      if (m_device->features().extMemoryBudget) {
+      if (m_backend->features().extMemoryBudget) {
         sstr << std::setw(6) << (memHeapInfo.heaps[i].memoryAllocated >> 20) << "      "
              << std::setw(6) << (memHeapInfo.heaps[i].memoryBudget >> 20) << "      " << std::endl;
       } else {
@@ -2166,14 +2303,12 @@ namespace dxvk {
 
 
   void DxvkMemoryAllocator::updateMemoryHeapBudgets() {
-    if (!m_device->features().extMemoryBudget)
+    if (!m_backend->features().extMemoryBudget)
       return;
 
     VkPhysicalDeviceMemoryBudgetPropertiesEXT memBudget = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
-    VkPhysicalDeviceMemoryProperties2 memInfo = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2, &memBudget };
 
-    auto vki = m_device->adapter()->vki();
-    vki->vkGetPhysicalDeviceMemoryProperties2(m_device->adapter()->handle(), &memInfo);
+    m_backend->getMemoryBudget(memBudget);
 
     for (uint32_t i = 0; i < m_memHeapCount; i++) {
       if (memBudget.heapBudget[i]) {
@@ -2189,10 +2324,75 @@ namespace dxvk {
   }
 
 
+  DxvkAllocationTraceHeader DxvkMemoryAllocator::getAllocationTraceHeader() const {
+    DxvkAllocationTraceHeader header;
+    header.memoryTypeCount = m_memTypeCount;
+    header.memoryHeapCount = m_memHeapCount;
+    header.minChunkSize = DxvkMemoryPool::MinChunkSize;
+
+    for (uint32_t i = 0; i < m_memTypeCount; i++) {
+      auto& type = header.memoryTypes[i];
+      type.heapIndex = m_memTypes[i].properties.heapIndex;
+      type.propertyFlags = m_memTypes[i].properties.propertyFlags;
+      type.deviceMaxChunkSize = m_memTypes[i].devicePool.maxChunkSize;
+      type.mappedMaxChunkSize = m_memTypes[i].mappedPool.maxChunkSize;
+      type.mappedNextChunkSize = m_memTypes[i].mappedPool.nextChunkSize;
+    }
+
+    for (uint32_t i = 0; i < m_memHeapCount; i++) {
+      header.memoryHeaps[i].size = m_memHeaps[i].properties.size;
+      header.memoryHeaps[i].budget = m_memHeaps[i].memoryBudget;
+    }
+
+    return header;
+  }
+
+
+  void DxvkMemoryAllocator::traceAllocation(
+          DxvkAllocationTraceEvent  event,
+    const VkMemoryRequirements&     requirements,
+    const DxvkAllocationInfo&       allocationInfo,
+    const DxvkResourceAllocation*   allocation) {
+    DxvkAllocationTraceRecord record = { };
+    record.event = event;
+    record.memoryType = allocation ? uint8_t(allocation->m_type->index) : uint8_t(0xffu);
+    record.memoryTypeBits = requirements.memoryTypeBits;
+    record.handle = reinterpret_cast<uintptr_t>(allocation);
+    record.size = requirements.size;
+    record.alignment = requirements.alignment;
+
+    // Cached allocations are rounded up to a power of two
+    if (event == DxvkAllocationTraceEvent::AllocateCached)
+      record.size = allocation->m_size;
+
+    if (allocationInfo.properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      record.flags.set(DxvkAllocationTraceFlag::HostVisible);
+
+    if (allocationInfo.properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+      record.flags.set(DxvkAllocationTraceFlag::DeviceLocal);
+
+    if (allocation && allocation->m_flags.test(DxvkAllocationFlag::OwnsMemory))
+      record.flags.set(DxvkAllocationTraceFlag::Dedicated);
+
+    if (allocationInfo.mode.test(DxvkAllocationMode::NoAllocation))
+      record.flags.set(DxvkAllocationTraceFlag::NoAllocation);
+
+    m_trace->record(record);
+  }
+
+
+  void DxvkMemoryAllocator::traceSubmission() {
+    DxvkAllocationTraceRecord record = { };
+    record.event = DxvkAllocationTraceEvent::Submit;
+
+    m_trace->record(record);
+  }
+
+
   void DxvkMemoryAllocator::updateMemoryHeapStats(uint32_t heapIndex) {
     DxvkMemoryStats stats = getMemoryStats(heapIndex);
 
-    m_device->notifyMemoryStats(heapIndex,
+    m_backend->notifyMemoryStats(heapIndex,
       stats.memoryAllocated - m_adapterHeapStats[heapIndex].memoryAllocated,
       stats.memoryUsed - m_adapterHeapStats[heapIndex].memoryUsed);
 
@@ -2253,94 +2453,20 @@ namespace dxvk {
     // amount of memory wasted, or if we're under memory pressure.
     auto heapStats = getMemoryStats(type.heap->index);
 
-    if (heapStats.memoryAllocated <= heapStats.memoryBudget) {
-      uint32_t pagesTotal = 0u;
-      uint32_t pagesUsed = 0u;
-
-      for (uint32_t i = 0; i < pool.chunks.size(); i++) {
-        uint32_t used = pool.pageAllocator.pagesUsed(i);
-
-        if (used) {
-          pagesUsed += used;
-          pagesTotal += pool.pageAllocator.pageCount(i);
-        }
-      }
-
-      uint32_t pagesPerChunk = pool.nextChunkSize / DxvkPageAllocator::PageSize;
-
-      if (pagesUsed + pagesUsed / 8u + pagesPerChunk >= pagesTotal)
-        return;
-    }
-
-    // Find live chunk with the lowest number of pages used. Skip
-    // empty chunks since the goal here is to turn a used chunk
-    // into an empty one.
-    uint32_t chunkIndex = 0u;
-    uint32_t chunkPages = 0u;
-
-    for (uint32_t i = 0; i < pool.chunks.size(); i++) {
-      // Mark any empty chunk as dead for now as well so that we don't
-      // keep moving resources between multiple otherwise unused chunks
-      uint32_t pagesUsed = pool.pageAllocator.pagesUsed(i);
-
-      if (!pagesUsed) {
-        pool.pageAllocator.killChunk(i);
-        continue;
-      }
-
-      // Move on if the chunk cannot be relocated anyway
-      if (!pool.chunks[i].canMove)
-        continue;
-
-      // If there's a non-empty chunk already marked as dead and we haven't
-      // finished moving resources around yet, killing another chunk would
-      // do more harm than good so wait for that to finish first.
-      if (!pool.pageAllocator.chunkIsAvailable(i)) {
-        if (!m_relocations.empty())
-          return;
-        continue;
-      }
-
-      if (!chunkPages || pagesUsed < chunkPages) {
-        chunkIndex = i;
-        chunkPages = pagesUsed;
-      }
-    }
-
-    if (!chunkPages)
-      return;
-
-    // Check if the remaining chunks in the pool have sufficient free space.
-    // This is not a strong guarantee that relocation will succeed, but the
-    // chance is reasonably high.
-    uint32_t freePages = 0u;
-
-    for (uint32_t i = 0; i < pool.chunks.size(); i++) {
-      uint32_t pagesUsed = pool.pageAllocator.pagesUsed(i);
-      uint32_t pageCount = pool.pageAllocator.pageCount(i);
-
-      if (pagesUsed && pool.pageAllocator.chunkIsAvailable(i) && i != chunkIndex)
-        freePages += pageCount - pagesUsed;
-    }
+    auto pressure = DxvkDefragScheduler::computePressure(
+      heapStats.memoryAllocated, heapStats.memoryBudget);
 
-    if (2u * freePages < 3u * chunkPages)
+    if (!DxvkDefragScheduler::shouldDefragment(pool.pageAllocator, pool.nextChunkSize, pressure))
       return;
 
-    // We only want one non-empty dead chunk at a time in order to prevent
-    // situations where defragmation locks itself up in a suboptimal state.
-    // If we already have a dead chunk with a resource that cannot be moved,
-    // revive it and mark the newly selected one instead so that it can be
-    // moved into the previously dead chunk.
-    for (uint32_t i = 0; i < pool.chunks.size(); i++) {
-      if (!pool.pageAllocator.chunkIsAvailable(i) && pool.pageAllocator.pagesUsed(i))
-        pool.pageAllocator.reviveChunk(i);
-    }
-
     // Mark the chunk as dead. If it does not subsequently get reactivated
     // because the game is loading more resources, the next worker iteration
     // will queue all live resources for relocation.
-    pool.pageAllocator.killChunk(chunkIndex);
-    pool.nextDefragChunk = chunkIndex;
+    int32_t chunkIndex = DxvkDefragScheduler::pickChunk(pool.pageAllocator, !m_relocations.empty(),
+      [&pool] (uint32_t i) { return bool(pool.chunks[i].canMove); });
+
+    if (chunkIndex >= 0)
+      pool.nextDefragChunk = uint32_t(chunkIndex);
   }
 
 
@@ -2349,7 +2475,7 @@ namespace dxvk {
 
     // This function shouldn't be called concurrently, so checking and
     // updating the deadline is fine without taking the global lock
-    auto currentTime = high_resolution_clock::now();
+    auto currentTime = m_backend->now();
 
     if (m_taskDeadline != high_resolution_clock::time_point()
      && m_taskDeadline > currentTime)
@@ -2384,19 +2510,38 @@ namespace dxvk {
     // For unknown reasons, defragmentation seems to break Genshin Impact and
     // possibly other games on ANV while working fine on other drivers even in
     // a stress-test scenario, see https://github.com/doitsujin/dxvk/issues/4395.
-    bool enableDefrag = !m_device->adapter()->matchesDriver(VK_DRIVER_ID_INTEL_OPEN_SOURCE_MESA);
-    applyTristate(enableDefrag, m_device->config().enableMemoryDefrag);
+    bool enableDefrag = !m_backend->matchesDriver(VK_DRIVER_ID_INTEL_OPEN_SOURCE_MESA);
+    applyTristate(enableDefrag, m_backend->config().enableMemoryDefrag);
 
     if (enableDefrag) {
+      // Scale the copy bandwidth used for relocations with
+      // the memory pressure of the most constrained heap.
+      DxvkDefragPressure pressure = DxvkDefragPressure::Low;
+
+      for (uint32_t i = 0; i < m_memHeapCount; i++) {
+        if (m_memHeaps[i].properties.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+          auto heapStats = getMemoryStats(i);
+
+          pressure = std::max(pressure, DxvkDefragScheduler::computePressure(
+            heapStats.memoryAllocated, heapStats.memoryBudget));
+        }
+      }
+
+      m_defrag.setPressure(pressure);
+
       // Periodically defragment device-local memory types. We cannot
       // do anything about mapped allocations since we rely on pointer
       // stability there.
+      auto t0 = high_resolution_clock::now();
+
       for (uint32_t i = 0; i < m_memTypeCount; i++) {
         if (m_memTypes[i].properties.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
           moveDefragChunk(m_memTypes[i]);
           pickDefragChunk(m_memTypes[i]);
         }
       }
+
+      m_defrag.addTime(high_resolution_clock::now() - t0);
     }
   }
 
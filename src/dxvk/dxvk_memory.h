@@ -5,13 +5,17 @@
 
 #include "dxvk_access.h"
 #include "dxvk_adapter.h"
+#include "dxvk_allocation_trace.h"
 #include "dxvk_allocator.h"
+#include "dxvk_defrag.h"
 #include "dxvk_hash.h"
+#include "dxvk_instance.h"
 
 #include "../util/util_time.h"
 
 namespace dxvk {
   
+  class DxvkDevice;
   class DxvkMemoryAllocator;
   class DxvkSparsePageTable;
   class DxvkSharedAllocationCache;
@@ -1070,6 +1074,171 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Memory allocator backend
+   *
+   * Provides the device properties, configuration and Vulkan
+   * functions that the memory allocator depends on. Normally
+   * backed by a device, but can be replaced in order to run
+   * the allocator without a Vulkan driver, e.g. when replaying
+   * allocation traces.
+   */
+  class DxvkMemoryBackend {
+
+  public:
+
+    virtual ~DxvkMemoryBackend();
+
+    /**
+     * \brief Queries device
+     *
+     * Only required for sparse resources.
+     * \returns Device, or \c nullptr if there is none
+     */
+    virtual DxvkDevice* device() const = 0;
+
+    /**
+     * \brief Vulkan device functions
+     * \returns Vulkan device functions
+     */
+    virtual Rc<vk::DeviceFn> vkd() const = 0;
+
+    /**
+     * \brief Enabled device features
+     * \returns Device features
+     */
+    virtual const DxvkDeviceFeatures& features() const = 0;
+
+    /**
+     * \brief Device properties
+     * \returns Device properties
+     */
+    virtual const DxvkDeviceInfo& properties() const = 0;
+
+    /**
+     * \brief Device options
+     * \returns Device options
+     */
+    virtual const DxvkOptions& config() const = 0;
+
+    /**
+     * \brief Debug flags
+     * \returns Debug flags
+     */
+    virtual DxvkDebugFlags debugFlags() const = 0;
+
+    /**
+     * \brief Queue sharing mode info
+     * \returns Sharing mode info
+     */
+    virtual DxvkSharingModeInfo getSharingMode() const = 0;
+
+    /**
+     * \brief Memory types and heaps
+     * \returns Memory properties
+     */
+    virtual VkPhysicalDeviceMemoryProperties memoryProperties() const = 0;
+
+    /**
+     * \brief Memory heap info
+     * \returns Memory heap info
+     */
+    virtual DxvkAdapterMemoryInfo getMemoryHeapInfo() const = 0;
+
+    /**
+     * \brief Queries current memory budgets
+     *
+     * Only called if \c VK_EXT_memory_budget is enabled.
+     * \param [out] budget Memory budget properties
+     */
+    virtual void getMemoryBudget(
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT& budget) const = 0;
+
+    /**
+     * \brief Tests if the driver matches a driver ID
+     *
+     * \param [in] driver Driver ID
+     * \returns \c True if the driver matches
+     */
+    virtual bool matchesDriver(
+            VkDriverIdKHR       driver) const = 0;
+
+    /**
+     * \brief Notifies memory allocation changes
+     *
+     * \param [in] heap Memory heap index
+     * \param [in] allocated Allocated size delta
+     * \param [in] used Used size delta
+     */
+    virtual void notifyMemoryStats(
+            uint32_t            heap,
+            int64_t             allocated,
+            int64_t             used) = 0;
+
+    /**
+     * \brief Queries current time
+     *
+     * Used for all time-based allocator policies, i.e. freeing
+     * unused chunks and cached allocations as well as the
+     * defragmentation copy budget.
+     * \returns Current time
+     */
+    virtual high_resolution_clock::time_point now() const = 0;
+
+  };
+
+
+  /**
+   * \brief Device memory backend
+   *
+   * Forwards all queries to a device and its adapter.
+   */
+  class DxvkDeviceMemoryBackend : public DxvkMemoryBackend {
+
+  public:
+
+    DxvkDeviceMemoryBackend(DxvkDevice* device);
+
+    ~DxvkDeviceMemoryBackend();
+
+    DxvkDevice* device() const override;
+
+    Rc<vk::DeviceFn> vkd() const override;
+
+    const DxvkDeviceFeatures& features() const override;
+
+    const DxvkDeviceInfo& properties() const override;
+
+    const DxvkOptions& config() const override;
+
+    DxvkDebugFlags debugFlags() const override;
+
+    DxvkSharingModeInfo getSharingMode() const override;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties() const override;
+
+    DxvkAdapterMemoryInfo getMemoryHeapInfo() const override;
+
+    void getMemoryBudget(
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT& budget) const override;
+
+    bool matchesDriver(
+            VkDriverIdKHR       driver) const override;
+
+    void notifyMemoryStats(
+            uint32_t            heap,
+            int64_t             allocated,
+            int64_t             used) override;
+
+    high_resolution_clock::time_point now() const override;
+
+  private:
+
+    DxvkDevice* m_device;
+
+  };
+
+
   /**
    * \brief Memory allocator
    * 
@@ -1095,10 +1264,29 @@ namespace dxvk {
   public:
     
     DxvkMemoryAllocator(DxvkDevice* device);
+
+    DxvkMemoryAllocator(std::unique_ptr<DxvkMemoryBackend>&& backend);
+
     ~DxvkMemoryAllocator();
     
     DxvkDevice* device() const {
-      return m_device;
+      return m_backend->device();
+    }
+
+    /**
+     * \brief Vulkan device functions
+     * \returns Vulkan device functions
+     */
+    Rc<vk::DeviceFn> vkd() const {
+      return m_backend->vkd();
+    }
+
+    /**
+     * \brief Enabled device features
+     * \returns Device features
+     */
+    const DxvkDeviceFeatures& features() const {
+      return m_backend->features();
     }
 
     /**
@@ -1290,17 +1478,51 @@ namespace dxvk {
     /**
      * \brief Polls relocation list
      *
+     * The total size of returned resources is limited by the copy
+     * budget of the defragmentation scheduler, which depends on
+     * the current memory pressure. Callers must report relocated
+     * resources via \ref notifyRelocation.
      * \param [in] count Maximum resource count
-     * \param [in] size Maximum total size
      * \returns Relocation entries
      */
-    auto pollRelocationList(uint32_t count, VkDeviceSize size) {
+    std::vector<DxvkRelocationEntry> pollRelocationList(uint32_t count) {
+      if (unlikely(m_trace))
+        traceSubmission();
+
+      VkDeviceSize size = m_defrag.getCopyBudget(m_backend->now());
+
+      if (!size)
+        return std::vector<DxvkRelocationEntry>();
+
       return m_relocations.poll(count, size);
     }
 
+    /**
+     * \brief Reports relocated resources
+     *
+     * \param [in] size Total size of relocated resources
+     * \param [in] count Number of relocated resources
+     * \param [in] time CPU time spent relocating resources
+     */
+    void notifyRelocation(
+            VkDeviceSize                      size,
+            uint32_t                          count,
+            high_resolution_clock::duration   time) {
+      m_defrag.notifyRelocation(size, count);
+      m_defrag.addTime(time);
+    }
+
+    /**
+     * \brief Queries defragmentation statistics
+     * \returns Defragmentation statistics
+     */
+    DxvkDefragStats getDefragStats() const {
+      return m_defrag.getStats();
+    }
+
   private:
 
-    DxvkDevice* m_device;
+    std::unique_ptr<DxvkMemoryBackend> m_backend;
 
     DxvkSharingModeInfo       m_sharingModeInfo;
 
@@ -1333,6 +1555,18 @@ namespace dxvk {
 
     alignas(CACHE_LINE_SIZE)
     DxvkRelocationList        m_relocations;
+    DxvkDefragScheduler       m_defrag;
+
+    std::unique_ptr<DxvkAllocationTrace> m_trace;
+
+    DxvkResourceAllocation* allocateMemoryLocked(
+      const VkMemoryRequirements&             requirements,
+      const DxvkAllocationInfo&               allocationInfo);
+
+    DxvkResourceAllocation* allocateDedicatedMemoryLocked(
+      const VkMemoryRequirements&             requirements,
+      const DxvkAllocationInfo&               allocationInfo,
+      const void*                             next);
 
     DxvkDeviceMemory allocateDeviceMemory(
             DxvkMemoryType&       type,
@@ -1419,8 +1653,7 @@ namespace dxvk {
       const DxvkMemoryType&       type,
             bool                  mappable) const;
 
-    uint32_t determineSparseMemoryTypes(
-            DxvkDevice*           device) const;
+    uint32_t determineSparseMemoryTypes() const;
 
     void determineBufferUsageFlagsPerMemoryType();
 
@@ -1442,6 +1675,16 @@ namespace dxvk {
 
     void updateMemoryHeapBudgets();
 
+    DxvkAllocationTraceHeader getAllocationTraceHeader() const;
+
+    void traceAllocation(
+            DxvkAllocationTraceEvent  event,
+      const VkMemoryRequirements&     requirements,
+      const DxvkAllocationInfo&       allocationInfo,
+      const DxvkResourceAllocation*   allocation);
+
+    void traceSubmission();
+
     void updateMemoryHeapStats(
             uint32_t              heapIndex);
 
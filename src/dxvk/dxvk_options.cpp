@@ -5,11 +5,14 @@ namespace dxvk {
   DxvkOptions::DxvkOptions(const Config& config) {
     enableDebugUtils      = config.getOption<bool>    ("dxvk.enableDebugUtils",       false);
     enableStateCache      = config.getOption<bool>    ("dxvk.enableStateCache",       true);
+    enableShaderCache     = config.getOption<bool>    ("dxvk.enableShaderCache",      true);
     enableMemoryDefrag    = config.getOption<Tristate>("dxvk.enableMemoryDefrag",     Tristate::Auto);
     numCompilerThreads    = config.getOption<int32_t> ("dxvk.numCompilerThreads",     0);
     enableGraphicsPipelineLibrary = config.getOption<Tristate>("dxvk.enableGraphicsPipelineLibrary", Tristate::Auto);
+    enableDescriptorBuffer = config.getOption<Tristate>("dxvk.enableDescriptorBuffer", Tristate::Auto);
     trackPipelineLifetime = config.getOption<Tristate>("dxvk.trackPipelineLifetime",  Tristate::Auto);
     useRawSsbo            = config.getOption<Tristate>("dxvk.useRawSsbo",             Tristate::Auto);
+    optimizeSpirv         = config.getOption<bool>    ("dxvk.optimizeSpirv",          false);
     hud                   = config.getOption<std::string>("dxvk.hud", "");
     tearFree              = config.getOption<Tristate>("dxvk.tearFree",               Tristate::Auto);
     latencySleep          = config.getOption<Tristate>("dxvk.latencySleep",           Tristate::False);
@@ -22,6 +25,7 @@ namespace dxvk {
     lowLatencyOffset      = config.getOption<int32_t> ("dxvk.lowLatencyOffset",       0);
     lowLatencyAllowCpuFramesOverlap
                           = config.getOption<bool>    ("dxvk.lowLatencyAllowCpuFramesOverlap", true);
+    smoothLatencyBudget   = config.getOption<int32_t> ("dxvk.smoothLatencyBudget",    1000);
     deviceFilter          = config.getOption<std::string>("dxvk.deviceFilter",        "");
     tilerMode             = config.getOption<Tristate>("dxvk.tilerMode",              Tristate::Auto);
   }
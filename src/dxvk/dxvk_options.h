@@ -14,6 +14,9 @@ namespace dxvk {
     /// Enable state cache
     bool enableStateCache = true;
 
+    /// Enable persistent shader cache
+    bool enableShaderCache = true;
+
     /// Enable memory defragmentation
     Tristate enableMemoryDefrag = Tristate::Auto;
 
@@ -24,12 +27,20 @@ namespace dxvk {
     /// Enable graphics pipeline library
     Tristate enableGraphicsPipelineLibrary = Tristate::Auto;
 
+    /// Use descriptor buffers instead of descriptor
+    /// sets for shader resource bindings
+    Tristate enableDescriptorBuffer = Tristate::Auto;
+
     /// Enables pipeline lifetime tracking
     Tristate trackPipelineLifetime = Tristate::Auto;
 
     /// Shader-related options
     Tristate useRawSsbo = Tristate::Auto;
 
+    /// Run basic optimization passes on
+    /// SPIR-V generated by shader compilers
+    bool optimizeSpirv = false;
+
     /// HUD elements
     std::string hud;
 
@@ -75,6 +86,10 @@ namespace dxvk {
     /// the cpu-part of the previous one, when low-latency frame pacing is used.
     bool lowLatencyAllowCpuFramesOverlap;
 
+    /// Maximum amount of latency in microseconds the smooth-latency
+    /// frame pacing mode may add in order to reduce frame time variance.
+    int32_t smoothLatencyBudget;
+
     // Device name
     std::string deviceFilter;
   };
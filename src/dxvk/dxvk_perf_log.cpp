@@ -0,0 +1,118 @@
+#include "dxvk_perf_log.h"
+
+#include "../util/log/log.h"
+
+#include "../util/util_env.h"
+#include "../util/util_string.h"
+
+namespace dxvk {
+
+  DxvkPerfLog::DxvkPerfLog(const std::string& path)
+  : m_path(path), m_startTime(high_resolution_clock::now()) {
+    m_thread = dxvk::thread([this] () { runWriter(); });
+  }
+
+
+  DxvkPerfLog::~DxvkPerfLog() {
+    { std::unique_lock<dxvk::mutex> lock(m_mutex);
+      m_stopped = true;
+      m_cond.notify_one();
+    }
+
+    m_thread.join();
+
+    if (m_dropped.load())
+      Logger::warn(str::format("Perf log: Dropped ", m_dropped.load(), " frames"));
+  }
+
+
+  void DxvkPerfLog::logFrame(const DxvkStatCounters& counters) {
+    auto now = high_resolution_clock::now();
+
+    // Multiple swap chains may present concurrently
+    std::lock_guard<sync::Spinlock> lock(m_producerLock);
+
+    DxvkStatCounters diff = counters.diff(m_prevCounters);
+    m_prevCounters = counters;
+
+    uint64_t frameId = ++m_frameId;
+    uint64_t written = m_written.load(std::memory_order_relaxed);
+
+    if (written - m_read.load(std::memory_order_acquire) >= RingSize) {
+      m_dropped.fetch_add(1u, std::memory_order_relaxed);
+      return;
+    }
+
+    DxvkPerfLogRecord& record = m_ring[written % RingSize];
+    record.frameId = frameId;
+    record.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(now - m_startTime).count();
+
+    for (uint32_t i = 0; i < record.counters.size(); i++)
+      record.counters[i] = int64_t(diff.getCtr(DxvkStatCounter(i)));
+
+    m_written.store(written + 1u, std::memory_order_release);
+  }
+
+
+  std::unique_ptr<DxvkPerfLog> DxvkPerfLog::createFromEnv() {
+    static std::atomic<uint32_t> s_logCount = { 0u };
+
+    std::string path = env::getEnvVar("DXVK_PERF_LOG");
+
+    if (path.empty())
+      return nullptr;
+
+    // Each device has its own log, give them distinct files
+    path = env::getIndexedFilePath(path, s_logCount++);
+
+    Logger::info(str::format("Perf log: ", path));
+    return std::make_unique<DxvkPerfLog>(path);
+  }
+
+
+  void DxvkPerfLog::runWriter() {
+    env::setThreadName("dxvk-perf-log");
+
+    std::ofstream file(str::topath(m_path.c_str()).c_str(),
+      std::ios_base::binary | std::ios_base::trunc);
+
+    if (!file) {
+      Logger::err(str::format("Perf log: Failed to open ", m_path));
+      return;
+    }
+
+    DxvkPerfLogHeader header;
+    header.recordSize = sizeof(DxvkPerfLogRecord);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    bool stopped = false;
+
+    while (!stopped) {
+      // Poll the ring so that presenting never needs to
+      // acquire the lock in order to wake up the writer
+      { std::unique_lock<dxvk::mutex> lock(m_mutex);
+        m_cond.wait_for(lock, std::chrono::milliseconds(100),
+          [this] { return m_stopped; });
+        stopped = m_stopped;
+      }
+
+      if (drainRing(file))
+        file.flush();
+    }
+  }
+
+
+  size_t DxvkPerfLog::drainRing(std::ofstream& file) {
+    uint64_t read    = m_read.load(std::memory_order_relaxed);
+    uint64_t written = m_written.load(std::memory_order_acquire);
+
+    for (uint64_t i = read; i < written; i++) {
+      file.write(reinterpret_cast<const char*>(&m_ring[i % RingSize]),
+        sizeof(DxvkPerfLogRecord));
+    }
+
+    m_read.store(written, std::memory_order_release);
+    return size_t(written - read);
+  }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+
+#include "dxvk_stats.h"
+
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+#include "../util/sync/sync_spinlock.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Performance log file header
+   *
+   * Log files consist of this header followed by
+   * tightly packed, fixed-size frame records.
+   */
+  struct DxvkPerfLogHeader {
+    char     magic[8]     = { 'D', 'X', 'V', 'K', 'P', 'R', 'F', '\0' };
+    uint32_t version      = 1;
+    uint32_t counterCount = uint32_t(DxvkStatCounter::NumCounters);
+    uint32_t recordSize   = 0;
+    uint32_t reserved     = 0;
+  };
+
+
+  /**
+   * \brief Performance log record
+   *
+   * Stores the difference of all stat counters between
+   * two consecutive presents. Counters that represent a
+   * total, such as pipeline counts, can be negative.
+   */
+  struct DxvkPerfLogRecord {
+    uint64_t frameId;
+    int64_t  timestamp;
+    std::array<int64_t, uint32_t(DxvkStatCounter::NumCounters)> counters;
+  };
+
+
+  /**
+   * \brief Performance log
+   *
+   * Writes one record per presented frame to a binary log
+   * file. Records are copied to a preallocated ring on the
+   * present path and written by a background thread.
+   *
+   * Enabled by setting \c DXVK_PERF_LOG to a file path. Devices
+   * other than the first get an index added to the file name.
+   * Logs can be converted to CSV with dxvk-perf-log.
+   */
+  class DxvkPerfLog {
+
+  public:
+
+    DxvkPerfLog(const std::string& path);
+
+    ~DxvkPerfLog();
+
+    /**
+     * \brief Logs a frame
+     *
+     * Computes the difference to the counters passed in
+     * on the previous call and queues up a log record.
+     * \param [in] counters Current stat counters
+     */
+    void logFrame(const DxvkStatCounters& counters);
+
+    /**
+     * \brief Creates performance log
+     *
+     * \returns Performance log if enabled, or \c nullptr
+     */
+    static std::unique_ptr<DxvkPerfLog> createFromEnv();
+
+  private:
+
+    static constexpr uint32_t RingSize = 1024;
+
+    std::string                       m_path;
+    high_resolution_clock::time_point m_startTime;
+
+    sync::Spinlock                    m_producerLock;
+    DxvkStatCounters                  m_prevCounters;
+    uint64_t                          m_frameId = 0u;
+
+    std::array<DxvkPerfLogRecord, RingSize> m_ring;
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t>             m_written = { 0u };
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t>             m_read    = { 0u };
+    std::atomic<uint64_t>             m_dropped = { 0u };
+
+    dxvk::mutex                       m_mutex;
+    dxvk::condition_variable          m_cond;
+    bool                              m_stopped = false;
+    dxvk::thread                      m_thread;
+
+    void runWriter();
+
+    size_t drainRing(std::ofstream& file);
+
+  };
+
+}
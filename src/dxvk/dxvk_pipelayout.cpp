@@ -180,14 +180,28 @@ namespace dxvk {
       templateInfos.push_back(templateInfo);
     }
 
+    bool useDescriptorBuffer = m_device->canUseDescriptorBuffer();
+
     VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
     layoutInfo.bindingCount = bindingInfos.size();
     layoutInfo.pBindings = bindingInfos.data();
 
+    if (useDescriptorBuffer)
+      layoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     if (vk->vkCreateDescriptorSetLayout(vk->device(), &layoutInfo, nullptr, &m_layout) != VK_SUCCESS)
       throw DxvkError("DxvkBindingSetLayoutKey: Failed to create descriptor set layout");
 
-    if (layoutInfo.bindingCount) {
+    // Descriptor buffer layouts cannot be used with update templates,
+    // query the memory layout of the set instead.
+    if (useDescriptorBuffer) {
+      vk->vkGetDescriptorSetLayoutSizeEXT(vk->device(), m_layout, &m_memorySize);
+
+      m_bindingOffsets.resize(layoutInfo.bindingCount);
+
+      for (uint32_t i = 0; i < layoutInfo.bindingCount; i++)
+        vk->vkGetDescriptorSetLayoutBindingOffsetEXT(vk->device(), m_layout, i, &m_bindingOffsets[i]);
+    } else if (layoutInfo.bindingCount) {
       VkDescriptorUpdateTemplateCreateInfo templateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
       templateInfo.descriptorUpdateEntryCount = templateInfos.size();
       templateInfo.pDescriptorUpdateEntries = templateInfos.data();
@@ -277,12 +277,36 @@ namespace dxvk {
       return m_template;
     }
 
+    /**
+     * \brief Queries descriptor buffer memory size
+     *
+     * Only valid if descriptor buffers are used.
+     * \returns Size of the set in descriptor memory
+     */
+    VkDeviceSize getMemorySize() const {
+      return m_memorySize;
+    }
+
+    /**
+     * \brief Queries descriptor buffer binding offset
+     *
+     * Only valid if descriptor buffers are used.
+     * \param [in] binding Binding index
+     * \returns Offset of the binding within the set
+     */
+    VkDeviceSize getBindingOffset(uint32_t binding) const {
+      return m_bindingOffsets[binding];
+    }
+
   private:
 
     DxvkDevice*                   m_device;
     VkDescriptorSetLayout         m_layout    = VK_NULL_HANDLE;
     VkDescriptorUpdateTemplate    m_template  = VK_NULL_HANDLE;
 
+    VkDeviceSize                  m_memorySize = 0u;
+    std::vector<VkDeviceSize>     m_bindingOffsets;
+
   };
 
 
@@ -531,6 +555,27 @@ namespace dxvk {
       return m_bindingObjects[set]->getSetUpdateTemplate();
     }
 
+    /**
+     * \brief Retrieves descriptor buffer memory size for a given set
+     *
+     * \param [in] set Descriptor set index
+     * \returns Size of the set in descriptor memory
+     */
+    VkDeviceSize getSetMemorySize(uint32_t set) const {
+      return m_bindingObjects[set]->getMemorySize();
+    }
+
+    /**
+     * \brief Retrieves descriptor buffer offset of a binding
+     *
+     * \param [in] set Descriptor set index
+     * \param [in] binding Binding index within the set
+     * \returns Offset of the binding within the set
+     */
+    VkDeviceSize getBindingOffset(uint32_t set, uint32_t binding) const {
+      return m_bindingObjects[set]->getBindingOffset(binding);
+    }
+
     /**
      * \brief Retrieves pipeline layout
      *
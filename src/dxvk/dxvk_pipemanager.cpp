@@ -6,9 +6,40 @@
 
 namespace dxvk {
   
+  DxvkPipelineTask::DxvkPipelineTask(
+          DxvkShaderPipelineLibrary*      library,
+          DxvkPipelinePriority            priority)
+  : m_pipelineLibrary(library), m_priority(priority) {
+
+  }
+
+
+  DxvkPipelineTask::DxvkPipelineTask(
+          DxvkGraphicsPipeline*           pipeline,
+    const DxvkGraphicsPipelineStateInfo&  state,
+          DxvkPipelinePriority            priority)
+  : m_graphicsPipeline(pipeline), m_graphicsState(state), m_priority(priority) {
+
+  }
+
+
+  DxvkPipelineTask::~DxvkPipelineTask() {
+
+  }
+
+
   DxvkPipelineWorkers::DxvkPipelineWorkers(
           DxvkDevice*                     device)
-  : m_device(device) {
+  : DxvkPipelineWorkers(getWorkerCount(device),
+      device->canUseGraphicsPipelineLibrary()) {
+
+  }
+
+
+  DxvkPipelineWorkers::DxvkPipelineWorkers(
+          uint32_t                        workerCount,
+          bool                            useLibraries)
+  : m_workerCount(std::max(workerCount, 1u)), m_useLibraries(useLibraries) {
 
   }
 
@@ -18,41 +49,31 @@ namespace dxvk {
   }
 
 
-  void DxvkPipelineWorkers::compilePipelineLibrary(
+  Rc<DxvkPipelineTask> DxvkPipelineWorkers::compilePipelineLibrary(
           DxvkShaderPipelineLibrary*      library,
-          DxvkPipelinePriority            priority) {
-    std::unique_lock lock(m_lock);
-    this->startWorkers();
-
-    m_tasksTotal += 1;
-
-    m_buckets[uint32_t(priority)].queue.emplace(library);
-    notifyWorkers(priority);
+          DxvkPipelinePriority            priority,
+    const Rc<DxvkPipelineTask>&           dependency) {
+    return submitTask(new DxvkPipelineTask(library, priority), dependency);
   }
 
 
-  void DxvkPipelineWorkers::compileGraphicsPipeline(
+  Rc<DxvkPipelineTask> DxvkPipelineWorkers::compileGraphicsPipeline(
           DxvkGraphicsPipeline*           pipeline,
     const DxvkGraphicsPipelineStateInfo&  state,
-          DxvkPipelinePriority            priority) {
-    std::unique_lock lock(m_lock);
-    this->startWorkers();
-
+          DxvkPipelinePriority            priority,
+    const Rc<DxvkPipelineTask>&           dependency) {
     pipeline->acquirePipeline();
-    m_tasksTotal += 1;
-
-    m_buckets[uint32_t(priority)].queue.emplace(pipeline, state);
-    notifyWorkers(priority);
+    return submitTask(new DxvkPipelineTask(pipeline, state, priority), dependency);
   }
 
 
   void DxvkPipelineWorkers::stopWorkers() {
     { std::unique_lock lock(m_lock);
 
-      if (!m_workersRunning)
+      if (!m_workersRunning.load())
         return;
 
-      m_workersRunning = false;
+      m_workersRunning.store(false, std::memory_order_release);
 
       for (uint32_t i = 0; i < m_buckets.size(); i++)
         m_buckets[i].cond.notify_all();
@@ -62,17 +83,233 @@ namespace dxvk {
       worker.join();
 
     m_workers.clear();
+
+    // Discard any pending work. Tasks that are waiting for a
+    // dependency are owned by that task and get freed with it.
+    for (const auto& queue : m_queues) {
+      std::unique_lock lock(queue->lock);
+
+      for (uint32_t i = 0; i < PriorityCount; i++) {
+        m_tasksQueued[i] -= queue->tasks[i].size();
+
+        queue->tasks[i].clear();
+        queue->taskCounts[i].store(0u);
+      }
+    }
   }
 
 
-  void DxvkPipelineWorkers::notifyWorkers(DxvkPipelinePriority priority) {
-    uint32_t index = uint32_t(priority);
+  Rc<DxvkPipelineTask> DxvkPipelineWorkers::submitTask(
+          Rc<DxvkPipelineTask>&&          task,
+    const Rc<DxvkPipelineTask>&           dependency) {
+    this->startWorkers();
+
+    m_tasksTotal += 1;
+
+    // If the dependency is still pending, it will enqueue
+    // this task once it completes. The counter can only
+    // be modified while the dependency is locked here.
+    if (dependency != nullptr) {
+      std::unique_lock lock(dependency->m_mutex);
+
+      if (!dependency->m_done) {
+        task->m_dependencies += 1;
+        dependency->m_dependents.push_back(task);
+        return std::move(task);
+      }
+    }
+
+    enqueueTask(Rc<DxvkPipelineTask>(task), ~0u);
+    return std::move(task);
+  }
+
+
+  void DxvkPipelineWorkers::enqueueTask(
+          Rc<DxvkPipelineTask>&&          task,
+          uint32_t                        queueIndex) {
+    // If no workers can process tasks with the given priority,
+    // process it with the next higher priority instead.
+    uint32_t priorityIndex = uint32_t(task->m_priority);
+
+    while (m_queueSets[priorityIndex].empty())
+      priorityIndex -= 1;
+
+    // Tasks submitted from outside the workers are distributed
+    // among suitable workers, whereas tasks that were unblocked
+    // by a worker go into that worker's own queue.
+    if (queueIndex >= m_queues.size()
+     || uint32_t(m_queues[queueIndex]->maxPriority) < priorityIndex) {
+      const auto& queueSet = m_queueSets[priorityIndex];
+      queueIndex = queueSet[(m_nextQueue++) % queueSet.size()];
+    }
+
+    // Only update the global count once the task is visible to other
+    // workers, since idle workers will not go to sleep while it is
+    // non-zero. Doing so under the lock ensures that it cannot drop
+    // below zero if another worker takes the task right away.
+    auto& queue = *m_queues[queueIndex];
+
+    { std::unique_lock lock(queue.lock);
+      queue.tasks[priorityIndex].push_back(std::move(task));
+      queue.taskCounts[priorityIndex] += 1;
 
+      m_tasksQueued[priorityIndex] += 1;
+    }
+
+    notifyWorkers(priorityIndex);
+  }
+
+
+  Rc<DxvkPipelineTask> DxvkPipelineWorkers::dequeueTask(
+          uint32_t                        queueIndex) {
+    auto& queue = *m_queues[queueIndex];
+
+    // Look for work in priority order, and only process our own
+    // lower-priority tasks if no other worker has any more urgent
+    // work queued, so that high-priority work preempts queued work.
+    for (uint32_t i = 0; i <= uint32_t(queue.maxPriority); i++) {
+      if (!m_tasksQueued[i].load())
+        continue;
+
+      if (queue.taskCounts[i].load()) {
+        std::unique_lock lock(queue.lock);
+
+        if (!queue.tasks[i].empty()) {
+          Rc<DxvkPipelineTask> task = std::move(queue.tasks[i].front());
+          queue.tasks[i].pop_front();
+          queue.taskCounts[i] -= 1;
+
+          m_tasksQueued[i] -= 1;
+          return task;
+        }
+      }
+
+      Rc<DxvkPipelineTask> task = stealTask(queueIndex, i);
+
+      if (task != nullptr)
+        return task;
+    }
+
+    return nullptr;
+  }
+
+
+  Rc<DxvkPipelineTask> DxvkPipelineWorkers::stealTask(
+          uint32_t                        queueIndex,
+          uint32_t                        priorityIndex) {
+    // Pick the worker with the most tasks of the given priority.
+    // Counts may be out of date, but this avoids taking locks.
+    uint32_t victimIndex = ~0u;
+    uint32_t victimCount = 0u;
+
+    for (uint32_t i = 0; i < m_queues.size(); i++) {
+      uint32_t count = m_queues[i]->taskCounts[priorityIndex].load(std::memory_order_relaxed);
+
+      if (i != queueIndex && count > victimCount) {
+        victimIndex = i;
+        victimCount = count;
+      }
+    }
+
+    if (victimIndex == ~0u)
+      return nullptr;
+
+    // Take half of the victim's tasks from the back of its queue
+    // and move all but one to our own, so that we do not need to
+    // steal again immediately. Never hold both locks at once, and
+    // do not count the stolen tasks as queued while they are not
+    // in any queue, or else idle workers would keep looking for
+    // them instead of going to sleep.
+    small_vector<Rc<DxvkPipelineTask>, 16> stolen;
+
+    { auto& victim = *m_queues[victimIndex];
+      std::unique_lock lock(victim.lock);
+
+      auto& tasks = victim.tasks[priorityIndex];
+      size_t count = std::min<size_t>((tasks.size() + 1u) / 2u, 16u);
+
+      for (size_t i = 0; i < count; i++) {
+        stolen.push_back(std::move(tasks.back()));
+        tasks.pop_back();
+      }
+
+      victim.taskCounts[priorityIndex] -= count;
+      m_tasksQueued[priorityIndex] -= count;
+    }
+
+    if (stolen.empty())
+      return nullptr;
+
+    if (stolen.size() > 1) {
+      auto& queue = *m_queues[queueIndex];
+
+      { std::unique_lock lock(queue.lock);
+
+        for (size_t i = stolen.size() - 1; i > 0; i--)
+          queue.tasks[priorityIndex].push_back(std::move(stolen[i]));
+
+        queue.taskCounts[priorityIndex] += stolen.size() - 1;
+        m_tasksQueued[priorityIndex] += stolen.size() - 1;
+      }
+
+      // Workers that went to sleep in the meantime
+      // can steal the remaining tasks from us.
+      notifyWorkers(priorityIndex);
+    }
+
+    return std::move(stolen[0]);
+  }
+
+
+  void DxvkPipelineWorkers::runTask(
+          DxvkPipelineTask&               task) {
+    if (task.m_pipelineLibrary) {
+      task.m_pipelineLibrary->compilePipeline();
+    } else if (task.m_graphicsPipeline) {
+      task.m_graphicsPipeline->compilePipeline(task.m_graphicsState);
+      task.m_graphicsPipeline->releasePipeline();
+    }
+  }
+
+
+  void DxvkPipelineWorkers::completeTask(
+          DxvkPipelineTask&               task,
+          uint32_t                        queueIndex) {
+    std::vector<Rc<DxvkPipelineTask>> dependents;
+
+    { std::unique_lock lock(task.m_mutex);
+      task.m_done = true;
+      dependents = std::move(task.m_dependents);
+    }
+
+    for (auto& dependent : dependents) {
+      if (!(--dependent->m_dependencies))
+        enqueueTask(std::move(dependent), queueIndex);
+    }
+
+    m_tasksCompleted += 1;
+  }
+
+
+  bool DxvkPipelineWorkers::hasQueuedTasks(
+          uint32_t                        maxPriorityIndex) const {
+    for (uint32_t i = 0; i <= maxPriorityIndex; i++) {
+      if (m_tasksQueued[i].load())
+        return true;
+    }
+
+    return false;
+  }
+
+
+  void DxvkPipelineWorkers::notifyWorkers(uint32_t priorityIndex) {
     // If any workers are idle in a suitable set, notify the corresponding
     // condition variable. If all workers are busy anyway, we know that the
-    // job is going to be picked up at some point anyway.
-    for (uint32_t i = index; i < m_buckets.size(); i++) {
-      if (m_buckets[i].idleWorkers) {
+    // job is going to be picked up at some point anyway. Workers increment
+    // the idle count before checking for work, so this cannot miss any.
+    for (uint32_t i = priorityIndex; i < m_buckets.size(); i++) {
+      if (m_buckets[i].idleWorkers.load()) {
+        std::unique_lock lock(m_lock);
         m_buckets[i].cond.notify_one();
         break;
       }
@@ -81,96 +318,106 @@ namespace dxvk {
 
 
   void DxvkPipelineWorkers::startWorkers() {
-    if (!std::exchange(m_workersRunning, true)) {
-      // Use all available cores by default
-      uint32_t workerCount = dxvk::thread::hardware_concurrency();
-
-      if (workerCount <  1) workerCount =  1;
-      if (workerCount > 64) workerCount = 64;
+    if (likely(m_workersRunning.load(std::memory_order_acquire)))
+      return;
 
-      // Reduce worker count on 32-bit to save adderss space
-      if (env::is32BitHostPlatform())
-        workerCount = std::min(workerCount, 16u);
+    std::unique_lock lock(m_lock);
 
-      if (m_device->config().numCompilerThreads > 0)
-        workerCount = m_device->config().numCompilerThreads;
+    if (m_workersRunning.load())
+      return;
 
+    // Queues are kept around if the workers get restarted, since
+    // other threads may access them without taking the lock.
+    if (m_queues.empty()) {
       // Number of workers that can process pipeline pipelines with normal
       // priority. Any other workers can only build high-priority pipelines.
-      uint32_t npWorkerCount = std::max(((workerCount - 1) * 5) / 7, 1u);
-      uint32_t lpWorkerCount = std::max(((workerCount - 1) * 2) / 7, 1u);
+      uint32_t npWorkerCount = std::max(((m_workerCount - 1) * 5) / 7, 1u);
+      uint32_t lpWorkerCount = std::max(((m_workerCount - 1) * 2) / 7, 1u);
 
-      m_workers.reserve(workerCount);
+      m_queues.reserve(m_workerCount);
 
-      for (size_t i = 0; i < workerCount; i++) {
-        DxvkPipelinePriority priority = DxvkPipelinePriority::Normal;
+      for (uint32_t i = 0; i < m_workerCount; i++) {
+        auto& queue = m_queues.emplace_back(std::make_unique<PipelineQueue>());
 
-        if (m_device->canUseGraphicsPipelineLibrary()) {
+        if (m_useLibraries) {
           if (i >= npWorkerCount)
-            priority = DxvkPipelinePriority::High;
+            queue->maxPriority = DxvkPipelinePriority::High;
           else if (i < lpWorkerCount)
-            priority = DxvkPipelinePriority::Low;
+            queue->maxPriority = DxvkPipelinePriority::Low;
         }
 
-        auto& worker = m_workers.emplace_back([this, priority] {
-          runWorker(priority);
-        });
-        
-        worker.set_priority(ThreadPriority::Lowest);
+        for (uint32_t j = 0; j <= uint32_t(queue->maxPriority); j++)
+          m_queueSets[j].push_back(i);
       }
+    }
+
+    m_workersRunning.store(true, std::memory_order_release);
+    m_workers.reserve(m_queues.size());
 
-      Logger::info(str::format("DXVK: Using ", workerCount, " compiler threads"));
+    for (uint32_t i = 0; i < m_queues.size(); i++) {
+      auto& worker = m_workers.emplace_back([this, i] {
+        runWorker(i);
+      });
+
+      worker.set_priority(ThreadPriority::Lowest);
     }
+
+    Logger::info(str::format("DXVK: Using ", m_queues.size(), " compiler threads"));
   }
 
 
-  void DxvkPipelineWorkers::runWorker(DxvkPipelinePriority maxPriority) {
+  void DxvkPipelineWorkers::runWorker(uint32_t queueIndex) {
     static const std::array<char, 3> suffixes = { 'h', 'n', 'l' };
 
-    const uint32_t maxPriorityIndex = uint32_t(maxPriority);
+    const uint32_t maxPriorityIndex = uint32_t(m_queues[queueIndex]->maxPriority);
     env::setThreadName(str::format("dxvk-shader-", suffixes.at(maxPriorityIndex)));
 
     while (true) {
-      PipelineEntry entry;
+      // Skip pending work, exiting early is
+      // more important in this case.
+      if (!m_workersRunning.load(std::memory_order_acquire))
+        break;
+
+      Rc<DxvkPipelineTask> task = dequeueTask(queueIndex);
 
-      { std::unique_lock lock(m_lock);
+      if (task == nullptr) {
+        std::unique_lock lock(m_lock);
         auto& bucket = m_buckets[maxPriorityIndex];
 
         bucket.idleWorkers += 1;
-        bucket.cond.wait(lock, [this, maxPriorityIndex, &entry] {
-          // Attempt to fetch a work item from the
-          // highest-priority queue that is not empty
-          for (uint32_t i = 0; i <= maxPriorityIndex; i++) {
-            if (!m_buckets[i].queue.empty()) {
-              entry = m_buckets[i].queue.front();
-              m_buckets[i].queue.pop();
-              return true;
-            }
-          }
-
-          return !m_workersRunning;
+        bucket.cond.wait(lock, [this, maxPriorityIndex] {
+          return hasQueuedTasks(maxPriorityIndex) || !m_workersRunning.load();
         });
 
         bucket.idleWorkers -= 1;
-
-        // Skip pending work, exiting early is
-        // more important in this case.
-        if (!m_workersRunning)
-          break;
-      }
-
-      if (entry.pipelineLibrary) {
-        entry.pipelineLibrary->compilePipeline();
-      } else if (entry.graphicsPipeline) {
-        entry.graphicsPipeline->compilePipeline(entry.graphicsState);
-        entry.graphicsPipeline->releasePipeline();
+        continue;
       }
 
-      m_tasksCompleted += 1;
+      runTask(*task);
+      completeTask(*task, queueIndex);
     }
   }
 
 
+  uint32_t DxvkPipelineWorkers::getWorkerCount(
+          DxvkDevice*                     device) {
+    // Use all available cores by default
+    uint32_t workerCount = dxvk::thread::hardware_concurrency();
+
+    if (workerCount <  1) workerCount =  1;
+    if (workerCount > 64) workerCount = 64;
+
+    // Reduce worker count on 32-bit to save adderss space
+    if (env::is32BitHostPlatform())
+      workerCount = std::min(workerCount, 16u);
+
+    if (device->config().numCompilerThreads > 0)
+      workerCount = device->config().numCompilerThreads;
+
+    return workerCount;
+  }
+
+
   DxvkPipelineManager::DxvkPipelineManager(
           DxvkDevice*         device)
   : m_device    (device),
@@ -1,8 +1,9 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <unordered_map>
 
 #include "dxvk_compute.h"
@@ -48,11 +49,69 @@ namespace dxvk {
     Low     = 2,
   };
 
+  /**
+   * \brief Pipeline compile task
+   *
+   * Handle to a pipeline library or optimized graphics
+   * pipeline that is queued for compilation on one of
+   * the pipeline workers. Can be passed to subsequent
+   * compile requests in order to make them wait for
+   * this task to complete.
+   */
+  class DxvkPipelineTask : public RcObject {
+    friend class DxvkPipelineWorkers;
+  public:
+
+    DxvkPipelineTask(
+            DxvkShaderPipelineLibrary*      library,
+            DxvkPipelinePriority            priority);
+
+    DxvkPipelineTask(
+            DxvkGraphicsPipeline*           pipeline,
+      const DxvkGraphicsPipelineStateInfo&  state,
+            DxvkPipelinePriority            priority);
+
+    ~DxvkPipelineTask();
+
+    /**
+     * \brief Checks whether the task has completed
+     * \returns \c true if the pipeline has been compiled
+     */
+    bool isDone() {
+      std::lock_guard lock(m_mutex);
+      return m_done;
+    }
+
+  private:
+
+    DxvkShaderPipelineLibrary*        m_pipelineLibrary  = nullptr;
+    DxvkGraphicsPipeline*             m_graphicsPipeline = nullptr;
+    DxvkGraphicsPipelineStateInfo     m_graphicsState;
+    DxvkPipelinePriority              m_priority;
+
+    std::atomic<uint32_t>             m_dependencies = { 0u };
+
+    dxvk::mutex                       m_mutex;
+    bool                              m_done = false;
+    std::vector<Rc<DxvkPipelineTask>> m_dependents;
+
+  };
+
+
   /**
    * \brief Pipeline manager worker threads
    *
    * Spawns worker threads to compile shader pipeline
    * libraries and optimized pipelines asynchronously.
+   *
+   * Each worker owns a task queue per priority, so that
+   * workers do not contend on a single lock. Workers that
+   * run out of work steal from the worker with the most
+   * queued tasks of the highest priority they can process,
+   * and always look for higher-priority work in all queues
+   * before processing their own lower-priority tasks, so
+   * that high-priority requests are picked up as soon as
+   * any worker finishes its current task.
    */
   class DxvkPipelineWorkers {
 
@@ -61,6 +120,17 @@ namespace dxvk {
     DxvkPipelineWorkers(
             DxvkDevice*                     device);
 
+    /**
+     * \brief Creates workers with a fixed configuration
+     *
+     * \param [in] workerCount Number of worker threads
+     * \param [in] useLibraries Whether to reserve some
+     *    workers for high-priority pipeline libraries
+     */
+    DxvkPipelineWorkers(
+            uint32_t                        workerCount,
+            bool                            useLibraries);
+
     ~DxvkPipelineWorkers();
 
     /**
@@ -84,21 +154,30 @@ namespace dxvk {
      * Note that pipeline libraries are high priority.
      * \param [in] library The pipeline library
      * \param [in] priority Pipeline priority
+     * \param [in] dependency Task that must complete
+     *    before this task can start, or \c nullptr
+     * \returns Compile task
      */
-    void compilePipelineLibrary(
+    Rc<DxvkPipelineTask> compilePipelineLibrary(
             DxvkShaderPipelineLibrary*      library,
-            DxvkPipelinePriority            priority);
+            DxvkPipelinePriority            priority,
+      const Rc<DxvkPipelineTask>&           dependency = nullptr);
 
     /**
      * \brief Compiles an optimized graphics pipeline
      *
      * \param [in] pipeline Compute pipeline
      * \param [in] state Pipeline state
+     * \param [in] priority Pipeline priority
+     * \param [in] dependency Task that must complete
+     *    before this task can start, or \c nullptr
+     * \returns Compile task
      */
-    void compileGraphicsPipeline(
+    Rc<DxvkPipelineTask> compileGraphicsPipeline(
             DxvkGraphicsPipeline*           pipeline,
       const DxvkGraphicsPipelineStateInfo&  state,
-            DxvkPipelinePriority            priority);
+            DxvkPipelinePriority            priority,
+      const Rc<DxvkPipelineTask>&           dependency = nullptr);
 
     /**
      * \brief Stops all worker threads
@@ -110,43 +189,71 @@ namespace dxvk {
 
   private:
 
-    struct PipelineEntry {
-      PipelineEntry()
-      : pipelineLibrary(nullptr), graphicsPipeline(nullptr) { }
-
-      PipelineEntry(DxvkShaderPipelineLibrary* l)
-      : pipelineLibrary(l), graphicsPipeline(nullptr) { }
-
-      PipelineEntry(DxvkGraphicsPipeline* p, const DxvkGraphicsPipelineStateInfo& s)
-      : pipelineLibrary(nullptr), graphicsPipeline(p), graphicsState(s) { }
+    constexpr static uint32_t PriorityCount = 3;
 
-      DxvkShaderPipelineLibrary*    pipelineLibrary;
-      DxvkGraphicsPipeline*         graphicsPipeline;
-      DxvkGraphicsPipelineStateInfo graphicsState;
+    struct PipelineQueue {
+      dxvk::mutex lock;
+      std::array<std::deque<Rc<DxvkPipelineTask>>, PriorityCount> tasks;
+      std::array<std::atomic<uint32_t>, PriorityCount> taskCounts = { };
+      DxvkPipelinePriority maxPriority = DxvkPipelinePriority::Normal;
     };
 
     struct PipelineBucket {
       dxvk::condition_variable  cond;
-      std::queue<PipelineEntry> queue;
-      uint32_t                  idleWorkers = 0;
+      std::atomic<uint32_t>     idleWorkers = { 0u };
     };
 
-    DxvkDevice*                       m_device;
+    uint32_t                          m_workerCount;
+    bool                              m_useLibraries;
 
     std::atomic<uint64_t>             m_tasksTotal     = { 0ull };
     std::atomic<uint64_t>             m_tasksCompleted = { 0ull };
 
+    std::array<std::atomic<uint32_t>, PriorityCount> m_tasksQueued = { };
+
     dxvk::mutex                       m_lock;
-    std::array<PipelineBucket, 3>     m_buckets;
+    std::array<PipelineBucket, PriorityCount> m_buckets;
 
-    bool                              m_workersRunning = false;
+    std::atomic<bool>                 m_workersRunning = { false };
     std::vector<dxvk::thread>         m_workers;
 
-    void notifyWorkers(DxvkPipelinePriority priority);
+    std::vector<std::unique_ptr<PipelineQueue>> m_queues;
+    std::array<std::vector<uint32_t>, PriorityCount> m_queueSets;
+    std::atomic<uint32_t>             m_nextQueue = { 0u };
+
+    Rc<DxvkPipelineTask> submitTask(
+            Rc<DxvkPipelineTask>&&          task,
+      const Rc<DxvkPipelineTask>&           dependency);
+
+    void enqueueTask(
+            Rc<DxvkPipelineTask>&&          task,
+            uint32_t                        queueIndex);
+
+    Rc<DxvkPipelineTask> dequeueTask(
+            uint32_t                        queueIndex);
+
+    Rc<DxvkPipelineTask> stealTask(
+            uint32_t                        queueIndex,
+            uint32_t                        priorityIndex);
+
+    void runTask(
+            DxvkPipelineTask&               task);
+
+    void completeTask(
+            DxvkPipelineTask&               task,
+            uint32_t                        queueIndex);
+
+    bool hasQueuedTasks(
+            uint32_t                        maxPriorityIndex) const;
+
+    void notifyWorkers(uint32_t priorityIndex);
 
     void startWorkers();
 
-    void runWorker(DxvkPipelinePriority maxPriority);
+    void runWorker(uint32_t queueIndex);
+
+    static uint32_t getWorkerCount(
+            DxvkDevice*                     device);
 
   };
 
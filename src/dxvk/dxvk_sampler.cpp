@@ -51,6 +51,17 @@ namespace dxvk {
     if (vk->vkCreateSampler(vk->device(),
         &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
       throw DxvkError("DxvkSampler::DxvkSampler: Failed to create sampler");
+
+    // Samplers are immutable, so create the descriptor right away
+    if (m_pool->m_device->canUseDescriptorBuffer()) {
+      VkDescriptorGetInfoEXT descriptorInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT };
+      descriptorInfo.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+      descriptorInfo.data.pSampler = &m_sampler;
+
+      vk->vkGetDescriptorEXT(vk->device(), &descriptorInfo,
+        m_pool->m_device->getDescriptorSize(VK_DESCRIPTOR_TYPE_SAMPLER),
+        m_descriptor.store(0u, 0u));
+    }
   }
 
 
@@ -5,6 +5,7 @@
 #include "../util/util_bit.h"
 #include "../util/thread.h"
 
+#include "dxvk_descriptor.h"
 #include "dxvk_hash.h"
 #include "dxvk_include.h"
 
@@ -195,6 +196,17 @@ namespace dxvk {
       return m_key;
     }
 
+    /**
+     * \brief Retrieves raw descriptor for descriptor buffers
+     *
+     * Only valid if the device uses descriptor buffers, in
+     * which case the descriptor is created with the sampler.
+     * \returns Pointer to raw descriptor data
+     */
+    const void* getDescriptorData() const {
+      return m_descriptor.find(0u, 0u);
+    }
+
   private:
     
     std::atomic<uint64_t> m_refCount  = { 0u };
@@ -205,6 +217,8 @@ namespace dxvk {
 
     VkSampler             m_sampler   = VK_NULL_HANDLE;
 
+    DxvkDescriptorCache<1> m_descriptor;
+
     DxvkSampler*          m_lruPrev   = nullptr;
     DxvkSampler*          m_lruNext   = nullptr;
 
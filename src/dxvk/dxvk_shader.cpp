@@ -169,6 +169,10 @@ namespace dxvk {
         m_bindingOffsets.push_back(info);
     }
 
+    // Gather the locations of everything that we
+    // may need to modify when creating shader modules
+    buildPatchPlan(code);
+
     // Set flag for stages that actually use push constants
     // so that they can be trimmed for optimized pipelines.
     if (usesPushConstants)
@@ -189,42 +193,68 @@ namespace dxvk {
     const DxvkBindingLayoutObjects*   layout,
     const DxvkShaderModuleCreateInfo& state) const {
     SpirvCodeBuffer spirvCode = m_code.decompress();
-    uint32_t* code = spirvCode.data();
-    
+    SpirvPatchList patches(spirvCode);
+
+    const uint32_t* code = spirvCode.data();
+
     // Remap resource binding IDs
-    for (const auto& info : m_bindingOffsets) {
-      auto mappedBinding = layout->lookupBinding(m_info.stage, info.bindingId);
+    if (layout) {
+      for (const auto& info : m_bindingOffsets) {
+        auto mappedBinding = layout->lookupBinding(m_info.stage, info.bindingId);
 
-      if (mappedBinding) {
-        code[info.bindingOffset] = mappedBinding->binding;
+        if (mappedBinding) {
+          patches.setWord(info.bindingOffset, mappedBinding->binding);
 
-        if (info.setOffset)
-          code[info.setOffset] = mappedBinding->set;
+          if (info.setOffset)
+            patches.setWord(info.setOffset, mappedBinding->set);
+        }
       }
     }
 
     // For dual-source blending we need to re-map
     // location 1, index 0 to location 0, index 1
-    if (state.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset)
-      std::swap(code[m_o1IdxOffset], code[m_o1LocOffset]);
-    
+    if (state.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset) {
+      patches.setWord(m_o1IdxOffset, code[m_o1LocOffset]);
+      patches.setWord(m_o1LocOffset, code[m_o1IdxOffset]);
+    }
+
     // Replace undefined input variables with zero
-    for (uint32_t u : bit::BitMask(state.undefinedInputs))
-      eliminateInput(spirvCode, u);
+    if (state.undefinedInputs) {
+      uint32_t removedInterfaceCount = 0;
 
-    // Patch primitive topology as necessary
-    if (m_info.stage == VK_SHADER_STAGE_GEOMETRY_BIT
-     && state.inputTopology != m_info.inputTopology
-     && state.inputTopology != VK_PRIMITIVE_TOPOLOGY_MAX_ENUM)
-      patchInputTopology(spirvCode, state.inputTopology);
+      for (const auto& var : m_patchPlan.inputs) {
+        if (isInputEliminated(var, state.undefinedInputs)) {
+          eliminateInput(patches, var);
+
+          if (var.interfaceOffset)
+            removedInterfaceCount += 1;
+        }
+      }
+
+      if (removedInterfaceCount) {
+        uint32_t length = m_patchPlan.entryPointLength - removedInterfaceCount;
+        patches.setWord(m_patchPlan.entryPointOffset,
+          spv::OpEntryPoint | (length << spv::WordCountShift));
+      }
+    }
 
     // Emit fragment shader swizzles as necessary
     if (m_info.stage == VK_SHADER_STAGE_FRAGMENT_BIT)
-      emitOutputSwizzles(spirvCode, m_info.outputMask, state.rtSwizzles.data());
+      emitOutputSwizzles(patches, state.rtSwizzles.data());
 
     // Emit input decorations for flat shading as necessary
     if (m_info.stage == VK_SHADER_STAGE_FRAGMENT_BIT && state.fsFlatShading)
-      emitFlatShadingDeclarations(spirvCode, m_info.flatShadingInputs);
+      emitFlatShadingDeclarations(patches, m_info.flatShadingInputs, state.undefinedInputs);
+
+    spirvCode = patches.apply(std::move(spirvCode));
+
+    // Patch primitive topology as necessary. This needs to rewrite
+    // code inside the function bodies, and only ever affects geometry
+    // shaders, so it is not part of the patch plan.
+    if (m_info.stage == VK_SHADER_STAGE_GEOMETRY_BIT
+     && state.inputTopology != m_info.inputTopology
+     && state.inputTopology != VK_PRIMITIVE_TOPOLOGY_MAX_ENUM)
+      patchInputTopology(spirvCode, state.inputTopology);
 
     return spirvCode;
   }
@@ -270,367 +300,316 @@ namespace dxvk {
   }
 
 
-  void DxvkShader::eliminateInput(SpirvCodeBuffer& code, uint32_t location) {
-    struct SpirvTypeInfo {
-      spv::Op           op            = spv::OpNop;
-      uint32_t          baseTypeId    = 0;
-      uint32_t          compositeSize = 0;
-      spv::StorageClass storageClass  = spv::StorageClassMax;
+  void DxvkShader::buildPatchPlan(SpirvCodeBuffer& code) {
+    struct TypeInfo {
+      spv::Op           op;
+      uint32_t          baseTypeId;
+      uint32_t          compositeSize;
+      spv::StorageClass storageClass;
+    };
+
+    struct AccessChainInfo {
+      size_t            inputIndex;
+      uint32_t          depth;
     };
 
     uint32_t spirvVersion = code.data()[1];
 
-    std::unordered_map<uint32_t, SpirvTypeInfo> types;
-    std::unordered_map<uint32_t, uint32_t>      constants;
-    std::unordered_set<uint32_t>                candidates;
+    std::unordered_map<uint32_t, TypeInfo>          types;
+    std::unordered_map<uint32_t, uint32_t>          constants;
+    std::unordered_map<uint32_t, uint32_t>          locations;
+    std::unordered_map<uint32_t, uint32_t>          interfaceOffsets;
+    std::unordered_map<uint32_t, uint32_t>          interpolationOffsets;
+    std::unordered_map<uint32_t,
+      std::vector<PatchDecoration>>                 decorations;
+    std::unordered_map<uint32_t, size_t>            inputVars;
+    std::unordered_map<uint32_t, AccessChainInfo>   accessChains;
 
-    // Find the input variable in question
-    size_t   inputVarOffset = 0;
-    uint32_t inputVarTypeId = 0;
-    uint32_t inputVarId     = 0;
+    uint32_t entryPointId = 0;
+    uint32_t functionId = 0;
+    uint32_t prevOffset = 0;
+    uint32_t locationMask = 0;
 
     for (auto ins : code) {
-      if (ins.opCode() == spv::OpDecorate) {
-        if (ins.arg(2) == spv::DecorationLocation
-         && ins.arg(3) == location)
-          candidates.insert(ins.arg(1));
-      }
+      switch (ins.opCode()) {
+        case spv::OpEntryPoint: {
+          m_patchPlan.entryPointOffset = ins.offset();
+          m_patchPlan.entryPointLength = ins.length();
+          entryPointId = ins.arg(2);
 
-      if (ins.opCode() == spv::OpConstant)
-        constants.insert({ ins.arg(2), ins.arg(3) });
+          // Starting with SPIR-V 1.4, the interface
+          // must list all variables, not just inputs
+          if (spirvVersion < spvVersion(1, 4)) {
+            for (uint32_t i = 3 + code.strLen(ins.chr(3)); i < ins.length(); i++)
+              interfaceOffsets.insert({ ins.arg(i), ins.offset() + i });
+          }
+        } break;
 
-      if (ins.opCode() == spv::OpTypeFloat || ins.opCode() == spv::OpTypeInt)
-        types.insert({ ins.arg(1), { ins.opCode(), 0, ins.arg(2), spv::StorageClassMax }});
+        case spv::OpDecorate: {
+          m_patchPlan.decorationEnd = ins.offset() + ins.length();
+          uint32_t varId = ins.arg(1);
 
-      if (ins.opCode() == spv::OpTypeVector)
-        types.insert({ ins.arg(1), { ins.opCode(), ins.arg(2), ins.arg(3), spv::StorageClassMax }});
+          switch (ins.arg(2)) {
+            case spv::DecorationLocation:
+              locations.insert({ varId, ins.arg(3) });
+              decorations[varId].push_back({ ins.offset(), ins.length() });
+              break;
 
-      if (ins.opCode() == spv::OpTypeArray) {
-        auto constant = constants.find(ins.arg(3));
-        if (constant == constants.end())
-          continue;
-        types.insert({ ins.arg(1), { ins.opCode(), ins.arg(2), constant->second, spv::StorageClassMax }});
-      }
+            case spv::DecorationFlat:
+            case spv::DecorationNoPerspective:
+            case spv::DecorationCentroid:
+            case spv::DecorationSample:
+              interpolationOffsets.insert({ varId, ins.offset() + 2 });
+              [[fallthrough]];
 
-      if (ins.opCode() == spv::OpTypePointer)
-        types.insert({ ins.arg(1), { ins.opCode(), ins.arg(3), 0, spv::StorageClass(ins.arg(2)) }});
+            case spv::DecorationPatch:
+              decorations[varId].push_back({ ins.offset(), ins.length() });
+              break;
 
-      if (ins.opCode() == spv::OpVariable && spv::StorageClass(ins.arg(3)) == spv::StorageClassInput) {
-        if (candidates.find(ins.arg(2)) != candidates.end()) {
-          inputVarOffset = ins.offset();
-          inputVarTypeId = ins.arg(1);
-          inputVarId     = ins.arg(2);
-          break;
-        }
-      }
+            default: ;
+          }
+        } break;
 
-      if (ins.opCode() == spv::OpFunction)
-        break;
-    }
+        case spv::OpConstant: {
+          constants.insert({ ins.arg(2), ins.arg(3) });
+        } break;
 
-    if (!inputVarId)
-      return;
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat: {
+          types.insert({ ins.arg(1), { ins.opCode(), 0, ins.arg(2), spv::StorageClassMax }});
+        } break;
 
-    // Declare private pointer types
-    auto pointerType = types.find(inputVarTypeId);
-    if (pointerType == types.end())
-      return;
+        case spv::OpTypeVector: {
+          types.insert({ ins.arg(1), { ins.opCode(), ins.arg(2), ins.arg(3), spv::StorageClassMax }});
+        } break;
 
-    code.beginInsertion(inputVarOffset);
-    std::vector<std::pair<uint32_t, SpirvTypeInfo>> privateTypes;
-
-    for (auto p  = types.find(pointerType->second.baseTypeId);
-              p != types.end();
-              p  = types.find(p->second.baseTypeId)) {
-      std::pair<uint32_t, SpirvTypeInfo> info = *p;
-      info.first = 0;
-      info.second.baseTypeId = p->first;
-      info.second.storageClass = spv::StorageClassPrivate;
-
-      for (auto t : types) {
-        if (t.second.op           == info.second.op
-         && t.second.baseTypeId   == info.second.baseTypeId
-         && t.second.storageClass == info.second.storageClass)
-          info.first = t.first;
-      }
+        case spv::OpTypeArray: {
+          auto constant = constants.find(ins.arg(3));
 
-      if (!info.first) {
-        info.first = code.allocId();
+          if (constant != constants.end())
+            types.insert({ ins.arg(1), { ins.opCode(), ins.arg(2), constant->second, spv::StorageClassMax }});
+        } break;
 
-        code.putIns(spv::OpTypePointer, 4);
-        code.putWord(info.first);
-        code.putWord(info.second.storageClass);
-        code.putWord(info.second.baseTypeId);
-      }
+        case spv::OpTypePointer: {
+          types.insert({ ins.arg(1), { ins.opCode(), ins.arg(3), 0, spv::StorageClass(ins.arg(2)) }});
+        } break;
 
-      privateTypes.push_back(info);
-    }
+        case spv::OpVariable: {
+          if (!m_patchPlan.variableOffset)
+            m_patchPlan.variableOffset = ins.offset();
 
-    // Define zero constants
-    uint32_t constantId = 0;
+          auto location = locations.find(ins.arg(2));
 
-    for (auto i = privateTypes.rbegin(); i != privateTypes.rend(); i++) {
-      if (constantId) {
-        uint32_t compositeSize = i->second.compositeSize;
-        uint32_t compositeId   = code.allocId();
+          if (location == locations.end())
+            break;
 
-        code.putIns(spv::OpConstantComposite, 3 + compositeSize);
-        code.putWord(i->second.baseTypeId);
-        code.putWord(compositeId);
+          if (ins.arg(3) == spv::StorageClassInput) {
+            PatchInputVar var = { };
+            var.location = location->second;
+            var.varId = ins.arg(2);
+            var.varOffset = ins.offset();
+            var.firstInLocation = location->second < 32
+              && !(locationMask & (1u << location->second));
 
-        for (uint32_t i = 0; i < compositeSize; i++)
-          code.putWord(constantId);
+            if (var.location < 32)
+              locationMask |= 1u << var.location;
 
-        constantId = compositeId;
-      } else {
-        constantId = code.allocId();
+            auto interface = interfaceOffsets.find(var.varId);
 
-        code.putIns(spv::OpConstant, 4);
-        code.putWord(i->second.baseTypeId);
-        code.putWord(constantId);
-        code.putWord(0);
-      }
-    }
+            if (interface != interfaceOffsets.end())
+              var.interfaceOffset = interface->second;
 
-    // Erase and re-declare variable
-    code.erase(4);
+            auto interpolation = interpolationOffsets.find(var.varId);
 
-    code.putIns(spv::OpVariable, 5);
-    code.putWord(privateTypes[0].first);
-    code.putWord(inputVarId);
-    code.putWord(spv::StorageClassPrivate);
-    code.putWord(constantId);
+            if (interpolation != interpolationOffsets.end())
+              var.interpolationOffset = interpolation->second;
 
-    code.endInsertion();
+            auto decoration = decorations.find(var.varId);
 
-    // Remove variable from interface list
-    if (spirvVersion < spvVersion(1, 4)) {
-      for (auto ins : code) {
-        if (ins.opCode() == spv::OpEntryPoint) {
-          uint32_t argIdx = 2 + code.strLen(ins.chr(2));
+            if (decoration != decorations.end())
+              var.decorations = std::move(decoration->second);
 
-          while (argIdx < ins.length()) {
-            if (ins.arg(argIdx) == inputVarId) {
-              ins.setArg(0, spv::OpEntryPoint | ((ins.length() - 1) << spv::WordCountShift));
+            // Gather the types that we need to declare private
+            // pointer types and zero constants for
+            auto pointerType = types.find(ins.arg(1));
 
-              code.beginInsertion(ins.offset() + argIdx);
-              code.erase(1);
-              code.endInsertion();
-              break;
+            if (pointerType != types.end()) {
+              for (auto t  = types.find(pointerType->second.baseTypeId);
+                        t != types.end();
+                        t  = types.find(t->second.baseTypeId))
+                var.types.push_back({ t->first, t->second.compositeSize });
             }
 
-            argIdx += 1;
+            inputVars.insert({ var.varId, m_patchPlan.inputs.size() });
+            m_patchPlan.inputs.push_back(std::move(var));
           }
 
-          break;
-        }
-      }
-    }
+          if (ins.arg(3) == spv::StorageClassOutput
+           && m_info.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+            auto pointerType = types.find(ins.arg(1));
 
-    // Remove location and other declarations
-    for (auto iter = code.begin(); iter != code.end(); ) {
-      auto ins = *(iter++);
-
-      if (ins.opCode() == spv::OpDecorate && ins.arg(1) == inputVarId) {
-        uint32_t numWords;
-
-        switch (ins.arg(2)) {
-          case spv::DecorationLocation:
-          case spv::DecorationFlat:
-          case spv::DecorationNoPerspective:
-          case spv::DecorationCentroid:
-          case spv::DecorationPatch:
-          case spv::DecorationSample:
-            numWords = ins.length();
-            break;
+            if (pointerType == types.end())
+              break;
 
-          default:
-            numWords = 0;
-        }
+            uint32_t typeId = pointerType->second.baseTypeId;
+            auto type = types.find(typeId);
 
-        if (numWords) {
-          code.beginInsertion(ins.offset());
-          code.erase(numWords);
+            if (type == types.end())
+              break;
 
-          iter = SpirvInstructionIterator(code.data(), code.endInsertion(), code.dwords());
-        }
-      }
+            PatchOutputVar var;
+            var.varId = ins.arg(2);
+            var.typeId = typeId;
+            var.location = location->second;
+
+            if (type->second.op == spv::OpTypeVector) {
+              var.componentCount = type->second.compositeSize;
+              var.componentTypeId = type->second.baseTypeId;
+            } else if (type->second.op == spv::OpTypeInt
+                    || type->second.op == spv::OpTypeFloat) {
+              var.componentCount = 1;
+              var.componentTypeId = typeId;
+            } else {
+              break;
+            }
 
-      if (ins.opCode() == spv::OpFunction)
-        break;
-    }
+            m_patchPlan.outputs.push_back(var);
+          }
+        } break;
 
-    // Fix up pointer types used in access chain instructions
-    std::unordered_map<uint32_t, uint32_t> accessChainIds;
+        case spv::OpAccessChain:
+        case spv::OpInBoundsAccessChain: {
+          uint32_t depth = ins.length() - 4;
+          size_t inputIndex = 0;
 
-    for (auto ins : code) {
-      if (ins.opCode() == spv::OpAccessChain
-       || ins.opCode() == spv::OpInBoundsAccessChain) {
-        uint32_t depth = ins.length() - 4;
-
-        if (ins.arg(3) == inputVarId) {
-          // Access chains accessing the variable directly
-          ins.setArg(1, privateTypes.at(depth).first);
-          accessChainIds.insert({ ins.arg(2), depth });
-        } else {
-          // Access chains derived from the variable
-          auto entry = accessChainIds.find(ins.arg(2));
-          if (entry != accessChainIds.end()) {
-            depth += entry->second;
-            ins.setArg(1, privateTypes.at(depth).first);
-            accessChainIds.insert({ ins.arg(2), depth });
+          auto var = inputVars.find(ins.arg(3));
+
+          if (var != inputVars.end()) {
+            inputIndex = var->second;
+          } else {
+            auto chain = accessChains.find(ins.arg(3));
+
+            if (chain == accessChains.end())
+              break;
+
+            inputIndex = chain->second.inputIndex;
+            depth += chain->second.depth;
           }
-        }
+
+          m_patchPlan.inputs[inputIndex].accessChains.push_back({ ins.offset() + 1, depth });
+          accessChains.insert({ ins.arg(2), { inputIndex, depth }});
+        } break;
+
+        case spv::OpFunction: {
+          functionId = ins.arg(2);
+        } break;
+
+        case spv::OpFunctionEnd: {
+          if (functionId == entryPointId)
+            m_patchPlan.epilogueOffset = prevOffset;
+        } break;
+
+        default: ;
       }
+
+      prevOffset = ins.offset();
     }
   }
 
 
-  void DxvkShader::emitOutputSwizzles(
-          SpirvCodeBuffer&          code,
-          uint32_t                  outputMask,
-          const VkComponentMapping* swizzles) {
-    // Skip this step entirely if all relevant
-    // outputs use the identity swizzle
-    bool requiresEpilogue = false;
+  bool DxvkShader::isInputEliminated(
+    const PatchInputVar&            var,
+          uint32_t                  undefinedInputs) {
+    return var.firstInLocation && !var.types.empty()
+        && (undefinedInputs & (1u << var.location));
+  }
 
-    for (auto index : bit::BitMask(outputMask))
-      requiresEpilogue |= !util::isIdentityMapping(swizzles[index]);
 
-    if (!requiresEpilogue)
-      return;
+  void DxvkShader::eliminateInput(
+          SpirvPatchList&           patches,
+    const PatchInputVar&            var) const {
+    patches.beginInsertion(var.varOffset);
 
-    // Gather some information. We need to scan pointer types with
-    // the output storage class to find the base vector type, and
-    // we need to scan vector types to find the component count.
-    uint32_t entryPointId = 0;
-    uint32_t functionId = 0;
+    // Declare private pointer types
+    std::vector<uint32_t> pointerTypeIds(var.types.size());
 
-    size_t epilogueOffset = 0;
-    size_t variableOffset = 0;
+    for (size_t i = 0; i < var.types.size(); i++) {
+      pointerTypeIds[i] = patches.allocId();
 
-    struct VarInfo {
-      uint32_t varId;
-      uint32_t typeId;
-      uint32_t location;
-      uint32_t componentCount;
-      uint32_t componentTypeId;
-    };
+      patches.putIns(spv::OpTypePointer, 4);
+      patches.putWord(pointerTypeIds[i]);
+      patches.putWord(spv::StorageClassPrivate);
+      patches.putWord(var.types[i].typeId);
+    }
 
-    struct VarIdInfo {
-      uint32_t location;
-    };
+    // Define zero constants
+    uint32_t constantId = 0;
 
-    struct TypeIdInfo {
-      uint32_t componentCount;
-      uint32_t baseTypeId;
-    };
+    for (size_t i = var.types.size(); i--; ) {
+      const auto& type = var.types[i];
 
-    union IdInfo {
-      VarIdInfo     var;
-      TypeIdInfo    type;
-    };
+      if (constantId) {
+        uint32_t compositeId = patches.allocId();
 
-    // Stores type information depending on type category:
-    // OpTypePointer:   type id -> base type id
-    // OpTypeVector:    type id -> component count
-    // OpTypeFloat/Int: type id -> 1
-    std::unordered_map<uint32_t, IdInfo> idInfo;
-    std::vector<VarInfo> varInfos;
+        patches.putIns(spv::OpConstantComposite, 3 + type.compositeSize);
+        patches.putWord(type.typeId);
+        patches.putWord(compositeId);
 
-    SpirvInstruction prev;
+        for (uint32_t j = 0; j < type.compositeSize; j++)
+          patches.putWord(constantId);
 
-    for (auto ins : code) {
-      switch (ins.opCode()) {
-        case spv::OpEntryPoint: {
-          entryPointId = ins.arg(2);
-        } break;
+        constantId = compositeId;
+      } else {
+        constantId = patches.allocId();
 
-        case spv::OpDecorate: {
-          if (ins.arg(2) == spv::DecorationLocation) {
-            IdInfo info;
-            info.var.location = ins.arg(3);
-            idInfo.insert({ ins.arg(1), info });
-          }
-        } break;
+        patches.putIns(spv::OpConstant, 4);
+        patches.putWord(type.typeId);
+        patches.putWord(constantId);
+        patches.putWord(0);
+      }
+    }
 
-        case spv::OpTypeVector: {
-          IdInfo info;
-          info.type.componentCount = ins.arg(3);
-          info.type.baseTypeId = ins.arg(2);
-          idInfo.insert({ ins.arg(1), info });
-        } break;
+    // Re-declare variable and erase the original
+    patches.putIns(spv::OpVariable, 5);
+    patches.putWord(pointerTypeIds[0]);
+    patches.putWord(var.varId);
+    patches.putWord(spv::StorageClassPrivate);
+    patches.putWord(constantId);
 
-        case spv::OpTypeInt:
-        case spv::OpTypeFloat: {
-          IdInfo info;
-          info.type.componentCount = 1;
-          info.type.baseTypeId = 0;
-          idInfo.insert({ ins.arg(1), info });
-        } break;
+    patches.erase(var.varOffset, 4);
 
-        case spv::OpTypePointer: {
-          if (ins.arg(2) == spv::StorageClassOutput) {
-            IdInfo info;
-            info.type.componentCount = 0;
-            info.type.baseTypeId = ins.arg(3);
-            idInfo.insert({ ins.arg(1), info });
-          }
-        } break;
+    // Remove variable from interface list. The caller
+    // is responsible for fixing up the word count.
+    if (var.interfaceOffset)
+      patches.erase(var.interfaceOffset, 1);
 
-        case spv::OpVariable: {
-          if (!variableOffset)
-            variableOffset = ins.offset();
-
-          if (ins.arg(3) == spv::StorageClassOutput) {
-            uint32_t ptrId = ins.arg(1);
-            uint32_t varId = ins.arg(2);
-
-            auto ptrEntry = idInfo.find(ptrId);
-            auto varEntry = idInfo.find(varId);
-
-            if (ptrEntry != idInfo.end()
-             && varEntry != idInfo.end()) {
-              uint32_t typeId = ptrEntry->second.type.baseTypeId;
-
-              auto typeEntry = idInfo.find(typeId);
-              if (typeEntry != idInfo.end()) {
-                VarInfo info;
-                info.varId = varId;
-                info.typeId = typeId;
-                info.location = varEntry->second.var.location;
-                info.componentCount = typeEntry->second.type.componentCount;
-                info.componentTypeId = (info.componentCount == 1)
-                  ? typeId : typeEntry->second.type.baseTypeId;
-
-                varInfos.push_back(info);
-              }
-            }
-          }
-        } break;
+    // Remove location and other declarations
+    for (const auto& decoration : var.decorations)
+      patches.erase(decoration.offset, decoration.length);
 
-        case spv::OpFunction: {
-          functionId = ins.arg(2);
-        } break;
+    // Fix up pointer types used in access chain instructions
+    for (const auto& chain : var.accessChains) {
+      if (chain.depth < pointerTypeIds.size())
+        patches.setWord(chain.offset, pointerTypeIds[chain.depth]);
+    }
+  }
 
-        case spv::OpFunctionEnd: {
-          if (entryPointId == functionId)
-            epilogueOffset = prev.offset();
-        } break;
 
-        default:
-          prev = ins;
-      }
+  void DxvkShader::emitOutputSwizzles(
+          SpirvPatchList&           patches,
+          const VkComponentMapping* swizzles) const {
+    // Skip this step entirely if all relevant
+    // outputs use the identity swizzle
+    bool requiresEpilogue = false;
 
-      if (epilogueOffset)
-        break;
-    }
+    for (auto index : bit::BitMask(m_info.outputMask))
+      requiresEpilogue |= !util::isIdentityMapping(swizzles[index]);
 
     // Oops, this shouldn't happen
-    if (!epilogueOffset)
+    if (!requiresEpilogue || !m_patchPlan.epilogueOffset)
       return;
 
-    code.beginInsertion(epilogueOffset);
+    patches.beginInsertion(m_patchPlan.epilogueOffset);
 
     struct ConstInfo {
       uint32_t constId;
@@ -640,12 +619,12 @@ namespace dxvk {
 
     std::vector<ConstInfo> consts;
 
-    for (const auto& var : varInfos) {
+    for (const auto& var : m_patchPlan.outputs) {
       uint32_t storeId = 0;
 
       if (var.componentCount == 1) {
         if (util::getComponentIndex(swizzles[var.location].r, 0) != 0) {
-          storeId = code.allocId();
+          storeId = patches.allocId();
 
           ConstInfo constInfo;
           constInfo.constId = storeId;
@@ -669,26 +648,26 @@ namespace dxvk {
           needsSwizzle |= indices[i] != i;
 
           if (indices[i] >= var.componentCount)
-            constId = code.allocId();
+            constId = patches.allocId();
         }
 
         if (needsSwizzle) {
-          uint32_t loadId = code.allocId();
-          code.putIns(spv::OpLoad, 4);
-          code.putWord(var.typeId);
-          code.putWord(loadId);
-          code.putWord(var.varId);
-
-          if (!constId) {        
-            storeId = code.allocId();
-            code.putIns(spv::OpVectorShuffle, 5 + var.componentCount);
-            code.putWord(var.typeId);
-            code.putWord(storeId);
-            code.putWord(loadId);
-            code.putWord(loadId);
+          uint32_t loadId = patches.allocId();
+          patches.putIns(spv::OpLoad, 4);
+          patches.putWord(var.typeId);
+          patches.putWord(loadId);
+          patches.putWord(var.varId);
+
+          if (!constId) {
+            storeId = patches.allocId();
+            patches.putIns(spv::OpVectorShuffle, 5 + var.componentCount);
+            patches.putWord(var.typeId);
+            patches.putWord(storeId);
+            patches.putWord(loadId);
+            patches.putWord(loadId);
 
             for (uint32_t i = 0; i < var.componentCount; i++)
-              code.putWord(indices[i]);
+              patches.putWord(indices[i]);
           } else {
             std::array<uint32_t, 4> ids = { };
 
@@ -700,140 +679,80 @@ namespace dxvk {
 
             for (uint32_t i = 0; i < var.componentCount; i++) {
               if (indices[i] < var.componentCount) {
-                ids[i] = code.allocId();
+                ids[i] = patches.allocId();
 
-                code.putIns(spv::OpCompositeExtract, 5);
-                code.putWord(var.componentTypeId);
-                code.putWord(ids[i]);
-                code.putWord(loadId);
-                code.putWord(indices[i]);
+                patches.putIns(spv::OpCompositeExtract, 5);
+                patches.putWord(var.componentTypeId);
+                patches.putWord(ids[i]);
+                patches.putWord(loadId);
+                patches.putWord(indices[i]);
               } else {
                 ids[i] = constId;
               }
             }
 
-            storeId = code.allocId();
-            code.putIns(spv::OpCompositeConstruct, 3 + var.componentCount);
-            code.putWord(var.typeId);
-            code.putWord(storeId);
+            storeId = patches.allocId();
+            patches.putIns(spv::OpCompositeConstruct, 3 + var.componentCount);
+            patches.putWord(var.typeId);
+            patches.putWord(storeId);
 
             for (uint32_t i = 0; i < var.componentCount; i++)
-              code.putWord(ids[i]);
+              patches.putWord(ids[i]);
           }
         }
       }
 
       if (storeId) {
-        code.putIns(spv::OpStore, 3);
-        code.putWord(var.varId);
-        code.putWord(storeId);
+        patches.putIns(spv::OpStore, 3);
+        patches.putWord(var.varId);
+        patches.putWord(storeId);
       }
     }
 
-    code.endInsertion();
-
     // If necessary, insert constants
     if (!consts.empty()) {
-      code.beginInsertion(variableOffset);
+      patches.beginInsertion(m_patchPlan.variableOffset);
 
       for (const auto& c : consts) {
-        code.putIns(spv::OpConstant, 4);
-        code.putWord(c.typeId);
-        code.putWord(c.constId);
-        code.putWord(c.value);
+        patches.putIns(spv::OpConstant, 4);
+        patches.putWord(c.typeId);
+        patches.putWord(c.constId);
+        patches.putWord(c.value);
       }
-
-      code.endInsertion();
     }
   }
 
 
   void DxvkShader::emitFlatShadingDeclarations(
-          SpirvCodeBuffer&          code,
-          uint32_t                  inputMask) {
+          SpirvPatchList&           patches,
+          uint32_t                  inputMask,
+          uint32_t                  undefinedInputs) const {
     if (!inputMask)
       return;
 
-    struct VarInfo {
-      uint32_t varId;
-      size_t decorationOffset;
-    };
-
-    std::unordered_set<uint32_t> candidates;
-    std::unordered_map<uint32_t, size_t> decorations;
-    std::vector<VarInfo> flatVars;
+    bool hasInsertion = false;
 
-    size_t decorateOffset = 0;
-
-    for (auto ins : code) {
-      switch (ins.opCode()) {
-        case spv::OpDecorate: {
-          decorateOffset = ins.offset() + ins.length();
-          uint32_t varId = ins.arg(1);
-
-          switch (ins.arg(2)) {
-            case spv::DecorationLocation: {
-              uint32_t location = ins.arg(3);
+    for (const auto& var : m_patchPlan.inputs) {
+      if (var.location >= 32 || !(inputMask & (1u << var.location)))
+        continue;
 
-              if (inputMask & (1u << location))
-                candidates.insert(varId);
-            } break;
+      // Eliminated inputs no longer have any decorations
+      if (isInputEliminated(var, undefinedInputs))
+        continue;
 
-            case spv::DecorationFlat:
-            case spv::DecorationCentroid:
-            case spv::DecorationSample:
-            case spv::DecorationNoPerspective: {
-              decorations.insert({ varId, ins.offset() + 2 });
-            } break;
-
-            default: ;
-          }
-        } break;
-
-        case spv::OpVariable: {
-          if (ins.arg(3) == spv::StorageClassInput) {
-            uint32_t varId = ins.arg(2);
-
-            // Only consider variables that have a desired location
-            if (candidates.find(varId) != candidates.end()) {
-              VarInfo varInfo;
-              varInfo.varId = varId;
-              varInfo.decorationOffset = 0;
-
-              auto decoration = decorations.find(varId);
-              if (decoration != decorations.end())
-                varInfo.decorationOffset = decoration->second;
-
-              flatVars.push_back(varInfo);
-            }
-          }
-        } break;
-
-        default:
-          break;
-      }
-    }
-
-    // Change existing decorations as necessary
-    for (const auto& var : flatVars) {
-      if (var.decorationOffset) {
-        uint32_t* rawCode = code.data();
-        rawCode[var.decorationOffset] = spv::DecorationFlat;
-      }
-    }
-
-    // Insert new decorations for remaining variables
-    code.beginInsertion(decorateOffset);
+      // Change existing decorations as necessary,
+      // and insert new decorations otherwise
+      if (var.interpolationOffset) {
+        patches.setWord(var.interpolationOffset, spv::DecorationFlat);
+      } else {
+        if (!std::exchange(hasInsertion, true))
+          patches.beginInsertion(m_patchPlan.decorationEnd);
 
-    for (const auto& var : flatVars) {
-      if (!var.decorationOffset) {
-        code.putIns(spv::OpDecorate, 3);
-        code.putWord(var.varId);
-        code.putWord(spv::DecorationFlat);
+        patches.putIns(spv::OpDecorate, 3);
+        patches.putWord(var.varId);
+        patches.putWord(spv::DecorationFlat);
       }
     }
-
-    code.endInsertion();
   }
 
 
@@ -1439,6 +1358,11 @@ namespace dxvk {
     DxvkShaderStageInfo stageInfo(m_device);
     VkShaderStageFlags stageMask = getShaderStages();
 
+    // Linked pipelines inherit the flags, so this also
+    // covers the final pipeline when using descriptor buffers
+    if (m_device->canUseDescriptorBuffer())
+      flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
     { std::lock_guard lock(m_identifierMutex);
       VkShaderStageFlags stages = stageMask;
 
@@ -10,6 +10,7 @@
 #include "../spirv/spirv_code_buffer.h"
 #include "../spirv/spirv_compression.h"
 #include "../spirv/spirv_module.h"
+#include "../spirv/spirv_patch_list.h"
 
 namespace dxvk {
   
@@ -168,8 +169,11 @@ namespace dxvk {
      * \brief Patches code using given info
      *
      * Rewrites binding IDs and potentially fixes up other
-     * parts of the code depending on pipeline state.
-     * \param [in] layout Biding layout
+     * parts of the code depending on pipeline state. Uses
+     * the patch plan gathered on shader creation so that
+     * most modifications are applied in a single pass.
+     * \param [in] layout Binding layout, or \c nullptr to
+     *    keep binding IDs unchanged
      * \param [in] state Pipeline state info
      * \returns Uncompressed SPIR-V code buffer
      */
@@ -254,6 +258,51 @@ namespace dxvk {
       uint32_t setOffset;
     };
 
+    struct PatchDecoration {
+      uint32_t offset;
+      uint32_t length;
+    };
+
+    struct PatchAccessChain {
+      uint32_t offset;
+      uint32_t depth;
+    };
+
+    struct PatchType {
+      uint32_t typeId;
+      uint32_t compositeSize;
+    };
+
+    struct PatchInputVar {
+      uint32_t location;
+      uint32_t varId;
+      uint32_t varOffset;
+      uint32_t interfaceOffset;
+      uint32_t interpolationOffset;
+      bool     firstInLocation;
+      std::vector<PatchDecoration>  decorations;
+      std::vector<PatchAccessChain> accessChains;
+      std::vector<PatchType>        types;
+    };
+
+    struct PatchOutputVar {
+      uint32_t varId;
+      uint32_t typeId;
+      uint32_t location;
+      uint32_t componentCount;
+      uint32_t componentTypeId;
+    };
+
+    struct PatchPlan {
+      uint32_t entryPointOffset = 0;
+      uint32_t entryPointLength = 0;
+      uint32_t decorationEnd    = 0;
+      uint32_t variableOffset   = 0;
+      uint32_t epilogueOffset   = 0;
+      std::vector<PatchInputVar>  inputs;
+      std::vector<PatchOutputVar> outputs;
+    };
+
     DxvkShaderCreateInfo          m_info;
     SpirvCompressedBuffer         m_code;
     
@@ -268,21 +317,29 @@ namespace dxvk {
     std::atomic<bool>             m_needsLibraryCompile = { true };
 
     std::vector<BindingOffsets>   m_bindingOffsets;
+    PatchPlan                     m_patchPlan;
 
     DxvkBindingLayout             m_bindings;
 
-    static void eliminateInput(
-            SpirvCodeBuffer&          code,
-            uint32_t                  location);
+    void buildPatchPlan(
+            SpirvCodeBuffer&          code);
 
-    static void emitOutputSwizzles(
-            SpirvCodeBuffer&          code,
-            uint32_t                  outputMask,
-            const VkComponentMapping* swizzles);
+    static bool isInputEliminated(
+      const PatchInputVar&            var,
+            uint32_t                  undefinedInputs);
 
-    static void emitFlatShadingDeclarations(
-            SpirvCodeBuffer&          code,
-            uint32_t                  inputMask);
+    void eliminateInput(
+            SpirvPatchList&           patches,
+      const PatchInputVar&            var) const;
+
+    void emitOutputSwizzles(
+            SpirvPatchList&           patches,
+            const VkComponentMapping* swizzles) const;
+
+    void emitFlatShadingDeclarations(
+            SpirvPatchList&           patches,
+            uint32_t                  inputMask,
+            uint32_t                  undefinedInputs) const;
 
     static void patchInputTopology(
             SpirvCodeBuffer&          code,
@@ -0,0 +1,431 @@
+#include <cstring>
+#include <filesystem>
+
+#include <version.h>
+
+#include "dxvk_device.h"
+#include "dxvk_shader_cache.h"
+
+namespace dxvk {
+
+  static Sha1Hash getSha1(const uint8_t* digest) {
+    Sha1Digest result;
+    std::memcpy(result.data(), digest, result.size());
+    return Sha1Hash(result);
+  }
+
+
+  static void putSha1(uint8_t* digest, const Sha1Hash& hash) {
+    for (uint32_t i = 0; i < 5; i++) {
+      uint32_t dw = hash.dword(i);
+
+      for (uint32_t j = 0; j < 4; j++)
+        digest[4 * i + j] = uint8_t(dw >> (8 * j));
+    }
+  }
+
+
+  DxvkShaderCache::DxvkShaderCache(const std::string& name)
+  : m_name(name) {
+    bool reset = env::getEnvVar("DXVK_SHADER_CACHE") == "reset";
+
+    if (reset || !readCacheFile()) {
+      m_file.close();
+      m_index.clear();
+      m_recreate = true;
+    }
+  }
+
+
+  DxvkShaderCache::~DxvkShaderCache() {
+    { std::unique_lock<dxvk::mutex> lock(m_writerLock);
+      m_stopped = true;
+      m_writerCond.notify_one();
+    }
+
+    if (m_writerThread.joinable())
+      m_writerThread.join();
+
+    uint64_t hits = m_hits.load();
+    uint64_t misses = m_misses.load();
+
+    if (hits || misses) {
+      Logger::info(str::format("DXVK: Shader cache: ", hits, " hits, ", misses,
+        " misses, ", m_bytesSaved.load() >> 10, " kB of SPIR-V loaded"));
+    }
+  }
+
+
+  bool DxvkShaderCache::lookup(
+    const DxvkShaderKey&          key,
+          DxvkShaderCacheEntry&   entry) {
+    auto indexEntry = m_index.find(key);
+
+    if (indexEntry == m_index.end() || !readCacheEntry(indexEntry->second, entry)) {
+      m_misses += 1;
+      return false;
+    }
+
+    m_hits += 1;
+    m_bytesSaved += entry.codeSize;
+    return true;
+  }
+
+
+  void DxvkShaderCache::store(
+    const DxvkShaderKey&          key,
+    const Rc<DxvkShader>&         shader,
+          std::vector<uint8_t>&&  data) {
+    if (m_index.find(key) != m_index.end())
+      return;
+
+    std::unique_lock<dxvk::mutex> lock(m_writerLock);
+
+    if (!m_writerKeys.insert(key).second)
+      return;
+
+    WriterItem item;
+    item.key    = key;
+    item.shader = shader;
+    item.data   = std::move(data);
+
+    m_writerQueue.push(std::move(item));
+    m_writerCond.notify_one();
+
+    if (!m_writerThread.joinable())
+      m_writerThread = dxvk::thread([this] () { writerFunc(); });
+  }
+
+
+  std::vector<DxvkShaderKey> DxvkShaderCache::getKeys() const {
+    std::vector<DxvkShaderKey> result;
+    result.reserve(m_index.size());
+
+    for (const auto& entry : m_index)
+      result.push_back(entry.first);
+
+    return result;
+  }
+
+
+  bool DxvkShaderCache::isEnabled(const DxvkDevice* device) {
+    std::string useShaderCache = env::getEnvVar("DXVK_SHADER_CACHE");
+
+    return useShaderCache != "0" && useShaderCache != "disable"
+        && device->config().enableShaderCache;
+  }
+
+
+  void DxvkShaderCache::writerFunc() {
+    env::setThreadName("dxvk-shader-writer");
+
+    std::ofstream file;
+
+    while (true) {
+      WriterItem item;
+
+      { std::unique_lock<dxvk::mutex> lock(m_writerLock);
+
+        m_writerCond.wait(lock, [this] () {
+          return m_writerQueue.size() || m_stopped;
+        });
+
+        if (m_writerQueue.empty())
+          break;
+
+        item = std::move(m_writerQueue.front());
+        m_writerQueue.pop();
+      }
+
+      if (!file.is_open()) {
+        file = openCacheFileForWrite();
+
+        if (!file) {
+          Logger::warn("DXVK: Failed to open shader cache file for writing");
+          break;
+        }
+      }
+
+      writeCacheEntry(file, item);
+    }
+  }
+
+
+  bool DxvkShaderCache::readCacheFile() {
+    auto path = getCacheFileName();
+    m_file = MappedFile(path);
+
+    // Create the file on demand if it does not exist
+    if (!m_file.isOpen()) {
+      Logger::debug("DXVK: No shader cache file found");
+      m_recreate = true;
+      return true;
+    }
+
+    DxvkShaderCacheHeader expected = getHeader();
+
+    if (m_file.size() < sizeof(expected) || !m_file.data()
+     || std::memcmp(m_file.data(), &expected, sizeof(expected))) {
+      Logger::info("DXVK: Shader cache out of date, creating new file");
+      return false;
+    }
+
+    // Only index the entries here, the entries themselves
+    // are validated and parsed when they are looked up.
+    size_t offset = sizeof(expected);
+
+    while (m_file.size() - offset >= sizeof(DxvkShaderCacheEntryHeader)) {
+      DxvkShaderCacheEntryHeader header;
+      std::memcpy(&header, m_file.data() + offset, sizeof(header));
+
+      size_t dataOffset = offset + sizeof(header);
+
+      if (header.size > m_file.size() - dataOffset || (header.size & 0x3))
+        break;
+
+      DxvkShaderKey key(VkShaderStageFlagBits(header.stage), getSha1(header.key));
+
+      IndexEntry entry;
+      entry.offset = dataOffset;
+      entry.size   = header.size;
+      std::memcpy(entry.checksum, header.checksum, sizeof(entry.checksum));
+
+      m_index.insert({ key, entry });
+
+      offset = dataOffset + header.size;
+    }
+
+    // If the application was terminated while writing an entry,
+    // truncate the file so that new entries can be appended.
+    if (offset != m_file.size()) {
+      Logger::warn(str::format("DXVK: Discarding ", m_file.size() - offset,
+        " bytes of incomplete shader cache data"));
+
+      m_file.close();
+
+      std::error_code ec;
+      std::filesystem::resize_file(path, offset, ec);
+
+      m_file = MappedFile(path);
+
+      if (ec || m_file.size() != offset)
+        return false;
+    }
+
+    Logger::info(str::format("DXVK: Read ", m_index.size(), " shader cache entries"));
+    return true;
+  }
+
+
+  bool DxvkShaderCache::readCacheEntry(
+    const IndexEntry&             indexEntry,
+          DxvkShaderCacheEntry&   entry) const {
+    const uint8_t* data = m_file.data() + indexEntry.offset;
+
+    if (Sha1Hash::compute(data, indexEntry.size) != getSha1(indexEntry.checksum)) {
+      Logger::warn("DXVK: Corrupted shader cache entry");
+      return false;
+    }
+
+    DxvkShaderCacheInfo info;
+
+    if (indexEntry.size < sizeof(info))
+      return false;
+
+    std::memcpy(&info, data, sizeof(info));
+
+    size_t bindingOffset = sizeof(info);
+    size_t codeOffset = bindingOffset + sizeof(DxvkShaderCacheBinding) * info.bindingCount;
+    size_t dataOffset = codeOffset + sizeof(uint32_t) * info.compressedCodeSize;
+
+    if (dataOffset + align(info.dataSize, 4u) != indexEntry.size)
+      return false;
+
+    std::vector<DxvkBindingInfo> bindings(info.bindingCount);
+
+    for (uint32_t i = 0; i < info.bindingCount; i++) {
+      DxvkShaderCacheBinding binding;
+      std::memcpy(&binding, data + bindingOffset + sizeof(binding) * i, sizeof(binding));
+
+      bindings[i].descriptorType  = VkDescriptorType(binding.descriptorType);
+      bindings[i].resourceBinding = binding.resourceBinding;
+      bindings[i].viewType        = VkImageViewType(binding.viewType);
+      bindings[i].stage           = VkShaderStageFlagBits(info.stage);
+      bindings[i].access          = binding.access;
+      bindings[i].accessOp.op     = binding.accessOp;
+      bindings[i].uboSet          = binding.uboSet;
+      bindings[i].isMultisampled  = binding.isMultisampled;
+    }
+
+    DxvkShaderCreateInfo shaderInfo;
+    shaderInfo.stage                = VkShaderStageFlagBits(info.stage);
+    shaderInfo.bindingCount         = info.bindingCount;
+    shaderInfo.bindings             = bindings.data();
+    shaderInfo.inputMask            = info.inputMask;
+    shaderInfo.outputMask           = info.outputMask;
+    shaderInfo.flatShadingInputs    = info.flatShadingInputs;
+    shaderInfo.pushConstStages      = info.pushConstStages;
+    shaderInfo.pushConstSize        = info.pushConstSize;
+    shaderInfo.xfbRasterizedStream  = info.xfbRasterizedStream;
+    shaderInfo.patchVertexCount     = info.patchVertexCount;
+    shaderInfo.inputTopology        = VkPrimitiveTopology(info.inputTopology);
+    shaderInfo.outputTopology       = VkPrimitiveTopology(info.outputTopology);
+
+    for (uint32_t i = 0; i < MaxNumXfbBuffers; i++)
+      shaderInfo.xfbStrides[i] = info.xfbStrides[i];
+
+    SpirvCompressedBuffer code(info.codeSize, info.compressedCodeSize,
+      reinterpret_cast<const uint32_t*>(data + codeOffset));
+
+    entry.shader = new DxvkShader(shaderInfo, code.decompress());
+    entry.data.resize(info.dataSize);
+    entry.codeSize = info.codeSize * sizeof(uint32_t);
+
+    if (info.dataSize)
+      std::memcpy(entry.data.data(), data + dataOffset, info.dataSize);
+
+    return true;
+  }
+
+
+  void DxvkShaderCache::writeCacheEntry(
+          std::ofstream&          file,
+    const WriterItem&             item) const {
+    const DxvkShaderCreateInfo& shaderInfo = item.shader->info();
+    const DxvkBindingLayout& layout = item.shader->getBindings();
+
+    // The shader does not retain the original binding array, gather
+    // bindings from the layout instead. Since bindings are sorted
+    // within each set, the order does not matter when re-creating
+    // the shader from the cache.
+    std::vector<DxvkShaderCacheBinding> bindings;
+
+    for (uint32_t i = 0; i < DxvkDescriptorSets::SetCount; i++) {
+      for (uint32_t j = 0; j < layout.getBindingCount(i); j++) {
+        const DxvkBindingInfo& binding = layout.getBinding(i, j);
+
+        DxvkShaderCacheBinding& e = bindings.emplace_back();
+        e.descriptorType  = uint32_t(binding.descriptorType);
+        e.resourceBinding = binding.resourceBinding;
+        e.viewType        = uint32_t(binding.viewType);
+        e.access          = uint32_t(binding.access);
+        e.accessOp        = uint16_t(binding.accessOp);
+        e.uboSet          = binding.uboSet;
+        e.isMultisampled  = binding.isMultisampled;
+      }
+    }
+
+    SpirvCodeBuffer rawCode = item.shader->getRawCode();
+    SpirvCompressedBuffer code(rawCode);
+
+    DxvkShaderCacheInfo info = { };
+    info.stage                = uint32_t(shaderInfo.stage);
+    info.bindingCount         = uint32_t(bindings.size());
+    info.inputMask            = shaderInfo.inputMask;
+    info.outputMask           = shaderInfo.outputMask;
+    info.flatShadingInputs    = shaderInfo.flatShadingInputs;
+    info.pushConstStages      = uint32_t(shaderInfo.pushConstStages);
+    info.pushConstSize        = shaderInfo.pushConstSize;
+    info.xfbRasterizedStream  = shaderInfo.xfbRasterizedStream;
+    info.patchVertexCount     = shaderInfo.patchVertexCount;
+    info.inputTopology        = uint32_t(shaderInfo.inputTopology);
+    info.outputTopology       = uint32_t(shaderInfo.outputTopology);
+    info.codeSize             = uint32_t(code.size());
+    info.compressedCodeSize   = uint32_t(code.compressedSize());
+    info.dataSize             = uint32_t(item.data.size());
+
+    for (uint32_t i = 0; i < MaxNumXfbBuffers; i++)
+      info.xfbStrides[i] = shaderInfo.xfbStrides[i];
+
+    size_t bindingOffset = sizeof(info);
+    size_t codeOffset = bindingOffset + sizeof(DxvkShaderCacheBinding) * bindings.size();
+    size_t dataOffset = codeOffset + sizeof(uint32_t) * code.compressedSize();
+
+    std::vector<uint8_t> payload(dataOffset + align(item.data.size(), 4u));
+    std::memcpy(&payload[0], &info, sizeof(info));
+
+    if (!bindings.empty())
+      std::memcpy(&payload[bindingOffset], bindings.data(), sizeof(DxvkShaderCacheBinding) * bindings.size());
+
+    if (code.compressedSize())
+      std::memcpy(&payload[codeOffset], code.compressedData(), sizeof(uint32_t) * code.compressedSize());
+
+    if (!item.data.empty())
+      std::memcpy(&payload[dataOffset], item.data.data(), item.data.size());
+
+    DxvkShaderCacheEntryHeader header = { };
+    header.stage = uint32_t(item.key.type());
+    header.size  = uint32_t(payload.size());
+    putSha1(header.key, item.key.sha1());
+    putSha1(header.checksum, Sha1Hash::compute(payload.data(), payload.size()));
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    file.flush();
+  }
+
+
+  std::ofstream DxvkShaderCache::openCacheFileForWrite() const {
+    std::ofstream file;
+
+    if (m_recreate) {
+      file = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+
+      if (!file && env::createDirectory(getCacheDir())) {
+        file = std::ofstream(getCacheFileName().c_str(),
+          std::ios_base::binary |
+          std::ios_base::trunc);
+      }
+
+      if (file) {
+        Logger::info("DXVK: Creating new shader cache file");
+
+        DxvkShaderCacheHeader header = getHeader();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      }
+    } else {
+      file = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary |
+        std::ios_base::app);
+    }
+
+    return file;
+  }
+
+
+  str::path_string DxvkShaderCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeBaseName();
+    path += exeName + "." + m_name + ".dxvk-shaders";
+    return str::topath(path.c_str());
+  }
+
+
+  std::string DxvkShaderCache::getCacheDir() const {
+    std::string path = env::getEnvVar("DXVK_SHADER_CACHE_PATH");
+
+    if (path.empty())
+      path = env::getEnvVar("DXVK_STATE_CACHE_PATH");
+
+    return path;
+  }
+
+
+  DxvkShaderCacheHeader DxvkShaderCache::getHeader() {
+    DxvkShaderCacheHeader header = { };
+    std::memcpy(header.magic, "DXVKSHC", 8);
+    header.version = 2;
+    header.entryHeaderSize = sizeof(DxvkShaderCacheEntryHeader);
+
+    // Invalidate the cache whenever the shader compiler may have changed
+    std::strncpy(header.dxvkVersion, DXVK_VERSION, sizeof(header.dxvkVersion) - 1);
+    return header;
+  }
+
+}
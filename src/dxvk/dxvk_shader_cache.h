@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+#include "../util/thread.h"
+#include "../util/util_mapped_file.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+
+  /**
+   * \brief Shader cache file header
+   *
+   * The DXVK version is part of the header so that
+   * shaders translated by a different version of the
+   * shader compiler are never loaded.
+   */
+  struct DxvkShaderCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entryHeaderSize;
+    char     dxvkVersion[64];
+  };
+
+
+  /**
+   * \brief Shader cache entry header
+   *
+   * Precedes the payload of each entry. The checksum
+   * is used to detect corrupted entries on lookup.
+   */
+  struct DxvkShaderCacheEntryHeader {
+    uint32_t stage;
+    uint8_t  key[20];
+    uint8_t  checksum[20];
+    uint32_t size;
+  };
+
+
+  /**
+   * \brief Serialized shader info
+   *
+   * Stores all \ref DxvkShaderCreateInfo fields, as well
+   * as the sizes of the arrays following the info.
+   */
+  struct DxvkShaderCacheInfo {
+    uint32_t stage;
+    uint32_t bindingCount;
+    uint32_t inputMask;
+    uint32_t outputMask;
+    uint32_t flatShadingInputs;
+    uint32_t pushConstStages;
+    uint32_t pushConstSize;
+    int32_t  xfbRasterizedStream;
+    uint32_t patchVertexCount;
+    uint32_t xfbStrides[MaxNumXfbBuffers];
+    uint32_t inputTopology;
+    uint32_t outputTopology;
+    uint32_t codeSize;
+    uint32_t compressedCodeSize;
+    uint32_t dataSize;
+  };
+
+
+  /**
+   * \brief Serialized binding info
+   */
+  struct DxvkShaderCacheBinding {
+    uint32_t descriptorType;
+    uint32_t resourceBinding;
+    uint32_t viewType;
+    uint32_t access;
+    uint16_t accessOp;
+    uint8_t  uboSet;
+    uint8_t  isMultisampled;
+  };
+
+
+  /**
+   * \brief Shader cache lookup result
+   */
+  struct DxvkShaderCacheEntry {
+    /// Shader object
+    Rc<DxvkShader>        shader;
+    /// Client API data
+    std::vector<uint8_t>  data;
+    /// Uncompressed SPIR-V size, in bytes
+    size_t                codeSize = 0;
+  };
+
+
+  /**
+   * \brief Persistent shader cache
+   *
+   * Stores translated shaders in a file, so that subsequent
+   * runs of an application do not need to translate the
+   * same shaders again. Entries are identified by a shader
+   * key, which must be computed by the client API from the
+   * original shader code and all options that may affect
+   * the translation.
+   *
+   * The cache file is memory-mapped on creation, and only
+   * the entry headers are read up front. Newly translated
+   * shaders are appended to the file by a worker thread.
+   * In addition to the shader itself, entries can store
+   * arbitrary client API data. This class is thread-safe.
+   */
+  class DxvkShaderCache : public RcObject {
+
+  public:
+
+    DxvkShaderCache(const std::string& name);
+
+    ~DxvkShaderCache();
+
+    /**
+     * \brief Looks up a shader
+     *
+     * \param [in] key Cache key
+     * \param [out] entry Shader and client API data
+     * \returns \c true if a valid entry was found
+     */
+    bool lookup(
+      const DxvkShaderKey&          key,
+            DxvkShaderCacheEntry&   entry);
+
+    /**
+     * \brief Adds a shader to the cache
+     *
+     * Does nothing if the key is already in the cache.
+     * \param [in] key Cache key
+     * \param [in] shader Translated shader
+     * \param [in] data Client API data
+     */
+    void store(
+      const DxvkShaderKey&          key,
+      const Rc<DxvkShader>&         shader,
+            std::vector<uint8_t>&&  data);
+
+    /**
+     * \brief Retrieves keys of all cached shaders
+     *
+     * Only includes shaders that were present in the cache
+     * file when the cache was created. Can be used by client
+     * APIs to load shaders before they are first requested.
+     * \returns Keys of all shaders in the cache file
+     */
+    std::vector<DxvkShaderKey> getKeys() const;
+
+    /**
+     * \brief Checks whether the shader cache is enabled
+     *
+     * \param [in] device DXVK device
+     * \returns \c true if the cache should be used
+     */
+    static bool isEnabled(const DxvkDevice* device);
+
+  private:
+
+    struct IndexEntry {
+      size_t  offset;
+      size_t  size;
+      uint8_t checksum[20];
+    };
+
+    struct WriterItem {
+      DxvkShaderKey         key;
+      Rc<DxvkShader>        shader;
+      std::vector<uint8_t>  data;
+    };
+
+    std::string                       m_name;
+    MappedFile                        m_file;
+
+    std::unordered_map<DxvkShaderKey,
+      IndexEntry, DxvkHash, DxvkEq>   m_index;
+
+    bool                              m_recreate = false;
+
+    std::atomic<uint64_t>             m_hits        = { 0u };
+    std::atomic<uint64_t>             m_misses      = { 0u };
+    std::atomic<uint64_t>             m_bytesSaved  = { 0u };
+
+    dxvk::mutex                       m_writerLock;
+    dxvk::condition_variable          m_writerCond;
+    std::queue<WriterItem>            m_writerQueue;
+    std::unordered_set<DxvkShaderKey,
+      DxvkHash, DxvkEq>               m_writerKeys;
+    bool                              m_stopped = false;
+    dxvk::thread                      m_writerThread;
+
+    void writerFunc();
+
+    bool readCacheFile();
+
+    bool readCacheEntry(
+      const IndexEntry&             indexEntry,
+            DxvkShaderCacheEntry&   entry) const;
+
+    void writeCacheEntry(
+            std::ofstream&          file,
+      const WriterItem&             item) const;
+
+    std::ofstream openCacheFileForWrite() const;
+
+    str::path_string getCacheFileName() const;
+
+    std::string getCacheDir() const;
+
+    static DxvkShaderCacheHeader getHeader();
+
+  };
+
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+#include "dxvk_shader_log.h"
+
+#include "../util/log/log.h"
+
+#include "../util/util_env.h"
+#include "../util/util_string.h"
+
+namespace dxvk {
+
+  static const std::array<const char*, 6> g_stageNames = {{
+    "VS", "HS", "DS", "GS", "PS", "CS",
+  }};
+
+
+  DxvkShaderLog::DxvkShaderLog(const std::string& path) {
+    m_file = std::ofstream(str::topath(path.c_str()).c_str(),
+      std::ios_base::trunc);
+
+    if (!m_file) {
+      Logger::err(str::format("Shader log: Failed to open ", path));
+      return;
+    }
+
+    m_file << "name,stage,input_bytes,spirv_bytes,time_us,valid" << std::endl;
+  }
+
+
+  DxvkShaderLog::~DxvkShaderLog() {
+    logStats();
+  }
+
+
+  void DxvkShaderLog::logShader(
+    const Rc<DxvkShader>&                 shader,
+          size_t                          inputSize,
+          high_resolution_clock::duration time) {
+    auto now = high_resolution_clock::now();
+
+    // This happens outside the measured time frame,
+    // so validation does not affect the results
+    SpirvCodeBuffer code = shader->getRawCode();
+    bool valid = validateCode(code);
+
+    if (!valid)
+      Logger::warn(str::format("Shader log: Invalid SPIR-V for ", shader->debugName()));
+
+    uint32_t stageIndex = bit::tzcnt(uint32_t(shader->info().stage));
+    uint32_t us = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+
+    std::lock_guard lock(m_mutex);
+
+    if (!(m_shaderCount++))
+      m_firstTime = now - time;
+
+    m_lastTime = now;
+
+    if (stageIndex < m_stages.size()) {
+      auto& stats = m_stages[stageIndex];
+      stats.invalidCount += valid ? 0 : 1;
+      stats.inputSize += inputSize;
+      stats.codeSize += code.size();
+      stats.times.push_back(us);
+    }
+
+    if (m_file) {
+      m_file << shader->debugName() << ","
+             << (stageIndex < g_stageNames.size() ? g_stageNames[stageIndex] : "??") << ","
+             << inputSize << "," << code.size() << "," << us << ","
+             << (valid ? 1 : 0) << "\n";
+    }
+  }
+
+
+  std::unique_ptr<DxvkShaderLog> DxvkShaderLog::createFromEnv() {
+    static std::atomic<uint32_t> s_logCount = { 0u };
+
+    std::string path = env::getEnvVar("DXVK_SHADER_LOG");
+
+    if (path.empty())
+      return nullptr;
+
+    // Each device has its own log, give them distinct files
+    path = env::getIndexedFilePath(path, s_logCount++);
+
+    Logger::info(str::format("Shader log: ", path));
+    return std::make_unique<DxvkShaderLog>(path);
+  }
+
+
+  void DxvkShaderLog::logStats() const {
+    uint64_t totalCount = 0;
+    uint64_t totalTime = 0;
+
+    for (uint32_t i = 0; i < m_stages.size(); i++) {
+      std::vector<uint32_t> times = m_stages[i].times;
+
+      if (times.empty())
+        continue;
+
+      std::sort(times.begin(), times.end());
+
+      uint64_t sum = 0;
+
+      for (auto t : times)
+        sum += t;
+
+      totalCount += times.size();
+      totalTime += sum;
+
+      std::stringstream str;
+      str << std::fixed << std::setprecision(2)
+          << "Shader log: " << g_stageNames[i] << ": " << times.size() << " shaders, "
+          << double(sum) / 1000.0 << " ms total, "
+          << sum / times.size() << " us mean, "
+          << times[times.size() / 2] << " us p50, "
+          << times[(times.size() * 99) / 100] << " us p99, "
+          << times.back() << " us max, "
+          << double(m_stages[i].inputSize) / 1024.0 << " kB input, "
+          << double(m_stages[i].codeSize) / 1024.0 << " kB SPIR-V";
+
+      if (m_stages[i].invalidCount)
+        str << ", " << m_stages[i].invalidCount << " invalid";
+
+      Logger::info(str.str());
+    }
+
+    if (!totalCount)
+      return;
+
+    // Translation time relative to the time between the first and
+    // last shader gives a rough idea of how well translation scales
+    // when the application creates shaders on multiple threads.
+    uint64_t wallTime = std::chrono::duration_cast<std::chrono::microseconds>(m_lastTime - m_firstTime).count();
+
+    std::stringstream str;
+    str << std::fixed << std::setprecision(2)
+        << "Shader log: " << totalCount << " shaders, "
+        << double(totalTime) / 1000.0 << " ms total, "
+        << double(wallTime) / 1000.0 << " ms elapsed, "
+        << (wallTime ? double(totalTime) / double(wallTime) : 1.0) << "x parallelism";
+
+    Logger::info(str.str());
+  }
+
+
+  bool DxvkShaderLog::validateCode(
+          SpirvCodeBuffer&                code) {
+    const uint32_t* data = code.data();
+    uint32_t size = code.dwords();
+
+    if (size < 5 || data[0] != spv::MagicNumber || !data[3])
+      return false;
+
+    // Make sure instruction lengths are consistent,
+    // and that there is at least one entry point
+    bool hasEntryPoint = false;
+
+    for (uint32_t offset = 5; offset < size; ) {
+      uint32_t length = data[offset] >> spv::WordCountShift;
+
+      if (!length || length > size - offset)
+        return false;
+
+      hasEntryPoint |= (data[offset] & spv::OpCodeMask) == spv::OpEntryPoint;
+      offset += length;
+    }
+
+    return hasEntryPoint;
+  }
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+#include "../util/thread.h"
+#include "../util/util_time.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Shader translation log
+   *
+   * Records the translation time and code size of every
+   * shader translated by a client API, and performs basic
+   * validation of the generated SPIR-V. Writes one CSV line
+   * per shader, and logs aggregate statistics per shader
+   * stage when the log is destroyed, so that changes to the
+   * shader compilers can be measured by replaying a game.
+   *
+   * Enabled by setting \c DXVK_SHADER_LOG to a file path.
+   */
+  class DxvkShaderLog {
+
+  public:
+
+    DxvkShaderLog(const std::string& path);
+
+    ~DxvkShaderLog();
+
+    /**
+     * \brief Logs a translated shader
+     *
+     * \param [in] shader Translated shader
+     * \param [in] inputSize Size of the original bytecode
+     * \param [in] time Time spent translating the shader
+     */
+    void logShader(
+      const Rc<DxvkShader>&                 shader,
+            size_t                          inputSize,
+            high_resolution_clock::duration time);
+
+    /**
+     * \brief Creates shader log
+     *
+     * \returns Shader log if enabled, or \c nullptr
+     */
+    static std::unique_ptr<DxvkShaderLog> createFromEnv();
+
+  private:
+
+    struct StageStats {
+      uint64_t              invalidCount  = 0;
+      uint64_t              inputSize     = 0;
+      uint64_t              codeSize      = 0;
+      std::vector<uint32_t> times;
+    };
+
+    dxvk::mutex                       m_mutex;
+    std::ofstream                     m_file;
+
+    std::array<StageStats, 6>         m_stages;
+    uint64_t                          m_shaderCount = 0;
+
+    high_resolution_clock::time_point m_firstTime;
+    high_resolution_clock::time_point m_lastTime;
+
+    void logStats() const;
+
+    static bool validateCode(
+            SpirvCodeBuffer&                code);
+
+  };
+
+}
@@ -2,6 +2,9 @@
 #include "dxvk_pipemanager.h"
 #include "dxvk_state_cache.h"
 
+#include "../util/util_mapped_file.h"
+#include "../util/util_time.h"
+
 namespace dxvk {
 
   static const Sha1Hash       g_nullHash      = Sha1Hash::compute(nullptr, 0);
@@ -18,6 +21,20 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Block header
+   *
+   * Starting with version 19, entries are stored in blocks.
+   * Each block header is followed by a table of entry offsets,
+   * relative to the start of the entry data, so that entries
+   * can be located without parsing preceding entries.
+   */
+  struct DxvkStateCacheBlockHeader {
+    uint32_t entryCount;
+    uint32_t dataSize;
+  };
+
+
   /**
    * \brief Version 8 entry header
    */
@@ -193,6 +210,17 @@ namespace dxvk {
       return true;
     }
 
+    bool readFromMemory(const char* data, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      std::memcpy(m_data, data, size);
+
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
   private:
 
     size_t m_size = 0;
@@ -221,6 +249,103 @@ namespace dxvk {
   };
 
 
+  static bool parseCacheEntry(
+          uint32_t                    version,
+    const DxvkStateCacheEntryHeader&  header,
+          VkShaderStageFlags          stageMask,
+    const Sha1Hash&                   hash,
+          DxvkStateCacheEntryData&    data,
+          DxvkStateCacheEntry&        entry) {
+    // Validate hash, skip entry if invalid
+    if (hash != data.computeHash())
+      return false;
+
+    // Set up entry metadata
+    entry.type = DxvkStateCacheEntryType(header.entryType);
+
+    // Read shader hashes
+    auto entryType = DxvkStateCacheEntryType(header.entryType);
+    data.read(entry.shaders, version, stageMask);
+
+    if (entryType == DxvkStateCacheEntryType::PipelineLibrary)
+      return true;
+
+    DxvkBindingMaskV10 dummyBindingMask = { };
+
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
+      if (!data.read(dummyBindingMask, version))
+        return false;
+    } else {
+      // Read packed render pass format
+      if (version < 12) {
+        DxvkRenderPassFormatV11 v11;
+        data.read(v11, version);
+        entry.gpState.rt = v11.convert();
+      }
+
+      // Read common pipeline state
+      if (!data.read(dummyBindingMask, version)
+       || !data.read(entry.gpState.ia, version)
+       || !data.read(entry.gpState.il, version)
+       || !data.read(entry.gpState.rs, version)
+       || !data.read(entry.gpState.ms, version)
+       || !data.read(entry.gpState.ds, version)
+       || !data.read(entry.gpState.om, version)
+       || !data.read(entry.gpState.rt, version)
+       || !data.read(entry.gpState.dsFront, version)
+       || !data.read(entry.gpState.dsBack, version))
+        return false;
+
+      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
+       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
+        return false;
+
+      // Read render target swizzles
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omSwizzle[i], version))
+          return false;
+      }
+
+      // Read render target blend info
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omBlend[i], version))
+          return false;
+      }
+
+      // Read defined vertex attributes
+      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
+        if (!data.read(entry.gpState.ilAttributes[i], version))
+          return false;
+      }
+
+      // Read defined vertex bindings
+      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
+        if (!data.read(entry.gpState.ilBindings[i], version))
+          return false;
+      }
+    }
+
+    // Read non-zero spec constants
+    uint32_t specConstantMask = 0;
+
+    if (!data.read(specConstantMask, version))
+      return false;
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (specConstantMask & (1 << i)) {
+        if (!data.read(entry.gpState.sc.specConstants[i], version))
+          return false;
+      }
+    }
+
+    // Compute shaders are no longer supported
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+      return false;
+
+    return true;
+  }
+
+
   template<typename T>
   bool readCacheEntryTyped(std::istream& stream, T& entry) {
     auto data = reinterpret_cast<char*>(&entry);
@@ -276,8 +401,10 @@ namespace dxvk {
 
       // Write all valid entries to the cache file in
       // case we're recovering a corrupted cache file
-      for (auto& e : m_entries)
-        writeCacheEntry(file, e);
+      for (size_t i = 0; i < m_entries.size(); i += MaxBlockEntries) {
+        writeCacheBlock(file, &m_entries[i],
+          std::min<size_t>(m_entries.size() - i, MaxBlockEntries));
+      }
     }
   }
   
@@ -445,32 +572,40 @@ namespace dxvk {
     DxvkGraphicsPipeline* pipeline = nullptr;
     auto entries = m_entryMap.equal_range(key);
 
+    // Compile pipeline libraries first and make optimized pipelines
+    // wait for them, since pipelines that can be fast-linked once
+    // the library is available do not need to be compiled at all.
+    Rc<DxvkPipelineTask> libraryTask;
+
     for (auto e = entries.first; e != entries.second; e++) {
       const auto& entry = m_entries[e->second];
 
-      switch (entry.type) {
-        case DxvkStateCacheEntryType::MonolithicPipeline: {
-          if (!pipeline)
-            pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
+      if (entry.type != DxvkStateCacheEntryType::PipelineLibrary
+       || !m_device->canUseGraphicsPipelineLibrary() || item.gp.vs == nullptr)
+        continue;
 
-          m_pipeWorkers->compileGraphicsPipeline(pipeline, entry.gpState, DxvkPipelinePriority::Normal);
-        } break;
+      DxvkShaderPipelineLibraryKey libraryKey;
+      libraryKey.addShader(item.gp.vs);
 
-        case DxvkStateCacheEntryType::PipelineLibrary: {
-          if (!m_device->canUseGraphicsPipelineLibrary() || item.gp.vs == nullptr)
-            break;
+      if (item.gp.tcs != nullptr) libraryKey.addShader(item.gp.tcs);
+      if (item.gp.tes != nullptr) libraryKey.addShader(item.gp.tes);
+      if (item.gp.gs  != nullptr) libraryKey.addShader(item.gp.gs);
 
-          DxvkShaderPipelineLibraryKey libraryKey;
-          libraryKey.addShader(item.gp.vs);
+      auto pipelineLibrary = m_pipeManager->createShaderPipelineLibrary(libraryKey);
+      libraryTask = m_pipeWorkers->compilePipelineLibrary(pipelineLibrary, DxvkPipelinePriority::Normal);
+    }
 
-          if (item.gp.tcs != nullptr) libraryKey.addShader(item.gp.tcs);
-          if (item.gp.tes != nullptr) libraryKey.addShader(item.gp.tes);
-          if (item.gp.gs  != nullptr) libraryKey.addShader(item.gp.gs);
+    for (auto e = entries.first; e != entries.second; e++) {
+      const auto& entry = m_entries[e->second];
 
-          auto pipelineLibrary = m_pipeManager->createShaderPipelineLibrary(libraryKey);
-          m_pipeWorkers->compilePipelineLibrary(pipelineLibrary, DxvkPipelinePriority::Normal);
-        } break;
-      }
+      if (entry.type != DxvkStateCacheEntryType::MonolithicPipeline)
+        continue;
+
+      if (!pipeline)
+        pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
+
+      m_pipeWorkers->compileGraphicsPipeline(pipeline, entry.gpState,
+        DxvkPipelinePriority::Normal, libraryTask);
     }
   }
 
@@ -502,34 +637,32 @@ namespace dxvk {
       return false;
     }
 
-    // Notify user about format conversion
-    if (curHeader.version != newHeader.version)
-      Logger::info(str::format("DXVK: Updating state cache version to v", newHeader.version));
-
     // Read actual cache entries from the file.
     // If we encounter invalid entries, we should
     // regenerate the entire state cache file.
     uint32_t numInvalidEntries = 0;
+    uint32_t numBlocks = 0;
 
-    while (ifile) {
-      DxvkStateCacheEntry entry;
+    if (curHeader.version >= 19) {
+      ifile.close();
 
-      if (readCacheEntry(curHeader.version, ifile, entry)) {
-        size_t entryId = m_entries.size();
-        m_entries.push_back(entry);
+      numInvalidEntries = readCacheBlocks(curHeader.version, numBlocks);
+    } else {
+      // Notify user about format conversion
+      Logger::info(str::format("DXVK: Updating state cache version to v", newHeader.version));
 
-        mapPipelineToEntry(entry.shaders, entryId);
+      while (ifile) {
+        DxvkStateCacheEntry entry;
 
-        mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
-        mapShaderToPipeline(entry.shaders.tes, entry.shaders);
-        mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
-      } else if (ifile) {
-        numInvalidEntries += 1;
+        if (readCacheEntry(curHeader.version, ifile, entry))
+          m_entries.push_back(entry);
+        else if (ifile)
+          numInvalidEntries += 1;
       }
     }
 
+    mapCacheEntries();
+
     Logger::info(str::format(
       "DXVK: Read ", m_entries.size(),
       " valid state cache entries"));
@@ -540,12 +673,140 @@ namespace dxvk {
         " invalid state cache entries"));
       return false;
     }
+
+    // Appending to the cache file creates one block per batch of
+    // new entries, rewrite the file if blocks are mostly tiny.
+    if (numBlocks > MaxBlockCount && numBlocks * 16u > m_entries.size()) {
+      Logger::info("DXVK: Compacting state cache");
+      return false;
+    }
     
     // Rewrite entire state cache if it is outdated
     return curHeader.version == newHeader.version;
   }
 
 
+  uint32_t DxvkStateCache::readCacheBlocks(
+          uint32_t                  version,
+          uint32_t&                 numBlocks) {
+    MappedFile file(getCacheFileName());
+
+    if (!file.data())
+      return 0;
+
+    // Gather entry locations from the block indices. This only
+    // touches block headers and offset tables, entries are
+    // validated and parsed in parallel afterwards.
+    std::vector<std::pair<const char*, size_t>> locations;
+    uint32_t numInvalidEntries = 0;
+
+    const char* base = reinterpret_cast<const char*>(file.data());
+    size_t offset = sizeof(DxvkStateCacheHeader);
+
+    while (offset < file.size()) {
+      DxvkStateCacheBlockHeader block;
+
+      if (file.size() - offset < sizeof(block)) {
+        numInvalidEntries += 1;
+        break;
+      }
+
+      std::memcpy(&block, base + offset, sizeof(block));
+
+      size_t indexOffset = offset + sizeof(block);
+      size_t dataOffset = indexOffset + sizeof(uint32_t) * size_t(block.entryCount);
+
+      // Most likely the application was terminated while writing
+      if (dataOffset > file.size() || block.dataSize > file.size() - dataOffset) {
+        numInvalidEntries += 1;
+        break;
+      }
+
+      for (uint32_t i = 0; i < block.entryCount; i++) {
+        uint32_t entryOffset;
+        std::memcpy(&entryOffset, base + indexOffset + sizeof(uint32_t) * i, sizeof(entryOffset));
+
+        if (entryOffset < block.dataSize)
+          locations.push_back({ base + dataOffset + entryOffset, block.dataSize - entryOffset });
+        else
+          numInvalidEntries += 1;
+      }
+
+      offset = dataOffset + block.dataSize;
+      numBlocks += 1;
+    }
+
+    // Validate and parse entries on multiple threads, each
+    // thread processes a contiguous range of entries
+    std::vector<uint8_t> valid(locations.size());
+    m_entries.resize(locations.size());
+
+    uint32_t threadCount = std::max<uint32_t>(1u, std::min<uint32_t>(
+      dxvk::thread::hardware_concurrency(), locations.size() / MinEntriesPerThread));
+
+    auto parseEntries = [&] (uint32_t threadIndex) {
+      size_t first = (locations.size() * (threadIndex + 0)) / threadCount;
+      size_t last  = (locations.size() * (threadIndex + 1)) / threadCount;
+
+      for (size_t i = first; i < last; i++) {
+        valid[i] = readCacheEntry(version,
+          locations[i].first, locations[i].second, m_entries[i]);
+      }
+    };
+
+    std::vector<dxvk::thread> threads;
+
+    for (uint32_t i = 1; i < threadCount; i++)
+      threads.emplace_back([&parseEntries, i] () { parseEntries(i); });
+
+    parseEntries(0);
+
+    for (auto& thread : threads)
+      thread.join();
+
+    // Remove invalid entries while preserving the order
+    size_t entryCount = 0;
+
+    for (size_t i = 0; i < m_entries.size(); i++) {
+      if (valid[i]) {
+        if (entryCount != i)
+          m_entries[entryCount] = std::move(m_entries[i]);
+
+        entryCount += 1;
+      } else {
+        numInvalidEntries += 1;
+      }
+    }
+
+    m_entries.resize(entryCount);
+    return numInvalidEntries;
+  }
+
+
+  void DxvkStateCache::mapCacheEntries() {
+    // Both maps are independent of each other,
+    // so they can be built on separate threads.
+    dxvk::thread thread([this] () {
+      m_entryMap.reserve(m_entries.size());
+
+      for (size_t i = 0; i < m_entries.size(); i++)
+        mapPipelineToEntry(m_entries[i].shaders, i);
+    });
+
+    m_pipelineMap.reserve(m_entries.size());
+
+    for (const auto& entry : m_entries) {
+      mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
+      mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
+      mapShaderToPipeline(entry.shaders.tes, entry.shaders);
+      mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
+      mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
+    }
+
+    thread.join();
+  }
+
+
   bool DxvkStateCache::readCacheHeader(
           std::istream&             stream,
           DxvkStateCacheHeader&     header) const {
@@ -598,99 +859,39 @@ namespace dxvk {
      || !data.readFromStream(stream, header.entrySize))
       return false;
 
-    // Validate hash, skip entry if invalid
-    if (hash != data.computeHash())
-      return false;
-
-    // Set up entry metadata
-    entry.type = DxvkStateCacheEntryType(header.entryType);
-
-    // Read shader hashes
-    auto entryType = DxvkStateCacheEntryType(header.entryType);
-    data.read(entry.shaders, version, stageMask);
-
-    if (entryType == DxvkStateCacheEntryType::PipelineLibrary)
-      return true;
-
-    DxvkBindingMaskV10 dummyBindingMask = { };
-
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
-      if (!data.read(dummyBindingMask, version))
-        return false;
-    } else {
-      // Read packed render pass format
-      if (version < 12) {
-        DxvkRenderPassFormatV11 v11;
-        data.read(v11, version);
-        entry.gpState.rt = v11.convert();
-      }
-
-      // Read common pipeline state
-      if (!data.read(dummyBindingMask, version)
-       || !data.read(entry.gpState.ia, version)
-       || !data.read(entry.gpState.il, version)
-       || !data.read(entry.gpState.rs, version)
-       || !data.read(entry.gpState.ms, version)
-       || !data.read(entry.gpState.ds, version)
-       || !data.read(entry.gpState.om, version)
-       || !data.read(entry.gpState.rt, version)
-       || !data.read(entry.gpState.dsFront, version)
-       || !data.read(entry.gpState.dsBack, version))
-        return false;
-
-      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
-       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
-        return false;
-
-      // Read render target swizzles
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omSwizzle[i], version))
-          return false;
-      }
-
-      // Read render target blend info
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omBlend[i], version))
-          return false;
-      }
+    return parseCacheEntry(version, header, stageMask, hash, data, entry);
+  }
 
-      // Read defined vertex attributes
-      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
-        if (!data.read(entry.gpState.ilAttributes[i], version))
-          return false;
-      }
 
-      // Read defined vertex bindings
-      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
-        if (!data.read(entry.gpState.ilBindings[i], version))
-          return false;
-      }
-    }
-
-    // Read non-zero spec constants
-    uint32_t specConstantMask = 0;
+  bool DxvkStateCache::readCacheEntry(
+          uint32_t                  version,
+    const char*                     data,
+          size_t                    size,
+          DxvkStateCacheEntry&      entry) const {
+    DxvkStateCacheEntryHeader header;
+    DxvkStateCacheEntryData entryData;
+    Sha1Hash hash;
 
-    if (!data.read(specConstantMask, version))
+    if (size < sizeof(header) + sizeof(hash))
       return false;
 
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
-      if (specConstantMask & (1 << i)) {
-        if (!data.read(entry.gpState.sc.specConstants[i], version))
-          return false;
-      }
-    }
+    std::memcpy(&header, data, sizeof(header));
+    std::memcpy(&hash, data + sizeof(header), sizeof(hash));
 
-    // Compute shaders are no longer supported
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+    size_t dataOffset = sizeof(header) + sizeof(hash);
+
+    if (header.entrySize > size - dataOffset
+     || !entryData.readFromMemory(data + dataOffset, header.entrySize))
       return false;
 
-    return true;
+    return parseCacheEntry(version, header,
+      VkShaderStageFlags(header.stageMask), hash, entryData, entry);
   }
 
 
   void DxvkStateCache::writeCacheEntry(
-          std::ostream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
+          std::vector<char>&        block,
+    const DxvkStateCacheEntry&      entry) const {
     DxvkStateCacheEntryData data;
     VkShaderStageFlags stageMask = 0;
 
@@ -758,8 +959,34 @@ namespace dxvk {
 
     Sha1Hash hash = data.computeHash();
 
-    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
-    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
+    auto headerData = reinterpret_cast<const char*>(&header);
+    auto hashData = reinterpret_cast<const char*>(&hash);
+
+    block.insert(block.end(), headerData, headerData + sizeof(header));
+    block.insert(block.end(), hashData, hashData + sizeof(hash));
+    block.insert(block.end(), data.data(), data.data() + data.size());
+  }
+
+
+  void DxvkStateCache::writeCacheBlock(
+          std::ostream&             stream,
+    const DxvkStateCacheEntry*      entries,
+          size_t                    entryCount) const {
+    // General layout: block header -> entry offsets -> entries
+    std::vector<uint32_t> offsets(entryCount);
+    std::vector<char> data;
+
+    for (size_t i = 0; i < entryCount; i++) {
+      offsets[i] = uint32_t(data.size());
+      writeCacheEntry(data, entries[i]);
+    }
+
+    DxvkStateCacheBlockHeader header;
+    header.entryCount = uint32_t(entryCount);
+    header.dataSize   = uint32_t(data.size());
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(offsets.data()), sizeof(uint32_t) * offsets.size());
     stream.write(data.data(), data.size());
     stream.flush();
   }
@@ -796,28 +1023,57 @@ namespace dxvk {
     env::setThreadName("dxvk-writer");
 
     std::ofstream file;
+    std::vector<DxvkStateCacheEntry> entries;
 
-    while (!m_stopThreads.load()) {
-      DxvkStateCacheEntry entry;
+    high_resolution_clock::time_point deadline;
+    bool stopped = false;
 
+    while (!stopped) {
       { std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
-        m_writerCond.wait(lock, [this] () {
+        auto ready = [this] () {
           return m_writerQueue.size()
               || m_stopThreads.load();
-        });
+        };
 
-        if (m_writerQueue.size() == 0)
-          break;
+        if (entries.empty()) {
+          m_writerCond.wait(lock, ready);
+        } else {
+          auto now = high_resolution_clock::now();
 
-        entry = m_writerQueue.front();
-        m_writerQueue.pop();
+          if (now < deadline)
+            m_writerCond.wait_for(lock, deadline - now, ready);
+        }
+
+        if (entries.empty() && !m_writerQueue.empty())
+          deadline = high_resolution_clock::now() + std::chrono::milliseconds(MaxBlockDelayMs);
+
+        while (!m_writerQueue.empty()) {
+          entries.push_back(m_writerQueue.front());
+          m_writerQueue.pop();
+        }
+
+        stopped = m_stopThreads.load();
       }
 
+      // New entries tend to trickle in a few at a time while the
+      // game is running, so collect them into larger blocks rather
+      // than appending a tiny block on every wakeup. Don't hold any
+      // entry back for too long in case the process gets killed,
+      // and write everything that is left when shutting down.
+      if (entries.empty() || (entries.size() < MaxBlockEntries
+       && !stopped && high_resolution_clock::now() < deadline))
+        continue;
+
       if (!file.is_open())
         file = openCacheFileForWrite(false);
 
-      writeCacheEntry(file, entry);
+      for (size_t i = 0; i < entries.size(); i += MaxBlockEntries) {
+        writeCacheBlock(file, &entries[i],
+          std::min<size_t>(entries.size() - i, MaxBlockEntries));
+      }
+
+      entries.clear();
     }
   }
 
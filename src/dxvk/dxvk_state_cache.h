@@ -78,6 +78,11 @@ namespace dxvk {
 
     using WriterItem = DxvkStateCacheEntry;
 
+    constexpr static uint32_t MaxBlockEntries     = 1024;
+    constexpr static uint32_t MaxBlockCount       = 256;
+    constexpr static uint32_t MaxBlockDelayMs     = 2000;
+    constexpr static uint32_t MinEntriesPerThread = 1024;
+
     struct WorkerItem {
       DxvkGraphicsPipelineShaders gp;
     };
@@ -134,6 +139,12 @@ namespace dxvk {
 
     bool readCacheFile();
 
+    uint32_t readCacheBlocks(
+            uint32_t                  version,
+            uint32_t&                 numBlocks);
+
+    void mapCacheEntries();
+
     bool readCacheHeader(
             std::istream&             stream,
             DxvkStateCacheHeader&     header) const;
@@ -142,10 +153,21 @@ namespace dxvk {
             uint32_t                  version,
             std::istream&             stream, 
             DxvkStateCacheEntry&      entry) const;
+
+    bool readCacheEntry(
+            uint32_t                  version,
+      const char*                     data,
+            size_t                    size,
+            DxvkStateCacheEntry&      entry) const;
     
     void writeCacheEntry(
-            std::ostream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
+            std::vector<char>&        block,
+      const DxvkStateCacheEntry&      entry) const;
+
+    void writeCacheBlock(
+            std::ostream&             stream,
+      const DxvkStateCacheEntry*      entries,
+            size_t                    entryCount) const;
     
     void workerFunc();
 
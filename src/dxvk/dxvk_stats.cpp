@@ -1,5 +1,7 @@
 #include "dxvk_stats.h"
 
+#include <iterator>
+
 namespace dxvk {
   
   DxvkStatCounters::DxvkStatCounters() {
@@ -30,5 +32,45 @@ namespace dxvk {
     for (size_t i = 0; i < m_counters.size(); i++)
       m_counters[i] = 0;
   }
+
+
+  const char* DxvkStatCounters::getName(DxvkStatCounter ctr) {
+    static const char* s_names[] = {
+      "CmdDrawCalls",
+      "CmdDrawsMerged",
+      "CmdDispatchCalls",
+      "CmdRenderPassCount",
+      "CmdBarrierCount",
+      "PipeCountGraphics",
+      "PipeCountLibrary",
+      "PipeCountCompute",
+      "PipeTasksDone",
+      "PipeTasksTotal",
+      "QueueSubmitCount",
+      "QueuePresentCount",
+      "GpuSyncCount",
+      "GpuSyncTicks",
+      "GpuIdleTicks",
+      "CsSyncCount",
+      "CsSyncTicks",
+      "CsIdleTicks",
+      "CsChunkCount",
+      "CsChunkBytesUsed",
+      "CsChunkBytesTotal",
+      "CsChunkPoolBytes",
+      "DescriptorPoolCount",
+      "DescriptorSetCount",
+      "ShaderCacheHits",
+      "ShaderCacheMisses",
+      "ShaderCacheBytesSaved",
+      "ShaderDedupCount",
+      "ShaderDedupTicks",
+      "ShaderAsyncStallCount",
+      "ShaderAsyncStallTicks",
+    };
+
+    static_assert(std::size(s_names) == uint32_t(DxvkStatCounter::NumCounters));
+    return uint32_t(ctr) < std::size(s_names) ? s_names[uint32_t(ctr)] : "";
+  }
   
 }
@@ -30,8 +30,18 @@ namespace dxvk {
     CsSyncTicks,              ///< Time spent waiting on CS
     CsIdleTicks,              ///< CS thread idle time in microseconds
     CsChunkCount,             ///< Submitted CS chunks
+    CsChunkBytesUsed,         ///< Bytes used in executed CS chunks
+    CsChunkBytesTotal,        ///< Capacity of executed CS chunks
+    CsChunkPoolBytes,         ///< Memory allocated for CS chunks
     DescriptorPoolCount,      ///< Descriptor pool count
     DescriptorSetCount,       ///< Descriptor sets allocated
+    ShaderCacheHits,          ///< Shaders loaded from the shader cache
+    ShaderCacheMisses,        ///< Shaders not found in the shader cache
+    ShaderCacheBytesSaved,    ///< SPIR-V bytes loaded instead of translated
+    ShaderDedupCount,         ///< Shader translations avoided by waiting on another thread
+    ShaderDedupTicks,         ///< Time spent waiting for other threads' translations
+    ShaderAsyncStallCount,    ///< Asynchronously translated shaders that were not ready when needed
+    ShaderAsyncStallTicks,    ///< Time spent blocked on asynchronous shader translation
 
     NumCounters               ///< Number of counters available
   };
@@ -112,6 +122,14 @@ namespace dxvk {
      * Sets all counters to zero.
      */
     void reset();
+
+    /**
+     * \brief Queries counter name
+     *
+     * \param [in] ctr The counter
+     * \returns Counter name, suitable for logging
+     */
+    static const char* getName(DxvkStatCounter ctr);
     
   private:
     
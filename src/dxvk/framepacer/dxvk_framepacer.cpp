@@ -1,6 +1,7 @@
 #include "dxvk_framepacer.h"
 #include "dxvk_framepacer_mode_low_latency.h"
 #include "dxvk_framepacer_mode_min_latency.h"
+#include "dxvk_framepacer_mode_smooth_latency.h"
 #include "dxvk_options.h"
 #include "../../util/util_flush.h"
 #include "../../util/util_env.h"
@@ -9,7 +10,8 @@
 namespace dxvk {
 
 
-  FramePacer::FramePacer( const DxvkOptions& options, uint64_t firstFrameId ) {
+  FramePacer::FramePacer( const DxvkOptions& options, uint64_t firstFrameId, FramePacerClock* clock )
+  : m_clock( clock ) {
     // we'll default to LOW_LATENCY in the draft-PR for now, for demonstration purposes,
     // highlighting the generally much better input lag and medium-term time consistency.
     // although MAX_FRAME_LATENCY has advantages in many games and is likely the better default,
@@ -25,42 +27,60 @@ namespace dxvk {
       mode = FramePacerMode::LOW_LATENCY;
     } else if (configStr.find("min-latency") != std::string::npos) {
       mode = FramePacerMode::MIN_LATENCY;
+    } else if (configStr.find("smooth-latency") != std::string::npos) {
+      mode = FramePacerMode::SMOOTH_LATENCY;
     } else if (options.framePace.find("max-frame-latency") != std::string::npos) {
       mode = FramePacerMode::MAX_FRAME_LATENCY;
     } else if (options.framePace.find("low-latency") != std::string::npos) {
       mode = FramePacerMode::LOW_LATENCY;
     } else if (options.framePace.find("min-latency") != std::string::npos) {
       mode = FramePacerMode::MIN_LATENCY;
+    } else if (options.framePace.find("smooth-latency") != std::string::npos) {
+      mode = FramePacerMode::SMOOTH_LATENCY;
     }
 
     switch (mode) {
       case FramePacerMode::MAX_FRAME_LATENCY:
         Logger::info( "Frame pace: max-frame-latency" );
-        m_mode = std::make_unique<FramePacerMode>(FramePacerMode::MAX_FRAME_LATENCY, &m_latencyMarkersStorage);
+        m_mode = std::make_unique<FramePacerMode>(FramePacerMode::MAX_FRAME_LATENCY, &m_latencyMarkersStorage, m_clock);
         break;
 
       case FramePacerMode::LOW_LATENCY:
         Logger::info( "Frame pace: low-latency" );
         GpuFlushTracker::m_minPendingSubmissions = 1;
         GpuFlushTracker::m_minChunkCount = 1;
-        m_mode = std::make_unique<LowLatencyMode>(mode, &m_latencyMarkersStorage, options);
+        m_mode = std::make_unique<LowLatencyMode>(mode, &m_latencyMarkersStorage, m_clock, options);
         break;
 
       case FramePacerMode::MIN_LATENCY:
         Logger::info( "Frame pace: min-latency" );
         GpuFlushTracker::m_minPendingSubmissions = 1;
         GpuFlushTracker::m_minChunkCount = 1;
-        m_mode = std::make_unique<MinLatencyMode>(mode, &m_latencyMarkersStorage);
+        m_mode = std::make_unique<MinLatencyMode>(mode, &m_latencyMarkersStorage, m_clock);
+        break;
+
+      case FramePacerMode::SMOOTH_LATENCY:
+        Logger::info( "Frame pace: smooth-latency" );
+        GpuFlushTracker::m_minPendingSubmissions = 1;
+        GpuFlushTracker::m_minChunkCount = 1;
+        m_mode = std::make_unique<SmoothLatencyMode>(mode, &m_latencyMarkersStorage, m_clock, options);
         break;
     }
 
+    m_trace = FramePacerTraceWriter::createFromEnv(m_clock->now());
+
     for (auto& gpuStart: m_gpuStarts) {
       gpuStart.store(0);
     }
 
     // be consistent that every frame has a gpuReady event from finishing the previous frame
+    auto now = m_clock->now();
+
     LatencyMarkers* m = m_latencyMarkersStorage.getMarkers( firstFrameId );
-    m->gpuReady.push_back( high_resolution_clock::now() );
+    m->gpuSubmit.clear( now );
+    m->gpuQueueSubmit.clear( now );
+    m->gpuReady.clear( now );
+    m->gpuReady.push_back( now );
     m_gpuStarts[ firstFrameId % m_gpuStarts.size() ] = gpuReadyBit;
 
     LatencyMarkersTimeline& timeline = m_latencyMarkersStorage.m_timeline;
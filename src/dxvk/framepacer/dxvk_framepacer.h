@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dxvk_framepacer_mode.h"
+#include "dxvk_framepacer_trace.h"
 #include "dxvk_latency_markers.h"
 #include "../dxvk_latency.h"
 #include "../../util/util_time.h"
@@ -23,7 +24,8 @@ namespace dxvk {
     using microseconds = std::chrono::microseconds;
   public:
 
-    FramePacer( const DxvkOptions& options, uint64_t firstFrameId );
+    FramePacer( const DxvkOptions& options, uint64_t firstFrameId,
+      FramePacerClock* clock = FramePacerSystemClock::get() );
     ~FramePacer();
 
     void sleepAndBeginFrame(
@@ -33,24 +35,27 @@ namespace dxvk {
       m_mode->waitRenderFinished(frameId);
       // potentially wait some more if the cpu gets too much ahead
       m_mode->startFrame(frameId);
-      m_latencyMarkersStorage.registerFrameStart(frameId);
+      m_latencyMarkersStorage.registerFrameStart(frameId, m_clock->now());
     }
 
     void notifyGpuPresentEnd( uint64_t frameId ) override {
       // the frame has been displayed to the screen
-      m_latencyMarkersStorage.registerFrameEnd(frameId);
+      m_latencyMarkersStorage.registerFrameEnd(frameId, m_clock->now());
       m_mode->endFrame(frameId);
+
+      if (unlikely(m_trace))
+        m_trace->record(frameId, *m_latencyMarkersStorage.getConstMarkers(frameId));
       m_gpuStarts[ (frameId-1) % m_gpuStarts.size() ].store(0);
     }
 
     void notifyCsRenderBegin( uint64_t frameId ) override {
-      auto now = high_resolution_clock::now();
+      auto now = m_clock->now();
       LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
       m->csStart = std::chrono::duration_cast<microseconds>(now - m->start).count();
     }
 
     void notifyCsRenderEnd( uint64_t frameId ) override {
-      auto now = high_resolution_clock::now();
+      auto now = m_clock->now();
       LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
       m->csFinished = std::chrono::duration_cast<microseconds>(now - m->start).count();
       m_mode->signalCsFinished( frameId );
@@ -58,25 +63,25 @@ namespace dxvk {
 
     void notifySubmit( uint64_t frameId ) override {
       LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
-      m->gpuSubmit.push_back(high_resolution_clock::now());
+      m->gpuSubmit.push_back(m_clock->now());
     }
 
     void notifyPresent( uint64_t frameId ) override {
       // dx to vk translation is finished
       if (frameId != 0) {
-        auto now = high_resolution_clock::now();
+        auto now = m_clock->now();
         LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
         LatencyMarkers* next = m_latencyMarkersStorage.getMarkers(frameId+1);
         m->gpuSubmit.push_back(now);
         m->cpuFinished = std::chrono::duration_cast<microseconds>(now - m->start).count();
-        next->gpuSubmit.clear();
+        next->gpuSubmit.clear(now);
 
         m_latencyMarkersStorage.m_timeline.cpuFinished.store(frameId);
       }
     }
 
     void notifyQueueSubmit( uint64_t frameId ) override {
-      auto now = high_resolution_clock::now();
+      auto now = m_clock->now();
       LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
       m->gpuQueueSubmit.push_back(now);
       queueSubmitCheckGpuStart(frameId, m, now);
@@ -84,17 +89,17 @@ namespace dxvk {
 
     void notifyQueuePresentBegin( uint64_t frameId ) override {
       if (frameId != 0) {
-        auto now = high_resolution_clock::now();
+        auto now = m_clock->now();
         LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
         LatencyMarkers* next = m_latencyMarkersStorage.getMarkers(frameId+1);
         m->gpuQueueSubmit.push_back(now);
-        next->gpuQueueSubmit.clear();
+        next->gpuQueueSubmit.clear(now);
         queueSubmitCheckGpuStart(frameId, m, now);
       }
     }
 
     void notifyGpuExecutionEnd( uint64_t frameId ) override {
-      auto now = high_resolution_clock::now();
+      auto now = m_clock->now();
       LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
       m->gpuReady.push_back(now);
     }
@@ -102,13 +107,13 @@ namespace dxvk {
     virtual void notifyGpuPresentBegin( uint64_t frameId ) override {
       // we get frameId == 0 for repeated presents (SyncInterval)
       if (frameId != 0) {
-        auto now = high_resolution_clock::now();
+        auto now = m_clock->now();
 
         LatencyMarkers* m = m_latencyMarkersStorage.getMarkers(frameId);
         LatencyMarkers* next = m_latencyMarkersStorage.getMarkers(frameId+1);
         m->gpuReady.push_back(now);
         m->gpuFinished = std::chrono::duration_cast<microseconds>(now - m->start).count();
-        next->gpuReady.clear();
+        next->gpuReady.clear(now);
         next->gpuReady.push_back(now);
 
         gpuExecutionCheckGpuStart(frameId+1, next, now);
@@ -167,7 +172,9 @@ namespace dxvk {
         signalGpuStart( frameId, m, t );
     }
 
+    FramePacerClock* m_clock;
     std::unique_ptr<FramePacerMode> m_mode;
+    std::unique_ptr<FramePacerTraceWriter> m_trace;
 
     std::array< std::atomic< uint16_t >, 8 > m_gpuStarts = { };
     static constexpr uint16_t queueSubmitBit = 1;
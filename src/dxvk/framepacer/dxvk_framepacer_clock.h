@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../../util/sync/sync_signal.h"
+
+#include "../../util/util_sleep.h"
+#include "../../util/util_time.h"
+
+namespace dxvk {
+
+  /*
+   * \brief Time source for the frame pacer
+   *
+   * All time queries, sleeps and fence waits of the frame pacer and
+   * its modes go through this interface, so that pacing decisions can
+   * be replayed against a virtual timeline instead of the system clock.
+   */
+  class FramePacerClock {
+
+  public:
+
+    using time_point = high_resolution_clock::time_point;
+
+    virtual ~FramePacerClock() { }
+
+    /*
+     * \brief Queries current time
+     */
+    virtual time_point now() = 0;
+
+    /*
+     * \brief Sleeps until the given time point
+     *
+     * \param [in] t0 Current time
+     * \param [in] t1 Target time
+     * \returns Time after the sleep has finished
+     */
+    virtual time_point sleepUntil( time_point t0, time_point t1 ) = 0;
+
+    /*
+     * \brief Waits for a fence to reach the given value
+     *
+     * A virtual clock must not block here, but advance its
+     * timeline until whatever signals the fence has run.
+     * \param [in] fence The fence to wait for
+     * \param [in] value Value to wait for
+     */
+    virtual void waitFence( sync::Fence& fence, uint64_t value ) = 0;
+
+  };
+
+
+  /*
+   * \brief System clock for the frame pacer
+   *
+   * Default time source, uses the high-resolution
+   * clock and the global sleep implementation.
+   */
+  class FramePacerSystemClock : public FramePacerClock {
+
+  public:
+
+    time_point now() override {
+      return high_resolution_clock::now();
+    }
+
+    time_point sleepUntil( time_point t0, time_point t1 ) override {
+      return Sleep::sleepUntil(t0, t1);
+    }
+
+    void waitFence( sync::Fence& fence, uint64_t value ) override {
+      fence.wait(value);
+    }
+
+    static FramePacerClock* get() {
+      static FramePacerSystemClock s_clock;
+      return &s_clock;
+    }
+
+  };
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dxvk_framepacer_clock.h"
 #include "dxvk_latency_markers.h"
 #include "../../util/sync/sync_signal.h"
 #include "../../util/util_env.h"
@@ -18,13 +19,15 @@ namespace dxvk {
     enum Mode {
       MAX_FRAME_LATENCY = 0,
       LOW_LATENCY,
-      MIN_LATENCY
+      MIN_LATENCY,
+      SMOOTH_LATENCY
     };
 
-    FramePacerMode( Mode mode, LatencyMarkersStorage* markerStorage, uint32_t maxFrameLatency=1 )
+    FramePacerMode( Mode mode, LatencyMarkersStorage* markerStorage, FramePacerClock* clock, uint32_t maxFrameLatency=1 )
     : m_mode( mode ),
       m_waitLatency( maxFrameLatency+1 ),
-      m_latencyMarkersStorage( markerStorage ) {
+      m_latencyMarkersStorage( markerStorage ),
+      m_clock( clock ) {
       setFpsLimitFrametimeFromEnv();
     }
 
@@ -36,7 +39,7 @@ namespace dxvk {
     virtual void finishRender( uint64_t frameId ) { }
 
     void waitRenderFinished( uint64_t frameId ) {
-      if (m_mode) m_fenceGpuFinished.wait(frameId-m_waitLatency); }
+      if (m_mode) m_clock->waitFence(m_fenceGpuFinished, frameId-m_waitLatency); }
 
     void signalRenderFinished( uint64_t frameId ) {
       if (m_mode) m_fenceGpuFinished.signal(frameId); }
@@ -63,6 +66,7 @@ namespace dxvk {
 
     const uint32_t m_waitLatency;
     LatencyMarkersStorage* m_latencyMarkersStorage;
+    FramePacerClock* m_clock;
     std::atomic<int32_t> m_fpsLimitFrametime = { 0 };
     bool m_fpsLimitEnvOverride = { false };
 
@@ -42,8 +42,8 @@ namespace dxvk {
     using time_point = high_resolution_clock::time_point;
   public:
 
-    LowLatencyMode(Mode mode, LatencyMarkersStorage* storage, const DxvkOptions& options)
-    : FramePacerMode(mode, storage),
+    LowLatencyMode(Mode mode, LatencyMarkersStorage* storage, FramePacerClock* clock, const DxvkOptions& options)
+    : FramePacerMode(mode, storage, clock),
       m_lowLatencyOffset(getLowLatencyOffset(options)),
       m_allowCpuFramesOverlap(getLowLatencyAllowCpuFramesOverlap(options)) {
       Logger::info( str::format("Using lowLatencyOffset: ", m_lowLatencyOffset) );
@@ -57,11 +57,11 @@ namespace dxvk {
       using std::chrono::duration_cast;
 
       if (!m_allowCpuFramesOverlap)
-        m_fenceCsFinished.wait( frameId-1 );
+        m_clock->waitFence( m_fenceCsFinished, frameId-1 );
 
-      m_fenceGpuStart.wait( frameId-1 );
+      m_clock->waitFence( m_fenceGpuStart, frameId-1 );
 
-      time_point now = high_resolution_clock::now();
+      time_point now = m_clock->now();
       uint64_t finishedId = m_latencyMarkersStorage->getTimeline()->gpuFinished.load();
       if (finishedId <= DXGI_MAX_SWAP_CHAIN_BUFFERS+1ull)
         return;
@@ -107,8 +107,11 @@ namespace dxvk {
       using std::chrono::duration_cast;
       const LatencyMarkers* m = m_latencyMarkersStorage->getConstMarkers(frameId);
 
+      // frames with missing submit events can't be analyzed
       int32_t numLoop = (int32_t)(m->gpuReady.size())-1;
-      if (numLoop <= 1) {
+      if (numLoop <= 1
+       || (int32_t)(m->gpuSubmit.size()) < numLoop
+       || (int32_t)(m->gpuQueueSubmit.size()) < numLoop) {
         m_props[frameId % m_props.size()] = SyncProps();
         m_props[frameId % m_props.size()].isOutlier = true;
         m_propsFinished.store( frameId );
@@ -119,16 +122,15 @@ namespace dxvk {
       // such that the gpu doesn't go into idle for this frame, and then aligning cpu submits
       // where gpuSubmit[i] <= gpuRun[i] for all i
 
-      std::vector<int32_t>& gpuRun = m_tempGpuRun;
-      gpuRun.clear();
+      std::array<int32_t, LatencyMarkers::MaxEvents>& gpuRun = m_tempGpuRun;
       int32_t optimizedGpuTime = 0;
-      gpuRun.push_back(optimizedGpuTime);
+      gpuRun[0] = optimizedGpuTime;
 
       for (int i=0; i<numLoop; ++i) {
         time_point _gpuRun = std::max( m->gpuReady[i], m->gpuQueueSubmit[i] );
         int32_t duration = duration_cast<microseconds>( m->gpuReady[i+1] - _gpuRun ).count();
         optimizedGpuTime += duration;
-        gpuRun.push_back(optimizedGpuTime);
+        gpuRun[i+1] = optimizedGpuTime;
       }
 
       int32_t alignment = duration_cast<microseconds>( m->gpuSubmit[numLoop-1] - m->gpuSubmit[0] ).count()
@@ -168,13 +170,13 @@ namespace dxvk {
       delay = std::max( 0, std::min( delay, maxDelay ) );
 
       Sleep::TimePoint nextStart = t + microseconds(delay);
-      Sleep::sleepUntil( t, nextStart );
+      m_clock->sleepUntil( t, nextStart );
       return nextStart;
 
     }
 
 
-  private:
+  protected:
 
     struct SyncProps {
       int32_t optimizedGpuTime;   // gpu executing packed submits in one go
@@ -187,7 +189,7 @@ namespace dxvk {
     };
 
 
-    SyncProps getSyncPrediction() {
+    virtual SyncProps getSyncPrediction() {
       // In the future we might use more samples to get a prediction.
       // Possibly this will be optional, as until now, basing it on
       // just the previous frame gave us the best mouse input feel.
@@ -210,8 +212,13 @@ namespace dxvk {
       }
 
       return m_props[ id % m_props.size() ];
-    };
+    }
+
+
+    std::array<SyncProps, 16> m_props;
+    std::atomic<uint64_t> m_propsFinished = { 0 };
 
+  private:
 
     bool isOutlier( uint64_t frameId ) {
       constexpr size_t numLoop = 7;
@@ -226,6 +233,10 @@ namespace dxvk {
       if (m->cpuFinished > 1.3*avgCpuTime || m->gpuSubmit.empty() || m->gpuReady.size() != (m->gpuSubmit.size()+1) )
         return true;
 
+      // the timestamp logs dropped events, so the frame can't be analyzed reliably
+      if (m->gpuReady.overflowed() || m->gpuSubmit.overflowed() || m->gpuQueueSubmit.overflowed())
+        return true;
+
       return false;
     }
 
@@ -236,11 +247,9 @@ namespace dxvk {
     const int32_t m_lowLatencyOffset;
     const bool    m_allowCpuFramesOverlap;
 
-    Sleep::TimePoint m_lastStart = { high_resolution_clock::now() };
-    std::array<SyncProps, 16> m_props;
-    std::atomic<uint64_t> m_propsFinished = { 0 };
+    Sleep::TimePoint m_lastStart = { m_clock->now() };
 
-    std::vector<int32_t>  m_tempGpuRun;
+    std::array<int32_t, LatencyMarkers::MaxEvents> m_tempGpuRun;
 
   };
 
@@ -16,14 +16,14 @@ namespace dxvk {
 
   public:
 
-    MinLatencyMode(Mode mode, LatencyMarkersStorage* storage)
-    : FramePacerMode(mode, storage, 0) {}
+    MinLatencyMode(Mode mode, LatencyMarkersStorage* storage, FramePacerClock* clock)
+    : FramePacerMode(mode, storage, clock, 0) {}
 
     ~MinLatencyMode() {}
 
     void startFrame( uint64_t frameId ) override {
 
-      Sleep::TimePoint now = high_resolution_clock::now();
+      Sleep::TimePoint now = m_clock->now();
       int32_t frametime = std::chrono::duration_cast<std::chrono::microseconds>(
         now - m_lastStart ).count();
       int32_t frametimeDiff = std::max( 0, m_fpsLimitFrametime.load() - frametime );
@@ -32,14 +32,14 @@ namespace dxvk {
       delay = std::min( delay, maxDelay );
 
       Sleep::TimePoint nextStart = now + std::chrono::microseconds(delay);
-      Sleep::sleepUntil( now, nextStart );
+      m_clock->sleepUntil( now, nextStart );
       m_lastStart = nextStart;
 
     }
 
   private:
 
-    Sleep::TimePoint m_lastStart = { high_resolution_clock::now() };
+    Sleep::TimePoint m_lastStart = { m_clock->now() };
 
   };
 
@@ -0,0 +1,18 @@
+#include "dxvk_framepacer_mode_smooth_latency.h"
+
+namespace dxvk {
+
+
+  int32_t SmoothLatencyMode::getSmoothLatencyBudget( const DxvkOptions& options ) {
+    int32_t budget = options.smoothLatencyBudget;
+    int32_t o;
+    if (FramePacerMode::getIntFromEnv("DXVK_SMOOTH_LATENCY_BUDGET", &o))
+      budget = o;
+
+    budget = std::max( 0, budget );
+    budget = std::min( 10000, budget );
+    return budget;
+  }
+
+
+}
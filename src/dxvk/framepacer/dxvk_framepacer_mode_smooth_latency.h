@@ -0,0 +1,99 @@
+#pragma once
+
+#include "dxvk_framepacer_mode_low_latency.h"
+
+namespace dxvk {
+
+  /*
+   * Smooth-latency mode, a variant of the low-latency mode which predicts
+   * the next frame's CPU and GPU timings from the recent history instead
+   * of from the previous frame only.
+   *
+   * Basing the frame start on the single previous frame makes the low-latency
+   * mode carry every frame-to-frame fluctuation into the next frame's start,
+   * which shows up as an alternating pattern that is especially noticeable on
+   * VRR displays. Here, every timing is predicted by its median over the last
+   * non-outlier frames, which ignores individual spikes and keeps the frame
+   * start steady.
+   *
+   * In addition, the frame is started earlier by the spread of recent GPU
+   * times, so that a slower than predicted frame does not leave the GPU idle.
+   * This trades latency for lower frame time variance, the amount of latency
+   * is bounded by dxvk.smoothLatencyBudget.
+   */
+
+  class SmoothLatencyMode : public LowLatencyMode {
+
+  public:
+
+    SmoothLatencyMode(Mode mode, LatencyMarkersStorage* storage, FramePacerClock* clock, const DxvkOptions& options)
+    : LowLatencyMode(mode, storage, clock, options),
+      m_latencyBudget(getSmoothLatencyBudget(options)) {
+      Logger::info( str::format("Using smoothLatencyBudget: ", m_latencyBudget) );
+    }
+
+    ~SmoothLatencyMode() {}
+
+  protected:
+
+    SyncProps getSyncPrediction() override {
+      // skip the oldest entry, it may be overwritten by finishRender() concurrently
+      constexpr size_t maxSamples = std::tuple_size<decltype(m_props)>::value - 1;
+      constexpr size_t minSamples = 4;
+
+      uint64_t id = m_propsFinished;
+      if (id < DXGI_MAX_SWAP_CHAIN_BUFFERS+maxSamples)
+        return LowLatencyMode::getSyncPrediction();
+
+      std::array<SyncProps, maxSamples> samples;
+      size_t numSamples = 0;
+
+      for (size_t i=0; i<maxSamples; ++i) {
+        const SyncProps& props = m_props[ (id-i) % m_props.size() ];
+        if (!props.isOutlier)
+          samples[numSamples++] = props;
+      }
+
+      if (numSamples < minSamples)
+        return LowLatencyMode::getSyncPrediction();
+
+      SyncProps res = {};
+      res.optimizedGpuTime = percentile( samples, numSamples, &SyncProps::optimizedGpuTime, 50 );
+      res.gpuSync          = percentile( samples, numSamples, &SyncProps::gpuSync, 50 );
+      res.cpuUntilGpuSync  = percentile( samples, numSamples, &SyncProps::cpuUntilGpuSync, 50 );
+      res.cpuUntilGpuStart = percentile( samples, numSamples, &SyncProps::cpuUntilGpuStart, 50 );
+      res.csStart          = percentile( samples, numSamples, &SyncProps::csStart, 50 );
+      res.csFinished       = percentile( samples, numSamples, &SyncProps::csFinished, 50 );
+
+      // predicting a shorter gpu time makes the frame start earlier, use the
+      // interquartile range as a measure for how much gpu times fluctuate
+      int32_t gpuTimeSpread
+        = percentile( samples, numSamples, &SyncProps::optimizedGpuTime, 75 )
+        - percentile( samples, numSamples, &SyncProps::optimizedGpuTime, 25 );
+      res.optimizedGpuTime -= std::min( gpuTimeSpread, m_latencyBudget );
+
+      return res;
+    }
+
+  private:
+
+    template<size_t N>
+    static int32_t percentile( const std::array<SyncProps, N>& samples, size_t numSamples,
+            int32_t SyncProps::* field, uint32_t p ) {
+      std::array<int32_t, N> values;
+
+      for (size_t i=0; i<numSamples; ++i)
+        values[i] = samples[i].*field;
+
+      size_t n = ((numSamples-1) * p) / 100;
+      std::nth_element( values.begin(), values.begin()+n, values.begin()+numSamples );
+      return values[n];
+    }
+
+    int32_t getSmoothLatencyBudget( const DxvkOptions& options );
+
+    const int32_t m_latencyBudget;
+
+  };
+
+}
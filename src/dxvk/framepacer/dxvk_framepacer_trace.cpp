@@ -0,0 +1,138 @@
+#include "dxvk_framepacer_trace.h"
+#include "../../util/util_env.h"
+#include "../../util/log/log.h"
+
+namespace dxvk {
+
+
+  FramePacerTraceWriter::FramePacerTraceWriter( const std::string& path, high_resolution_clock::time_point startTime )
+  : m_path( path ),
+    m_startTime( startTime ) {
+    m_thread = dxvk::thread([this] () { runWriter(); });
+  }
+
+
+  FramePacerTraceWriter::~FramePacerTraceWriter() {
+    { std::unique_lock<dxvk::mutex> lock(m_mutex);
+      m_stopped = true;
+      m_cond.notify_one();
+    }
+
+    m_thread.join();
+
+    if (m_dropped.load()) {
+      Logger::warn( str::format("Frame pace trace: dropped ",
+        m_dropped.load(), " frames") );
+    }
+  }
+
+
+  void FramePacerTraceWriter::record( uint64_t frameId, const LatencyMarkers& markers ) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    uint64_t written = m_written.load(std::memory_order_relaxed);
+
+    if (written - m_read.load(std::memory_order_acquire) >= RingSize) {
+      m_dropped.fetch_add(1u, std::memory_order_relaxed);
+      return;
+    }
+
+    FramePacerTraceRecord& r = m_ring[written % RingSize];
+    r.frameId         = frameId;
+    r.start           = duration_cast<microseconds>(markers.start - m_startTime).count();
+    r.csStart         = markers.csStart;
+    r.csFinished      = markers.csFinished;
+    r.cpuFinished     = markers.cpuFinished;
+    r.gpuStart        = markers.gpuStart;
+    r.gpuFinished     = markers.gpuFinished;
+    r.presentFinished = markers.presentFinished;
+    r.gpuSubmitCount  = uint16_t(std::min<uint32_t>(markers.gpuSubmit.size() + markers.gpuSubmit.overflowCount(), UINT16_MAX));
+    r.gpuReadyCount   = uint16_t(std::min<uint32_t>(markers.gpuReady.size() + markers.gpuReady.overflowCount(), UINT16_MAX));
+
+    uint32_t submitCount = std::min<uint32_t>(markers.gpuSubmit.size(), FramePacerTraceRecord::MaxEvents);
+    uint32_t readyCount  = std::min<uint32_t>(markers.gpuReady.size(),  FramePacerTraceRecord::MaxEvents);
+
+    for (uint32_t i = 0; i < submitCount; i++)
+      r.gpuSubmit[i] = duration_cast<microseconds>(markers.gpuSubmit[i] - markers.start).count();
+
+    for (uint32_t i = 0; i < readyCount; i++)
+      r.gpuReady[i] = duration_cast<microseconds>(markers.gpuReady[i] - markers.start).count();
+
+    m_written.store(written + 1u, std::memory_order_release);
+  }
+
+
+  std::unique_ptr<FramePacerTraceWriter> FramePacerTraceWriter::createFromEnv( high_resolution_clock::time_point startTime ) {
+    static std::atomic<uint32_t> s_traceCount = { 0u };
+
+    std::string path = env::getEnvVar("DXVK_FRAME_PACE_TRACE");
+
+    if (path.empty())
+      return nullptr;
+
+    env::createDirectory(path);
+
+    if (*path.rbegin() != '/')
+      path += '/';
+
+    // Each swap chain has its own frame pacer, give them distinct files
+    uint32_t index = s_traceCount++;
+    path += env::getExeBaseName();
+
+    if (index)
+      path += str::format("_", index);
+
+    path += ".dxvk-fptrace";
+
+    Logger::info( str::format("Frame pace trace: ", path) );
+    return std::make_unique<FramePacerTraceWriter>(path, startTime);
+  }
+
+
+  void FramePacerTraceWriter::runWriter() {
+    env::setThreadName("dxvk-fptrace");
+
+    std::ofstream file(str::topath(m_path.c_str()).c_str(),
+      std::ios_base::binary | std::ios_base::trunc);
+
+    if (!file) {
+      Logger::err( str::format("Frame pace trace: failed to open ", m_path) );
+      return;
+    }
+
+    FramePacerTraceHeader header;
+    header.recordSize = sizeof(FramePacerTraceRecord);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    bool stopped = false;
+
+    while (!stopped) {
+      // The present path never signals us so that it cannot block
+      // on the lock, poll the ring at a rate it cannot fill up at
+      { std::unique_lock<dxvk::mutex> lock(m_mutex);
+        m_cond.wait_for(lock, std::chrono::milliseconds(100),
+          [this] { return m_stopped; });
+        stopped = m_stopped;
+      }
+
+      if (drainRing(file))
+        file.flush();
+    }
+  }
+
+
+  size_t FramePacerTraceWriter::drainRing( std::ofstream& file ) {
+    uint64_t read    = m_read.load(std::memory_order_relaxed);
+    uint64_t written = m_written.load(std::memory_order_acquire);
+
+    for (uint64_t i = read; i < written; i++) {
+      file.write(reinterpret_cast<const char*>(&m_ring[i % RingSize]),
+        sizeof(FramePacerTraceRecord));
+    }
+
+    m_read.store(written, std::memory_order_release);
+    return size_t(written - read);
+  }
+
+}
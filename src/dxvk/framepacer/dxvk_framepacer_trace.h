@@ -0,0 +1,101 @@
+#pragma once
+
+#include "dxvk_latency_markers.h"
+#include "../../util/thread.h"
+#include "../../util/util_math.h"
+#include "../../util/util_string.h"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+
+namespace dxvk {
+
+  /*
+   * \brief Frame pacing trace file header
+   *
+   * Trace files consist of this header followed by
+   * tightly packed, fixed-size frame records.
+   */
+  struct FramePacerTraceHeader {
+    char     magic[8]   = { 'D', 'X', 'V', 'K', 'F', 'P', 'T', '\0' };
+    uint32_t version    = 1;
+    uint32_t recordSize = 0;
+  };
+
+
+  /*
+   * \brief Frame pacing trace record
+   *
+   * Compact copy of the latency markers of a single frame. The frame
+   * start is relative to the start of the trace, all other values are
+   * relative to the frame start, in microseconds. Only the first few
+   * submit and ready events are stored, the counts however are exact.
+   */
+  struct FramePacerTraceRecord {
+    static constexpr uint32_t MaxEvents = 16;
+
+    uint64_t frameId;
+    int64_t  start;
+    int32_t  csStart;
+    int32_t  csFinished;
+    int32_t  cpuFinished;
+    int32_t  gpuStart;
+    int32_t  gpuFinished;
+    int32_t  presentFinished;
+    uint16_t gpuSubmitCount;
+    uint16_t gpuReadyCount;
+    int32_t  gpuSubmit [MaxEvents];
+    int32_t  gpuReady  [MaxEvents];
+  };
+
+
+  /*
+   * \brief Frame pacing trace writer
+   *
+   * Streams latency markers of finished frames to a binary trace file.
+   * Records are copied into a preallocated ring on the present path,
+   * which never allocates or blocks; a background thread drains the
+   * ring into the file. If the writer cannot keep up, frames are
+   * dropped rather than stalling presentation.
+   *
+   * Enabled by setting \c DXVK_FRAME_PACE_TRACE to a directory.
+   * Traces can be converted to CSV with dxvk-framepacer-trace.
+   */
+  class FramePacerTraceWriter {
+
+  public:
+
+    FramePacerTraceWriter( const std::string& path, high_resolution_clock::time_point startTime );
+    ~FramePacerTraceWriter();
+
+    void record( uint64_t frameId, const LatencyMarkers& markers );
+
+    static std::unique_ptr<FramePacerTraceWriter> createFromEnv( high_resolution_clock::time_point startTime );
+
+  private:
+
+    static constexpr uint32_t RingSize = 256;
+
+    std::string                                  m_path;
+    high_resolution_clock::time_point            m_startTime;
+
+    std::array<FramePacerTraceRecord, RingSize>  m_ring = { };
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t>                        m_written = { 0u };
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t>                        m_read    = { 0u };
+    std::atomic<uint64_t>                        m_dropped = { 0u };
+
+    dxvk::mutex                                  m_mutex;
+    dxvk::condition_variable                     m_cond;
+    bool                                         m_stopped = false;
+    dxvk::thread                                 m_thread;
+
+    void runWriter();
+
+    size_t drainRing( std::ofstream& file );
+
+  };
+
+}
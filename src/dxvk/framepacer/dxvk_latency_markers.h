@@ -2,9 +2,10 @@
 
 #include <atomic>
 #include <dxgi.h>
-#include <vector>
+#include <algorithm>
 #include <array>
 #include <assert.h>
+#include "../../util/util_likely.h"
 #include "../../util/util_sleep.h"
 #include "../../util/log/log.h"
 #include "../../util/util_string.h"
@@ -16,6 +17,123 @@ namespace dxvk {
   class LatencyMarkersStorage;
 
 
+  /*
+   * \brief Fixed-capacity timestamp log
+   *
+   * Per-frame list of timestamps that can be appended to from
+   * multiple threads without locking or allocating. Timestamps
+   * beyond the capacity are dropped, but still counted, so that
+   * consumers can detect incomplete frames via \c overflowed.
+   *
+   * Each slot is a single 64-bit word holding the timestamp relative
+   * to the base passed to \c clear, and the number of \c clear calls
+   * at the time the slot was reserved. Writers store a slot with one
+   * compare-and-swap that fails if the slot was already written for
+   * a later frame, so a writer that raced with \c clear can neither
+   * publish nor overwrite a timestamp of the next frame. Readers see
+   * the leading run of slots written since the last \c clear, and
+   * neither readers nor writers ever wait for another thread.
+   */
+  template<uint32_t N>
+  class LatencyTimestampLog {
+
+  public:
+
+    using time_point = high_resolution_clock::time_point;
+
+    static constexpr uint32_t Capacity = N;
+
+    void push_back( time_point t ) {
+      uint64_t reserved = m_reserved.fetch_add(1u, std::memory_order_acquire);
+      uint32_t index = uint32_t(reserved);
+
+      if (unlikely(index >= N))
+        return;
+
+      uint16_t epoch = uint16_t(reserved >> 32);
+
+      int64_t delta = std::clamp<int64_t>(
+        t.time_since_epoch().count() - m_base.load(std::memory_order_relaxed),
+        -MaxDelta, MaxDelta);
+
+      uint64_t word = (uint64_t(epoch) << DeltaBits) | (uint64_t(delta) & DeltaMask);
+      uint64_t slot = m_stamps[index].load(std::memory_order_acquire);
+
+      do {
+        // Epochs are compared relative to our own in order to deal
+        // with wrap-around. A slot owned by an epoch between ours and
+        // the current one belongs to a later frame, drop the timestamp.
+        uint16_t owner  = uint16_t(uint16_t(slot >> DeltaBits) - epoch);
+        uint16_t latest = uint16_t(uint16_t(m_reserved.load(std::memory_order_relaxed) >> 32) - epoch);
+
+        if (owner && owner <= latest)
+          return;
+      } while (!m_stamps[index].compare_exchange_weak(slot, word,
+          std::memory_order_release, std::memory_order_acquire));
+    }
+
+    void clear( time_point base ) {
+      uint64_t epoch = (m_reserved.load(std::memory_order_relaxed) >> 32) + 1u;
+      m_base.store(base.time_since_epoch().count(), std::memory_order_relaxed);
+      m_reserved.store(epoch << 32, std::memory_order_release);
+    }
+
+    uint32_t size() const {
+      uint64_t reserved = m_reserved.load(std::memory_order_acquire);
+      uint32_t count = std::min(uint32_t(reserved), N);
+      uint16_t epoch = uint16_t(reserved >> 32);
+
+      uint32_t n = 0u;
+
+      while (n < count && uint16_t(m_stamps[n].load(std::memory_order_acquire) >> DeltaBits) == epoch)
+        n += 1u;
+
+      return n;
+    }
+
+    bool empty() const {
+      return !size();
+    }
+
+    bool overflowed() const {
+      return count() > N;
+    }
+
+    uint32_t overflowCount() const {
+      uint32_t n = count();
+      return n > N ? n - N : 0u;
+    }
+
+    time_point operator [] ( uint32_t index ) const {
+      assert(index < size());
+
+      // Sign-extend the stored delta
+      uint64_t word = m_stamps[index].load(std::memory_order_acquire);
+      int64_t delta = int64_t(word << (64u - DeltaBits)) >> (64u - DeltaBits);
+
+      return time_point(high_resolution_clock::duration(
+        m_base.load(std::memory_order_relaxed) + delta));
+    }
+
+  private:
+
+    static constexpr uint32_t DeltaBits = 48u;
+    static constexpr uint64_t DeltaMask = (uint64_t(1u) << DeltaBits) - 1u;
+    static constexpr int64_t  MaxDelta  = int64_t(DeltaMask >> 1u);
+
+    // Slots start out owned by epoch 0, so that they are
+    // not visible until written after the first clear
+    std::atomic<uint64_t> m_reserved  = { uint64_t(1u) << 32 };
+    std::atomic<high_resolution_clock::rep> m_base = { 0 };
+    std::array<std::atomic<uint64_t>, N> m_stamps = { };
+
+    uint32_t count() const {
+      return uint32_t(m_reserved.load(std::memory_order_acquire));
+    }
+
+  };
+
+
   struct LatencyMarkers {
 
     using time_point = high_resolution_clock::time_point;
@@ -30,9 +148,13 @@ namespace dxvk {
     int32_t gpuFinished;
     int32_t presentFinished;
 
-    std::vector<time_point> gpuReady;
-    std::vector<time_point> gpuSubmit;
-    std::vector<time_point> gpuQueueSubmit;
+    // Enough for the number of submissions per frame
+    // with the flush heuristics used for low latency
+    static constexpr uint32_t MaxEvents = 64;
+
+    LatencyTimestampLog<MaxEvents> gpuReady;
+    LatencyTimestampLog<MaxEvents> gpuSubmit;
+    LatencyTimestampLog<MaxEvents> gpuQueueSubmit;
 
   };
 
@@ -77,24 +199,20 @@ namespace dxvk {
       return LatencyMarkersReader(this, numEntries);
     }
 
-    void registerFrameStart( uint64_t frameId ) {
+    void registerFrameStart( uint64_t frameId, high_resolution_clock::time_point now ) {
       if (frameId <= m_timeline.frameFinished.load()) {
         Logger::warn( str::format("internal error during registerFrameStart: expected frameId=",
           m_timeline.frameFinished.load()+1, ", got: ", frameId) );
       }
-      auto now = high_resolution_clock::now();
-
       LatencyMarkers* markers = getMarkers(frameId);
       markers->start = now;
     }
 
-    void registerFrameEnd( uint64_t frameId ) {
+    void registerFrameEnd( uint64_t frameId, high_resolution_clock::time_point now ) {
       if (frameId <= m_timeline.frameFinished.load()) {
         Logger::warn( str::format("internal error during registerFrameEnd: expected frameId=",
           m_timeline.frameFinished.load()+1, ", got: ", frameId) );
       }
-      auto now = high_resolution_clock::now();
-
       LatencyMarkers* markers = getMarkers(frameId);
       markers->presentFinished = std::chrono::duration_cast<std::chrono::microseconds>(
         now - markers->start).count();
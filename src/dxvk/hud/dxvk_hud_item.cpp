@@ -271,6 +271,177 @@ namespace dxvk::hud {
   }
 
 
+  HudLatencyHistogramItem::HudLatencyHistogramItem() { }
+  HudLatencyHistogramItem::~HudLatencyHistogramItem() { }
+
+  void HudLatencyHistogramItem::update(dxvk::high_resolution_clock::time_point time) {
+    const Rc<DxvkLatencyTracker> tracker = m_tracker;
+    const FramePacer* framePacer = dynamic_cast<FramePacer*>( tracker.ptr() );
+    if (!framePacer)
+      return;
+
+    const LatencyMarkersStorage& storage = framePacer->m_latencyMarkersStorage;
+    uint64_t frameId = storage.getTimeline()->frameFinished.load();
+
+    // The storage only keeps a limited number of frames around, and the
+    // first few frames of the timeline do not contain valid markers
+    constexpr uint64_t MaxFrames = 64u;
+
+    if (m_lastFrameId + MaxFrames < frameId)
+      m_lastFrameId = frameId - MaxFrames;
+
+    m_lastFrameId = std::max<uint64_t>(m_lastFrameId, DXGI_MAX_SWAP_CHAIN_BUFFERS + 1u);
+
+    while (m_lastFrameId < frameId)
+      addFrame(*storage.getConstMarkers(++m_lastFrameId));
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastUpdate);
+
+    if (elapsed.count() >= UpdateInterval) {
+      m_lastUpdate = time;
+
+      for (uint32_t i = 0; i < ComponentCount; i++) {
+        const Histogram& h = m_histograms[i];
+
+        m_strings[i] = m_frameCount
+          ? str::format(
+              formatTime(getPercentile(h, 50)), " ",
+              formatTime(getPercentile(h, 95)), " ",
+              formatTime(getPercentile(h, 99)), " ",
+              formatTime(getMax(h)))
+          : std::string("N/A");
+      }
+    }
+  }
+
+
+  HudPos HudLatencyHistogramItem::render(
+    const DxvkContextObjects& ctx,
+    const HudPipelineKey&     key,
+    const HudOptions&         options,
+          HudRenderer&        renderer,
+          HudPos              position) {
+    static const std::array<const char*, ComponentCount> s_names = {{
+      "CPU:", "CS:", "GPU start:", "GPU:", "Present:",
+    }};
+
+    position.y += 16;
+    renderer.drawText(16, position, 0xff4040ffu, "Latency (ms):");
+    renderer.drawText(16, { position.x + 168, position.y },
+      0xffffffffu, "  p50   p95   p99   max");
+
+    for (uint32_t i = 0; i < ComponentCount; i++) {
+      position.y += 20;
+      renderer.drawText(16, position, 0xff4040ffu, s_names[i]);
+      renderer.drawText(16, { position.x + 168, position.y },
+        0xffffffffu, m_strings[i]);
+    }
+
+    position.y += 8;
+    return position;
+  }
+
+
+  void HudLatencyHistogramItem::addFrame(
+    const LatencyMarkers&     markers) {
+    std::array<int32_t, ComponentCount> values;
+    values[CpuTime]  = markers.cpuFinished;
+    values[CsTime]   = markers.csFinished - markers.csStart;
+    values[GpuStart] = markers.gpuStart - markers.csStart;
+    values[GpuTime]  = markers.gpuFinished - markers.gpuStart;
+    values[Present]  = markers.presentFinished - markers.gpuFinished;
+
+    for (uint32_t i = 0; i < ComponentCount; i++)
+      addValue(m_histograms[i], values[i]);
+
+    m_frameCount += 1u;
+  }
+
+
+  void HudLatencyHistogramItem::addValue(
+          Histogram&          histogram,
+          int32_t             value) {
+    uint32_t slot = m_frameCount % WindowSize;
+
+    // Evict the value that drops out of the sliding window
+    if (m_frameCount >= WindowSize)
+      histogram.counts[histogram.buckets[slot]] -= 1u;
+
+    uint32_t bucket = getBucket(value);
+
+    histogram.counts[bucket] += 1u;
+    histogram.buckets[slot] = uint16_t(bucket);
+    histogram.values[slot] = value;
+  }
+
+
+  int32_t HudLatencyHistogramItem::getPercentile(
+    const Histogram&          histogram,
+          uint32_t            percent) const {
+    uint32_t total = std::min(m_frameCount, WindowSize);
+    uint32_t target = (total * percent + 99u) / 100u;
+    uint32_t count = 0u;
+
+    for (uint32_t i = 0; i < BucketCount; i++) {
+      count += histogram.counts[i];
+
+      if (count >= target)
+        return getBucketValue(i);
+    }
+
+    return getBucketValue(BucketCount - 1u);
+  }
+
+
+  int32_t HudLatencyHistogramItem::getMax(
+    const Histogram&          histogram) const {
+    uint32_t total = std::min(m_frameCount, WindowSize);
+    int32_t result = 0;
+
+    for (uint32_t i = 0; i < total; i++)
+      result = std::max(result, histogram.values[i]);
+
+    return result;
+  }
+
+
+  uint32_t HudLatencyHistogramItem::getBucket(int32_t value) {
+    // Buckets are linear up to 2^SubBucketBits us, after that, each power
+    // of two is split into 2^SubBucketBits buckets of equal size
+    constexpr uint32_t SubBuckets = 1u << SubBucketBits;
+    constexpr uint32_t MaxValue = (1u << ((BucketCount >> SubBucketBits) - 1u + SubBucketBits)) - 1u;
+
+    uint32_t v = std::min(uint32_t(std::max(value, 0)), MaxValue);
+
+    if (v < SubBuckets)
+      return v;
+
+    uint32_t e = 31u - bit::lzcnt(v);
+    uint32_t sub = (v >> (e - SubBucketBits)) & (SubBuckets - 1u);
+    return ((e - SubBucketBits + 1u) << SubBucketBits) + sub;
+  }
+
+
+  int32_t HudLatencyHistogramItem::getBucketValue(uint32_t bucket) {
+    constexpr uint32_t SubBuckets = 1u << SubBucketBits;
+
+    if (bucket < SubBuckets)
+      return int32_t(bucket);
+
+    uint32_t e = (bucket >> SubBucketBits) + SubBucketBits - 1u;
+    uint32_t sub = bucket & (SubBuckets - 1u);
+    uint32_t width = 1u << (e - SubBucketBits);
+
+    // Return the center of the bucket
+    return int32_t(((SubBuckets + sub) << (e - SubBucketBits)) + width / 2u);
+  }
+
+
+  std::string HudLatencyHistogramItem::formatTime(int32_t us) {
+    return str::format(std::setfill(' '), std::setw(3), us / 1000, ".", (us / 100) % 10);
+  }
+
+
   HudFrameTimeItem::HudFrameTimeItem(const Rc<DxvkDevice>& device, HudRenderer* renderer)
   : m_device            (device),
     m_gfxSetLayout      (createDescriptorSetLayout()),
@@ -999,6 +1170,8 @@ namespace dxvk::hud {
   void HudMemoryStatsItem::update(dxvk::high_resolution_clock::time_point time) {
     for (uint32_t i = 0; i < m_memory.memoryHeapCount; i++)
       m_heaps[i] = m_device->getMemoryStats(i);
+
+    m_defragStats = m_device->getMemoryDefragStats();
   }
 
 
@@ -1028,6 +1201,17 @@ namespace dxvk::hud {
       position.y += 4;
     }
 
+    if (m_defragStats.relocatedCount) {
+      std::string text = str::format(std::setfill(' '), std::setw(5), m_defragStats.relocatedBytes >> 20, " MB moved, ",
+        m_defragStats.timeSpent / 1000u, " ms");
+
+      position.y += 16;
+      renderer.drawText(16, position, 0xff40ffffu, "Defrag:");
+      renderer.drawText(16, { position.x + 168, position.y }, 0xffffffffu, text);
+
+      position.y += 4;
+    }
+
     position.y += 4;
     return position;
   }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -11,6 +12,10 @@
 
 #include "dxvk_hud_renderer.h"
 
+namespace dxvk {
+  struct LatencyMarkers;
+}
+
 namespace dxvk::hud {
 
   /**
@@ -289,6 +294,88 @@ namespace dxvk::hud {
   };
 
 
+  /**
+   * \brief HUD item to display latency percentiles
+   *
+   * Tracks the individual latency components of the frame
+   * pacer in log-bucketed histograms over a sliding window
+   * of frames, and displays percentiles for each of them.
+   */
+  class HudLatencyHistogramItem : public HudItem {
+    constexpr static int64_t  UpdateInterval  = 500'000;
+    constexpr static uint32_t WindowSize      = 1024u;
+    constexpr static uint32_t SubBucketBits   = 4u;
+    constexpr static uint32_t BucketCount     = 26u << SubBucketBits;
+  public:
+
+    HudLatencyHistogramItem();
+
+    ~HudLatencyHistogramItem();
+
+    void updateLatencyTracker( const Rc<DxvkLatencyTracker>& tracker ) {
+      m_tracker = tracker;
+    }
+
+    void update(dxvk::high_resolution_clock::time_point time);
+
+    HudPos render(
+      const DxvkContextObjects& ctx,
+      const HudPipelineKey&     key,
+      const HudOptions&         options,
+            HudRenderer&        renderer,
+            HudPos              position);
+
+  private:
+
+    enum Component : uint32_t {
+      CpuTime,
+      CsTime,
+      GpuStart,
+      GpuTime,
+      Present,
+      ComponentCount
+    };
+
+    struct Histogram {
+      std::array<uint32_t, BucketCount> counts  = { };
+      std::array<uint16_t, WindowSize>  buckets = { };
+      std::array<int32_t,  WindowSize>  values  = { };
+    };
+
+    Rc<DxvkLatencyTracker> m_tracker;
+
+    dxvk::high_resolution_clock::time_point m_lastUpdate
+      = dxvk::high_resolution_clock::now();
+
+    uint64_t  m_lastFrameId = 0u;
+    uint32_t  m_frameCount  = 0u;
+
+    std::array<Histogram,   ComponentCount> m_histograms;
+    std::array<std::string, ComponentCount> m_strings;
+
+    void addFrame(
+      const LatencyMarkers&     markers);
+
+    void addValue(
+            Histogram&          histogram,
+            int32_t             value);
+
+    int32_t getPercentile(
+      const Histogram&          histogram,
+            uint32_t            percent) const;
+
+    int32_t getMax(
+      const Histogram&          histogram) const;
+
+    static uint32_t getBucket(int32_t value);
+
+    static int32_t getBucketValue(uint32_t bucket);
+
+    static std::string formatTime(int32_t us);
+
+  };
+
+
   /**
    * \brief HUD item to display the frame rate
    */
@@ -565,6 +652,7 @@ namespace dxvk::hud {
     Rc<DxvkDevice>                    m_device;
     VkPhysicalDeviceMemoryProperties  m_memory;
     DxvkMemoryStats                   m_heaps[VK_MAX_MEMORY_HEAPS];
+    DxvkDefragStats                   m_defragStats;
 
   };
 
@@ -1,7 +1,393 @@
+#include <array>
+#include <cstring>
+
 #include "spirv_compression.h"
 
+#include "../util/util_bit.h"
+
+#if defined(DXVK_ARCH_X86) && !defined(__e2k__)
+  #define DXVK_SPIRV_SIMD
+
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #define DXVK_SPIRV_TARGET(isa)
+  #else
+    #include <cpuid.h>
+    #define DXVK_SPIRV_TARGET(isa) __attribute__((target(isa)))
+  #endif
+#endif
+
 namespace dxvk {
 
+  // SPIR-V code is compressed with a variant of stream-vbyte. Each token
+  // is stored in one to four bytes, and the byte counts of four tokens
+  // are stored in a single control byte, two bits each. Control bytes are
+  // stored in front of all token bytes, so that the position of the next
+  // group of four tokens only depends on the control byte. A full group
+  // can then be decoded with one unaligned load and one byte shuffle.
+  //
+  // Before encoding, instruction headers and result IDs are remapped so
+  // that they usually fit into one or two bytes:
+  // - Headers store the word count in the upper 16 bits, so the bits are
+  //   reordered to keep small word counts and opcodes in the low bits.
+  // - Result IDs are mostly allocated in order, so they are stored as the
+  //   difference to the previous result ID plus one, zigzag-encoded.
+  // Decoding these only requires a walk over all instruction headers.
+  // Code that is not a SPIR-V module is stored without remapping.
+  struct SpirvVbyteTables {
+    std::array<std::array<uint8_t, 16>, 256> shuffle = { };
+    std::array<uint8_t, 256>                 length  = { };
+  };
+
+
+  static constexpr SpirvVbyteTables buildVbyteTables() {
+    SpirvVbyteTables tables;
+
+    for (uint32_t c = 0; c < 256; c++) {
+      uint32_t offset = 0;
+
+      for (uint32_t i = 0; i < 4; i++) {
+        uint32_t length = ((c >> (2 * i)) & 0x3) + 1;
+
+        for (uint32_t j = 0; j < 4; j++)
+          tables.shuffle[c][4 * i + j] = j < length ? uint8_t(offset + j) : uint8_t(0x80);
+
+        offset += length;
+      }
+
+      tables.length[c] = uint8_t(offset);
+    }
+
+    return tables;
+  }
+
+
+  alignas(16) static constexpr SpirvVbyteTables g_vbyteTables = buildVbyteTables();
+
+
+  static constexpr uint32_t getResultOffset(uint32_t op) {
+    switch (op) {
+      case spv::OpString:
+      case spv::OpExtInstImport:
+      case spv::OpTypeVoid:
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampler:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeArray:
+      case spv::OpTypeRuntimeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypePointer:
+      case spv::OpTypeFunction:
+      case spv::OpDecorationGroup:
+      case spv::OpLabel:
+        return 1;
+
+      case spv::OpNop:
+      case spv::OpSourceContinued:
+      case spv::OpSource:
+      case spv::OpSourceExtension:
+      case spv::OpName:
+      case spv::OpMemberName:
+      case spv::OpLine:
+      case spv::OpNoLine:
+      case spv::OpModuleProcessed:
+      case spv::OpExtension:
+      case spv::OpMemoryModel:
+      case spv::OpEntryPoint:
+      case spv::OpExecutionMode:
+      case spv::OpExecutionModeId:
+      case spv::OpCapability:
+      case spv::OpDecorate:
+      case spv::OpMemberDecorate:
+      case spv::OpDecorateId:
+      case spv::OpDecorateString:
+      case spv::OpMemberDecorateString:
+      case spv::OpGroupDecorate:
+      case spv::OpGroupMemberDecorate:
+      case spv::OpStore:
+      case spv::OpCopyMemory:
+      case spv::OpCopyMemorySized:
+      case spv::OpFunctionEnd:
+      case spv::OpImageWrite:
+      case spv::OpEmitVertex:
+      case spv::OpEndPrimitive:
+      case spv::OpEmitStreamVertex:
+      case spv::OpEndStreamPrimitive:
+      case spv::OpControlBarrier:
+      case spv::OpMemoryBarrier:
+      case spv::OpAtomicStore:
+      case spv::OpLoopMerge:
+      case spv::OpSelectionMerge:
+      case spv::OpBranch:
+      case spv::OpBranchConditional:
+      case spv::OpSwitch:
+      case spv::OpKill:
+      case spv::OpReturn:
+      case spv::OpReturnValue:
+      case spv::OpUnreachable:
+      case spv::OpTerminateInvocation:
+      case spv::OpDemoteToHelperInvocation:
+      case spv::OpBeginInvocationInterlockEXT:
+      case spv::OpEndInvocationInterlockEXT:
+        return 0;
+
+      default:
+        // Most instructions have a result type and a result
+        return 2;
+    }
+  }
+
+
+  static constexpr std::array<uint8_t, 1024> buildResultOffsetTable() {
+    std::array<uint8_t, 1024> table = { };
+
+    for (uint32_t i = 0; i < table.size(); i++)
+      table[i] = uint8_t(getResultOffset(i));
+
+    return table;
+  }
+
+
+  static constexpr std::array<uint8_t, 1024> g_resultOffsets = buildResultOffsetTable();
+
+
+  static uint32_t lookupResultOffset(uint32_t op) {
+    return likely(op < g_resultOffsets.size())
+      ? g_resultOffsets[op] : getResultOffset(op);
+  }
+
+
+  static uint32_t encodeHeader(uint32_t header) {
+    uint32_t op = header & spv::OpCodeMask;
+    uint32_t len = header >> spv::WordCountShift;
+
+    return (len & 0xff) | (op << 8) | ((len >> 8) << 24);
+  }
+
+
+  static uint32_t decodeLength(uint32_t token) {
+    uint32_t len = token & 0xff;
+
+    if (unlikely(token >> 24))
+      len |= (token >> 24) << 8;
+
+    return len;
+  }
+
+
+  static uint32_t decodeHeader(uint32_t token) {
+    uint32_t op = (token >> 8) & 0xffff;
+    return op | (decodeLength(token) << spv::WordCountShift);
+  }
+
+
+  static uint32_t encodeResult(uint32_t id, uint32_t prevId) {
+    uint32_t delta = id - prevId - 1u;
+    return (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+  }
+
+
+  static uint32_t decodeResult(uint32_t token, uint32_t prevId) {
+    uint32_t delta = (token >> 1) ^ (0u - (token & 1u));
+    return prevId + 1u + delta;
+  }
+
+
+  static bool isModule(const uint32_t* code, size_t size) {
+    return size >= 5 && code[0] == spv::MagicNumber;
+  }
+
+
+  static void decodeModel(uint32_t* code, size_t size) {
+    if (!isModule(code, size))
+      return;
+
+    uint32_t prevId = 0u;
+
+    for (size_t i = 5; i < size; ) {
+      uint32_t token = code[i];
+      uint32_t len = decodeLength(token);
+
+      uint32_t header = decodeHeader(token);
+      code[i] = header;
+
+      if (unlikely(!len))
+        break;
+
+      uint32_t op = header & spv::OpCodeMask;
+      uint32_t result = lookupResultOffset(op);
+
+      if (result && result < len && i + result < size) {
+        prevId = decodeResult(code[i + result], prevId);
+        code[i + result] = prevId;
+      }
+
+      i += len;
+    }
+  }
+
+
+  static const uint8_t* decodeTokensScalar(
+    const uint8_t*        ctrl,
+    const uint8_t*        src,
+    const uint8_t*        end,
+          uint32_t*       dst,
+          size_t          count) {
+    for (size_t i = 0; i < count; i++) {
+      uint32_t length = ((ctrl[i >> 2] >> ((i & 3) << 1)) & 0x3) + 1;
+      uint32_t token = 0;
+
+      if (likely(src + 4 <= end)) {
+        std::memcpy(&token, src, 4);
+        token &= ~0u >> (32 - 8 * length);
+      } else {
+        for (uint32_t j = 0; j < length; j++)
+          token |= uint32_t(src[j]) << (8 * j);
+      }
+
+      dst[i] = token;
+      src += length;
+    }
+
+    return src;
+  }
+
+
+#ifdef DXVK_SPIRV_SIMD
+  // Decodes full groups of four tokens for as long as the input
+  // can be read 16 bytes at a time. Returns the number of groups
+  // that were decoded, the rest is handled by the scalar decoder.
+  using SpirvDecodeGroupsProc = size_t (*)(
+    const uint8_t*        ctrl,
+    const uint8_t*&       src,
+    const uint8_t*        end,
+          uint32_t*       dst,
+          size_t          groups);
+
+
+  DXVK_SPIRV_TARGET("ssse3")
+  static size_t decodeGroupsSsse3(
+    const uint8_t*        ctrl,
+    const uint8_t*&       src,
+    const uint8_t*        end,
+          uint32_t*       dst,
+          size_t          groups) {
+    const uint8_t* ptr = src;
+    size_t i = 0;
+
+    for ( ; i < groups && ptr + 16 <= end; i++) {
+      uint32_t c = ctrl[i];
+
+      __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+      __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g_vbyteTables.shuffle[c].data()));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[4 * i]), _mm_shuffle_epi8(data, mask));
+      ptr += g_vbyteTables.length[c];
+    }
+
+    src = ptr;
+    return i;
+  }
+
+
+  DXVK_SPIRV_TARGET("avx2")
+  static size_t decodeGroupsAvx2(
+    const uint8_t*        ctrl,
+    const uint8_t*&       src,
+    const uint8_t*        end,
+          uint32_t*       dst,
+          size_t          groups) {
+    const uint8_t* ptr = src;
+    size_t i = 0;
+
+    // Decode two groups at a time, one per 128-bit lane
+    for ( ; i + 2 <= groups; i += 2) {
+      uint32_t c0 = ctrl[i + 0];
+      uint32_t c1 = ctrl[i + 1];
+
+      const uint8_t* ptr1 = ptr + g_vbyteTables.length[c0];
+
+      if (unlikely(ptr1 + 16 > end))
+        break;
+
+      __m256i data = _mm256_inserti128_si256(_mm256_castsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr1)), 1);
+
+      __m256i mask = _mm256_inserti128_si256(_mm256_castsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(g_vbyteTables.shuffle[c0].data()))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(g_vbyteTables.shuffle[c1].data())), 1);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[4 * i]), _mm256_shuffle_epi8(data, mask));
+      ptr = ptr1 + g_vbyteTables.length[c1];
+    }
+
+    src = ptr;
+    return i + decodeGroupsSsse3(&ctrl[i], src, end, &dst[4 * i], groups - i);
+  }
+
+
+  static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t (&regs)[4]) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int result[4];
+    __cpuidex(result, int(leaf), int(subleaf));
+
+    for (uint32_t i = 0; i < 4; i++)
+      regs[i] = uint32_t(result[i]);
+    #else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+  }
+
+
+  static uint64_t xgetbv(uint32_t index) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(index);
+    #else
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (index));
+    return uint64_t(lo) | (uint64_t(hi) << 32);
+    #endif
+  }
+
+
+  static SpirvDecodeGroupsProc selectDecodeGroupsProc() {
+    uint32_t regs[4] = { };
+    cpuid(0, 0, regs);
+
+    uint32_t maxLeaf = regs[0];
+
+    if (maxLeaf < 1)
+      return nullptr;
+
+    cpuid(1, 0, regs);
+
+    bool hasSsse3 = regs[2] & (1u << 9);
+    bool hasAvx = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28))
+      && (xgetbv(0) & 0x6) == 0x6;
+
+    if (hasAvx && maxLeaf >= 7) {
+      cpuid(7, 0, regs);
+
+      if (regs[1] & (1u << 5))
+        return &decodeGroupsAvx2;
+    }
+
+    return hasSsse3 ? &decodeGroupsSsse3 : nullptr;
+  }
+
+
+  static SpirvDecodeGroupsProc getDecodeGroupsProc() {
+    static const SpirvDecodeGroupsProc s_proc = selectDecodeGroupsProc();
+    return s_proc;
+  }
+#endif
+
+
   SpirvCompressedBuffer::SpirvCompressedBuffer()
   : m_size(0) {
 
@@ -10,77 +396,63 @@ namespace dxvk {
 
   SpirvCompressedBuffer::SpirvCompressedBuffer(SpirvCodeBuffer& code)
   : m_size(code.dwords()) {
-    // The compression (detailed below) achieves roughly 55% of the
-    // original size on average and is very consistent, so an initial
-    // estimate of roughly 58% will be accurate most of the time.
     const uint32_t* data = code.data();
-    m_code.reserve((m_size * 75) / 128);
-
-    std::array<uint32_t, 16> block;
-    uint32_t blockMask = 0;
-    uint32_t blockOffset = 0;
-
-    // The algorithm used is a simple variable-to-fixed compression that
-    // encodes up to two consecutive SPIR-V tokens into one DWORD using
-    // a small number of different encodings. While not achieving great
-    // compression ratios, the main goal is to allow decompression code
-    // to be fast, with short dependency chains.
-    // Compressed tokens are stored in blocks of 16 DWORDs, each preceeded
-    // by a single DWORD which stores the layout for each DWORD, two bits
-    // each. The supported layouts, are as follows:
-    // 0x0: 1x 32-bit;  0x1: 1x 20-bit + 1x 12-bit
-    // 0x2: 2x 16-bit;  0x3: 1x 12-bit + 1x 20-bit
-    // These layouts are chosen to allow reasonably efficient encoding of
-    // opcode tokens, which usually fit into 20 bits, followed by type IDs,
-    // which tend to be low as well since most types are defined early.
-    for (size_t i = 0; i < m_size; ) {
-      if (likely(i + 1 < m_size)) {
-        uint32_t a = data[i];
-        uint32_t b = data[i + 1];
-        uint32_t schema;
-        uint32_t encode;
-
-        if (std::max(a, b) < (1u << 16)) {
-          schema = 0x2;
-          encode = a | (b << 16);
-        } else if (a < (1u << 20) && b < (1u << 12)) {
-          schema = 0x1;
-          encode = a | (b << 20);
-        } else if (a < (1u << 12) && b < (1u << 20)) {
-          schema = 0x3;
-          encode = a | (b << 12);
-        } else {
-          schema = 0x0;
-          encode = a;
-        }
-
-        block[blockOffset] = encode;
-        blockMask |= schema << (blockOffset << 1);
-        blockOffset += 1;
-
-        i += schema ? 2 : 1;
-      } else {
-        block[blockOffset] = data[i++];
-        blockOffset += 1;
-      }
 
-      if (unlikely(blockOffset == 16) || unlikely(i == m_size)) {
-        m_code.insert(m_code.end(), blockMask);
-        m_code.insert(m_code.end(), block.begin(), block.begin() + blockOffset);
+    // Allocate for the worst case, which is four bytes per token
+    // plus the control bytes, and shrink the array afterwards.
+    // Control bytes rely on the array being zero-initialized.
+    size_t ctrlSize = (m_size + 3) / 4;
+    m_code.resize((ctrlSize + 4 * m_size + 3) / 4);
+
+    uint8_t* ctrl = reinterpret_cast<uint8_t*>(m_code.data());
+    uint8_t* dst = ctrl + ctrlSize;
 
-        blockMask = 0;
-        blockOffset = 0;
+    size_t nextHeader = isModule(data, m_size) ? 5 : m_size;
+    size_t nextResult = m_size;
+    uint32_t prevId = 0u;
+
+    for (size_t i = 0; i < m_size; i++) {
+      uint32_t token = data[i];
+
+      if (i == nextHeader) {
+        uint32_t len = token >> spv::WordCountShift;
+        uint32_t result = lookupResultOffset(token & spv::OpCodeMask);
+
+        nextHeader = len ? i + len : m_size;
+        nextResult = result && result < len ? i + result : m_size;
+
+        token = encodeHeader(token);
+      } else if (i == nextResult) {
+        token = encodeResult(token, prevId);
+        prevId = data[i];
       }
+
+      uint32_t length = 4u - (bit::lzcnt(token | 1u) >> 3);
+
+      // The buffer has room for four bytes per token, so it is
+      // always safe to write the full token and only advance the
+      // pointer by the number of bytes that are actually needed.
+      std::memcpy(dst, &token, 4);
+      dst += length;
+
+      ctrl[i >> 2] |= (length - 1) << ((i & 3) << 1);
     }
 
-    // Only shrink the array if we have lots of overhead for some reason.
-    // This should only happen on shaders where our initial estimate was
-    // too small. In general, we want to avoid reallocation here.
-    if (m_code.capacity() > (m_code.size() * 10) / 9)
-      m_code.shrink_to_fit();
+    size_t byteSize = size_t(dst - ctrl);
+    m_code.resize((byteSize + 3) / 4);
+    m_code.shrink_to_fit();
   }
 
-    
+
+  SpirvCompressedBuffer::SpirvCompressedBuffer(
+          size_t          size,
+          size_t          compressedSize,
+    const uint32_t*       compressedData)
+  : m_size(size), m_code(compressedData, compressedData + compressedSize) {
+
+  }
+
+
   SpirvCompressedBuffer::~SpirvCompressedBuffer() {
 
   }
@@ -90,34 +462,25 @@ namespace dxvk {
     SpirvCodeBuffer code(m_size);
     uint32_t* data = code.data();
 
-    uint32_t srcOffset = 0;
-    uint32_t dstOffset = 0;
-
-    constexpr uint32_t shiftAmounts = 0x0c101420;
+    if (!m_size)
+      return code;
 
-    while (dstOffset < m_size) {
-      uint32_t blockMask = m_code[srcOffset];
+    const uint8_t* ctrl = reinterpret_cast<const uint8_t*>(m_code.data());
+    const uint8_t* end = ctrl + sizeof(uint32_t) * m_code.size();
+    const uint8_t* src = ctrl + (m_size + 3) / 4;
 
-      for (uint32_t i = 0; i < 16 && dstOffset < m_size; i++) {
-        // Use 64-bit integers for some of the operands so we can
-        // shift by 32 bits and not handle it as a special cases
-        uint32_t schema = (blockMask >> (i << 1)) & 0x3;
-        uint32_t shift  = (shiftAmounts >> (schema << 3)) & 0xff;
-        uint64_t mask   = ~(~0ull << shift);
-        uint64_t encode = m_code[srcOffset + i + 1];
+    size_t decoded = 0;
 
-        data[dstOffset] = encode & mask;
+#ifdef DXVK_SPIRV_SIMD
+    SpirvDecodeGroupsProc proc = getDecodeGroupsProc();
 
-        if (likely(schema))
-          data[dstOffset + 1] = encode >> shift;
-
-        dstOffset += schema ? 2 : 1;
-      }
-
-      srcOffset += 17;
-    }
+    if (likely(proc))
+      decoded = 4 * proc(ctrl, src, end, data, m_size / 4);
+#endif
 
+    decodeTokensScalar(&ctrl[decoded / 4], src, end, &data[decoded], m_size - decoded);
+    decodeModel(data, m_size);
     return code;
   }
 
-}
\ No newline at end of file
+}
@@ -10,7 +10,8 @@ namespace dxvk {
    * \brief Compressed SPIR-V code buffer
    *
    * Implements a fast in-memory compression
-   * to keep memory footprint low.
+   * to keep memory footprint low. The format
+   * is not stable across DXVK versions.
    */
   class SpirvCompressedBuffer {
 
@@ -19,20 +20,48 @@ namespace dxvk {
     SpirvCompressedBuffer();
 
     SpirvCompressedBuffer(SpirvCodeBuffer& code);
+
+    SpirvCompressedBuffer(
+            size_t          size,
+            size_t          compressedSize,
+      const uint32_t*       compressedData);
     
     ~SpirvCompressedBuffer();
     
     SpirvCodeBuffer decompress() const;
 
+    /**
+     * \brief Uncompressed code size
+     * \returns Code size, in dwords
+     */
+    size_t size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Compressed code size
+     * \returns Compressed size, in dwords
+     */
+    size_t compressedSize() const {
+      return m_code.size();
+    }
+
+    /**
+     * \brief Compressed code
+     *
+     * Can be used to serialize the buffer, and to
+     * re-create it via the corresponding constructor.
+     * \returns Pointer to compressed dwords
+     */
+    const uint32_t* compressedData() const {
+      return m_code.data();
+    }
+
   private:
 
     size_t                m_size;
     std::vector<uint32_t> m_code;
 
-    void encodeDword(uint32_t dw);
-
-    uint32_t decodeDword(size_t& offset) const;
-
   };
 
 }
\ No newline at end of file
@@ -0,0 +1,1116 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "spirv_optimizer.h"
+
+namespace dxvk {
+
+  SpirvOptimizer::SpirvOptimizer(SpirvCodeBuffer&& code)
+  : m_original(std::move(code)) {
+    const uint32_t* data = m_original.data();
+    m_code.assign(data, data + m_original.dwords());
+  }
+
+
+  SpirvOptimizer::~SpirvOptimizer() {
+
+  }
+
+
+  SpirvCodeBuffer SpirvOptimizer::optimize() {
+    if (!parseModule())
+      return std::move(m_original);
+
+    // Forward variables first so that constants
+    // stored to registers can be folded as well
+    forwardVariables();
+    foldConstants();
+    eliminateDeadCode();
+    return buildModule();
+  }
+
+
+  bool SpirvOptimizer::parseModule() {
+    if (m_code.size() < 5 || m_code[0] != spv::MagicNumber)
+      return false;
+
+    m_idBound = m_code[3];
+
+    m_replace.resize(m_idBound, 0);
+    m_defs.resize(m_idBound, ~0u);
+    m_idTypes.resize(m_idBound, 0);
+    m_pinned.resize(m_idBound, false);
+
+    bool inFunction = false;
+
+    for (uint32_t offset = 5; offset < m_code.size(); ) {
+      uint32_t length = m_code[offset] >> spv::WordCountShift;
+
+      if (!length || length > m_code.size() - offset)
+        return false;
+
+      uint32_t* words = &m_code[offset];
+      auto op = spv::Op(words[0] & spv::OpCodeMask);
+
+      Instruction ins = { offset, length, 0, false };
+      uint32_t typeId = 0;
+
+      if (op == spv::OpFunction && !inFunction) {
+        m_functionIndex = m_ins.size();
+        inFunction = true;
+      }
+
+      if (inFunction) {
+        // Bail on anything we do not know the operand layout of,
+        // since we would not be able to track uses otherwise
+        if (!visitOperands(words, length, typeId, ins.resultId, [] (uint32_t&) { }))
+          return false;
+      } else {
+        switch (op) {
+          case spv::OpExtInstImport: {
+            size_t maxLength = sizeof(uint32_t) * (length - 2);
+
+            if (strnlen(reinterpret_cast<const char*>(&words[2]), maxLength) < maxLength
+             && !std::strcmp(reinterpret_cast<const char*>(&words[2]), "GLSL.std.450"))
+              m_glslId = words[1];
+          } break;
+
+          case spv::OpDecorate:
+          case spv::OpDecorateId:
+          case spv::OpDecorateString:
+          case spv::OpMemberDecorate:
+            if (length > 1 && words[1] < m_idBound)
+              m_pinned[words[1]] = true;
+            break;
+
+          case spv::OpTypeBool:
+            m_types.insert({ words[1], TypeClass::Bool });
+            break;
+
+          case spv::OpTypeInt:
+            if (length > 2 && words[2] == 32)
+              m_types.insert({ words[1], TypeClass::Int32 });
+            break;
+
+          case spv::OpTypeFloat:
+            if (length > 2 && words[2] == 32)
+              m_types.insert({ words[1], TypeClass::Float32 });
+            break;
+
+          case spv::OpConstant:
+          case spv::OpConstantTrue:
+          case spv::OpConstantFalse:
+          case spv::OpConstantComposite:
+          case spv::OpConstantNull:
+          case spv::OpSpecConstant:
+          case spv::OpSpecConstantTrue:
+          case spv::OpSpecConstantFalse:
+          case spv::OpSpecConstantComposite:
+          case spv::OpSpecConstantOp:
+          case spv::OpVariable:
+          case spv::OpUndef:
+            if (length < 3)
+              return false;
+
+            typeId = words[1];
+            ins.resultId = words[2];
+            break;
+
+          default:
+            break;
+        }
+
+        // Only record non-specialization scalar constants, since
+        // these are the only ones we can actually fold.
+        if (ins.resultId && ins.resultId < m_idBound) {
+          uint32_t value = 0;
+          bool isConstant = true;
+
+          if (op == spv::OpConstant && length == 4)
+            value = words[3];
+          else if (op == spv::OpConstantTrue)
+            value = 1;
+          else if (op != spv::OpConstantFalse)
+            isConstant = false;
+
+          if (isConstant) {
+            m_constants.insert({ ins.resultId, { typeId, value } });
+            m_constantIds.insert({ (uint64_t(typeId) << 32) | value, ins.resultId });
+          }
+        }
+      }
+
+      if (ins.resultId) {
+        if (ins.resultId >= m_idBound)
+          return false;
+
+        m_defs[ins.resultId] = m_ins.size();
+        m_idTypes[ins.resultId] = typeId;
+      }
+
+      m_ins.push_back(ins);
+      offset += length;
+    }
+
+    return inFunction;
+  }
+
+
+  void SpirvOptimizer::foldConstants() {
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+      resolveOperands(ins);
+
+      if (ins.resultId && m_idTypes[ins.resultId] && !m_pinned[ins.resultId])
+        tryFold(ins);
+    }
+  }
+
+
+  void SpirvOptimizer::forwardVariables() {
+    // Gather private and function variables that are only ever loaded
+    // or stored as a whole. Negative load counts mark variables that
+    // are accessed in any other way, e.g. through access chains.
+    std::unordered_map<uint32_t, int32_t> loadCounts;
+
+    for (const auto& ins : m_ins) {
+      if (getOpCode(ins) != spv::OpVariable || ins.length < 4 || m_pinned[ins.resultId])
+        continue;
+
+      auto storage = spv::StorageClass(getArg(ins, 3));
+
+      if (storage == spv::StorageClassPrivate || storage == spv::StorageClassFunction)
+        loadCounts.insert({ ins.resultId, 0 });
+    }
+
+    if (loadCounts.empty())
+      return;
+
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed)
+        continue;
+
+      uint32_t* words = &m_code[ins.offset];
+      auto op = getOpCode(ins);
+
+      uint32_t typeId, resultId;
+
+      visitOperands(words, ins.length, typeId, resultId, [&] (uint32_t& id) {
+        auto entry = loadCounts.find(id);
+
+        if (entry == loadCounts.end() || entry->second < 0)
+          return;
+
+        uint32_t index = &id - words;
+
+        if (op == spv::OpLoad && index == 3 && ins.length == 4)
+          entry->second += 1;
+        else if (op != spv::OpStore || index != 1 || ins.length != 3)
+          entry->second = -1;
+      });
+    }
+
+    // Forward stored or previously loaded values to subsequent
+    // loads within the same block. Function calls may modify
+    // private variables, so treat them as a block boundary.
+    std::unordered_map<uint32_t, uint32_t> values;
+
+    auto isSimple = [&] (uint32_t id) {
+      auto entry = loadCounts.find(id);
+      return entry != loadCounts.end() && entry->second >= 0;
+    };
+
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed)
+        continue;
+
+      resolveOperands(ins);
+
+      switch (getOpCode(ins)) {
+        case spv::OpFunction:
+        case spv::OpLabel:
+        case spv::OpFunctionCall:
+          values.clear();
+          break;
+
+        case spv::OpStore: {
+          uint32_t ptrId = getArg(ins, 1);
+
+          if (isSimple(ptrId))
+            values[ptrId] = getArg(ins, 2);
+        } break;
+
+        case spv::OpLoad: {
+          uint32_t ptrId = getArg(ins, 3);
+
+          if (!isSimple(ptrId))
+            break;
+
+          auto entry = values.find(ptrId);
+
+          if (entry != values.end() && !m_pinned[ins.resultId]) {
+            replaceResult(ins, entry->second);
+            loadCounts[ptrId] -= 1;
+          } else {
+            values[ptrId] = ins.resultId;
+          }
+        } break;
+
+        default:
+          break;
+      }
+    }
+
+    // Remove variables that are never read, along with all stores
+    std::unordered_set<uint32_t> deadVars;
+
+    for (const auto& entry : loadCounts) {
+      if (!entry.second) {
+        m_ins[m_defs[entry.first]].removed = true;
+        deadVars.insert(entry.first);
+      }
+    }
+
+    if (deadVars.empty())
+      return;
+
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (!ins.removed && getOpCode(ins) == spv::OpStore
+       && deadVars.find(getArg(ins, 1)) != deadVars.end())
+        ins.removed = true;
+    }
+  }
+
+
+  void SpirvOptimizer::eliminateDeadCode() {
+    std::vector<uint32_t> useCounts(m_idBound, 0);
+
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed)
+        continue;
+
+      resolveOperands(ins);
+
+      uint32_t typeId, resultId;
+
+      visitOperands(&m_code[ins.offset], ins.length, typeId, resultId, [&] (uint32_t& id) {
+        if (id < useCounts.size())
+          useCounts[id] += 1;
+      });
+    }
+
+    std::vector<size_t> worklist;
+
+    for (size_t i = m_functionIndex; i < m_ins.size(); i++) {
+      const auto& ins = m_ins[i];
+
+      if (!ins.removed && ins.resultId && !useCounts[ins.resultId] && isRemovable(ins))
+        worklist.push_back(i);
+    }
+
+    // Removing an instruction may leave its operands
+    // unused as well, so keep going until we're done
+    while (!worklist.empty()) {
+      auto& ins = m_ins[worklist.back()];
+      worklist.pop_back();
+
+      if (ins.removed)
+        continue;
+
+      ins.removed = true;
+
+      uint32_t typeId, resultId;
+
+      visitOperands(&m_code[ins.offset], ins.length, typeId, resultId, [&] (uint32_t& id) {
+        if (id >= useCounts.size() || --useCounts[id])
+          return;
+
+        uint32_t def = m_defs[id];
+
+        if (def != ~0u && def >= m_functionIndex
+         && !m_ins[def].removed && isRemovable(m_ins[def]))
+          worklist.push_back(def);
+      });
+    }
+  }
+
+
+  SpirvCodeBuffer SpirvOptimizer::buildModule() {
+    std::vector<uint32_t> code;
+    code.reserve(m_code.size() + m_newConstants.size());
+    code.insert(code.end(), m_code.begin(), m_code.begin() + 5);
+    code[3] = m_idBound;
+
+    for (size_t i = 0; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (i == m_functionIndex)
+        code.insert(code.end(), m_newConstants.begin(), m_newConstants.end());
+
+      if (ins.removed)
+        continue;
+
+      const uint32_t* words = &m_code[ins.offset];
+
+      switch (getOpCode(ins)) {
+        case spv::OpName:
+        case spv::OpMemberName:
+          if (isRemoved(words[1]))
+            continue;
+          break;
+
+        case spv::OpEntryPoint: {
+          // Private variables are part of the interface as of
+          // SPIR-V 1.4, so remove any variables we got rid of.
+          size_t start = code.size();
+          size_t nameLength = strnlen(reinterpret_cast<const char*>(&words[3]),
+            sizeof(uint32_t) * (ins.length - 3)) / sizeof(uint32_t) + 1;
+
+          code.insert(code.end(), words, words + std::min<size_t>(3 + nameLength, ins.length));
+
+          for (uint32_t j = 3 + nameLength; j < ins.length; j++) {
+            if (!isRemoved(words[j]))
+              code.push_back(words[j]);
+          }
+
+          code[start] = (code[start] & spv::OpCodeMask)
+            | uint32_t((code.size() - start) << spv::WordCountShift);
+        } continue;
+
+        default:
+          if (i >= m_functionIndex)
+            resolveOperands(ins);
+      }
+
+      code.insert(code.end(), words, words + ins.length);
+    }
+
+    return SpirvCodeBuffer(code.size(), code.data());
+  }
+
+
+  bool SpirvOptimizer::tryFold(
+          Instruction&              ins) {
+    auto op = getOpCode(ins);
+
+    switch (op) {
+      case spv::OpSelect: {
+        auto cond = findConstant(getArg(ins, 3), TypeClass::Bool);
+
+        if (!cond)
+          return false;
+
+        replaceResult(ins, getArg(ins, cond->value ? 4 : 5));
+      } return true;
+
+      case spv::OpCompositeExtract: {
+        uint32_t id = getArg(ins, 3);
+
+        for (uint32_t i = 4; i < ins.length; i++) {
+          uint32_t def = id < m_defs.size() ? m_defs[id] : ~0u;
+
+          if (def == ~0u || getOpCode(m_ins[def]) != spv::OpConstantComposite)
+            return false;
+
+          uint32_t index = getArg(ins, i);
+
+          if (index >= m_ins[def].length - 3)
+            return false;
+
+          id = getArg(m_ins[def], 3 + index);
+        }
+
+        replaceResult(ins, id);
+      } return true;
+
+      case spv::OpBitcast: {
+        uint32_t typeId = getArg(ins, 1);
+        TypeClass type = getTypeClass(typeId);
+
+        if (type != TypeClass::Int32 && type != TypeClass::Float32)
+          return false;
+
+        auto a = findConstant(getArg(ins, 3), TypeClass::Int32);
+
+        if (!a)
+          a = findConstant(getArg(ins, 3), TypeClass::Float32);
+
+        if (!a)
+          return false;
+
+        replaceResult(ins, getConstantId(typeId, a->value));
+      } return true;
+
+      default:
+        break;
+    }
+
+    uint32_t typeId = getArg(ins, 1);
+    TypeClass type = getTypeClass(typeId);
+
+    if (type == TypeClass::Int32 && ins.length == 5) {
+      uint32_t aId = getArg(ins, 3);
+      uint32_t bId = getArg(ins, 4);
+
+      auto a = findConstant(aId, TypeClass::Int32);
+      auto b = findConstant(bId, TypeClass::Int32);
+
+      if (a && b) {
+        uint32_t av = a->value;
+        uint32_t bv = b->value;
+
+        int32_t as = int32_t(av);
+        int32_t bs = int32_t(bv);
+
+        uint32_t result = 0;
+
+        switch (op) {
+          case spv::OpIAdd:                 result = av + bv; break;
+          case spv::OpISub:                 result = av - bv; break;
+          case spv::OpIMul:                 result = av * bv; break;
+          case spv::OpBitwiseAnd:           result = av & bv; break;
+          case spv::OpBitwiseOr:            result = av | bv; break;
+          case spv::OpBitwiseXor:           result = av ^ bv; break;
+
+          case spv::OpUDiv:
+            if (!bv) return false;
+            result = av / bv;
+            break;
+
+          case spv::OpUMod:
+            if (!bv) return false;
+            result = av % bv;
+            break;
+
+          case spv::OpSDiv:
+            if (!bv || (as == INT32_MIN && bs == -1)) return false;
+            result = uint32_t(as / bs);
+            break;
+
+          case spv::OpSRem:
+            if (!bv || (as == INT32_MIN && bs == -1)) return false;
+            result = uint32_t(as % bs);
+            break;
+
+          case spv::OpShiftLeftLogical:
+            if (bv >= 32) return false;
+            result = av << bv;
+            break;
+
+          case spv::OpShiftRightLogical:
+            if (bv >= 32) return false;
+            result = av >> bv;
+            break;
+
+          case spv::OpShiftRightArithmetic:
+            if (bv >= 32) return false;
+            result = uint32_t(as >> bv);
+            break;
+
+          default:
+            return false;
+        }
+
+        replaceResult(ins, getConstantId(typeId, result));
+        return true;
+      }
+
+      // Fold trivial identities as long as this does
+      // not change the type of the result
+      uint32_t id = 0;
+
+      switch (op) {
+        case spv::OpIAdd:
+        case spv::OpBitwiseOr:
+        case spv::OpBitwiseXor:
+          if (a && !a->value) id = bId;
+          if (b && !b->value) id = aId;
+          break;
+
+        case spv::OpISub:
+        case spv::OpShiftLeftLogical:
+        case spv::OpShiftRightLogical:
+        case spv::OpShiftRightArithmetic:
+          if (b && !b->value) id = aId;
+          break;
+
+        case spv::OpIMul:
+          if (a && a->value == 1u) id = bId;
+          if (b && b->value == 1u) id = aId;
+          break;
+
+        case spv::OpBitwiseAnd:
+          if (a && a->value == ~0u) id = bId;
+          if (b && b->value == ~0u) id = aId;
+          break;
+
+        default:
+          break;
+      }
+
+      if (!id || id >= m_idTypes.size() || m_idTypes[id] != typeId)
+        return false;
+
+      replaceResult(ins, id);
+      return true;
+    }
+
+    if (type == TypeClass::Int32 && ins.length == 4) {
+      auto a = findConstant(getArg(ins, 3), TypeClass::Int32);
+
+      if (!a)
+        return false;
+
+      uint32_t result = 0;
+
+      switch (op) {
+        case spv::OpNot:      result = ~a->value; break;
+        case spv::OpSNegate:  result = 0u - a->value; break;
+        default: return false;
+      }
+
+      replaceResult(ins, getConstantId(typeId, result));
+      return true;
+    }
+
+    if (type == TypeClass::Bool && ins.length == 5) {
+      auto a = findConstant(getArg(ins, 3), TypeClass::Int32);
+      auto b = findConstant(getArg(ins, 4), TypeClass::Int32);
+
+      bool result = false;
+
+      if (a && b) {
+        uint32_t av = a->value;
+        uint32_t bv = b->value;
+
+        int32_t as = int32_t(av);
+        int32_t bs = int32_t(bv);
+
+        switch (op) {
+          case spv::OpIEqual:               result = av == bv; break;
+          case spv::OpINotEqual:            result = av != bv; break;
+          case spv::OpULessThan:            result = av <  bv; break;
+          case spv::OpULessThanEqual:       result = av <= bv; break;
+          case spv::OpUGreaterThan:         result = av >  bv; break;
+          case spv::OpUGreaterThanEqual:    result = av >= bv; break;
+          case spv::OpSLessThan:            result = as <  bs; break;
+          case spv::OpSLessThanEqual:       result = as <= bs; break;
+          case spv::OpSGreaterThan:         result = as >  bs; break;
+          case spv::OpSGreaterThanEqual:    result = as >= bs; break;
+          default: return false;
+        }
+      } else {
+        a = findConstant(getArg(ins, 3), TypeClass::Bool);
+        b = findConstant(getArg(ins, 4), TypeClass::Bool);
+
+        if (!a || !b)
+          return false;
+
+        switch (op) {
+          case spv::OpLogicalAnd:           result = a->value && b->value; break;
+          case spv::OpLogicalOr:            result = a->value || b->value; break;
+          case spv::OpLogicalEqual:         result = a->value == b->value; break;
+          case spv::OpLogicalNotEqual:      result = a->value != b->value; break;
+          default: return false;
+        }
+      }
+
+      replaceResult(ins, getConstantId(typeId, result ? 1u : 0u));
+      return true;
+    }
+
+    if (type == TypeClass::Bool && ins.length == 4 && op == spv::OpLogicalNot) {
+      auto a = findConstant(getArg(ins, 3), TypeClass::Bool);
+
+      if (!a)
+        return false;
+
+      replaceResult(ins, getConstantId(typeId, a->value ? 0u : 1u));
+      return true;
+    }
+
+    return false;
+  }
+
+
+  uint32_t SpirvOptimizer::resolve(
+          uint32_t                  id) const {
+    while (id < m_replace.size() && m_replace[id])
+      id = m_replace[id];
+
+    return id;
+  }
+
+
+  void SpirvOptimizer::resolveOperands(
+          Instruction&              ins) {
+    uint32_t typeId, resultId;
+
+    visitOperands(&m_code[ins.offset], ins.length, typeId, resultId,
+      [this] (uint32_t& id) { id = resolve(id); });
+  }
+
+
+  void SpirvOptimizer::replaceResult(
+          Instruction&              ins,
+          uint32_t                  id) {
+    m_replace[ins.resultId] = id;
+    ins.removed = true;
+  }
+
+
+  const SpirvOptimizer::Constant* SpirvOptimizer::findConstant(
+          uint32_t                  id,
+          TypeClass                 type) const {
+    auto entry = m_constants.find(id);
+
+    if (entry == m_constants.end() || getTypeClass(entry->second.typeId) != type)
+      return nullptr;
+
+    return &entry->second;
+  }
+
+
+  uint32_t SpirvOptimizer::getConstantId(
+          uint32_t                  typeId,
+          uint32_t                  value) {
+    uint64_t key = (uint64_t(typeId) << 32) | value;
+    auto entry = m_constantIds.find(key);
+
+    if (entry != m_constantIds.end())
+      return entry->second;
+
+    uint32_t id = allocId();
+
+    if (getTypeClass(typeId) == TypeClass::Bool) {
+      m_newConstants.push_back(uint32_t(value ? spv::OpConstantTrue : spv::OpConstantFalse) | (3u << spv::WordCountShift));
+      m_newConstants.push_back(typeId);
+      m_newConstants.push_back(id);
+    } else {
+      m_newConstants.push_back(uint32_t(spv::OpConstant) | (4u << spv::WordCountShift));
+      m_newConstants.push_back(typeId);
+      m_newConstants.push_back(id);
+      m_newConstants.push_back(value);
+    }
+
+    m_idTypes[id] = typeId;
+
+    m_constants.insert({ id, { typeId, value } });
+    m_constantIds.insert({ key, id });
+    return id;
+  }
+
+
+  SpirvOptimizer::TypeClass SpirvOptimizer::getTypeClass(
+          uint32_t                  typeId) const {
+    auto entry = m_types.find(typeId);
+
+    return entry != m_types.end()
+      ? entry->second
+      : TypeClass::Other;
+  }
+
+
+  uint32_t SpirvOptimizer::allocId() {
+    uint32_t id = m_idBound++;
+
+    m_replace.push_back(0);
+    m_defs.push_back(~0u);
+    m_idTypes.push_back(0);
+    m_pinned.push_back(false);
+    return id;
+  }
+
+
+  bool SpirvOptimizer::isRemovable(
+    const Instruction&              ins) const {
+    if (!ins.resultId || !m_idTypes[ins.resultId] || m_pinned[ins.resultId])
+      return false;
+
+    const uint32_t* words = &m_code[ins.offset];
+
+    switch (spv::Op(words[0] & spv::OpCodeMask)) {
+      // Loads with memory operands may be volatile
+      case spv::OpLoad:
+        return ins.length == 4;
+
+      // GLSL instructions are all pure, other sets may not be
+      case spv::OpExtInst:
+        return m_glslId && words[3] == m_glslId;
+
+      case spv::OpFunction:
+      case spv::OpFunctionParameter:
+      case spv::OpFunctionCall:
+      case spv::OpVariable:
+      case spv::OpAtomicLoad:
+      case spv::OpAtomicExchange:
+      case spv::OpAtomicCompareExchange:
+      case spv::OpAtomicIIncrement:
+      case spv::OpAtomicIDecrement:
+      case spv::OpAtomicIAdd:
+      case spv::OpAtomicISub:
+      case spv::OpAtomicSMin:
+      case spv::OpAtomicUMin:
+      case spv::OpAtomicSMax:
+      case spv::OpAtomicUMax:
+      case spv::OpAtomicAnd:
+      case spv::OpAtomicOr:
+      case spv::OpAtomicXor:
+        return false;
+
+      default:
+        return true;
+    }
+  }
+
+
+  bool SpirvOptimizer::isRemoved(
+          uint32_t                  id) const {
+    return id < m_defs.size()
+        && m_defs[id] != ~0u
+        && m_ins[m_defs[id]].removed;
+  }
+
+
+  template<typename Fn>
+  bool SpirvOptimizer::visitOperands(
+          uint32_t*                 words,
+          uint32_t                  length,
+          uint32_t&                 typeId,
+          uint32_t&                 resultId,
+          Fn&&                      fn) {
+    typeId = 0;
+    resultId = 0;
+
+    auto ids = [&] (uint32_t first, uint32_t end) {
+      for (uint32_t i = first; i < std::min(end, length); i++)
+        fn(words[i]);
+    };
+
+    auto value = [&] () {
+      if (length < 3)
+        return false;
+
+      typeId = words[1];
+      resultId = words[2];
+      return true;
+    };
+
+    // Memory and image operands start with a literal mask, followed by
+    // ID operands, except for the literal alignment of memory operands.
+    auto memoryOperands = [&] (uint32_t idx) {
+      if (idx < length && (words[idx++] & spv::MemoryAccessAlignedMask))
+        idx++;
+
+      ids(idx, length);
+    };
+
+    auto imageOperands = [&] (uint32_t idx) {
+      ids(idx + 1, length);
+    };
+
+    switch (spv::Op(words[0] & spv::OpCodeMask)) {
+      case spv::OpNop:
+      case spv::OpLine:
+      case spv::OpNoLine:
+      case spv::OpReturn:
+      case spv::OpUnreachable:
+      case spv::OpKill:
+      case spv::OpTerminateInvocation:
+      case spv::OpDemoteToHelperInvocation:
+      case spv::OpFunctionEnd:
+      case spv::OpEmitVertex:
+      case spv::OpEndPrimitive:
+      case spv::OpBeginInvocationInterlockEXT:
+      case spv::OpEndInvocationInterlockEXT:
+        return true;
+
+      case spv::OpLabel:
+        if (length < 2)
+          return false;
+
+        resultId = words[1];
+        return true;
+
+      case spv::OpUndef:
+      case spv::OpFunctionParameter:
+        return value();
+
+      case spv::OpFunction:
+        ids(4, 5);
+        return value();
+
+      case spv::OpVariable:
+        ids(4, length);
+        return value();
+
+      case spv::OpLoad:
+        ids(3, 4);
+        memoryOperands(4);
+        return value();
+
+      case spv::OpStore:
+        ids(1, 3);
+        memoryOperands(3);
+        return true;
+
+      case spv::OpAtomicStore:
+        ids(1, length);
+        return true;
+
+      case spv::OpArrayLength:
+      case spv::OpCompositeExtract:
+        ids(3, 4);
+        return value();
+
+      case spv::OpVectorShuffle:
+      case spv::OpCompositeInsert:
+        ids(3, 5);
+        return value();
+
+      case spv::OpRawAccessChainNV:
+        ids(3, 7);
+        return value();
+
+      case spv::OpExtInst:
+      case spv::OpGroupNonUniformBallotBitCount:
+      case spv::OpGroupNonUniformIAdd:
+      case spv::OpGroupNonUniformFAdd:
+      case spv::OpGroupNonUniformIMul:
+      case spv::OpGroupNonUniformFMul:
+      case spv::OpGroupNonUniformSMin:
+      case spv::OpGroupNonUniformUMin:
+      case spv::OpGroupNonUniformFMin:
+      case spv::OpGroupNonUniformSMax:
+      case spv::OpGroupNonUniformUMax:
+      case spv::OpGroupNonUniformFMax:
+      case spv::OpGroupNonUniformBitwiseAnd:
+      case spv::OpGroupNonUniformBitwiseOr:
+      case spv::OpGroupNonUniformBitwiseXor:
+      case spv::OpGroupNonUniformLogicalAnd:
+      case spv::OpGroupNonUniformLogicalOr:
+      case spv::OpGroupNonUniformLogicalXor:
+        ids(3, 4);
+        ids(5, length);
+        return value();
+
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageSampleProjImplicitLod:
+      case spv::OpImageSampleProjExplicitLod:
+      case spv::OpImageFetch:
+      case spv::OpImageRead:
+      case spv::OpImageSparseSampleImplicitLod:
+      case spv::OpImageSparseSampleExplicitLod:
+      case spv::OpImageSparseSampleProjImplicitLod:
+      case spv::OpImageSparseSampleProjExplicitLod:
+      case spv::OpImageSparseFetch:
+      case spv::OpImageSparseRead:
+        ids(3, 5);
+        imageOperands(5);
+        return value();
+
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+      case spv::OpImageSampleProjDrefImplicitLod:
+      case spv::OpImageSampleProjDrefExplicitLod:
+      case spv::OpImageGather:
+      case spv::OpImageDrefGather:
+      case spv::OpImageSparseSampleDrefImplicitLod:
+      case spv::OpImageSparseSampleDrefExplicitLod:
+      case spv::OpImageSparseSampleProjDrefImplicitLod:
+      case spv::OpImageSparseSampleProjDrefExplicitLod:
+      case spv::OpImageSparseGather:
+      case spv::OpImageSparseDrefGather:
+        ids(3, 6);
+        imageOperands(6);
+        return value();
+
+      case spv::OpImageWrite:
+        ids(1, 4);
+        imageOperands(4);
+        return true;
+
+      case spv::OpBranch:
+      case spv::OpSelectionMerge:
+      case spv::OpReturnValue:
+      case spv::OpEmitStreamVertex:
+      case spv::OpEndStreamPrimitive:
+        ids(1, 2);
+        return true;
+
+      case spv::OpLoopMerge:
+      case spv::OpMemoryBarrier:
+        ids(1, 3);
+        return true;
+
+      case spv::OpBranchConditional:
+      case spv::OpControlBarrier:
+        ids(1, 4);
+        return true;
+
+      case spv::OpSwitch:
+        ids(1, 3);
+
+        for (uint32_t i = 4; i < length; i += 2)
+          fn(words[i]);
+        return true;
+
+      case spv::OpFunctionCall:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpPtrAccessChain:
+      case spv::OpCompositeConstruct:
+      case spv::OpCopyObject:
+      case spv::OpSelect:
+      case spv::OpPhi:
+      case spv::OpSampledImage:
+      case spv::OpImage:
+      case spv::OpImageQuerySize:
+      case spv::OpImageQuerySizeLod:
+      case spv::OpImageQueryLevels:
+      case spv::OpImageQueryLod:
+      case spv::OpImageQuerySamples:
+      case spv::OpImageTexelPointer:
+      case spv::OpImageSparseTexelsResident:
+      case spv::OpVectorExtractDynamic:
+      case spv::OpVectorInsertDynamic:
+      case spv::OpTranspose:
+      case spv::OpConvertFToU:
+      case spv::OpConvertFToS:
+      case spv::OpConvertSToF:
+      case spv::OpConvertUToF:
+      case spv::OpUConvert:
+      case spv::OpSConvert:
+      case spv::OpFConvert:
+      case spv::OpQuantizeToF16:
+      case spv::OpBitcast:
+      case spv::OpSNegate:
+      case spv::OpFNegate:
+      case spv::OpIAdd:
+      case spv::OpFAdd:
+      case spv::OpISub:
+      case spv::OpFSub:
+      case spv::OpIMul:
+      case spv::OpFMul:
+      case spv::OpUDiv:
+      case spv::OpSDiv:
+      case spv::OpFDiv:
+      case spv::OpUMod:
+      case spv::OpSRem:
+      case spv::OpSMod:
+      case spv::OpFRem:
+      case spv::OpFMod:
+      case spv::OpVectorTimesScalar:
+      case spv::OpMatrixTimesScalar:
+      case spv::OpVectorTimesMatrix:
+      case spv::OpMatrixTimesVector:
+      case spv::OpMatrixTimesMatrix:
+      case spv::OpOuterProduct:
+      case spv::OpDot:
+      case spv::OpIAddCarry:
+      case spv::OpISubBorrow:
+      case spv::OpUMulExtended:
+      case spv::OpSMulExtended:
+      case spv::OpAny:
+      case spv::OpAll:
+      case spv::OpIsNan:
+      case spv::OpIsInf:
+      case spv::OpLogicalEqual:
+      case spv::OpLogicalNotEqual:
+      case spv::OpLogicalOr:
+      case spv::OpLogicalAnd:
+      case spv::OpLogicalNot:
+      case spv::OpIEqual:
+      case spv::OpINotEqual:
+      case spv::OpUGreaterThan:
+      case spv::OpSGreaterThan:
+      case spv::OpUGreaterThanEqual:
+      case spv::OpSGreaterThanEqual:
+      case spv::OpULessThan:
+      case spv::OpSLessThan:
+      case spv::OpULessThanEqual:
+      case spv::OpSLessThanEqual:
+      case spv::OpFOrdEqual:
+      case spv::OpFUnordEqual:
+      case spv::OpFOrdNotEqual:
+      case spv::OpFUnordNotEqual:
+      case spv::OpFOrdLessThan:
+      case spv::OpFUnordLessThan:
+      case spv::OpFOrdGreaterThan:
+      case spv::OpFUnordGreaterThan:
+      case spv::OpFOrdLessThanEqual:
+      case spv::OpFUnordLessThanEqual:
+      case spv::OpFOrdGreaterThanEqual:
+      case spv::OpFUnordGreaterThanEqual:
+      case spv::OpShiftRightLogical:
+      case spv::OpShiftRightArithmetic:
+      case spv::OpShiftLeftLogical:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpBitwiseAnd:
+      case spv::OpNot:
+      case spv::OpBitFieldInsert:
+      case spv::OpBitFieldSExtract:
+      case spv::OpBitFieldUExtract:
+      case spv::OpBitReverse:
+      case spv::OpBitCount:
+      case spv::OpDPdx:
+      case spv::OpDPdy:
+      case spv::OpFwidth:
+      case spv::OpDPdxFine:
+      case spv::OpDPdyFine:
+      case spv::OpFwidthFine:
+      case spv::OpDPdxCoarse:
+      case spv::OpDPdyCoarse:
+      case spv::OpFwidthCoarse:
+      case spv::OpAtomicLoad:
+      case spv::OpAtomicExchange:
+      case spv::OpAtomicCompareExchange:
+      case spv::OpAtomicIIncrement:
+      case spv::OpAtomicIDecrement:
+      case spv::OpAtomicIAdd:
+      case spv::OpAtomicISub:
+      case spv::OpAtomicSMin:
+      case spv::OpAtomicUMin:
+      case spv::OpAtomicSMax:
+      case spv::OpAtomicUMax:
+      case spv::OpAtomicAnd:
+      case spv::OpAtomicOr:
+      case spv::OpAtomicXor:
+      case spv::OpGroupNonUniformElect:
+      case spv::OpGroupNonUniformAll:
+      case spv::OpGroupNonUniformAny:
+      case spv::OpGroupNonUniformAllEqual:
+      case spv::OpGroupNonUniformBroadcast:
+      case spv::OpGroupNonUniformBroadcastFirst:
+      case spv::OpGroupNonUniformBallot:
+      case spv::OpGroupNonUniformInverseBallot:
+      case spv::OpGroupNonUniformBallotBitExtract:
+      case spv::OpGroupNonUniformBallotFindLSB:
+      case spv::OpGroupNonUniformBallotFindMSB:
+      case spv::OpGroupNonUniformShuffle:
+      case spv::OpGroupNonUniformShuffleXor:
+      case spv::OpGroupNonUniformShuffleUp:
+      case spv::OpGroupNonUniformShuffleDown:
+      case spv::OpGroupNonUniformQuadBroadcast:
+      case spv::OpGroupNonUniformQuadSwap:
+      case spv::OpIsHelperInvocationEXT:
+        ids(3, length);
+        return value();
+
+      default:
+        return false;
+    }
+  }
+
+}
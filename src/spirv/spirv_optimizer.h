@@ -0,0 +1,148 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "spirv_code_buffer.h"
+
+namespace dxvk {
+
+  /**
+   * \brief SPIR-V optimizer
+   *
+   * Performs a small set of cheap optimizations on code
+   * generated by the shader compilers, in order to reduce
+   * the amount of work drivers need to do when compiling
+   * pipelines:
+   *
+   * - Constant folding of 32-bit integer and boolean
+   *   arithmetic, as well as selects and extracts with
+   *   constant operands, and trivial identities.
+   * - Forwarding of loads and stores within a block for
+   *   private and function variables that are only ever
+   *   accessed as a whole, such as the \c r# registers.
+   * - Removal of variables that are never read, and of
+   *   unused instructions without side effects.
+   *
+   * Modules containing instructions that the optimizer
+   * does not know the operand layout of are returned
+   * unchanged.
+   */
+  class SpirvOptimizer {
+
+  public:
+
+    SpirvOptimizer(SpirvCodeBuffer&& code);
+
+    ~SpirvOptimizer();
+
+    /**
+     * \brief Runs all optimization passes
+     * \returns Optimized code
+     */
+    SpirvCodeBuffer optimize();
+
+  private:
+
+    struct Instruction {
+      uint32_t offset;
+      uint32_t length;
+      uint32_t resultId;
+      bool     removed;
+    };
+
+    struct Constant {
+      uint32_t typeId;
+      uint32_t value;
+    };
+
+    enum class TypeClass : uint32_t {
+      Other,
+      Bool,
+      Int32,
+      Float32,
+    };
+
+    SpirvCodeBuffer                         m_original;
+
+    std::vector<uint32_t>                   m_code;
+    std::vector<Instruction>                m_ins;
+    std::vector<uint32_t>                   m_newConstants;
+
+    size_t                                  m_functionIndex = 0;
+    uint32_t                                m_idBound       = 0;
+    uint32_t                                m_glslId        = 0;
+
+    std::vector<uint32_t>                   m_replace;
+    std::vector<uint32_t>                   m_defs;
+    std::vector<uint32_t>                   m_idTypes;
+    std::vector<bool>                       m_pinned;
+
+    std::unordered_map<uint32_t, TypeClass> m_types;
+    std::unordered_map<uint32_t, Constant>  m_constants;
+    std::unordered_map<uint64_t, uint32_t>  m_constantIds;
+
+    bool parseModule();
+
+    void foldConstants();
+
+    void forwardVariables();
+
+    void eliminateDeadCode();
+
+    SpirvCodeBuffer buildModule();
+
+    bool tryFold(
+            Instruction&              ins);
+
+    uint32_t resolve(
+            uint32_t                  id) const;
+
+    void resolveOperands(
+            Instruction&              ins);
+
+    void replaceResult(
+            Instruction&              ins,
+            uint32_t                  id);
+
+    const Constant* findConstant(
+            uint32_t                  id,
+            TypeClass                 type) const;
+
+    uint32_t getConstantId(
+            uint32_t                  typeId,
+            uint32_t                  value);
+
+    TypeClass getTypeClass(
+            uint32_t                  typeId) const;
+
+    uint32_t allocId();
+
+    spv::Op getOpCode(
+      const Instruction&              ins) const {
+      return spv::Op(m_code[ins.offset] & spv::OpCodeMask);
+    }
+
+    uint32_t& getArg(
+      const Instruction&              ins,
+            uint32_t                  idx) {
+      return m_code[ins.offset + idx];
+    }
+
+    bool isRemovable(
+      const Instruction&              ins) const;
+
+    bool isRemoved(
+            uint32_t                  id) const;
+
+    template<typename Fn>
+    static bool visitOperands(
+            uint32_t*                 words,
+            uint32_t                  length,
+            uint32_t&                 typeId,
+            uint32_t&                 resultId,
+            Fn&&                      fn);
+
+  };
+
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstring>
+
+#include "spirv_patch_list.h"
+
+namespace dxvk {
+
+  SpirvPatchList::SpirvPatchList(const SpirvCodeBuffer& code) {
+    constexpr size_t BoundIdsOffset = 3;
+
+    if (code.dwords() > BoundIdsOffset)
+      m_idBound = code.data()[BoundIdsOffset];
+  }
+
+
+  SpirvPatchList::~SpirvPatchList() {
+
+  }
+
+
+  void SpirvPatchList::setWord(size_t offset, uint32_t word) {
+    m_wordPatches.push_back({ offset, word });
+  }
+
+
+  void SpirvPatchList::beginInsertion(size_t offset) {
+    m_codePatches.push_back({ offset, 0, m_words.size(), 0 });
+  }
+
+
+  void SpirvPatchList::erase(size_t offset, size_t count) {
+    m_codePatches.push_back({ offset, count, m_words.size(), 0 });
+  }
+
+
+  void SpirvPatchList::putWord(uint32_t word) {
+    m_words.push_back(word);
+    m_codePatches.back().wordCount += 1;
+  }
+
+
+  void SpirvPatchList::putIns(spv::Op opCode, uint16_t wordCount) {
+    this->putWord(
+        (uint32_t(opCode)    <<  0)
+      | (uint32_t(wordCount) << 16));
+  }
+
+
+  SpirvCodeBuffer SpirvPatchList::apply(SpirvCodeBuffer&& code) {
+    constexpr size_t BoundIdsOffset = 3;
+
+    // Later replacements of the same word take precedence,
+    // so make sure to preserve the order of patches here.
+    std::stable_sort(m_wordPatches.begin(), m_wordPatches.end(),
+      [] (const WordPatch& a, const WordPatch& b) {
+        return a.offset < b.offset;
+      });
+
+    if (m_codePatches.empty()) {
+      uint32_t* data = code.data();
+
+      for (const auto& patch : m_wordPatches)
+        data[patch.offset] = patch.word;
+
+      if (code.dwords() > BoundIdsOffset)
+        data[BoundIdsOffset] = m_idBound;
+
+      return std::move(code);
+    }
+
+    std::stable_sort(m_codePatches.begin(), m_codePatches.end(),
+      [] (const CodePatch& a, const CodePatch& b) {
+        return a.offset < b.offset;
+      });
+
+    // Compute size of the patched code up front. Erased
+    // ranges may overlap, so we need to be careful here.
+    size_t srcOffset = 0;
+    size_t dstOffset = 0;
+
+    for (const auto& patch : m_codePatches) {
+      dstOffset += std::max(patch.offset, srcOffset) - srcOffset + patch.wordCount;
+      srcOffset  = std::max(patch.offset + patch.eraseCount, srcOffset);
+    }
+
+    size_t srcSize = code.dwords();
+    size_t dstSize = dstOffset + srcSize - std::min(srcOffset, srcSize);
+
+    SpirvCodeBuffer result(dstSize);
+
+    const uint32_t* src = code.data();
+          uint32_t* dst = result.data();
+
+    auto wordPatch = m_wordPatches.begin();
+
+    srcOffset = 0;
+    dstOffset = 0;
+
+    auto copyCode = [&] (size_t srcEnd) {
+      srcEnd = std::min(srcEnd, srcSize);
+
+      if (srcOffset >= srcEnd)
+        return;
+
+      std::memcpy(&dst[dstOffset], &src[srcOffset],
+        sizeof(uint32_t) * (srcEnd - srcOffset));
+
+      // Skip replacements for words that have been erased
+      while (wordPatch != m_wordPatches.end() && wordPatch->offset < srcEnd) {
+        if (wordPatch->offset >= srcOffset)
+          dst[dstOffset + wordPatch->offset - srcOffset] = wordPatch->word;
+
+        wordPatch++;
+      }
+
+      dstOffset += srcEnd - srcOffset;
+      srcOffset  = srcEnd;
+    };
+
+    for (const auto& patch : m_codePatches) {
+      copyCode(patch.offset);
+
+      if (patch.wordCount) {
+        std::memcpy(&dst[dstOffset], &m_words[patch.wordIndex],
+          sizeof(uint32_t) * patch.wordCount);
+        dstOffset += patch.wordCount;
+      }
+
+      srcOffset = std::max(patch.offset + patch.eraseCount, srcOffset);
+    }
+
+    copyCode(srcSize);
+
+    if (dstSize > BoundIdsOffset)
+      dst[BoundIdsOffset] = m_idBound;
+
+    return result;
+  }
+
+}
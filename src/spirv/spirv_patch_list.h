@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include "spirv_code_buffer.h"
+
+namespace dxvk {
+
+  /**
+   * \brief SPIR-V patch list
+   *
+   * Collects word replacements, insertions and erasures
+   * for an existing SPIR-V module, and applies all of them
+   * in a single linear copy. All offsets refer to the code
+   * as it was before any patches were applied, so that
+   * offsets computed up front remain valid.
+   */
+  class SpirvPatchList {
+
+  public:
+
+    SpirvPatchList(const SpirvCodeBuffer& code);
+
+    ~SpirvPatchList();
+
+    /**
+     * \brief Allocates a new ID
+     *
+     * The ID bound is written back to the module
+     * header when the patches are applied.
+     * \returns Newly allocated ID
+     */
+    uint32_t allocId() {
+      return m_idBound++;
+    }
+
+    /**
+     * \brief Replaces a single word
+     *
+     * Replacements of words that are erased by
+     * another patch will be ignored.
+     * \param [in] offset Word offset
+     * \param [in] word New value
+     */
+    void setWord(size_t offset, uint32_t word);
+
+    /**
+     * \brief Begins inserting code at the given offset
+     *
+     * Subsequent calls to \ref putIns and \ref putWord
+     * will add words to this insertion. Insertions at
+     * the same offset are applied in the order in which
+     * they were recorded.
+     * \param [in] offset Word offset
+     */
+    void beginInsertion(size_t offset);
+
+    /**
+     * \brief Erases words
+     *
+     * \param [in] offset Word offset
+     * \param [in] count Number of words to erase
+     */
+    void erase(size_t offset, size_t count);
+
+    /**
+     * \brief Inserts a word
+     * \param [in] word The word
+     */
+    void putWord(uint32_t word);
+
+    /**
+     * \brief Inserts an instruction token
+     *
+     * \param [in] opCode Operation code
+     * \param [in] wordCount Instruction length
+     */
+    void putIns(spv::Op opCode, uint16_t wordCount);
+
+    /**
+     * \brief Applies all patches
+     *
+     * Patches the code in place if no words are inserted
+     * or erased, and creates a new code buffer otherwise.
+     * \param [in] code Code that the patches were built for
+     * \returns Patched code
+     */
+    SpirvCodeBuffer apply(SpirvCodeBuffer&& code);
+
+  private:
+
+    struct WordPatch {
+      size_t    offset;
+      uint32_t  word;
+    };
+
+    struct CodePatch {
+      size_t    offset;
+      size_t    eraseCount;
+      size_t    wordIndex;
+      size_t    wordCount;
+    };
+
+    uint32_t                m_idBound = 0;
+
+    std::vector<WordPatch>  m_wordPatches;
+    std::vector<CodePatch>  m_codePatches;
+    std::vector<uint32_t>   m_words;
+
+  };
+
+}
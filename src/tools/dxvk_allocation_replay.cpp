@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_allocation_replay.h"
+#include "../dxvk/dxvk_options.h"
+
+#include "../util/config/config.h"
+
+// Allocation trace replay
+//
+// Replays an allocation trace recorded via DXVK_ALLOCATION_TRACE
+// against the memory allocator, using a fake Vulkan device with the
+// memory types and heaps of the device that recorded the trace. This
+// allows allocator changes to be evaluated on real workloads without
+// running the game.
+//
+// Usage: dxvk-allocation-replay [options] <trace>
+//   --defrag <mode>   Memory defragmentation, auto|true|false
+//
+// Prints replay statistics when all records are replayed.
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-allocation-replay.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct ReplayParameters {
+    std::string trace;
+    Tristate    defrag = Tristate::Auto;
+  };
+
+
+  bool parseArgs(int argc, char** argv, ReplayParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+
+      if (arg.size() < 2 || arg[0] != '-' || arg[1] != '-') {
+        if (!params.trace.empty())
+          return false;
+
+        params.trace = arg;
+        continue;
+      }
+
+      if (i + 1 >= argc)
+        return false;
+
+      const char* value = argv[++i];
+
+      if (arg == "--defrag") {
+        if (!std::strcmp(value, "auto"))
+          params.defrag = Tristate::Auto;
+        else if (!std::strcmp(value, "true"))
+          params.defrag = Tristate::True;
+        else if (!std::strcmp(value, "false"))
+          params.defrag = Tristate::False;
+        else
+          return false;
+      } else {
+        return false;
+      }
+    }
+
+    return !params.trace.empty();
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  ReplayParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--defrag <mode>] <trace>\n", argv[0]);
+    return 1;
+  }
+
+  // Read the entire trace up front, in case the replay
+  // itself is recording a trace to the same file.
+  DxvkAllocationTraceHeader header;
+  std::vector<DxvkAllocationTraceRecord> records;
+
+  if (!DxvkAllocationTrace::read(params.trace, header, records)) {
+    std::fprintf(stderr, "Failed to read %s\n", params.trace.c_str());
+    return 1;
+  }
+
+  DxvkOptions options = DxvkOptions(Config());
+  options.enableMemoryDefrag = params.defrag;
+
+  DxvkAllocationReplay replay(header, options);
+
+  for (const auto& record : records)
+    replay.execute(record);
+
+  DxvkAllocationReplayStats stats = replay.getStats();
+
+  std::printf("Events:           %llu\n", (unsigned long long)stats.eventCount);
+  std::printf("Submissions:      %llu\n", (unsigned long long)stats.submissionCount);
+  std::printf("Allocations:      %llu\n", (unsigned long long)stats.allocationCount);
+  std::printf("Failed (trace):   %llu\n", (unsigned long long)stats.traceFailureCount);
+  std::printf("Failed (replay):  %llu\n", (unsigned long long)stats.replayFailureCount);
+  std::printf("Memory objects:   %llu allocated, %llu freed\n",
+    (unsigned long long)stats.memoryObjectsAllocated, (unsigned long long)stats.memoryObjectsFreed);
+  std::printf("Relocated:        %llu resources, %llu MB\n",
+    (unsigned long long)stats.relocatedCount, (unsigned long long)(stats.relocatedBytes >> 20));
+  std::printf("Cache requests:   %llu, %llu missed\n",
+    (unsigned long long)stats.cacheRequestCount, (unsigned long long)stats.cacheMissCount);
+  std::printf("Peak committed:   %llu MB\n", (unsigned long long)(stats.peakCommitted >> 20));
+  std::printf("Peak used:        %llu MB\n", (unsigned long long)(stats.peakUsed >> 20));
+  std::printf("Fragmentation:    %.1f%% at peak, %.1f%% average\n",
+    stats.peakFragmentation * 100.0, stats.averageFragmentation * 100.0);
+  std::printf("Allocator time:   %lld us\n",
+    (long long)std::chrono::duration_cast<std::chrono::microseconds>(stats.allocatorTime).count());
+  return 0;
+}
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dxvk_legacy_barrier_tracker.h"
+
+#include "../util/util_time.h"
+
+// Barrier tracker benchmark
+//
+// Replays synthetic sequences of compute dispatches with D3D11-style
+// resource bindings against DxvkBarrierTracker. Before each dispatch,
+// every bound resource is checked for hazards the way DxvkContext does
+// it, and if any are found, a barrier is emitted and the tracker gets
+// cleared. All accesses of the dispatch are then added to the tracker.
+//
+// The workloads model patterns that are common with UAV-heavy games:
+//  - buffers: random whole-buffer SRV reads and UAV writes
+//  - slices: disjoint slices of a few large buffers, e.g. particle
+//    systems, which exceeds the number of inline ranges per resource
+//  - mips: mip chain generation, reading one mip and writing the next
+//  - atomics: order-invariant UAV atomics that do not need barriers
+//  - clears: full-resource UAV clears interleaved with partial writes
+//
+// The same sequences are run against the previous tracker, which used
+// a fixed-size hash table of red-black trees, and both must emit the
+// same number of barriers.
+//
+// Usage: dxvk-bench-barrier-tracker [--dispatches <n>] [--runs <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-barrier-tracker.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  constexpr uint64_t MB = 1ull << 20;
+
+
+  struct BenchParameters {
+    uint32_t dispatches = 1000000u;
+    uint32_t runs       = 3u;
+  };
+
+
+  struct Access {
+    uint64_t      resource;
+    uint64_t      rangeStart;
+    uint64_t      rangeEnd;
+    DxvkAccessOp  accessOp;
+    bool          write;
+  };
+
+
+  struct Workload {
+    const char*         name;
+    std::vector<Access> accesses;
+    std::vector<uint32_t> dispatches;
+  };
+
+
+  struct BenchResult {
+    double    nsPerDispatch;
+    uint64_t  barriers;
+    uint64_t  operations;
+  };
+
+
+  class WorkloadBuilder {
+
+  public:
+
+    WorkloadBuilder(const char* name) {
+      m_workload.name = name;
+    }
+
+    void read(uint64_t resource, uint64_t start, uint64_t end) {
+      m_workload.accesses.push_back({ resource, start, end, DxvkAccessOp::None, false });
+    }
+
+    void write(uint64_t resource, uint64_t start, uint64_t end, DxvkAccessOp op = DxvkAccessOp::None) {
+      m_workload.accesses.push_back({ resource, start, end, op, true });
+    }
+
+    void dispatch() {
+      m_workload.dispatches.push_back(uint32_t(m_workload.accesses.size()));
+    }
+
+    Workload finish() {
+      return std::move(m_workload);
+    }
+
+  private:
+
+    Workload m_workload;
+
+  };
+
+
+  uint64_t imageAddress(uint32_t layers, uint32_t mip, uint32_t layer) {
+    // Matches DxvkImage::getTrackingAddress
+    return uint64_t((layers * mip) + layer) << 48u;
+  }
+
+
+  Workload buildBuffers(uint32_t count, std::mt19937& rng) {
+    WorkloadBuilder builder("buffers");
+
+    std::vector<uint64_t> sizes(512u);
+
+    for (auto& size : sizes)
+      size = (64u << 10u) << (rng() % 9u);
+
+    for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t j = 0; j < 4u; j++) {
+        uint32_t buffer = rng() % sizes.size();
+        builder.read(1u + buffer, 0u, sizes[buffer] - 1u);
+      }
+
+      for (uint32_t j = 0; j < 2u; j++) {
+        uint32_t buffer = rng() % sizes.size();
+        builder.write(1u + buffer, 0u, sizes[buffer] - 1u);
+      }
+
+      builder.dispatch();
+    }
+
+    return builder.finish();
+  }
+
+
+  Workload buildSlices(uint32_t count, std::mt19937& rng) {
+    WorkloadBuilder builder("slices");
+
+    constexpr uint32_t BufferCount = 8u;
+    constexpr uint64_t SliceSize = 256u << 10u;
+    constexpr uint32_t SliceCount = uint32_t((64u * MB) / SliceSize);
+
+    std::array<uint32_t, BufferCount> nextSlice = { };
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t buffer = rng() % BufferCount;
+      uint32_t slice = nextSlice[buffer]++ % SliceCount;
+
+      for (uint32_t j = 0; j < 2u; j++) {
+        uint32_t src = rng() % BufferCount;
+        uint32_t srcSlice = rng() % SliceCount;
+        builder.read(1u + src, srcSlice * SliceSize, (srcSlice + 1u) * SliceSize - 1u);
+      }
+
+      builder.write(1u + buffer, slice * SliceSize, (slice + 1u) * SliceSize - 1u);
+      builder.dispatch();
+    }
+
+    return builder.finish();
+  }
+
+
+  Workload buildMips(uint32_t count, std::mt19937& rng) {
+    WorkloadBuilder builder("mips");
+
+    constexpr uint32_t ImageCount = 16u;
+    constexpr uint32_t MipCount = 12u;
+    constexpr uint32_t LayerCount = 6u;
+
+    uint32_t image = 0u;
+    uint32_t mip = 1u;
+
+    for (uint32_t i = 0; i < count; i++) {
+      // Downsample all layers of one mip into the next
+      builder.read(1u + image,
+        imageAddress(LayerCount, mip - 1u, 0u),
+        imageAddress(LayerCount, mip, 0u) - 1u);
+      builder.write(1u + image,
+        imageAddress(LayerCount, mip, 0u),
+        imageAddress(LayerCount, mip + 1u, 0u) - 1u);
+
+      // Plus some unrelated constant data
+      builder.read(1000u + rng() % 64u, 0u, 255u);
+      builder.dispatch();
+
+      if (++mip == MipCount) {
+        image = (image + 1u) % ImageCount;
+        mip = 1u;
+      }
+    }
+
+    return builder.finish();
+  }
+
+
+  Workload buildAtomics(uint32_t count, std::mt19937& rng) {
+    WorkloadBuilder builder("atomics");
+
+    constexpr uint32_t BufferCount = 32u;
+
+    for (uint32_t i = 0; i < count; i++) {
+      // Counters and histograms accumulated over many dispatches
+      uint32_t buffer = rng() % BufferCount;
+      builder.write(1u + buffer, 0u, 4095u, DxvkAccessOp(DxvkAccessOp::Add));
+
+      for (uint32_t j = 0; j < 3u; j++)
+        builder.read(100u + rng() % 256u, 0u, MB - 1u);
+
+      builder.dispatch();
+    }
+
+    return builder.finish();
+  }
+
+
+  Workload buildClears(uint32_t count, std::mt19937& rng) {
+    WorkloadBuilder builder("clears");
+
+    constexpr uint32_t BufferCount = 64u;
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t buffer = rng() % BufferCount;
+
+      if (!(i % 4u)) {
+        // Full-resource clears cover the entire address space
+        builder.write(1u + buffer, 0u, ~uint64_t(0u));
+      } else {
+        uint64_t offset = (rng() % 64u) * 4096u;
+        builder.write(1u + buffer, offset, offset + 4095u);
+        builder.read(1u + (buffer + 1u) % BufferCount, 0u, 16u * MB - 1u);
+      }
+
+      builder.dispatch();
+    }
+
+    return builder.finish();
+  }
+
+
+  template<typename Tracker>
+  BenchResult runWorkload(const Workload& workload) {
+    Tracker tracker;
+
+    BenchResult result = { };
+
+    auto t0 = high_resolution_clock::now();
+
+    uint32_t first = 0u;
+
+    for (uint32_t last : workload.dispatches) {
+      bool hazard = false;
+
+      for (uint32_t i = first; i < last; i++) {
+        const auto& access = workload.accesses[i];
+
+        DxvkAddressRange range;
+        range.resource = bit::uint48_t(access.resource);
+        range.accessOp = access.accessOp;
+        range.rangeStart = access.rangeStart;
+        range.rangeEnd = access.rangeEnd;
+
+        hazard |= tracker.findRange(range, DxvkAccess::Write);
+        result.operations += 1u;
+
+        if (access.write) {
+          hazard |= tracker.findRange(range, DxvkAccess::Read);
+          result.operations += 1u;
+        }
+      }
+
+      if (hazard) {
+        tracker.clear();
+        result.barriers += 1u;
+      }
+
+      for (uint32_t i = first; i < last; i++) {
+        const auto& access = workload.accesses[i];
+
+        DxvkAddressRange range;
+        range.resource = bit::uint48_t(access.resource);
+        range.accessOp = access.accessOp;
+        range.rangeStart = access.rangeStart;
+        range.rangeEnd = access.rangeEnd;
+
+        tracker.insertRange(range, access.write ? DxvkAccess::Write : DxvkAccess::Read);
+        result.operations += 1u;
+      }
+
+      first = last;
+    }
+
+    auto t1 = high_resolution_clock::now();
+
+    result.nsPerDispatch = std::chrono::duration<double, std::nano>(t1 - t0).count()
+                         / double(workload.dispatches.size());
+    return result;
+  }
+
+
+  bool parseArgs(int argc, char** argv, BenchParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--dispatches")
+        params.dispatches = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--runs")
+        params.runs = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.dispatches > 0u && params.runs > 0u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--dispatches <n>] [--runs <n>]\n", argv[0]);
+    return 1;
+  }
+
+  std::mt19937 rng(1u);
+
+  std::vector<Workload> workloads;
+  workloads.push_back(buildBuffers(params.dispatches, rng));
+  workloads.push_back(buildSlices(params.dispatches, rng));
+  workloads.push_back(buildMips(params.dispatches, rng));
+  workloads.push_back(buildAtomics(params.dispatches, rng));
+  workloads.push_back(buildClears(params.dispatches, rng));
+
+  std::printf("%u dispatches per workload, times in ns per dispatch\n", params.dispatches);
+  std::printf("%-10s %10s %10s %10s %12s\n", "Workload", "Current", "Previous", "Barriers", "Tracker ops");
+
+  uint32_t mismatches = 0u;
+
+  for (const auto& workload : workloads) {
+    BenchResult current = runWorkload<DxvkBarrierTracker>(workload);
+    BenchResult legacy = runWorkload<DxvkLegacyBarrierTracker>(workload);
+
+    // Alternate between both trackers and keep the best run of
+    // each, so that neither benefits from running first or last
+    for (uint32_t i = 1; i < params.runs; i++) {
+      current.nsPerDispatch = std::min(current.nsPerDispatch,
+        runWorkload<DxvkBarrierTracker>(workload).nsPerDispatch);
+      legacy.nsPerDispatch = std::min(legacy.nsPerDispatch,
+        runWorkload<DxvkLegacyBarrierTracker>(workload).nsPerDispatch);
+    }
+
+    std::printf("%-10s %10.1f %10.1f %10llu %12llu\n", workload.name,
+      current.nsPerDispatch, legacy.nsPerDispatch,
+      (unsigned long long)current.barriers,
+      (unsigned long long)current.operations);
+
+    if (current.barriers != legacy.barriers) {
+      std::fprintf(stderr, "%s: %llu barriers, previous tracker emitted %llu\n", workload.name,
+        (unsigned long long)current.barriers, (unsigned long long)legacy.barriers);
+      mismatches += 1u;
+    }
+  }
+
+  return mismatches ? 1 : 0;
+}
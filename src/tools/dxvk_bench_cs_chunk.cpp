@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../dxvk/dxvk_cs.h"
+
+#include "../util/util_time.h"
+
+// CS chunk benchmark
+//
+// Records commands into CS chunks and executes them with a null context,
+// which measures the cost of recording, dispatching and destroying CS
+// commands without any of the work that the commands would normally do.
+// Every command only updates a counter.
+//
+// Each command mix is run once with single-use chunks, which destroy
+// commands as they execute them, and once with command lists of a few
+// thousand commands that are recorded once and then executed repeatedly,
+// like deferred context command lists. Single-use times include recording
+// since the two are interleaved. The best of several runs is used.
+//
+// For comparison, the same benchmark is run on a copy of the previous
+// chunk implementation, which dispatched commands through a virtual
+// function and stored a pointer to the next command in each command.
+//
+// Usage: dxvk-bench-cs-chunk [--commands <millions>] [--replays <n>] [--runs <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-cs-chunk.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  /// Number of commands per replayed command list
+  constexpr uint32_t ListSize = 4096u;
+
+
+  struct BenchParameters {
+    uint32_t commands = 10u;
+    uint32_t replays  = 16u;
+    uint32_t runs     = 3u;
+  };
+
+
+  enum class CommandMix : uint32_t {
+    /// Commands capturing plain values only, e.g. state updates
+    Trivial,
+    /// Every other command holds a reference to a resource
+    Resources,
+    /// Every fourth command stores a variable amount of data
+    Data,
+  };
+
+
+  struct BenchResult {
+    double recordNs;
+    double executeNs;
+  };
+
+
+  /**
+   * \brief Reference-counted object captured by commands
+   */
+  class BenchResource : public RcObject {
+
+  public:
+
+    uint64_t value = 1u;
+
+  };
+
+
+  struct BenchData {
+    uint32_t a, b, c, d;
+  };
+
+
+  uint64_t g_sink = 0u;
+
+
+  /**
+   * \brief Previous CS command
+   *
+   * Virtual dispatch, and an explicit next pointer.
+   */
+  class LegacyCsCmd {
+
+  public:
+
+    virtual ~LegacyCsCmd() { }
+
+    LegacyCsCmd* next() const {
+      return m_next;
+    }
+
+    LegacyCsCmd** chain() {
+      return &m_next;
+    }
+
+    virtual void exec(DxvkContext* ctx) = 0;
+
+  private:
+
+    LegacyCsCmd* m_next = nullptr;
+
+  };
+
+
+  template<typename T>
+  class LegacyCsTypedCmd : public LegacyCsCmd {
+
+  public:
+
+    LegacyCsTypedCmd(T&& cmd)
+    : m_command(std::move(cmd)) { }
+
+    void exec(DxvkContext* ctx) {
+      m_command(ctx);
+    }
+
+  private:
+
+    T m_command;
+
+  };
+
+
+  class LegacyCsDataBlock {
+    friend class LegacyCsChunk;
+  public:
+
+    size_t count() const {
+      return m_structCount;
+    }
+
+    void* first() {
+      return reinterpret_cast<char*>(this) + m_dataOffset;
+    }
+
+    void* at(uint32_t idx) {
+      return reinterpret_cast<char*>(this) + m_dataOffset + idx * uint32_t(m_structSize);
+    }
+
+  private:
+
+    uint32_t m_dataOffset  = 0u;
+    uint16_t m_structSize  = 0u;
+    uint16_t m_structCount = 0u;
+
+  };
+
+
+  template<typename T, typename M>
+  class LegacyCsDataCmd : public LegacyCsCmd {
+
+  public:
+
+    LegacyCsDataCmd(T&& cmd)
+    : m_command(std::move(cmd)) { }
+
+    ~LegacyCsDataCmd() {
+      auto data = reinterpret_cast<M*>(m_data.first());
+
+      for (size_t i = 0; i < m_data.count(); i++)
+        data[i].~M();
+    }
+
+    void exec(DxvkContext* ctx) {
+      m_command(ctx, reinterpret_cast<M*>(m_data.first()), m_data.count());
+    }
+
+    LegacyCsDataBlock* data() {
+      return &m_data;
+    }
+
+  private:
+
+    alignas(std::max(alignof(T), alignof(M)))
+    T                 m_command;
+    LegacyCsDataBlock m_data;
+
+  };
+
+
+  /**
+   * \brief Previous CS chunk
+   *
+   * Only implements what the benchmark needs.
+   */
+  class LegacyCsChunk {
+
+  public:
+
+    LegacyCsChunk(uint32_t sizeClass)
+    : m_capacity(DxvkCsChunkSizes[sizeClass]),
+      m_data(static_cast<char*>(::operator new(m_capacity, std::align_val_t(CACHE_LINE_SIZE)))) { }
+
+    ~LegacyCsChunk() {
+      reset();
+
+      ::operator delete(m_data, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    void init(DxvkCsChunkFlags flags) {
+      m_flags = flags;
+    }
+
+    template<typename T>
+    bool push(T& command) {
+      using FuncType = LegacyCsTypedCmd<T>;
+      void* ptr = alloc<FuncType>(0u);
+
+      if (unlikely(!ptr))
+        return false;
+
+      append(new (ptr) FuncType(std::move(command)));
+      return true;
+    }
+
+    template<typename M, typename T>
+    LegacyCsDataBlock* pushCmd(T& command, size_t count) {
+      size_t dataSize = count * sizeof(M);
+
+      using FuncType = LegacyCsDataCmd<T, M>;
+      void* ptr = alloc<FuncType>(dataSize);
+
+      if (unlikely(!ptr))
+        return nullptr;
+
+      auto next = new (ptr) FuncType(std::move(command));
+      append(next);
+
+      auto block = next->data();
+      block->m_dataOffset = reinterpret_cast<uintptr_t>(&m_data[m_commandOffset - dataSize])
+                          - reinterpret_cast<uintptr_t>(block);
+      block->m_structSize = sizeof(M);
+      block->m_structCount = count;
+      return block;
+    }
+
+    void executeAll(DxvkContext* ctx) {
+      auto cmd = m_head;
+
+      if (m_flags.test(DxvkCsChunkFlag::SingleUse)) {
+        m_commandOffset = 0;
+
+        while (cmd != nullptr) {
+          auto next = cmd->next();
+          cmd->exec(ctx);
+          cmd->~LegacyCsCmd();
+          cmd = next;
+        }
+
+        m_head = nullptr;
+        m_next = &m_head;
+      } else {
+        while (cmd != nullptr) {
+          cmd->exec(ctx);
+          cmd = cmd->next();
+        }
+      }
+    }
+
+    void reset() {
+      auto cmd = m_head;
+
+      while (cmd != nullptr) {
+        auto next = cmd->next();
+        cmd->~LegacyCsCmd();
+        cmd = next;
+      }
+
+      m_head = nullptr;
+      m_next = &m_head;
+
+      m_commandOffset = 0;
+    }
+
+  private:
+
+    size_t m_commandOffset = 0;
+    size_t m_capacity      = 0;
+
+    LegacyCsCmd*  m_head = nullptr;
+    LegacyCsCmd** m_next = &m_head;
+
+    DxvkCsChunkFlags m_flags;
+
+    char* m_data = nullptr;
+
+    template<typename T>
+    void* alloc(size_t extra) {
+      if (alignof(T) > alignof(LegacyCsCmd))
+        m_commandOffset = dxvk::align(m_commandOffset, alignof(T));
+
+      if (unlikely(m_commandOffset + sizeof(T) + extra > m_capacity))
+        return nullptr;
+
+      void* result = &m_data[m_commandOffset];
+      m_commandOffset += sizeof(T) + extra;
+      return result;
+    }
+
+    void append(LegacyCsCmd* cmd) {
+      *m_next = cmd;
+      m_next = cmd->chain();
+    }
+
+  };
+
+
+  /**
+   * \brief Records a single command
+   *
+   * \param [in] chunk Chunk to record into
+   * \param [in] mix Command mix
+   * \param [in] index Command index
+   * \param [in] resource Resource to capture
+   * \returns \c true if the command was recorded,
+   *    \c false if the chunk is full
+   */
+  template<typename Chunk>
+  bool recordCommand(Chunk& chunk, CommandMix mix, uint32_t index, const Rc<BenchResource>& resource) {
+    if (mix == CommandMix::Resources && (index & 1u)) {
+      auto cmd = [
+        cResource = resource,
+        cIndex    = index
+      ] (DxvkContext* ctx) {
+        g_sink += cResource->value + cIndex;
+      };
+
+      return chunk.push(cmd);
+    }
+
+    if (mix == CommandMix::Data && !(index & 3u)) {
+      uint32_t count = 1u + (index >> 2u) % 4u;
+
+      auto cmd = [] (DxvkContext* ctx, const BenchData* data, size_t count) {
+        for (size_t i = 0; i < count; i++)
+          g_sink += data[i].a + data[i].d;
+      };
+
+      auto block = chunk.template pushCmd<BenchData>(cmd, count);
+
+      if (!block)
+        return false;
+
+      for (uint32_t i = 0; i < count; i++)
+        new (block->at(i)) BenchData { index, i, 0u, 1u };
+
+      return true;
+    }
+
+    // Roughly the size of a typical state update
+    auto cmd = [
+      cIndex  = index,
+      cA      = index * 3u,
+      cB      = index ^ 0x55u,
+      cC      = uint64_t(index) << 8u
+    ] (DxvkContext* ctx) {
+      g_sink += cIndex + cA + cB + cC;
+    };
+
+    return chunk.push(cmd);
+  }
+
+
+  template<typename Chunk>
+  BenchResult runSingleUse(CommandMix mix, uint32_t commandCount) {
+    Rc<BenchResource> resource = new BenchResource();
+
+    auto chunk = std::make_unique<Chunk>(DxvkCsChunkSizeClassDefault);
+    chunk->init(DxvkCsChunkFlag::SingleUse);
+
+    auto t0 = high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < commandCount; ) {
+      if (recordCommand(*chunk, mix, i, resource)) {
+        i += 1u;
+        continue;
+      }
+
+      chunk->executeAll(nullptr);
+      chunk->reset();
+    }
+
+    chunk->executeAll(nullptr);
+    chunk->reset();
+
+    auto t1 = high_resolution_clock::now();
+
+    // Recording and execution are interleaved here
+    BenchResult result = { };
+    result.executeNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(commandCount);
+    return result;
+  }
+
+
+  template<typename Chunk>
+  BenchResult runReplay(CommandMix mix, uint32_t commandCount, uint32_t replays) {
+    Rc<BenchResource> resource = new BenchResource();
+
+    // Record command lists of a limited size so that replays run
+    // from the cache, and reuse chunks between command lists.
+    std::vector<std::unique_ptr<Chunk>> chunks;
+
+    high_resolution_clock::duration recordTime = { };
+    high_resolution_clock::duration executeTime = { };
+
+    for (uint32_t first = 0; first < commandCount; first += ListSize) {
+      uint32_t last = std::min(first + ListSize, commandCount);
+      uint32_t chunkCount = 1u;
+
+      auto t0 = high_resolution_clock::now();
+
+      for (uint32_t i = first; i < last; ) {
+        if (chunks.size() < chunkCount) {
+          chunks.push_back(std::make_unique<Chunk>(DxvkCsChunkSizeClassDefault));
+          chunks.back()->init(DxvkCsChunkFlags());
+        }
+
+        if (recordCommand(*chunks[chunkCount - 1u], mix, i, resource))
+          i += 1u;
+        else
+          chunkCount += 1u;
+      }
+
+      auto t1 = high_resolution_clock::now();
+
+      for (uint32_t i = 0; i < replays; i++) {
+        for (uint32_t j = 0; j < chunkCount; j++)
+          chunks[j]->executeAll(nullptr);
+      }
+
+      auto t2 = high_resolution_clock::now();
+
+      for (uint32_t j = 0; j < chunkCount; j++)
+        chunks[j]->reset();
+
+      recordTime += t1 - t0;
+      executeTime += t2 - t1;
+    }
+
+    BenchResult result = { };
+    result.recordNs = std::chrono::duration<double, std::nano>(recordTime).count() / double(commandCount);
+    result.executeNs = std::chrono::duration<double, std::nano>(executeTime).count() / double(uint64_t(commandCount) * replays);
+    return result;
+  }
+
+
+  template<typename Fn>
+  BenchResult runBest(uint32_t runs, const Fn& fn) {
+    // Take the best of several runs to reduce noise
+    BenchResult best = fn();
+
+    for (uint32_t i = 1; i < runs; i++) {
+      BenchResult result = fn();
+      best.recordNs = std::min(best.recordNs, result.recordNs);
+      best.executeNs = std::min(best.executeNs, result.executeNs);
+    }
+
+    return best;
+  }
+
+
+  bool parseArgs(int argc, char** argv, BenchParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--commands")
+        params.commands = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--replays")
+        params.replays = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--runs")
+        params.runs = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.commands > 0u && params.commands <= 1000u
+        && params.replays > 0u && params.runs > 0u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--commands <millions>] [--replays <n>] [--runs <n>]\n", argv[0]);
+    return 1;
+  }
+
+  static const std::array<std::pair<CommandMix, const char*>, 3> mixes = {{
+    { CommandMix::Trivial,    "trivial"   },
+    { CommandMix::Resources,  "resources" },
+    { CommandMix::Data,       "data"      },
+  }};
+
+  uint32_t commandCount = params.commands * 1000000u;
+
+  std::printf("%u million commands, %u replays, times in ns per command\n", params.commands, params.replays);
+  std::printf("%-10s %-10s %10s %10s %12s %12s\n", "Mix", "Mode",
+    "Record", "Execute", "Prev record", "Prev execute");
+
+  for (const auto& mix : mixes) {
+    BenchResult current = runBest(params.runs, [&] {
+      return runSingleUse<DxvkCsChunk>(mix.first, commandCount);
+    });
+
+    BenchResult legacy = runBest(params.runs, [&] {
+      return runSingleUse<LegacyCsChunk>(mix.first, commandCount);
+    });
+
+    std::printf("%-10s %-10s %10s %10.2f %12s %12.2f\n", mix.second, "single-use",
+      "-", current.executeNs, "-", legacy.executeNs);
+
+    current = runBest(params.runs, [&] {
+      return runReplay<DxvkCsChunk>(mix.first, commandCount, params.replays);
+    });
+
+    legacy = runBest(params.runs, [&] {
+      return runReplay<LegacyCsChunk>(mix.first, commandCount, params.replays);
+    });
+
+    std::printf("%-10s %-10s %10.2f %10.2f %12.2f %12.2f\n", mix.second, "replay",
+      current.recordNs, current.executeNs, legacy.recordNs, legacy.executeNs);
+  }
+
+  // Keep the side effects of all commands alive
+  if (!g_sink)
+    std::fprintf(stderr, "No commands executed\n");
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dxvk_legacy_page_allocator.h"
+
+#include "../util/log/log.h"
+
+#include "../util/util_time.h"
+
+// Page allocator churn benchmark
+//
+// Fills a set of chunks to a given occupancy and then keeps freeing a
+// random allocation and allocating a new one, which is what a running
+// game does to the allocator once its working set is loaded. The same
+// request sequence is run against DxvkPageAllocator and against the
+// sorted free list it replaced, and the average time per allocation
+// and free is reported for several allocation size distributions.
+//
+// Usage: dxvk-bench-page-allocator [--ops <n>] [--chunks <n>] [--occupancy <percent>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-page-allocator.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  constexpr uint32_t ChunkPageCount = 1u << DxvkPageAllocator::ChunkPageBits;
+
+
+  struct BenchParameters {
+    uint32_t ops        = 2000000u;
+    uint32_t chunks     = 16u;
+    uint32_t occupancy  = 85u;
+  };
+
+
+  struct Request {
+    uint32_t count;
+    uint32_t alignment;
+    uint32_t victim;
+  };
+
+
+  struct Distribution {
+    const char* name;
+    uint32_t    maxSmall;
+    uint32_t    maxLarge;
+    uint32_t    largePercent;
+  };
+
+
+  struct BenchResult {
+    double    nsPerOp;
+    uint32_t  failures;
+  };
+
+
+  const std::vector<Distribution> g_distributions = {
+    { "small",  4u,   4u,    0u  },
+    { "mixed",  16u,  512u,  20u },
+    { "large",  64u,  2048u, 50u },
+  };
+
+
+  std::vector<Request> generateRequests(const Distribution& dist, uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    auto random = [&rng] (uint32_t n) {
+      return std::uniform_int_distribution<uint32_t>(0u, n - 1u)(rng);
+    };
+
+    std::vector<Request> requests(count);
+
+    for (auto& r : requests) {
+      r.count = random(100u) < dist.largePercent
+        ? 1u + random(dist.maxLarge)
+        : 1u + random(dist.maxSmall);
+
+      // Buffers with large alignment requirements are rare
+      r.alignment = random(8u) ? 1u : (2u << random(4u));
+      r.count = align(r.count, r.alignment);
+      r.victim = uint32_t(rng());
+    }
+
+    return requests;
+  }
+
+
+  void addChunk(DxvkPageAllocator& allocator) {
+    allocator.addChunk(uint64_t(ChunkPageCount) * DxvkPageAllocator::PageSize);
+  }
+
+
+  void addChunk(DxvkLegacyPageAllocator& allocator) {
+    allocator.addChunk(ChunkPageCount);
+  }
+
+
+  template<typename Allocator>
+  BenchResult runChurn(const BenchParameters& params, const std::vector<Request>& fill, const std::vector<Request>& churn) {
+    struct Allocation {
+      int32_t   index;
+      uint32_t  count;
+    };
+
+    Allocator allocator;
+
+    for (uint32_t i = 0; i < params.chunks; i++)
+      addChunk(allocator);
+
+    // Fill up to the desired occupancy, not timed
+    std::vector<Allocation> allocations;
+    allocations.reserve(params.chunks * ChunkPageCount);
+
+    uint64_t targetPages = uint64_t(params.chunks) * ChunkPageCount * params.occupancy / 100u;
+    uint64_t usedPages = 0u;
+
+    for (const auto& r : fill) {
+      if (usedPages + r.count > targetPages)
+        break;
+
+      int32_t index = allocator.allocPages(r.count, r.alignment);
+
+      if (index >= 0) {
+        allocations.push_back({ index, r.count });
+        usedPages += r.count;
+      }
+    }
+
+    BenchResult result = { };
+
+    auto t0 = high_resolution_clock::now();
+
+    for (const auto& r : churn) {
+      if (!allocations.empty()) {
+        uint32_t victim = r.victim % allocations.size();
+        allocator.freePages(allocations[victim].index, allocations[victim].count);
+
+        allocations[victim] = allocations.back();
+        allocations.pop_back();
+      }
+
+      int32_t index = allocator.allocPages(r.count, r.alignment);
+
+      if (index >= 0)
+        allocations.push_back({ index, r.count });
+      else
+        result.failures += 1u;
+    }
+
+    auto t1 = high_resolution_clock::now();
+
+    // One allocation and one free per request
+    result.nsPerOp = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(2u * churn.size());
+    return result;
+  }
+
+
+  bool parseArgs(int argc, char** argv, BenchParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--ops")
+        params.ops = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--chunks")
+        params.chunks = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--occupancy")
+        params.occupancy = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.ops > 0u
+        && params.chunks > 0u && params.chunks <= 1024u
+        && params.occupancy <= 100u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--ops <n>] [--chunks <n>] [--occupancy <percent>]\n", argv[0]);
+    return 1;
+  }
+
+  std::printf("%u chunks of %u pages, %u%% occupancy, %u requests\n",
+    params.chunks, ChunkPageCount, params.occupancy, params.ops);
+  std::printf("%-8s %14s %10s %14s %10s\n", "Sizes", "Current", "Failed", "Previous", "Failed");
+
+  for (const auto& dist : g_distributions) {
+    auto fill = generateRequests(dist, params.chunks * ChunkPageCount, 1u);
+    auto churn = generateRequests(dist, params.ops, 2u);
+
+    BenchResult current = runChurn<DxvkPageAllocator>(params, fill, churn);
+    BenchResult legacy = runChurn<DxvkLegacyPageAllocator>(params, fill, churn);
+
+    std::printf("%-8s %11.1f ns %10u %11.1f ns %10u\n", dist.name,
+      current.nsPerOp, current.failures, legacy.nsPerOp, legacy.failures);
+  }
+
+  return 0;
+}
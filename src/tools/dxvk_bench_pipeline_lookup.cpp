@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../dxvk/dxvk_graphics_state.h"
+
+#include "../util/log/log.h"
+
+#include "../util/sync/sync_hashlist.h"
+#include "../util/sync/sync_list.h"
+
+#include "../util/util_time.h"
+
+// Pipeline instance lookup benchmark
+//
+// Compares the hashed instance lookup used by graphics pipelines
+// against a linear search over all instances, which is what the
+// lookup used to do. The context only hashes the state vector when
+// it changes, so lookups use precomputed hashes, and the cost of
+// hashing the state is reported separately.
+//
+// Usage: dxvk-bench-pipeline-lookup [lookups]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-pipeline-lookup.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct Instance {
+    Instance(const DxvkGraphicsPipelineStateInfo& state_)
+    : state(state_) { }
+
+    DxvkGraphicsPipelineStateInfo state;
+  };
+
+
+  DxvkGraphicsPipelineStateInfo makeState(uint32_t index) {
+    DxvkGraphicsPipelineStateInfo state;
+
+    // Real-world variants tend to differ in only a few
+    // bits somewhere in the middle of the state vector
+    state.sc.specConstants[0] = index;
+    state.sc.specConstants[1] = index * 7u;
+    return state;
+  }
+
+
+  template<typename Fn>
+  double measure(uint32_t lookups, const Fn& fn) {
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < lookups; i++)
+      fn(i);
+
+    auto t1 = dxvk::high_resolution_clock::now();
+
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count())
+         / double(lookups);
+  }
+
+
+  void runBenchmark(uint32_t instanceCount, uint32_t lookups) {
+    sync::List<Instance> list;
+    sync::HashList<Instance, 64> hashList;
+
+    std::vector<DxvkGraphicsPipelineStateInfo> states;
+    std::vector<size_t> hashes;
+
+    for (uint32_t i = 0; i < instanceCount; i++) {
+      states.push_back(makeState(i));
+      hashes.push_back(states.back().hash());
+
+      list.emplace(states.back());
+      hashList.emplace(hashes.back(), states.back());
+    }
+
+    size_t found = 0;
+
+    double linearNs = measure(lookups, [&] (uint32_t i) {
+      const auto& state = states[i % instanceCount];
+
+      for (const auto& instance : list) {
+        if (instance.state == state) {
+          found += 1;
+          break;
+        }
+      }
+    });
+
+    double hashedNs = measure(lookups, [&] (uint32_t i) {
+      const auto& state = states[i % instanceCount];
+
+      found += hashList.find(hashes[i % instanceCount], [&state] (const Instance& instance) {
+        return instance.state == state;
+      }) != nullptr;
+    });
+
+    volatile size_t hash = 0;
+
+    double hashNs = measure(lookups, [&] (uint32_t i) {
+      hash = states[i % instanceCount].hash();
+    });
+
+    std::printf("%4u instances: linear %8.1f ns, hashed %8.1f ns, state hash %8.1f ns (%zu hits)\n",
+      instanceCount, linearNs, hashedNs, hashNs, found);
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  uint32_t lookups = 1000000u;
+
+  if (argc > 1)
+    lookups = uint32_t(std::strtoul(argv[1], nullptr, 10));
+
+  if (!lookups)
+    lookups = 1u;
+
+  for (uint32_t count : { 1u, 16u, 256u })
+    runBenchmark(count, lookups);
+
+  return 0;
+}
@@ -0,0 +1,282 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_shader.h"
+
+#include "../util/util_time.h"
+
+#include <dxvk_blit_frag_1d.h>
+#include <dxvk_blit_frag_2d.h>
+#include <dxvk_blit_frag_3d.h>
+#include <dxvk_buffer_to_image_d.h>
+#include <dxvk_buffer_to_image_ds_export.h>
+#include <dxvk_buffer_to_image_s_discard.h>
+#include <dxvk_copy_color_1d.h>
+#include <dxvk_copy_color_2d.h>
+#include <dxvk_copy_color_ms.h>
+#include <dxvk_copy_depth_stencil_1d.h>
+#include <dxvk_copy_depth_stencil_2d.h>
+#include <dxvk_copy_depth_stencil_ms.h>
+#include <dxvk_cursor_frag.h>
+#include <dxvk_cursor_vert.h>
+#include <dxvk_dummy_frag.h>
+#include <dxvk_fullscreen_geom.h>
+#include <dxvk_fullscreen_layer_vert.h>
+#include <dxvk_fullscreen_vert.h>
+#include <dxvk_present_frag.h>
+#include <dxvk_present_frag_blit.h>
+#include <dxvk_present_frag_ms.h>
+#include <dxvk_present_frag_ms_amd.h>
+#include <dxvk_present_frag_ms_blit.h>
+#include <dxvk_present_vert.h>
+#include <dxvk_resolve_frag_d.h>
+#include <dxvk_resolve_frag_ds.h>
+#include <dxvk_resolve_frag_f.h>
+#include <dxvk_resolve_frag_i.h>
+#include <dxvk_resolve_frag_u.h>
+
+// Shader patching benchmark
+//
+// Creates shader objects from the built-in graphics meta shaders and
+// measures how long DxvkShader::getCode takes for each of the shader
+// module variants that pipeline state can produce, i.e. eliminated
+// inputs, flat shading, render target swizzles, dual-source blending
+// and geometry shader input topologies. Binding IDs are not remapped
+// since that requires a device to create binding layout objects.
+//
+// The time needed to only decompress the shader is reported as well,
+// since getCode always has to do that.
+//
+// Usage: dxvk-bench-shader-patch [--iterations <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-shader-patch.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct BenchParameters {
+    uint32_t iterations = 10000u;
+  };
+
+
+  struct MetaShader {
+    const char*             name;
+    VkShaderStageFlagBits   stage;
+    uint32_t                size;
+    const uint32_t*         code;
+  };
+
+
+  struct ShaderVariant {
+    std::string                 name;
+    DxvkShaderModuleCreateInfo  state;
+  };
+
+
+  #define META_SHADER(name, stage) { #name, stage, uint32_t(sizeof(name) / sizeof(uint32_t)), name }
+
+  const std::vector<MetaShader> g_shaders = {
+    META_SHADER(dxvk_blit_frag_1d,                VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_blit_frag_2d,                VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_blit_frag_3d,                VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_buffer_to_image_d,           VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_buffer_to_image_ds_export,   VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_buffer_to_image_s_discard,   VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_color_1d,               VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_color_2d,               VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_color_ms,               VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_depth_stencil_1d,       VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_depth_stencil_2d,       VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_copy_depth_stencil_ms,       VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_cursor_frag,                 VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_cursor_vert,                 VK_SHADER_STAGE_VERTEX_BIT),
+    META_SHADER(dxvk_dummy_frag,                  VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_fullscreen_geom,             VK_SHADER_STAGE_GEOMETRY_BIT),
+    META_SHADER(dxvk_fullscreen_layer_vert,       VK_SHADER_STAGE_VERTEX_BIT),
+    META_SHADER(dxvk_fullscreen_vert,             VK_SHADER_STAGE_VERTEX_BIT),
+    META_SHADER(dxvk_present_frag,                VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_present_frag_blit,           VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_present_frag_ms,             VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_present_frag_ms_amd,         VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_present_frag_ms_blit,        VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_present_vert,                VK_SHADER_STAGE_VERTEX_BIT),
+    META_SHADER(dxvk_resolve_frag_d,              VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_resolve_frag_ds,             VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_resolve_frag_f,              VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_resolve_frag_i,              VK_SHADER_STAGE_FRAGMENT_BIT),
+    META_SHADER(dxvk_resolve_frag_u,              VK_SHADER_STAGE_FRAGMENT_BIT),
+  };
+
+  #undef META_SHADER
+
+
+  uint32_t getLocationMask(SpirvCodeBuffer& code, spv::StorageClass storageClass) {
+    std::vector<std::pair<uint32_t, uint32_t>> locations;
+    uint32_t mask = 0u;
+
+    for (auto ins : code) {
+      if (ins.opCode() == spv::OpDecorate && ins.arg(2) == spv::DecorationLocation)
+        locations.push_back({ ins.arg(1), ins.arg(3) });
+
+      if (ins.opCode() == spv::OpVariable && ins.arg(3) == uint32_t(storageClass)) {
+        for (const auto& l : locations) {
+          if (l.first == ins.arg(2) && l.second < 32u)
+            mask |= 1u << l.second;
+        }
+      }
+
+      if (ins.opCode() == spv::OpFunction)
+        break;
+    }
+
+    return mask;
+  }
+
+
+  std::vector<ShaderVariant> getVariants(const DxvkShaderCreateInfo& info) {
+    std::vector<ShaderVariant> variants;
+    variants.push_back({ "default", DxvkShaderModuleCreateInfo() });
+
+    if (info.inputMask) {
+      ShaderVariant variant = { "undefined-inputs", DxvkShaderModuleCreateInfo() };
+      variant.state.undefinedInputs = info.inputMask;
+      variants.push_back(variant);
+    }
+
+    if (info.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+      std::array<VkComponentMapping, MaxNumRenderTargets> swizzles;
+
+      for (auto& swizzle : swizzles) {
+        swizzle = { VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_G,
+                    VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+      }
+
+      ShaderVariant variant = { "flat-shading", DxvkShaderModuleCreateInfo() };
+      variant.state.fsFlatShading = true;
+      variants.push_back(variant);
+
+      variant = { "swizzle", DxvkShaderModuleCreateInfo() };
+      variant.state.rtSwizzles = swizzles;
+      variants.push_back(variant);
+
+      variant = { "dual-source", DxvkShaderModuleCreateInfo() };
+      variant.state.fsDualSrcBlend = true;
+      variants.push_back(variant);
+
+      // Everything at once, which is what the single-pass
+      // patching should benefit from the most
+      variant.name = "all";
+      variant.state.fsFlatShading = true;
+      variant.state.undefinedInputs = info.inputMask;
+      variant.state.rtSwizzles = swizzles;
+      variants.push_back(variant);
+    }
+
+    if (info.stage == VK_SHADER_STAGE_GEOMETRY_BIT) {
+      ShaderVariant variant = { "points", DxvkShaderModuleCreateInfo() };
+      variant.state.inputTopology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+      variants.push_back(variant);
+
+      variant = { "lines", DxvkShaderModuleCreateInfo() };
+      variant.state.inputTopology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+      variants.push_back(variant);
+    }
+
+    return variants;
+  }
+
+
+  template<typename Fn>
+  double measure(uint32_t iterations, const Fn& fn) {
+    // Keep the result alive so that the work is not optimized out
+    size_t size = 0u;
+
+    auto t0 = high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+      size += fn().size();
+
+    auto t1 = high_resolution_clock::now();
+
+    if (!size)
+      std::fprintf(stderr, "Empty shader code\n");
+
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / double(iterations);
+  }
+
+
+  bool parseArgs(int argc, char** argv, BenchParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--iterations")
+        params.iterations = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.iterations > 0u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--iterations <n>]\n", argv[0]);
+    return 1;
+  }
+
+  std::printf("%-32s %-18s %10s %10s\n", "Shader", "Variant", "getCode", "raw");
+
+  double totalTime = 0.0;
+  double totalRawTime = 0.0;
+  uint32_t totalVariants = 0u;
+
+  for (const auto& meta : g_shaders) {
+    SpirvCodeBuffer code(meta.size, meta.code);
+
+    DxvkShaderCreateInfo info;
+    info.stage = meta.stage;
+    info.inputMask = getLocationMask(code, spv::StorageClassInput);
+    info.outputMask = getLocationMask(code, spv::StorageClassOutput);
+    info.flatShadingInputs = info.inputMask;
+
+    if (meta.stage == VK_SHADER_STAGE_GEOMETRY_BIT)
+      info.inputTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    Rc<DxvkShader> shader = new DxvkShader(info, std::move(code));
+
+    double rawTime = measure(params.iterations, [&] {
+      return shader->getRawCode();
+    });
+
+    for (const auto& variant : getVariants(info)) {
+      double time = measure(params.iterations, [&] {
+        return shader->getCode(nullptr, variant.state);
+      });
+
+      std::printf("%-32s %-18s %8.2f us %7.2f us\n", meta.name, variant.name.c_str(), time, rawTime);
+
+      totalTime += time;
+      totalRawTime += rawTime;
+      totalVariants += 1u;
+    }
+  }
+
+  std::printf("Average over %u variants: %.2f us, %.2f us of which decompression\n",
+    totalVariants, totalTime / double(totalVariants), totalRawTime / double(totalVariants));
+  return 0;
+}
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../spirv/spirv_compression.h"
+
+#include "../util/util_bit.h"
+#include "../util/util_time.h"
+
+// SPIR-V compression benchmark
+//
+// Compresses and decompresses every .spv file in a directory tree, checks
+// that each shader round-trips, and reports throughput and compression
+// ratio. The previous compression format, which packed up to two tokens
+// into each dword, is measured as well for comparison.
+//
+// Real shaders can be obtained by running dxvk-shader-corpus with the
+// --spirv option on a directory of shaders written by dxvk.shaderDumpPath.
+//
+// Usage: dxvk-bench-spirv-compression [--iterations <n>] <directory>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-bench-spirv-compression.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct BenchParameters {
+    std::string directory;
+    uint32_t    iterations = 20u;
+  };
+
+
+  struct BenchResult {
+    double      compressTime    = 0.0;
+    double      decompressTime  = 0.0;
+    size_t      compressedSize  = 0u;
+    uint32_t    mismatches      = 0u;
+  };
+
+
+  /**
+   * \brief Previous compression format
+   *
+   * Encodes up to two tokens into a dword using one of four
+   * layouts, in blocks of 16 dwords preceded by a layout dword.
+   * Decoding matches the last version of the old decoder, which
+   * decoded whole blocks with SSE2 where possible.
+   */
+  class LegacySpirvCompressedBuffer {
+
+  public:
+
+    LegacySpirvCompressedBuffer(SpirvCodeBuffer& code)
+    : m_size(code.dwords()) {
+      const uint32_t* data = code.data();
+      m_code.reserve((m_size * 75) / 128);
+
+      std::array<uint32_t, 16> block;
+      uint32_t blockMask = 0;
+      uint32_t blockOffset = 0;
+
+      for (size_t i = 0; i < m_size; ) {
+        if (likely(i + 1 < m_size)) {
+          uint32_t a = data[i];
+          uint32_t b = data[i + 1];
+          uint32_t schema;
+          uint32_t encode;
+
+          if (std::max(a, b) < (1u << 16)) {
+            schema = 0x2;
+            encode = a | (b << 16);
+          } else if (a < (1u << 20) && b < (1u << 12)) {
+            schema = 0x1;
+            encode = a | (b << 20);
+          } else if (a < (1u << 12) && b < (1u << 20)) {
+            schema = 0x3;
+            encode = a | (b << 12);
+          } else {
+            schema = 0x0;
+            encode = a;
+          }
+
+          block[blockOffset] = encode;
+          blockMask |= schema << (blockOffset << 1);
+          blockOffset += 1;
+
+          i += schema ? 2 : 1;
+        } else {
+          block[blockOffset] = data[i++];
+          blockOffset += 1;
+        }
+
+        if (unlikely(blockOffset == 16) || unlikely(i == m_size)) {
+          m_code.insert(m_code.end(), blockMask);
+          m_code.insert(m_code.end(), block.begin(), block.begin() + blockOffset);
+
+          blockMask = 0;
+          blockOffset = 0;
+        }
+      }
+
+      if (m_code.capacity() > (m_code.size() * 10) / 9)
+        m_code.shrink_to_fit();
+    }
+
+    size_t compressedSize() const {
+      return m_code.size();
+    }
+
+    SpirvCodeBuffer decompress() const {
+      SpirvCodeBuffer code(m_size);
+      uint32_t* data = code.data();
+
+      const uint32_t* src = m_code.data();
+      size_t dstOffset = 0;
+
+      while (dstOffset + 32 <= m_size) {
+        dstOffset += decodeBlock(src, &data[dstOffset]);
+        src += 17;
+      }
+
+      constexpr uint32_t shiftAmounts = 0x0c101420;
+
+      while (dstOffset < m_size) {
+        uint32_t blockMask = src[0];
+
+        for (uint32_t i = 0; i < 16 && dstOffset < m_size; i++) {
+          uint32_t schema = (blockMask >> (i << 1)) & 0x3;
+          uint32_t shift  = (shiftAmounts >> (schema << 3)) & 0xff;
+          uint64_t mask   = ~(~0ull << shift);
+          uint64_t encode = src[i + 1];
+
+          data[dstOffset] = encode & mask;
+
+          if (likely(schema))
+            data[dstOffset + 1] = encode >> shift;
+
+          dstOffset += schema ? 2 : 1;
+        }
+
+        src += 17;
+      }
+
+      return code;
+    }
+
+  private:
+
+    size_t                m_size;
+    std::vector<uint32_t> m_code;
+
+    static size_t decodeBlock(
+      const uint32_t*       src,
+            uint32_t*       dst) {
+      uint32_t blockMask = src[0];
+      size_t dstOffset = 0;
+
+#ifdef DXVK_ARCH_X86
+      const __m128i schema1 = _mm_set1_epi32(0x1);
+      const __m128i schema2 = _mm_set1_epi32(0x2);
+      const __m128i schema3 = _mm_set1_epi32(0x3);
+
+      for (uint32_t i = 0; i < 16; i += 4) {
+        uint32_t groupMask = blockMask >> (i << 1);
+
+        __m128i schema = _mm_set_epi32(
+          (groupMask >> 6) & 0x3, (groupMask >> 4) & 0x3,
+          (groupMask >> 2) & 0x3, (groupMask >> 0) & 0x3);
+
+        __m128i is1 = _mm_cmpeq_epi32(schema, schema1);
+        __m128i is2 = _mm_cmpeq_epi32(schema, schema2);
+        __m128i is3 = _mm_cmpeq_epi32(schema, schema3);
+        __m128i is0 = _mm_cmpeq_epi32(schema, _mm_setzero_si128());
+
+        __m128i encode = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i + 1]));
+
+        __m128i lo = _mm_and_si128(encode, _mm_or_si128(
+          _mm_or_si128(
+            _mm_and_si128(is1, _mm_set1_epi32(0xfffff)),
+            _mm_and_si128(is2, _mm_set1_epi32(0xffff))),
+          _mm_or_si128(
+            _mm_and_si128(is3, _mm_set1_epi32(0xfff)), is0)));
+
+        __m128i hi = _mm_or_si128(
+          _mm_or_si128(
+            _mm_and_si128(is1, _mm_srli_epi32(encode, 20)),
+            _mm_and_si128(is2, _mm_srli_epi32(encode, 16))),
+          _mm_and_si128(is3, _mm_srli_epi32(encode, 12)));
+
+        __m128i tokens01 = _mm_unpacklo_epi32(lo, hi);
+        __m128i tokens23 = _mm_unpackhi_epi32(lo, hi);
+
+        size_t offset0 = dstOffset;
+        size_t offset1 = offset0 + ((groupMask & 0x03) ? 2 : 1);
+        size_t offset2 = offset1 + ((groupMask & 0x0c) ? 2 : 1);
+        size_t offset3 = offset2 + ((groupMask & 0x30) ? 2 : 1);
+        dstOffset      = offset3 + ((groupMask & 0xc0) ? 2 : 1);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[offset0]), tokens01);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[offset1]), _mm_unpackhi_epi64(tokens01, tokens01));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[offset2]), tokens23);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&dst[offset3]), _mm_unpackhi_epi64(tokens23, tokens23));
+      }
+#else
+      constexpr uint32_t shiftAmounts = 0x0c101420;
+
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t schema = (blockMask >> (i << 1)) & 0x3;
+        uint32_t shift  = (shiftAmounts >> (schema << 3)) & 0xff;
+        uint64_t encode = src[i + 1];
+
+        dst[dstOffset + 0] = encode & ~(~0ull << shift);
+        dst[dstOffset + 1] = encode >> shift;
+
+        dstOffset += schema ? 2 : 1;
+      }
+#endif
+
+      return dstOffset;
+    }
+
+  };
+
+
+  bool parseArgs(int argc, char** argv, BenchParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+
+      if (arg.size() < 2 || arg[0] != '-' || arg[1] != '-') {
+        if (!params.directory.empty())
+          return false;
+
+        params.directory = arg;
+        continue;
+      }
+
+      if (i + 1 >= argc)
+        return false;
+
+      const char* value = argv[++i];
+
+      if (arg == "--iterations")
+        params.iterations = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return !params.directory.empty() && params.iterations;
+  }
+
+
+  bool readShader(const std::filesystem::path& path, SpirvCodeBuffer& code) {
+    std::ifstream file(path, std::ios_base::binary);
+
+    if (!file)
+      return false;
+
+    code = SpirvCodeBuffer(file);
+    return code.dwords() != 0;
+  }
+
+
+  bool equal(const SpirvCodeBuffer& a, const SpirvCodeBuffer& b) {
+    return a.dwords() == b.dwords()
+        && !std::memcmp(a.data(), b.data(), a.size());
+  }
+
+
+  template<typename Buffer>
+  BenchResult runBenchmark(
+    const BenchParameters&              params,
+          std::vector<SpirvCodeBuffer>& shaders) {
+    BenchResult result;
+
+    std::vector<Buffer> compressed;
+    compressed.reserve(shaders.size());
+
+    for (uint32_t i = 0; i < params.iterations; i++) {
+      compressed.clear();
+
+      auto t0 = high_resolution_clock::now();
+
+      for (auto& shader : shaders)
+        compressed.emplace_back(shader);
+
+      auto t1 = high_resolution_clock::now();
+      result.compressTime += std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    for (const auto& buffer : compressed)
+      result.compressedSize += buffer.compressedSize() * sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < params.iterations; i++) {
+      auto t0 = high_resolution_clock::now();
+
+      for (const auto& buffer : compressed) {
+        SpirvCodeBuffer code = buffer.decompress();
+
+        // Keep the compiler from discarding the result
+        if (unlikely(!code.dwords()))
+          result.mismatches += 1;
+      }
+
+      auto t1 = high_resolution_clock::now();
+      result.decompressTime += std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    for (size_t i = 0; i < shaders.size(); i++) {
+      if (!equal(compressed[i].decompress(), shaders[i]))
+        result.mismatches += 1;
+    }
+
+    return result;
+  }
+
+
+  void printResult(const char* name, const BenchResult& result, size_t totalSize, uint32_t iterations) {
+    double mb = double(totalSize) * double(iterations) / double(1u << 20);
+
+    std::printf("%-8s  %8.1f MB/s compress  %8.1f MB/s decompress  %5.1f%% size  %u mismatches\n",
+      name, mb / result.compressTime, mb / result.decompressTime,
+      100.0 * double(result.compressedSize) / double(totalSize), result.mismatches);
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--iterations <n>] <directory>\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> files;
+  std::error_code ec;
+
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(params.directory, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".spv")
+      files.push_back(entry.path());
+  }
+
+  if (ec) {
+    std::fprintf(stderr, "Failed to read %s: %s\n", params.directory.c_str(), ec.message().c_str());
+    return 1;
+  }
+
+  std::sort(files.begin(), files.end());
+
+  std::vector<SpirvCodeBuffer> shaders;
+  size_t totalSize = 0u;
+
+  for (const auto& path : files) {
+    SpirvCodeBuffer code;
+
+    if (!readShader(path, code)) {
+      std::fprintf(stderr, "Failed to read %s\n", path.string().c_str());
+      continue;
+    }
+
+    totalSize += code.size();
+    shaders.push_back(std::move(code));
+  }
+
+  if (shaders.empty()) {
+    std::fprintf(stderr, "No shaders found in %s\n", params.directory.c_str());
+    return 1;
+  }
+
+  std::printf("%zu shaders, %.2f MB, %u iterations\n", shaders.size(),
+    double(totalSize) / double(1u << 20), params.iterations);
+
+  BenchResult current = runBenchmark<SpirvCompressedBuffer>(params, shaders);
+  BenchResult legacy = runBenchmark<LegacySpirvCompressedBuffer>(params, shaders);
+
+  printResult("current", current, totalSize, params.iterations);
+  printResult("previous", legacy, totalSize, params.iterations);
+  return current.mismatches || legacy.mismatches ? 1 : 0;
+}
@@ -0,0 +1,324 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "../dxvk/dxvk_options.h"
+
+#include "../dxvk/framepacer/dxvk_framepacer.h"
+
+#include "../util/config/config.h"
+
+// Frame pacer simulator
+//
+// Drives the frame pacer against a virtual clock with a synthetic
+// workload, so that pacing decisions can be evaluated without a GPU
+// and without any real-time sleeps or thread interactions. Each frame
+// consists of CPU work on the application thread, which submits once
+// mid-frame and once on present, CS thread work that trails the last
+// submission, and GPU work that executes both submissions in order.
+//
+// All events that would happen on other threads are run on the
+// application thread whenever the pacer sleeps or waits for a fence,
+// so runs are fully deterministic for a given set of parameters.
+//
+// Usage: dxvk-framepacer-sim [options]
+//   --mode <str>      Frame pace mode, same values as dxvk.framePace
+//   --frames <n>      Number of frames to simulate
+//   --cpu <us>        Application CPU time per frame
+//   --cs <us>         CS thread time after the final submission
+//   --gpu <us>        GPU time per frame
+//   --jitter <pct>    Random variation of all durations, in percent
+//   --seed <n>        Seed for the random variation
+//   --fps <n>         Frame rate limit, 0 to disable
+//
+// Prints one CSV line per frame, followed by a summary.
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-framepacer-sim.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  using time_point = high_resolution_clock::time_point;
+  using microseconds = std::chrono::microseconds;
+
+
+  struct SimParameters {
+    std::string mode      = "low-latency";
+    uint32_t    frames    = 1000u;
+    uint32_t    cpuTime   = 8000u;
+    uint32_t    csTime    = 1000u;
+    uint32_t    gpuTime   = 12000u;
+    uint32_t    jitter    = 10u;
+    uint32_t    seed      = 1u;
+    double      fpsLimit  = 0.0;
+  };
+
+
+  /*
+   * \brief Virtual clock
+   *
+   * Keeps a queue of pending events ordered by time. Sleeping
+   * or waiting for a fence runs events until the target time
+   * or fence value is reached, which advances the clock.
+   */
+  class SimClock : public FramePacerClock {
+
+  public:
+
+    SimClock()
+    : m_now(time_point(std::chrono::seconds(1))) { }
+
+    time_point now() override {
+      return m_now;
+    }
+
+    time_point sleepUntil( time_point t0, time_point t1 ) override {
+      runUntil(t1);
+      return m_now;
+    }
+
+    void waitFence( sync::Fence& fence, uint64_t value ) override {
+      while (fence.value() < value) {
+        if (m_events.empty()) {
+          std::fprintf(stderr, "Deadlock: fence will never reach %llu\n", (unsigned long long)value);
+          std::exit(1);
+        }
+
+        runNext();
+      }
+    }
+
+    void schedule( time_point t, std::function<void ()> fn ) {
+      m_events.push({ t, m_sequence++, std::move(fn) });
+    }
+
+    void runUntil( time_point t ) {
+      while (!m_events.empty() && m_events.top().time <= t)
+        runNext();
+
+      m_now = std::max(m_now, t);
+    }
+
+    void runAll() {
+      while (!m_events.empty())
+        runNext();
+    }
+
+  private:
+
+    struct Event {
+      time_point            time;
+      uint64_t              sequence;
+      std::function<void ()> fn;
+
+      bool operator < (const Event& other) const {
+        // Inverted since priority_queue returns the largest element
+        if (time != other.time)
+          return time > other.time;
+        return sequence > other.sequence;
+      }
+    };
+
+    time_point                m_now;
+    uint64_t                  m_sequence = 0u;
+    std::priority_queue<Event> m_events;
+
+    void runNext() {
+      Event e = m_events.top();
+      m_events.pop();
+
+      m_now = std::max(m_now, e.time);
+      e.fn();
+    }
+
+  };
+
+
+  /*
+   * \brief Deterministic random duration generator
+   */
+  class SimRandom {
+
+  public:
+
+    SimRandom(uint32_t seed, uint32_t jitter)
+    : m_state(seed ? seed : 1u), m_jitter(jitter) { }
+
+    microseconds vary(uint32_t us) {
+      // xorshift32 is good enough for timing noise
+      m_state ^= m_state << 13;
+      m_state ^= m_state >> 17;
+      m_state ^= m_state << 5;
+
+      int64_t range = int64_t(us) * int64_t(m_jitter) / 100;
+      int64_t delta = range ? int64_t(m_state % uint32_t(2 * range + 1)) - range : 0;
+      return microseconds(std::max<int64_t>(int64_t(us) + delta, 1));
+    }
+
+  private:
+
+    uint32_t m_state;
+    uint32_t m_jitter;
+
+  };
+
+
+  struct SimFrameResult {
+    time_point start;
+    time_point end;
+    int32_t    cpuFinished;
+    int32_t    gpuFinished;
+    int32_t    presentFinished;
+  };
+
+
+  bool parseArgs(int argc, char** argv, SimParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--mode")
+        params.mode = value;
+      else if (arg == "--frames")
+        params.frames = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--cpu")
+        params.cpuTime = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--cs")
+        params.csTime = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--gpu")
+        params.gpuTime = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--jitter")
+        params.jitter = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--seed")
+        params.seed = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--fps")
+        params.fpsLimit = std::strtod(value, nullptr);
+      else
+        return false;
+    }
+
+    return params.frames != 0u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  SimParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--mode <str>] [--frames <n>] [--cpu <us>] [--cs <us>]"
+      " [--gpu <us>] [--jitter <pct>] [--seed <n>] [--fps <n>]\n", argv[0]);
+    return 1;
+  }
+
+  DxvkOptions options = DxvkOptions(Config());
+  options.framePace = params.mode;
+
+  // Matches the first frame ID used by DxvkDevice
+  constexpr uint64_t firstFrameId = DXGI_MAX_SWAP_CHAIN_BUFFERS + 1u;
+
+  SimClock clock;
+  SimRandom random(params.seed, params.jitter);
+
+  Rc<FramePacer> pacer = new FramePacer(options, firstFrameId, &clock);
+
+  if (params.fpsLimit > 0.0)
+    pacer->setTargetFrameRate(params.fpsLimit);
+
+  std::vector<SimFrameResult> results(params.frames);
+  time_point gpuIdle = clock.now();
+
+  for (uint32_t i = 0; i < params.frames; i++) {
+    uint64_t frameId = firstFrameId + i;
+
+    pacer->sleepAndBeginFrame(frameId, 0.0);
+
+    time_point start = clock.now();
+
+    time_point submitTime = start + random.vary(params.cpuTime / 2u);
+    time_point presentTime = submitTime + random.vary(params.cpuTime - params.cpuTime / 2u);
+    time_point csEndTime = presentTime + random.vary(params.csTime);
+
+    // The GPU executes submissions in order, and
+    // may still be busy with the previous frame
+    time_point gpuMidTime = std::max(gpuIdle, submitTime) + random.vary(params.gpuTime / 2u);
+    time_point gpuEndTime = std::max(gpuMidTime, presentTime) + random.vary(params.gpuTime - params.gpuTime / 2u);
+    gpuIdle = gpuEndTime;
+
+    clock.schedule(start, [p = pacer.ptr(), frameId] {
+      p->notifyCsRenderBegin(frameId);
+    });
+
+    clock.schedule(submitTime, [p = pacer.ptr(), frameId] {
+      p->notifySubmit(frameId);
+      p->notifyQueueSubmit(frameId);
+    });
+
+    clock.schedule(presentTime, [p = pacer.ptr(), frameId] {
+      p->notifyPresent(frameId);
+      p->notifyQueuePresentBegin(frameId);
+    });
+
+    clock.schedule(csEndTime, [p = pacer.ptr(), frameId] {
+      p->notifyCsRenderEnd(frameId);
+    });
+
+    clock.schedule(gpuMidTime, [p = pacer.ptr(), frameId] {
+      p->notifyGpuExecutionEnd(frameId);
+    });
+
+    clock.schedule(gpuEndTime, [p = pacer.ptr(), frameId, result = &results[i]] {
+      p->notifyGpuPresentBegin(frameId);
+      p->notifyGpuPresentEnd(frameId);
+
+      const LatencyMarkers* m = p->m_latencyMarkersStorage.getConstMarkers(frameId);
+      result->start = m->start;
+      result->end = m->end;
+      result->cpuFinished = m->cpuFinished;
+      result->gpuFinished = m->gpuFinished;
+      result->presentFinished = m->presentFinished;
+    });
+
+    // Application thread is busy until it presents
+    clock.runUntil(presentTime);
+  }
+
+  clock.runAll();
+
+  std::printf("frame,start_us,frametime_us,cpu_finished_us,gpu_finished_us,latency_us\n");
+
+  time_point simStart = results.front().start;
+  double frametimeSum = 0.0;
+  double latencySum = 0.0;
+
+  for (uint32_t i = 0; i < params.frames; i++) {
+    const auto& r = results[i];
+
+    int64_t startUs = std::chrono::duration_cast<microseconds>(r.start - simStart).count();
+    int64_t frametimeUs = i ? std::chrono::duration_cast<microseconds>(r.start - results[i - 1].start).count() : 0;
+
+    std::printf("%llu,%lld,%lld,%d,%d,%d\n",
+      (unsigned long long)(firstFrameId + i), (long long)startUs, (long long)frametimeUs,
+      r.cpuFinished, r.gpuFinished, r.presentFinished);
+
+    frametimeSum += double(frametimeUs);
+    latencySum += double(r.presentFinished);
+  }
+
+  std::printf("# mode=%s frames=%u avg_frametime_us=%.1f avg_latency_us=%.1f\n",
+    params.mode.c_str(), params.frames,
+    params.frames > 1u ? frametimeSum / double(params.frames - 1u) : 0.0,
+    latencySum / double(params.frames));
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "../dxvk/framepacer/dxvk_framepacer_trace.h"
+
+#include "../util/log/log.h"
+
+// Frame pacing trace converter
+//
+// Converts a binary trace written by the frame pacer when
+// DXVK_FRAME_PACE_TRACE is set to CSV, with one line per frame.
+// Submit and ready events are written as semicolon-separated
+// lists, and only the first few events of each frame are stored
+// in the trace, whereas the counts are exact.
+//
+// Usage: dxvk-framepacer-trace <trace> [<csv>]
+//
+// The CSV file defaults to the trace file name with .csv appended.
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-framepacer-trace.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  void writeEvents(std::ofstream& out, const int32_t* events, uint32_t count) {
+    count = std::min(count, FramePacerTraceRecord::MaxEvents);
+
+    for (uint32_t i = 0; i < count; i++)
+      out << (i ? ";" : "") << events[i];
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "Usage: %s <trace> [<csv>]\n", argv[0]);
+    return 1;
+  }
+
+  std::string tracePath = argv[1];
+  std::string csvPath = argc > 2 ? argv[2] : tracePath + ".csv";
+
+  std::ifstream in(str::topath(tracePath.c_str()).c_str(), std::ios_base::binary);
+
+  FramePacerTraceHeader expected;
+  FramePacerTraceHeader header;
+
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+   || std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+   || header.version != expected.version
+   || header.recordSize != sizeof(FramePacerTraceRecord)) {
+    std::fprintf(stderr, "Invalid trace file %s\n", tracePath.c_str());
+    return 1;
+  }
+
+  std::ofstream out(str::topath(csvPath.c_str()).c_str(), std::ios_base::trunc);
+
+  if (!out) {
+    std::fprintf(stderr, "Failed to open %s\n", csvPath.c_str());
+    return 1;
+  }
+
+  out << "frameId,start,csStart,csFinished,cpuFinished,gpuStart,gpuFinished,"
+         "presentFinished,gpuSubmitCount,gpuReadyCount,gpuSubmit,gpuReady\n";
+
+  FramePacerTraceRecord r;
+  uint64_t frameCount = 0u;
+
+  while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+    out << r.frameId << ','
+        << r.start << ','
+        << r.csStart << ','
+        << r.csFinished << ','
+        << r.cpuFinished << ','
+        << r.gpuStart << ','
+        << r.gpuFinished << ','
+        << r.presentFinished << ','
+        << r.gpuSubmitCount << ','
+        << r.gpuReadyCount << ',';
+
+    writeEvents(out, r.gpuSubmit, r.gpuSubmitCount);
+    out << ',';
+    writeEvents(out, r.gpuReady, r.gpuReadyCount);
+    out << '\n';
+
+    frameCount += 1u;
+  }
+
+  std::printf("Converted %llu frames to %s\n",
+    (unsigned long long)frameCount, csvPath.c_str());
+  return 0;
+}
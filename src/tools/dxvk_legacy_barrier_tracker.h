@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include "../dxvk/dxvk_barrier.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Legacy barrier tracker
+   *
+   * Copy of the barrier tracker as it was before hash table entries
+   * stored ranges inline, i.e. a fixed-size implicit hash table of
+   * red-black trees. Only used as a reference by the barrier tracker
+   * benchmark.
+   */
+  class DxvkLegacyBarrierTracker {
+    constexpr static uint32_t HashTableSize = 32u;
+  public:
+
+    DxvkLegacyBarrierTracker();
+
+    ~DxvkLegacyBarrierTracker();
+
+    /**
+     * \brief Checks whether there is a pending access of a given type
+     *
+     * \param [in] range Resource range
+     * \param [in] accessType Access type
+     * \returns \c true if the range has a pending access
+     */
+    bool findRange(
+      const DxvkAddressRange&           range,
+            DxvkAccess                  accessType) const;
+
+    /**
+     * \brief Inserts address range for a given access type
+     *
+     * \param [in] range Resource range
+     * \param [in] accessType Access type
+     */
+    void insertRange(
+      const DxvkAddressRange&           range,
+            DxvkAccess                  accessType);
+
+    /**
+     * \brief Clears the entire structure
+     *
+     * Invalidates all hash table entries and trees.
+     */
+    void clear();
+
+    /**
+     * \brief Checks whether any resources are dirty
+     * \returns \c true if the tracker is empty.
+     */
+    bool empty() const {
+      return !m_rootMaskValid;
+    }
+
+  private:
+
+    uint64_t m_rootMaskValid = 0u;
+    uint64_t m_rootMaskSubtree = 0u;
+
+    std::vector<DxvkBarrierTreeNode>  m_nodes;
+    std::vector<uint32_t>             m_free;
+
+    uint32_t allocateNode();
+
+    void freeNode(uint32_t node);
+
+    uint32_t findNode(
+      const DxvkAddressRange&           range,
+            uint32_t                    rootIndex) const;
+
+    uint32_t insertNode(
+      const DxvkAddressRange&           range,
+            uint32_t                    rootIndex);
+
+    void removeNode(
+            uint32_t                    nodeIndex,
+            uint32_t                    rootIndex);
+
+    void rebalancePostInsert(
+            uint32_t                    nodeIndex,
+            uint32_t                    rootIndex);
+
+    void rotateLeft(
+            uint32_t                    nodeIndex,
+            uint32_t                    rootIndex);
+
+    void rotateRight(
+            uint32_t                    nodeIndex,
+            uint32_t                    rootIndex);
+
+    static uint32_t computeRootIndex(
+      const DxvkAddressRange&           range,
+            DxvkAccess                  access) {
+      // TODO revisit once we use internal allocation
+      // objects or resource cookies here.
+      size_t hash = uint64_t(range.resource) * 93887;
+             hash ^= (hash >> 16);
+
+      // Reserve the upper half of the implicit hash table for written
+      // ranges, and add 1 because 0 refers to the actual null node.
+      return 1u + (hash % HashTableSize) + (access == DxvkAccess::Write ? HashTableSize : 0u);
+    }
+
+  };
+
+}
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <utility>
+
+#include "dxvk_legacy_page_allocator.h"
+
+#include "../util/util_likely.h"
+#include "../util/util_math.h"
+
+namespace dxvk {
+
+  uint32_t DxvkLegacyPageAllocator::pagesUsed(uint32_t chunkIndex) const {
+    return m_chunks.at(chunkIndex).pagesUsed;
+  }
+
+
+  int32_t DxvkLegacyPageAllocator::allocPages(uint32_t count, uint32_t alignment) {
+    int32_t index = searchFreeList(count);
+
+    while (index--) {
+      PageRange entry = m_freeList[index];
+
+      uint32_t chunkIndex = entry.index >> ChunkPageBits;
+
+      if (unlikely(m_chunks[chunkIndex].disabled))
+        continue;
+
+      if (likely(!(entry.index & (alignment - 1u)))) {
+        uint32_t pageIndex = entry.index;
+
+        entry.index += count;
+        entry.count -= count;
+
+        insertFreeRange(entry, index);
+
+        m_chunks[chunkIndex].pagesUsed += count;
+        return pageIndex;
+      } else {
+        uint32_t pageIndex = align(entry.index, alignment);
+
+        if (pageIndex + count > entry.index + entry.count)
+          continue;
+
+        PageRange prevRange = { };
+        prevRange.index = entry.index;
+        prevRange.count = pageIndex - entry.index;
+
+        insertFreeRange(prevRange, index);
+
+        PageRange nextRange = { };
+        nextRange.index = pageIndex + count;
+        nextRange.count = entry.index + entry.count - nextRange.index;
+
+        if (nextRange.count)
+          insertFreeRange(nextRange, -1);
+
+        m_chunks[chunkIndex].pagesUsed += count;
+        return pageIndex;
+      }
+    }
+
+    return -1;
+  }
+
+
+  bool DxvkLegacyPageAllocator::freePages(uint32_t index, uint32_t count) {
+    int32_t prevRange = -1;
+    int32_t nextRange = -1;
+
+    if (index & ChunkPageMask)
+      prevRange = m_freeListLutByPage[index - 1];
+
+    if ((index + count) & ChunkPageMask)
+      nextRange = m_freeListLutByPage[index + count];
+
+    if (prevRange < 0) {
+      if (nextRange < 0) {
+        PageRange range = { };
+        range.index = index;
+        range.count = count;
+
+        insertFreeRange(range, -1);
+      } else {
+        PageRange range = m_freeList[nextRange];
+        range.index = index;
+        range.count += count;
+
+        insertFreeRange(range, nextRange);
+      }
+    } else if (nextRange < 0) {
+      PageRange range = m_freeList[prevRange];
+      range.count += count;
+
+      insertFreeRange(range, prevRange);
+    } else {
+      PageRange prev = m_freeList[prevRange];
+      PageRange next = m_freeList[nextRange];
+
+      PageRange mergedRange = { };
+      mergedRange.index = prev.index;
+      mergedRange.count = next.index + next.count - prev.index;
+
+      PageRange emptyRange = { };
+
+      insertFreeRange(emptyRange, std::max(prevRange, nextRange));
+      insertFreeRange(mergedRange, std::min(prevRange, nextRange));
+    }
+
+    uint32_t chunkIndex = index >> ChunkPageBits;
+    return !(m_chunks[chunkIndex].pagesUsed -= count);
+  }
+
+
+  uint32_t DxvkLegacyPageAllocator::addChunk(uint32_t pageCount) {
+    int32_t chunkIndex = m_freeChunk;
+
+    if (chunkIndex < 0) {
+      chunkIndex = m_chunks.size();
+
+      m_freeListLutByPage.resize((chunkIndex + 1u) << ChunkPageBits, -1);
+      m_chunks.emplace_back();
+    }
+
+    auto& chunk = m_chunks[chunkIndex];
+    m_freeChunk = chunk.nextChunk;
+
+    chunk.pageCount = pageCount;
+    chunk.pagesUsed = 0u;
+    chunk.nextChunk = -1;
+    chunk.disabled = false;
+
+    PageRange pageRange = { };
+    pageRange.index = uint32_t(chunkIndex) << ChunkPageBits;
+    pageRange.count = chunk.pageCount;
+
+    insertFreeRange(pageRange, -1);
+
+    return uint32_t(chunkIndex);
+  }
+
+
+  void DxvkLegacyPageAllocator::removeChunk(uint32_t chunkIndex) {
+    auto& chunk = m_chunks[chunkIndex];
+    chunk.pageCount = 0u;
+    chunk.pagesUsed = 0u;
+    chunk.nextChunk = std::exchange(m_freeChunk, int32_t(chunkIndex));
+    chunk.disabled = true;
+
+    uint32_t pageIndex = chunkIndex << ChunkPageBits;
+
+    PageRange pageRange = { };
+    pageRange.index = pageIndex;
+    pageRange.count = 0;
+
+    insertFreeRange(pageRange, m_freeListLutByPage[pageIndex]);
+  }
+
+
+  void DxvkLegacyPageAllocator::killChunk(uint32_t chunkIndex) {
+    m_chunks[chunkIndex].disabled = true;
+  }
+
+
+  void DxvkLegacyPageAllocator::reviveChunk(uint32_t chunkIndex) {
+    m_chunks[chunkIndex].disabled = false;
+  }
+
+
+  int32_t DxvkLegacyPageAllocator::searchFreeList(uint32_t count) {
+    if (unlikely(m_freeList.empty()))
+      return 0u;
+
+    uint32_t lo = 0u;
+    uint32_t hi = m_freeList.size();
+
+    if (count <= m_freeList.back().count)
+      return int32_t(hi);
+
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2u;
+
+      if (count <= m_freeList[mid].count)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    return int32_t(lo);
+  }
+
+
+  void DxvkLegacyPageAllocator::addLutEntry(const PageRange& range, int32_t index) {
+    m_freeListLutByPage[range.index] = index;
+    m_freeListLutByPage[range.index + range.count - 1u] = index;
+  }
+
+
+  void DxvkLegacyPageAllocator::removeLutEntry(const PageRange& range) {
+    m_freeListLutByPage[range.index] = -1;
+    m_freeListLutByPage[range.index + range.count - 1u] = -1;
+  }
+
+
+  void DxvkLegacyPageAllocator::insertFreeRange(PageRange newRange, int32_t currentIndex) {
+    size_t count = m_freeList.size();
+    size_t index = size_t(currentIndex);
+
+    if (unlikely(currentIndex < 0)) {
+      m_freeList.emplace_back();
+      index = count++;
+    }
+
+    PageRange oldRange = m_freeList[index];
+
+    if (likely(oldRange.count))
+      removeLutEntry(oldRange);
+
+    if (newRange.count < oldRange.count) {
+      while (index + 1u < count) {
+        PageRange next = m_freeList[index + 1u];
+
+        if (newRange.count >= next.count)
+          break;
+
+        addLutEntry(next, index);
+        m_freeList[index++] = next;
+      }
+    } else if (newRange.count > oldRange.count) {
+      while (index) {
+        PageRange prev = m_freeList[index - 1u];
+
+        if (newRange.count <= prev.count)
+          break;
+
+        addLutEntry(prev, index);
+        m_freeList[index--] = prev;
+      }
+    }
+
+    if (newRange.count) {
+      m_freeList[index] = newRange;
+      addLutEntry(newRange, index);
+    } else {
+      m_freeList.pop_back();
+    }
+  }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../dxvk/dxvk_allocator.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Legacy page allocator
+   *
+   * Copy of the page allocator as it was before free ranges were moved
+   * to a segregated free list, i.e. a single free list sorted by size.
+   * Only used as a reference by the page allocator test and benchmark,
+   * and therefore only implements the page-level interface.
+   */
+  class DxvkLegacyPageAllocator {
+
+  public:
+
+    constexpr static uint32_t ChunkPageBits = DxvkPageAllocator::ChunkPageBits;
+    constexpr static uint32_t ChunkPageMask = DxvkPageAllocator::ChunkPageMask;
+
+    uint32_t pagesUsed(uint32_t chunkIndex) const;
+
+    int32_t allocPages(uint32_t count, uint32_t alignment);
+
+    bool freePages(uint32_t index, uint32_t count);
+
+    uint32_t addChunk(uint32_t pageCount);
+
+    void removeChunk(uint32_t chunkIndex);
+
+    void killChunk(uint32_t chunkIndex);
+
+    void reviveChunk(uint32_t chunkIndex);
+
+  private:
+
+    struct ChunkInfo {
+      uint32_t  pageCount = 0u;
+      uint32_t  pagesUsed = 0u;
+      int32_t   nextChunk = -1;
+      bool      disabled  = false;
+    };
+
+    struct PageRange {
+      uint32_t  index = 0u;
+      uint32_t  count = 0u;
+    };
+
+    std::vector<PageRange>  m_freeList;
+    std::vector<int32_t>    m_freeListLutByPage;
+
+    std::vector<ChunkInfo>  m_chunks;
+    int32_t                 m_freeChunk = -1;
+
+    int32_t searchFreeList(uint32_t count);
+
+    void addLutEntry(const PageRange& range, int32_t index);
+
+    void removeLutEntry(const PageRange& range);
+
+    void insertFreeRange(PageRange newRange, int32_t currentIndex);
+
+  };
+
+}
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "../dxvk/dxvk_perf_log.h"
+
+// Performance log converter
+//
+// Converts a binary log written when DXVK_PERF_LOG is set to CSV,
+// with one line per presented frame and one column per stat counter.
+// Counter values are the difference to the previous frame.
+//
+// Usage: dxvk-perf-log <log> [<csv>]
+//
+// The CSV file defaults to the log file name with .csv appended.
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-perf-log.log");
+}
+
+using namespace dxvk;
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "Usage: %s <log> [<csv>]\n", argv[0]);
+    return 1;
+  }
+
+  std::string logPath = argv[1];
+  std::string csvPath = argc > 2 ? argv[2] : logPath + ".csv";
+
+  std::ifstream in(str::topath(logPath.c_str()).c_str(), std::ios_base::binary);
+
+  DxvkPerfLogHeader expected;
+  expected.recordSize = sizeof(DxvkPerfLogRecord);
+
+  DxvkPerfLogHeader header;
+
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+   || std::memcmp(&header, &expected, sizeof(header))) {
+    std::fprintf(stderr, "Invalid log file %s\n", logPath.c_str());
+    return 1;
+  }
+
+  std::ofstream out(str::topath(csvPath.c_str()).c_str(), std::ios_base::trunc);
+
+  if (!out) {
+    std::fprintf(stderr, "Failed to open %s\n", csvPath.c_str());
+    return 1;
+  }
+
+  out << "frameId,timestamp";
+
+  for (uint32_t i = 0; i < header.counterCount; i++)
+    out << ',' << DxvkStatCounters::getName(DxvkStatCounter(i));
+
+  out << '\n';
+
+  DxvkPerfLogRecord record;
+  uint64_t frameCount = 0u;
+
+  while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+    out << record.frameId << ',' << record.timestamp;
+
+    for (uint32_t i = 0; i < header.counterCount; i++)
+      out << ',' << record.counters[i];
+
+    out << '\n';
+
+    frameCount += 1u;
+  }
+
+  std::printf("Converted %llu frames to %s\n",
+    (unsigned long long)frameCount, csvPath.c_str());
+  return 0;
+}
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../dxbc/dxbc_module.h"
+
+#include "../dxso/dxso_module.h"
+
+#include "../d3d9/d3d9_caps.h"
+
+#include "../dxvk/dxvk_shader_log.h"
+
+#include "../util/util_math.h"
+
+// Shader corpus runner
+//
+// Translates every .dxbc and .dxso file in a directory tree, as written
+// by dxvk.shaderDumpPath, and records the results in a shader log. This
+// allows changes to the shader compilers to be measured and checked
+// against a fixed corpus without running a game or creating a device.
+//
+// Usage: dxvk-shader-corpus [options] <directory>
+//   --threads <n>         Number of worker threads, defaults to all cores
+//   --output <file>       CSV file to write per-shader results to
+//   --spirv <directory>   Directory to write the generated SPIR-V to
+//   --dxbc <option>       Enables a boolean DXBC compiler option
+//   --dxso <option>       Enables a boolean DXSO compiler option
+//   --ssbo-alignment <n>  Minimum SSBO alignment for DXBC raw buffers
+//   --float-emulation <m> DXSO float emulation, disabled|enabled|strict
+//   --swvp                Use the software vertex processing constant layout
+//
+// Per-stage statistics are logged when all shaders are translated.
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-shader-corpus.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct CorpusParameters {
+    std::string              directory;
+    std::string              output     = "shader-corpus.csv";
+    std::string              spirvPath;
+    uint32_t                 threads    = 0u;
+    bool                     swvp       = false;
+
+    DxbcOptions              dxbcOptions;
+    DxsoOptions              dxsoOptions;
+  };
+
+
+  struct DxbcBoolOption {
+    const char*              name;
+    bool DxbcOptions::*      member;
+  };
+
+
+  struct DxsoBoolOption {
+    const char*              name;
+    bool DxsoOptions::*      member;
+  };
+
+
+  const std::array<DxbcBoolOption, 13> g_dxbcOptions = {{
+    { "useDepthClipWorkaround",       &DxbcOptions::useDepthClipWorkaround       },
+    { "supportsTypedUavLoadR32",      &DxbcOptions::supportsTypedUavLoadR32      },
+    { "supportsRawAccessChains",      &DxbcOptions::supportsRawAccessChains      },
+    { "zeroInitWorkgroupMemory",      &DxbcOptions::zeroInitWorkgroupMemory      },
+    { "invariantPosition",            &DxbcOptions::invariantPosition            },
+    { "forceVolatileTgsmAccess",      &DxbcOptions::forceVolatileTgsmAccess      },
+    { "forceComputeUavBarriers",      &DxbcOptions::forceComputeUavBarriers      },
+    { "disableMsaa",                  &DxbcOptions::disableMsaa                  },
+    { "forceSampleRateShading",       &DxbcOptions::forceSampleRateShading       },
+    { "enableSampleShadingInterlock", &DxbcOptions::enableSampleShadingInterlock },
+    { "supportsTightIcbPacking",      &DxbcOptions::supportsTightIcbPacking      },
+    { "needsPointSizeExport",         &DxbcOptions::needsPointSizeExport         },
+    { "optimizeSpirv",                &DxbcOptions::optimizeSpirv                },
+  }};
+
+
+  const std::array<DxsoBoolOption, 8> g_dxsoOptions = {{
+    { "strictConstantCopies",            &DxsoOptions::strictConstantCopies            },
+    { "strictPow",                       &DxsoOptions::strictPow                       },
+    { "invariantPosition",               &DxsoOptions::invariantPosition               },
+    { "forceSamplerTypeSpecConstants",   &DxsoOptions::forceSamplerTypeSpecConstants   },
+    { "forceSampleRateShading",          &DxsoOptions::forceSampleRateShading          },
+    { "vertexFloatConstantBufferAsSSBO", &DxsoOptions::vertexFloatConstantBufferAsSSBO },
+    { "robustness2Supported",            &DxsoOptions::robustness2Supported            },
+    { "optimizeSpirv",                   &DxsoOptions::optimizeSpirv                   },
+  }};
+
+
+  void initDefaultOptions(CorpusParameters& params) {
+    // Roughly matches what a desktop driver would report
+    params.dxbcOptions.minSsboAlignment = 16u;
+
+    // DxsoOptions has no defaults for most of its members
+    for (const auto& option : g_dxsoOptions)
+      params.dxsoOptions.*option.member = false;
+
+    params.dxsoOptions.d3d9FloatEmulation = D3D9FloatEmulation::Enabled;
+    params.dxsoOptions.robustness2Supported = true;
+  }
+
+
+  bool parseArgs(int argc, char** argv, CorpusParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+
+      if (arg == "--swvp") {
+        params.swvp = true;
+        continue;
+      }
+
+      if (arg.size() < 2 || arg[0] != '-' || arg[1] != '-') {
+        if (!params.directory.empty())
+          return false;
+
+        params.directory = arg;
+        continue;
+      }
+
+      if (i + 1 >= argc)
+        return false;
+
+      const char* value = argv[++i];
+
+      if (arg == "--threads") {
+        params.threads = uint32_t(std::strtoul(value, nullptr, 10));
+      } else if (arg == "--output") {
+        params.output = value;
+      } else if (arg == "--spirv") {
+        params.spirvPath = value;
+      } else if (arg == "--ssbo-alignment") {
+        params.dxbcOptions.minSsboAlignment = std::strtoull(value, nullptr, 10);
+      } else if (arg == "--float-emulation") {
+        if (!std::strcmp(value, "disabled"))
+          params.dxsoOptions.d3d9FloatEmulation = D3D9FloatEmulation::Disabled;
+        else if (!std::strcmp(value, "enabled"))
+          params.dxsoOptions.d3d9FloatEmulation = D3D9FloatEmulation::Enabled;
+        else if (!std::strcmp(value, "strict"))
+          params.dxsoOptions.d3d9FloatEmulation = D3D9FloatEmulation::Strict;
+        else
+          return false;
+      } else if (arg == "--dxbc") {
+        bool found = false;
+
+        for (const auto& option : g_dxbcOptions) {
+          if (!std::strcmp(option.name, value)) {
+            params.dxbcOptions.*option.member = true;
+            found = true;
+          }
+        }
+
+        if (!found)
+          return false;
+      } else if (arg == "--dxso") {
+        bool found = false;
+
+        for (const auto& option : g_dxsoOptions) {
+          if (!std::strcmp(option.name, value)) {
+            params.dxsoOptions.*option.member = true;
+            found = true;
+          }
+        }
+
+        if (!found)
+          return false;
+      } else {
+        return false;
+      }
+    }
+
+    return !params.directory.empty();
+  }
+
+
+  D3D9ConstantLayout getConstantLayout(DxsoProgramType type, bool swvp) {
+    // Matches D3D9DeviceEx::DetermineConstantLayouts
+    D3D9ConstantLayout layout = { };
+
+    if (type == DxsoProgramType::VertexShader) {
+      layout.floatCount = swvp ? caps::MaxFloatConstantsSoftware : caps::MaxFloatConstantsVS;
+      layout.intCount   = swvp ? caps::MaxOtherConstantsSoftware : caps::MaxOtherConstants;
+      layout.boolCount  = swvp ? caps::MaxOtherConstantsSoftware : caps::MaxOtherConstants;
+    } else {
+      layout.floatCount = caps::MaxFloatConstantsPS;
+      layout.intCount   = caps::MaxOtherConstants;
+      layout.boolCount  = caps::MaxOtherConstants;
+    }
+
+    layout.bitmaskCount = align(layout.boolCount, 32) / 32;
+    return layout;
+  }
+
+
+  bool readFile(const std::filesystem::path& path, std::vector<char>& data) {
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+
+    if (!file)
+      return false;
+
+    data.resize(size_t(file.tellg()));
+    file.seekg(0);
+    return bool(file.read(data.data(), data.size()));
+  }
+
+
+  Rc<DxvkShader> translateDxbc(
+    const CorpusParameters&       params,
+          DxvkShaderLog&          log,
+    const std::string&            name,
+    const std::vector<char>&      data) {
+    DxbcReader reader(data.data(), data.size());
+    DxbcModule module(reader);
+
+    if (!module.programInfo())
+      throw DxvkError("Invalid shader binary.");
+
+    DxbcModuleInfo moduleInfo = { };
+    moduleInfo.options = params.dxbcOptions;
+
+    auto t0 = high_resolution_clock::now();
+    Rc<DxvkShader> shader = module.compile(moduleInfo, name);
+    auto t1 = high_resolution_clock::now();
+
+    log.logShader(shader, data.size(), t1 - t0);
+    return shader;
+  }
+
+
+  Rc<DxvkShader> translateDxso(
+    const CorpusParameters&       params,
+          DxvkShaderLog&          log,
+    const std::string&            name,
+    const std::vector<char>&      data) {
+    DxsoReader reader(data.data());
+    DxsoModule module(reader);
+
+    DxsoModuleInfo moduleInfo = { };
+    moduleInfo.options = params.dxsoOptions;
+
+    D3D9ConstantLayout layout = getConstantLayout(
+      module.info().type(), params.swvp);
+
+    auto t0 = high_resolution_clock::now();
+    DxsoAnalysisInfo analysis = module.analyze();
+    Rc<DxvkShader> shader = module.compile(moduleInfo, name, analysis, layout);
+    auto t1 = high_resolution_clock::now();
+
+    log.logShader(shader, analysis.bytecodeByteLength, t1 - t0);
+    return shader;
+  }
+
+
+  void writeSpirv(
+    const CorpusParameters&       params,
+    const std::string&            name,
+    const Rc<DxvkShader>&         shader) {
+    std::ofstream file(
+      str::topath(str::format(params.spirvPath, "/", name, ".spv").c_str()).c_str(),
+      std::ios_base::binary | std::ios_base::trunc);
+
+    if (!file)
+      throw DxvkError("Failed to write SPIR-V.");
+
+    shader->dump(file);
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  CorpusParameters params;
+  initDefaultOptions(params);
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--threads <n>] [--output <file>] [--spirv <directory>] [--dxbc <option>] [--dxso <option>]"
+      " [--ssbo-alignment <n>] [--float-emulation <mode>] [--swvp] <directory>\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> files;
+  std::error_code ec;
+
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(params.directory, ec)) {
+    auto ext = entry.path().extension();
+
+    if (entry.is_regular_file() && (ext == ".dxbc" || ext == ".dxso"))
+      files.push_back(entry.path());
+  }
+
+  if (ec) {
+    std::fprintf(stderr, "Failed to read %s: %s\n", params.directory.c_str(), ec.message().c_str());
+    return 1;
+  }
+
+  std::sort(files.begin(), files.end());
+
+  uint32_t threadCount = params.threads;
+
+  if (!threadCount)
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+  std::fprintf(stderr, "Translating %zu shaders on %u threads\n", files.size(), threadCount);
+
+  std::atomic<size_t>   nextFile    = { 0u };
+  std::atomic<uint32_t> errorCount  = { 0u };
+
+  auto t0 = high_resolution_clock::now();
+
+  { // The shader log writes its statistics when destroyed
+    DxvkShaderLog log(params.output);
+
+    auto worker = [&] {
+      std::vector<char> data;
+      size_t index;
+
+      while ((index = nextFile++) < files.size()) {
+        const auto& path = files[index];
+        std::string name = path.stem().string();
+
+        try {
+          if (!readFile(path, data))
+            throw DxvkError("Failed to read file.");
+
+          Rc<DxvkShader> shader = path.extension() == ".dxbc"
+            ? translateDxbc(params, log, name, data)
+            : translateDxso(params, log, name, data);
+
+          if (!params.spirvPath.empty())
+            writeSpirv(params, name, shader);
+        } catch (const DxvkError& e) {
+          std::fprintf(stderr, "%s: %s\n", path.string().c_str(), e.message().c_str());
+          errorCount += 1;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 1; i < threadCount; i++)
+      threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  auto t1 = high_resolution_clock::now();
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+
+  std::fprintf(stderr, "Translated %zu shaders in %.2f ms, %u failed\n",
+    files.size() - errorCount.load(), double(us) / 1000.0, errorCount.load());
+  return errorCount.load() ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include "../dxvk/dxvk_defrag.h"
+
+// Defragmentation scheduler policy test
+//
+// Checks the policy functions of DxvkDefragScheduler on page allocators
+// with a known layout, i.e. how chunks get ranked for relocation, at
+// which point a pool is considered fragmented enough to defragment for
+// each memory pressure level, and how the copy budget token bucket
+// refills and lets large relocations borrow from future submissions.
+//
+// Usage: dxvk-test-defrag-scheduler
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-test-defrag-scheduler.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  using time_point = high_resolution_clock::time_point;
+
+  constexpr VkDeviceSize MB = 1ull << 20;
+
+
+  struct ChunkLayout {
+    uint32_t pageCount;
+    uint32_t pagesUsed;
+  };
+
+
+  uint32_t g_errors = 0u;
+
+  void check(bool condition, const char* test, const char* what) {
+    if (!condition && g_errors++ < 16u)
+      std::fprintf(stderr, "%s: %s\n", test, what);
+  }
+
+
+  void initPool(DxvkPageAllocator& allocator, std::initializer_list<ChunkLayout> chunks) {
+    // Fill every chunk completely and free the unused tail afterwards,
+    // since the allocator picks which chunk to allocate pages from.
+    for (const auto& chunk : chunks)
+      allocator.addChunk(chunk.pageCount * DxvkPageAllocator::PageSize);
+
+    while (allocator.allocPages(1u, 1u) >= 0)
+      continue;
+
+    uint32_t chunkIndex = 0u;
+
+    for (const auto& chunk : chunks) {
+      uint32_t firstPage = chunkIndex++ << DxvkPageAllocator::ChunkPageBits;
+
+      if (chunk.pagesUsed < chunk.pageCount)
+        allocator.freePages(firstPage + chunk.pagesUsed, chunk.pageCount - chunk.pagesUsed);
+    }
+  }
+
+
+  void testPressure() {
+    constexpr const char* Test = "computePressure";
+
+    VkDeviceSize budget = 8192u * MB;
+
+    check(DxvkDefragScheduler::computePressure(0u, budget) == DxvkDefragPressure::Low,
+      Test, "empty heap is not low pressure");
+    check(DxvkDefragScheduler::computePressure(7168u * MB, budget) == DxvkDefragPressure::Low,
+      Test, "heap with an eighth of the budget left is not low pressure");
+    check(DxvkDefragScheduler::computePressure(7168u * MB + 1u, budget) == DxvkDefragPressure::High,
+      Test, "heap with less than an eighth of the budget left is not high pressure");
+    check(DxvkDefragScheduler::computePressure(budget, budget) == DxvkDefragPressure::High,
+      Test, "heap at its budget is not high pressure");
+    check(DxvkDefragScheduler::computePressure(budget + 1u, budget) == DxvkDefragPressure::OverBudget,
+      Test, "heap exceeding its budget is not over budget");
+  }
+
+
+  void testShouldDefragment() {
+    constexpr const char* Test = "shouldDefragment";
+
+    // 64 pages per chunk, i.e. one chunk worth of waste is tolerated
+    VkDeviceSize chunkSize = 64u * DxvkPageAllocator::PageSize;
+
+    { DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 64u }, { 64u, 64u } });
+
+      check(!DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::High),
+        Test, "full pool defragmented");
+      check(DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::OverBudget),
+        Test, "full pool not defragmented over budget");
+    }
+
+    { // 192 pages, 114 used. Low pressure tolerates 64 + 114 / 8 = 78
+      // unused pages, high pressure only tolerates 64 unused pages.
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 60u }, { 64u, 34u }, { 64u, 20u } });
+
+      check(!DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::Low),
+        Test, "pool within tolerance defragmented at low pressure");
+      check(DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::High),
+        Test, "pool exceeding tolerance not defragmented at high pressure");
+    }
+
+    { // 192 pages, 113 used, one page more than tolerated at low pressure
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 60u }, { 64u, 33u }, { 64u, 20u } });
+
+      check(DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::Low),
+        Test, "fragmented pool not defragmented at low pressure");
+    }
+
+    { // Empty chunks get freed on their own and must not count as waste
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 64u }, { 64u, 0u }, { 64u, 0u }, { 64u, 60u } });
+
+      check(!DxvkDefragScheduler::shouldDefragment(allocator, chunkSize, DxvkDefragPressure::High),
+        Test, "empty chunks counted as waste");
+    }
+  }
+
+
+  void testPickChunk() {
+    constexpr const char* Test = "pickChunk";
+
+    auto canMoveAll = [] (uint32_t) { return true; };
+
+    { // Chunk 1 frees the most memory per copied page
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 48u }, { 64u, 8u }, { 64u, 32u }, { 64u, 0u } });
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) == 1,
+        Test, "chunk with the highest capacity per used page not picked");
+      check(!allocator.chunkIsAvailable(1u),
+        Test, "picked chunk not killed");
+      check(!allocator.chunkIsAvailable(3u),
+        Test, "empty chunk not killed");
+      check(allocator.chunkIsAvailable(0u) && allocator.chunkIsAvailable(2u),
+        Test, "other chunks killed");
+
+      // Must not pick another chunk while chunk 1 is still being moved
+      check(DxvkDefragScheduler::pickChunk(allocator, true, canMoveAll) < 0,
+        Test, "second chunk picked while relocation is pending");
+      check(!allocator.chunkIsAvailable(1u),
+        Test, "pending chunk revived");
+    }
+
+    { // Once chunk 1 is done, chunk 2 is next, which revives chunk 1
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 8u }, { 64u, 4u }, { 64u, 32u } });
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) == 1,
+        Test, "chunk with the highest capacity per used page not picked");
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) == 0,
+        Test, "next chunk not picked after relocation finished");
+      check(allocator.chunkIsAvailable(1u) && !allocator.chunkIsAvailable(0u),
+        Test, "more than one non-empty chunk dead");
+    }
+
+    { // Same ratio, prefer the chunk with fewer pages to copy
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 16u }, { 32u, 8u }, { 64u, 56u } });
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) == 1,
+        Test, "tie not broken towards the smaller chunk");
+    }
+
+    { // Chunks that cannot be moved are never picked
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 40u }, { 64u, 4u }, { 64u, 16u } });
+
+      auto canMove = [] (uint32_t chunk) { return chunk != 1u; };
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMove) == 2,
+        Test, "immovable chunk picked");
+      check(allocator.chunkIsAvailable(1u),
+        Test, "immovable chunk killed");
+    }
+
+    { // Remaining chunks need 1.5x the used pages of the picked chunk
+      DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 52u }, { 64u, 8u } });
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) == 1,
+        Test, "chunk not picked with sufficient free space");
+    }
+
+    { DxvkPageAllocator allocator;
+      initPool(allocator, { { 64u, 53u }, { 64u, 8u } });
+
+      check(DxvkDefragScheduler::pickChunk(allocator, false, canMoveAll) < 0,
+        Test, "chunk picked with insufficient free space");
+      check(allocator.chunkIsAvailable(0u) && allocator.chunkIsAvailable(1u),
+        Test, "chunk killed with insufficient free space");
+    }
+  }
+
+
+  void testCopyBudget() {
+    constexpr const char* Test = "getCopyBudget";
+
+    // Low pressure allows 4 MB per submission at 64 MB/s,
+    // i.e. the bucket refills completely within 62.5 ms.
+    DxvkDefragScheduler scheduler;
+
+    time_point t = time_point(std::chrono::seconds(1));
+
+    check(scheduler.getCopyBudget(t) == 4u * MB,
+      Test, "bucket not full initially");
+
+    scheduler.notifyRelocation(1u * MB, 1u);
+
+    check(scheduler.getCopyBudget(t) == 3u * MB,
+      Test, "relocation did not consume budget");
+
+    // A resource larger than the budget may still be moved, in which
+    // case subsequent submissions pay for it until the debt is repaid.
+    scheduler.notifyRelocation(19u * MB, 1u);
+
+    check(scheduler.getCopyBudget(t) == 0u,
+      Test, "budget left after borrowing");
+
+    t += std::chrono::milliseconds(125);
+
+    check(scheduler.getCopyBudget(t) == 0u,
+      Test, "debt repaid too early");
+
+    t += std::chrono::milliseconds(125);
+
+    check(scheduler.getCopyBudget(t) == 0u,
+      Test, "debt repaid too early");
+
+    // 16 MB debt minus 16 MB refilled over 250 ms, plus 1 MB
+    t += std::chrono::microseconds(15625);
+
+    check(scheduler.getCopyBudget(t) == 1u * MB,
+      Test, "debt not repaid at the sustained rate");
+
+    // Idle time must not accumulate more than one submission's worth
+    t += std::chrono::seconds(10);
+
+    check(scheduler.getCopyBudget(t) == 4u * MB,
+      Test, "bucket exceeds the submission limit");
+
+    // Time going backwards must not drain or refill the bucket
+    scheduler.notifyRelocation(2u * MB, 1u);
+
+    check(scheduler.getCopyBudget(t - std::chrono::seconds(1)) == 2u * MB,
+      Test, "bucket changed when time went backwards");
+
+    check(scheduler.getCopyBudget(t) == 4u * MB,
+      Test, "bucket not refilled after time went backwards");
+
+    scheduler.notifyRelocation(4u * MB, 1u);
+
+    // Higher pressure raises both the limit and the refill rate,
+    // 1 GB/s over budget, which refills about 41 MB in 40 ms.
+    scheduler.setPressure(DxvkDefragPressure::OverBudget);
+
+    t += std::chrono::milliseconds(40);
+
+    VkDeviceSize budget = scheduler.getCopyBudget(t);
+
+    check(budget > 32u * MB && budget < 64u * MB,
+      Test, "refill rate not raised over budget");
+
+    t += std::chrono::seconds(1);
+
+    check(scheduler.getCopyBudget(t) == 64u * MB,
+      Test, "submission limit not raised over budget");
+
+    // Lowering the pressure clamps the bucket right away
+    scheduler.setPressure(DxvkDefragPressure::High);
+
+    check(scheduler.getCopyBudget(t) == 16u * MB,
+      Test, "bucket not clamped when pressure dropped");
+
+    DxvkDefragStats stats = scheduler.getStats();
+
+    check(stats.relocatedBytes == 26u * MB && stats.relocatedCount == 4u,
+      Test, "wrong relocation statistics");
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  testPressure();
+  testShouldDefragment();
+  testPickChunk();
+  testCopyBudget();
+
+  if (g_errors) {
+    std::fprintf(stderr, "%u errors\n", g_errors);
+    return 1;
+  }
+
+  std::printf("All defragmentation policy checks passed\n");
+  return 0;
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../dxvk/framepacer/dxvk_latency_markers.h"
+
+// Latency timestamp log stress test
+//
+// Appends timestamps to a LatencyTimestampLog from several threads while
+// another thread keeps clearing it, and checks that readers only ever see
+// timestamps that were pushed for the current frame, in order.
+//
+// Each timestamp encodes the frame it was pushed for, the writer thread
+// and a per-thread sequence number. Since a thread reserves slots in the
+// order it pushes them, the sequence numbers of one thread must increase
+// with the slot index. A writer that raced with clear and overwrote a slot
+// of the next frame would break that order, or show up with a frame that
+// is older than any frame a writer was working on when the log was cleared.
+//
+// Usage: dxvk-test-latency-log [--frames <n>] [--threads <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-test-latency-log.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  using Log = LatencyTimestampLog<LatencyMarkers::MaxEvents>;
+  using time_point = Log::time_point;
+
+  constexpr uint32_t FrameShift   = 40u;
+  constexpr uint32_t ThreadShift  = 32u;
+
+
+  struct TestParameters {
+    uint32_t frames   = 100000u;
+    uint32_t threads  = 4u;
+  };
+
+
+  struct Stamp {
+    uint64_t frame;
+    uint32_t thread;
+    uint32_t seq;
+  };
+
+
+  time_point encode(uint64_t frame, uint32_t thread, uint32_t seq) {
+    return time_point(high_resolution_clock::duration(int64_t(
+      (frame << FrameShift) | (uint64_t(thread) << ThreadShift) | seq)));
+  }
+
+
+  Stamp decode(time_point t) {
+    uint64_t value = uint64_t(t.time_since_epoch().count());
+
+    Stamp result;
+    result.frame  = value >> FrameShift;
+    result.thread = uint32_t(value >> ThreadShift) & 0xffu;
+    result.seq    = uint32_t(value);
+    return result;
+  }
+
+
+  uint32_t g_errors = 0u;
+
+  void fail(const char* what, uint64_t frame, uint32_t index) {
+    if (g_errors++ < 16u)
+      std::fprintf(stderr, "Frame %llu, slot %u: %s\n", (unsigned long long)frame, index, what);
+  }
+
+
+  void validate(const Log& log, uint64_t frame, uint64_t oldest, uint32_t threadCount) {
+    uint32_t size = log.size();
+
+    if (size > Log::Capacity)
+      fail("size exceeds capacity", frame, size);
+
+    std::vector<int64_t> lastSeq(threadCount, -1);
+
+    for (uint32_t i = 0; i < size; i++) {
+      Stamp stamp = decode(log[i]);
+
+      if (stamp.frame > frame || stamp.frame < oldest) {
+        fail("timestamp from a different frame", frame, i);
+        continue;
+      }
+
+      if (stamp.thread >= threadCount) {
+        fail("timestamp from an unknown thread", frame, i);
+        continue;
+      }
+
+      if (int64_t(stamp.seq) <= lastSeq[stamp.thread])
+        fail("timestamps out of order", frame, i);
+
+      lastSeq[stamp.thread] = stamp.seq;
+    }
+  }
+
+
+  void testSequential() {
+    Log log;
+    log.clear(encode(1u, 0u, 0u));
+
+    if (!log.empty())
+      fail("log not empty after clear", 1u, 0u);
+
+    for (uint32_t i = 0; i < Log::Capacity + 3u; i++)
+      log.push_back(encode(1u, 0u, i));
+
+    if (log.size() != Log::Capacity || log.overflowCount() != 3u || !log.overflowed())
+      fail("wrong size after overflow", 1u, log.size());
+
+    for (uint32_t i = 0; i < log.size(); i++) {
+      if (log[i] != encode(1u, 0u, i))
+        fail("wrong timestamp", 1u, i);
+    }
+
+    // Timestamps may predate the base
+    log.clear(encode(3u, 0u, 0u));
+    log.push_back(encode(2u, 1u, 7u));
+
+    if (log.size() != 1u || log.overflowed() || log[0] != encode(2u, 1u, 7u))
+      fail("wrong timestamp before base", 3u, 0u);
+  }
+
+
+  void testConcurrent(const TestParameters& params) {
+    Log log;
+    log.clear(encode(1u, 0u, 0u));
+
+    std::atomic<uint64_t> frame = { 1u };
+    std::atomic<uint64_t> pushed = { 0u };
+    std::atomic<bool> stop = { false };
+
+    // Frame that each writer last pushed, or is about to push, a
+    // timestamp for. Anything pushed later is for the same frame
+    // or a newer one, which bounds how old a visible stamp can be.
+    std::vector<std::atomic<uint64_t>> current(params.threads);
+
+    for (auto& c : current)
+      c.store(1u);
+
+    std::vector<std::thread> writers;
+
+    for (uint32_t i = 0; i < params.threads; i++) {
+      writers.emplace_back([&, i] {
+        uint32_t seq = 0u;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+          uint64_t f = frame.load();
+          current[i].store(f);
+          log.push_back(encode(f, i, seq++));
+
+          // Let other threads run on machines with few cores
+          if (!(pushed.fetch_add(1u, std::memory_order_relaxed) % 16u))
+            std::this_thread::yield();
+        }
+      });
+    }
+
+    for (uint64_t f = 2u; f <= params.frames; f++) {
+      uint64_t oldest = f;
+
+      for (const auto& c : current)
+        oldest = std::min(oldest, c.load());
+
+      log.clear(encode(f, 0u, 0u));
+      frame.store(f);
+
+      validate(log, f, oldest, params.threads);
+
+      // Give writers a chance to push into the new frame
+      uint64_t target = pushed.load() + params.threads;
+
+      while (pushed.load() < target)
+        std::this_thread::yield();
+
+      validate(log, f, oldest, params.threads);
+    }
+
+    stop.store(true);
+
+    for (auto& t : writers)
+      t.join();
+  }
+
+
+  void testQuiescent(const TestParameters& params) {
+    Log log;
+
+    for (uint32_t n = 1u; n <= 32u; n++) {
+      log.clear(encode(n, 0u, 0u));
+
+      std::vector<std::thread> writers;
+
+      for (uint32_t i = 0; i < params.threads; i++) {
+        writers.emplace_back([&, i] {
+          for (uint32_t j = 0; j < n; j++)
+            log.push_back(encode(n, i, j));
+        });
+      }
+
+      for (auto& t : writers)
+        t.join();
+
+      uint32_t total = n * params.threads;
+      uint32_t expectedSize = std::min(total, Log::Capacity);
+
+      if (log.size() != expectedSize || log.overflowCount() != total - expectedSize)
+        fail("wrong size after all writers finished", n, log.size());
+
+      validate(log, n, n, params.threads);
+    }
+  }
+
+
+  bool parseArgs(int argc, char** argv, TestParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--frames")
+        params.frames = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--threads")
+        params.threads = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.frames >= 2u && params.threads >= 1u && params.threads <= 256u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  TestParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--frames <n>] [--threads <n>]\n", argv[0]);
+    return 1;
+  }
+
+  testSequential();
+  testQuiescent(params);
+  testConcurrent(params);
+
+  if (g_errors) {
+    std::fprintf(stderr, "%u errors\n", g_errors);
+    return 1;
+  }
+
+  std::printf("%u frames on %u threads passed\n", params.frames, params.threads);
+  return 0;
+}
@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dxvk_legacy_page_allocator.h"
+
+#include "../util/log/log.h"
+
+// Page allocator randomized test
+//
+// Runs random sequences of page allocations, frees, and chunk additions,
+// removals, kills and revivals against DxvkPageAllocator, and checks the
+// result of every operation against a model that tracks each page.
+// Allocations must be aligned, must not overlap, and must fail only if
+// no enabled chunk has a suitable free range.
+//
+// The sorted free list the allocator used previously is the reference
+// for which allocations can be served. At regular intervals, its state
+// is rebuilt from the current page layout and random allocations close
+// to the largest free range are performed on both allocators, which must
+// then either both succeed or both fail.
+//
+// Usage: dxvk-test-page-allocator [--seeds <n>] [--ops <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-test-page-allocator.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  constexpr uint32_t ChunkPageCount = 1u << DxvkPageAllocator::ChunkPageBits;
+  constexpr uint32_t MaxChunks      = 12u;
+  constexpr uint32_t CheckInterval  = 64u;
+  constexpr uint32_t ProbeCount     = 16u;
+
+
+  struct TestParameters {
+    uint32_t seeds  = 8u;
+    uint32_t ops    = 20000u;
+  };
+
+
+  struct ModelChunk {
+    uint32_t          pageCount = 0u;
+    uint32_t          pagesUsed = 0u;
+    bool              disabled  = false;
+    bool              removed   = false;
+    std::vector<bool> used;
+  };
+
+
+  struct ModelAllocation {
+    uint32_t index;
+    uint32_t count;
+  };
+
+
+  uint32_t g_errors = 0u;
+
+  void check(bool condition, uint32_t seed, uint32_t op, const char* what) {
+    if (!condition && g_errors++ < 16u)
+      std::fprintf(stderr, "seed %u, op %u: %s\n", seed, op, what);
+  }
+
+
+  class PageAllocatorTest {
+
+  public:
+
+    PageAllocatorTest(uint32_t seed)
+    : m_seed(seed), m_rng(seed) { }
+
+    void run(uint32_t opCount) {
+      for (uint32_t i = 0; i < 4u; i++)
+        addChunk();
+
+      for (m_op = 0; m_op < opCount; m_op++) {
+        uint32_t op = random(100u);
+
+        if (op < 50u)
+          allocate();
+        else if (op < 85u)
+          free();
+        else if (op < 89u)
+          killChunk();
+        else if (op < 93u)
+          reviveChunk();
+        else if (op < 94u)
+          reviveChunks();
+        else if (op < 96u)
+          removeChunk();
+        else
+          addChunk();
+
+        if (!(m_op % CheckInterval)) {
+          checkLayout();
+          checkLegacy();
+        }
+      }
+
+      // Free everything in random order, which must
+      // leave every chunk in one single free range
+      while (!m_allocations.empty())
+        free();
+
+      checkLayout();
+
+      reviveChunks();
+      checkLegacy();
+
+      for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        if (!m_chunks[i].removed) {
+          int32_t index = m_allocator.allocPages(m_chunks[i].pageCount, 1u);
+          check(index >= 0, m_seed, m_op, "empty chunk not allocated in full");
+
+          if (index >= 0)
+            m_allocator.freePages(index, m_chunks[i].pageCount);
+        }
+      }
+    }
+
+  private:
+
+    uint32_t                      m_seed;
+    uint32_t                      m_op = 0u;
+    std::mt19937                  m_rng;
+
+    DxvkPageAllocator             m_allocator;
+
+    std::vector<ModelChunk>       m_chunks;
+    std::vector<uint32_t>         m_removedChunks;
+    std::vector<ModelAllocation>  m_allocations;
+
+    uint32_t random(uint32_t n) {
+      return std::uniform_int_distribution<uint32_t>(0u, n - 1u)(m_rng);
+    }
+
+
+    void randomRequest(uint32_t& count, uint32_t& alignment) {
+      // Mostly small allocations, with the occasional large one
+      uint32_t size = random(100u);
+
+      if (size < 70u)
+        count = 1u + random(16u);
+      else if (size < 95u)
+        count = 1u + random(512u);
+      else
+        count = 1u + random(ChunkPageCount);
+
+      alignment = random(4u) ? 1u : (2u << random(6u));
+      count = align(count, alignment);
+    }
+
+
+    bool modelCanAllocate(uint32_t count, uint32_t alignment) const {
+      for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        const auto& chunk = m_chunks[i];
+
+        if (chunk.disabled || chunk.removed)
+          continue;
+
+        uint32_t page = 0u;
+
+        while (page < chunk.pageCount) {
+          if (chunk.used[page]) {
+            page += 1u;
+            continue;
+          }
+
+          uint32_t end = page;
+
+          while (end < chunk.pageCount && !chunk.used[end])
+            end += 1u;
+
+          if (align(page, alignment) + count <= end)
+            return true;
+
+          page = end;
+        }
+      }
+
+      return false;
+    }
+
+
+    uint32_t modelLargestFreeRange() const {
+      uint32_t largest = 0u;
+
+      for (const auto& chunk : m_chunks) {
+        if (chunk.disabled || chunk.removed)
+          continue;
+
+        uint32_t run = 0u;
+
+        for (uint32_t i = 0; i < chunk.pageCount; i++) {
+          run = chunk.used[i] ? 0u : run + 1u;
+          largest = std::max(largest, run);
+        }
+      }
+
+      return largest;
+    }
+
+
+    void allocate() {
+      uint32_t count, alignment;
+      randomRequest(count, alignment);
+
+      int32_t index;
+
+      if (random(8u)) {
+        index = m_allocator.allocPages(count, alignment);
+      } else {
+        // Exercise the byte interface, which rounds up to full pages
+        uint64_t size = uint64_t(count - 1u) * DxvkPageAllocator::PageSize + 1u + random(DxvkPageAllocator::PageSize);
+        int64_t address = m_allocator.alloc(size, alignment * DxvkPageAllocator::PageSize);
+
+        check(address < 0 || !(address % DxvkPageAllocator::PageSize), m_seed, m_op, "byte address not page-aligned");
+        index = address < 0 ? -1 : int32_t(address / DxvkPageAllocator::PageSize);
+      }
+
+      bool expected = modelCanAllocate(count, alignment);
+
+      if (index < 0) {
+        check(!expected, m_seed, m_op, "allocation failed with a suitable free range");
+        return;
+      }
+
+      check(expected, m_seed, m_op, "allocation succeeded without a suitable free range");
+      check(!(uint32_t(index) % alignment), m_seed, m_op, "allocation not aligned");
+
+      uint32_t chunkIndex = uint32_t(index) >> DxvkPageAllocator::ChunkPageBits;
+      uint32_t pageIndex = uint32_t(index) & DxvkPageAllocator::ChunkPageMask;
+
+      if (chunkIndex >= m_chunks.size()) {
+        check(false, m_seed, m_op, "allocation in unknown chunk");
+        return;
+      }
+
+      auto& chunk = m_chunks[chunkIndex];
+      check(!chunk.disabled && !chunk.removed, m_seed, m_op, "allocation in disabled chunk");
+
+      if (pageIndex + count > chunk.pageCount) {
+        check(false, m_seed, m_op, "allocation exceeds chunk");
+        return;
+      }
+
+      bool overlap = false;
+
+      for (uint32_t i = pageIndex; i < pageIndex + count; i++) {
+        overlap |= chunk.used[i];
+        chunk.used[i] = true;
+      }
+
+      check(!overlap, m_seed, m_op, "allocation overlaps allocated pages");
+
+      chunk.pagesUsed += count;
+      check(m_allocator.pagesUsed(chunkIndex) == chunk.pagesUsed, m_seed, m_op, "wrong used page count after allocation");
+
+      m_allocations.push_back({ uint32_t(index), count });
+    }
+
+
+    void free() {
+      if (m_allocations.empty())
+        return;
+
+      uint32_t allocIndex = random(m_allocations.size());
+      auto& allocation = m_allocations[allocIndex];
+
+      // Occasionally free only part of an allocation, which
+      // creates free ranges that can merge on either side
+      uint32_t count = allocation.count;
+      uint32_t index = allocation.index;
+
+      if (count > 1u && !random(4u)) {
+        count = 1u + random(count - 1u);
+
+        if (random(2u))
+          index += allocation.count - count;
+      }
+
+      uint32_t chunkIndex = index >> DxvkPageAllocator::ChunkPageBits;
+      uint32_t pageIndex = index & DxvkPageAllocator::ChunkPageMask;
+
+      auto& chunk = m_chunks[chunkIndex];
+
+      for (uint32_t i = pageIndex; i < pageIndex + count; i++)
+        chunk.used[i] = false;
+
+      chunk.pagesUsed -= count;
+
+      bool chunkFreed = m_allocator.freePages(index, count);
+
+      check(chunkFreed == !chunk.pagesUsed, m_seed, m_op, "wrong chunk freed status");
+      check(m_allocator.pagesUsed(chunkIndex) == chunk.pagesUsed, m_seed, m_op, "wrong used page count after free");
+
+      if (count == allocation.count) {
+        allocation = m_allocations.back();
+        m_allocations.pop_back();
+      } else {
+        if (index == allocation.index)
+          allocation.index += count;
+
+        allocation.count -= count;
+      }
+    }
+
+
+    void addChunk() {
+      if (m_chunks.size() - m_removedChunks.size() >= MaxChunks)
+        return;
+
+      // Chunks larger than half the maximum size are rare in
+      // practice, but a full chunk needs to work as well.
+      uint32_t pageCount = random(8u) ? 16u + random(ChunkPageCount / 2u) : ChunkPageCount;
+      uint32_t chunkIndex = m_allocator.addChunk(uint64_t(pageCount) * DxvkPageAllocator::PageSize);
+
+      // Removed chunk indices are reused in reverse order
+      uint32_t expected = m_chunks.size();
+
+      if (!m_removedChunks.empty()) {
+        expected = m_removedChunks.back();
+        m_removedChunks.pop_back();
+      } else {
+        m_chunks.emplace_back();
+      }
+
+      check(chunkIndex == expected, m_seed, m_op, "unexpected chunk index");
+
+      if (chunkIndex != expected)
+        chunkIndex = expected;
+
+      auto& chunk = m_chunks[chunkIndex];
+      chunk.pageCount = pageCount;
+      chunk.pagesUsed = 0u;
+      chunk.disabled = false;
+      chunk.removed = false;
+      chunk.used.assign(pageCount, false);
+    }
+
+
+    void removeChunk() {
+      // Only empty chunks can be removed
+      for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        auto& chunk = m_chunks[i];
+
+        if (chunk.removed || chunk.pagesUsed)
+          continue;
+
+        m_allocator.removeChunk(i);
+
+        chunk.pageCount = 0u;
+        chunk.disabled = true;
+        chunk.removed = true;
+        chunk.used.clear();
+
+        m_removedChunks.push_back(i);
+        return;
+      }
+    }
+
+
+    void killChunk() {
+      uint32_t chunkIndex = random(m_chunks.size());
+
+      if (m_chunks[chunkIndex].removed)
+        return;
+
+      m_allocator.killChunk(chunkIndex);
+      m_chunks[chunkIndex].disabled = true;
+    }
+
+
+    void reviveChunk() {
+      uint32_t chunkIndex = random(m_chunks.size());
+
+      if (m_chunks[chunkIndex].removed)
+        return;
+
+      m_allocator.reviveChunk(chunkIndex);
+      m_chunks[chunkIndex].disabled = false;
+    }
+
+
+    void reviveChunks() {
+      uint32_t expected = 0u;
+
+      for (auto& chunk : m_chunks) {
+        if (chunk.disabled && !chunk.removed) {
+          chunk.disabled = false;
+          expected += 1u;
+        }
+      }
+
+      check(m_allocator.reviveChunks() == expected, m_seed, m_op, "wrong revived chunk count");
+    }
+
+
+    void checkLayout() {
+      check(m_allocator.chunkCount() == m_chunks.size(), m_seed, m_op, "wrong chunk count");
+
+      std::vector<uint32_t> mask(ChunkPageCount / 32u);
+
+      for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        const auto& chunk = m_chunks[i];
+
+        check(m_allocator.pageCount(i) == chunk.pageCount, m_seed, m_op, "wrong page count");
+        check(m_allocator.pagesUsed(i) == chunk.pagesUsed, m_seed, m_op, "wrong used page count");
+        check(m_allocator.chunkIsAvailable(i) == !chunk.disabled, m_seed, m_op, "wrong chunk status");
+
+        if (chunk.removed)
+          continue;
+
+        std::fill(mask.begin(), mask.end(), 0u);
+        m_allocator.getPageAllocationMask(i, mask.data());
+
+        bool match = true;
+
+        for (uint32_t j = 0; j < chunk.pageCount; j++)
+          match &= bool((mask[j / 32u] >> (j % 32u)) & 1u) == chunk.used[j];
+
+        check(match, m_seed, m_op, "page allocation mask does not match allocations");
+      }
+    }
+
+
+    void checkLegacy() {
+      // Rebuild the legacy allocator with the same free ranges by
+      // allocating every page and freeing all unused page ranges.
+      DxvkLegacyPageAllocator legacy;
+
+      for (const auto& chunk : m_chunks)
+        legacy.addChunk(chunk.pageCount);
+
+      while (legacy.allocPages(1u, 1u) >= 0)
+        continue;
+
+      for (uint32_t i = 0; i < m_chunks.size(); i++) {
+        const auto& chunk = m_chunks[i];
+        uint32_t page = 0u;
+
+        while (page < chunk.pageCount) {
+          uint32_t end = page;
+
+          while (end < chunk.pageCount && !chunk.used[end])
+            end += 1u;
+
+          if (end > page)
+            legacy.freePages((i << DxvkPageAllocator::ChunkPageBits) + page, end - page);
+
+          page = end + 1u;
+        }
+
+        if (chunk.disabled)
+          legacy.killChunk(i);
+      }
+
+      // Requests around the size of the largest free range are the
+      // ones where a search may miss a range that fits.
+      uint32_t largest = modelLargestFreeRange();
+
+      for (uint32_t i = 0; i < ProbeCount; i++) {
+        uint32_t count, alignment;
+        randomRequest(count, alignment);
+
+        if (largest && random(2u)) {
+          count = std::max(largest + 2u, 3u) - random(3u);
+          count = align(count, alignment);
+        }
+
+        bool expected = modelCanAllocate(count, alignment);
+
+        int32_t index = m_allocator.allocPages(count, alignment);
+        int32_t legacyIndex = legacy.allocPages(count, alignment);
+
+        check((index >= 0) == (legacyIndex >= 0), m_seed, m_op, "allocation result differs from legacy allocator");
+        check((index >= 0) == expected, m_seed, m_op, "allocation result differs from model");
+
+        if (index >= 0)
+          m_allocator.freePages(index, count);
+
+        if (legacyIndex >= 0)
+          legacy.freePages(legacyIndex, count);
+      }
+    }
+
+  };
+
+
+  bool parseArgs(int argc, char** argv, TestParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--seeds")
+        params.seeds = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--ops")
+        params.ops = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.seeds > 0u && params.ops > 0u;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  TestParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--seeds <n>] [--ops <n>]\n", argv[0]);
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < params.seeds; i++)
+    PageAllocatorTest(i).run(params.ops);
+
+  if (g_errors) {
+    std::fprintf(stderr, "%u errors\n", g_errors);
+    return 1;
+  }
+
+  std::printf("All page allocator checks passed over %u seeds\n", params.seeds);
+  return 0;
+}
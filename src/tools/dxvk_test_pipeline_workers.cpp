@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../dxvk/dxvk_pipemanager.h"
+
+// Pipeline worker stress test
+//
+// Submits tasks to DxvkPipelineWorkers from several threads at once, with
+// random priorities and dependencies on previously submitted tasks, and
+// checks that every task completes, that no task completes before the
+// task it depends on, and that idle workers go to sleep rather than spin.
+// Tasks do not reference a pipeline, so workers only exercise the queues.
+//
+// This is primarily meant to be run in a build with -Db_sanitize=thread,
+// so that data races in the work-stealing queues get reported.
+//
+// Usage: dxvk-test-pipeline-workers [--tasks <n>] [--threads <n>] [--workers <n>]
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-test-pipeline-workers.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  struct TestParameters {
+    uint32_t tasks    = 100000u;
+    uint32_t threads  = 4u;
+    uint32_t workers  = 8u;
+  };
+
+
+  struct SubmittedTask {
+    Rc<DxvkPipelineTask> task;
+    Rc<DxvkPipelineTask> dependency;
+  };
+
+
+  struct SubmitList {
+    std::vector<SubmittedTask> tasks;
+    std::atomic<size_t>        published = { 0u };
+  };
+
+
+  uint32_t g_errors = 0u;
+
+  void check(bool condition, const char* test, const char* what) {
+    if (!condition && g_errors++ < 16u)
+      std::fprintf(stderr, "%s: %s\n", test, what);
+  }
+
+
+  void submitTasks(DxvkPipelineWorkers& workers, SubmitList& list, uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    for (uint32_t i = 0; i < count; i++) {
+      auto& entry = list.tasks[i];
+
+      // Most state cache work is low priority, with pipeline libraries
+      // for newly compiled shaders occasionally jumping the queue
+      uint32_t roll = rng() % 16u;
+
+      auto priority = roll < 2u
+        ? DxvkPipelinePriority::High
+        : (roll < 6u ? DxvkPipelinePriority::Normal : DxvkPipelinePriority::Low);
+
+      if (i && !(rng() % 4u))
+        entry.dependency = list.tasks[i - 1u - rng() % std::min(i, 64u)].task;
+
+      entry.task = workers.compilePipelineLibrary(nullptr, priority, entry.dependency);
+      list.published.store(i + 1u, std::memory_order_release);
+
+      // Give workers a chance to run dry every now and then
+      if (!(i % 1024u))
+        std::this_thread::yield();
+    }
+  }
+
+
+  bool waitForWorkers(const DxvkPipelineWorkers& workers, std::chrono::seconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+      auto stats = workers.getStats();
+
+      if (stats.tasksCompleted == stats.tasksTotal)
+        return true;
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+  }
+
+
+  void testSubmit(const TestParameters& params, bool useLibraries) {
+    const char* Test = useLibraries ? "submit (libraries)" : "submit";
+
+    DxvkPipelineWorkers workers(params.workers, useLibraries);
+
+    uint32_t tasksPerThread = params.tasks / params.threads;
+
+    std::vector<SubmitList> lists(params.threads);
+    std::vector<std::thread> threads;
+
+    // Size all lists up front since the checker reads them
+    for (auto& list : lists)
+      list.tasks.resize(tasksPerThread);
+
+    for (uint32_t i = 0; i < params.threads; i++) {
+      threads.emplace_back([&, i] {
+        submitTasks(workers, lists[i], tasksPerThread, i + 1u);
+      });
+    }
+
+    // Check ordering while tasks are being processed. A dependency
+    // that is not done yet must not have any completed dependents.
+    // Only look at recent tasks, older ones are most likely done.
+    std::atomic<bool> running = { true };
+
+    std::thread checker([&] {
+      uint32_t errors = 0u;
+
+      while (running.load()) {
+        for (const auto& list : lists) {
+          size_t count = list.published.load(std::memory_order_acquire);
+          size_t first = count - std::min<size_t>(count, 1024u);
+
+          for (size_t i = first; i < count; i++) {
+            const auto& entry = list.tasks[i];
+
+            if (entry.dependency == nullptr)
+              continue;
+
+            // Check the dependent first, since the dependency
+            // may complete at any point in between
+            if (entry.task->isDone() && !entry.dependency->isDone())
+              errors += 1u;
+          }
+        }
+
+        // Workers run at the lowest priority, do not starve them
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+
+      check(!errors, Test, "task completed before its dependency");
+    });
+
+    for (auto& thread : threads)
+      thread.join();
+
+    bool completed = waitForWorkers(workers, std::chrono::seconds(60));
+
+    running.store(false);
+    checker.join();
+
+    check(completed, Test, "not all tasks completed");
+
+    auto stats = workers.getStats();
+    check(stats.tasksTotal == uint64_t(tasksPerThread) * params.threads,
+      Test, "unexpected task count");
+
+    for (const auto& list : lists) {
+      for (const auto& entry : list.tasks) {
+        if (!entry.task->isDone()) {
+          check(false, Test, "task not marked as done");
+          break;
+        }
+      }
+    }
+
+#ifndef _WIN32
+    // std::clock measures CPU time of the process here. Workers that
+    // keep looking for queued work rather than going to sleep would
+    // burn through a full core each while there is nothing to do.
+    std::clock_t c0 = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    std::clock_t c1 = std::clock();
+
+    double cpuTime = double(c1 - c0) / double(CLOCKS_PER_SEC);
+    check(cpuTime < 0.05, Test, "idle workers are not sleeping");
+#endif
+
+    // Stop while busy, any remaining tasks get discarded
+    SubmitList pending;
+    pending.tasks.resize(tasksPerThread);
+
+    submitTasks(workers, pending, tasksPerThread, 0u);
+    workers.stopWorkers();
+  }
+
+
+  bool parseArgs(int argc, char** argv, TestParameters& params) {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 >= argc)
+        return false;
+
+      std::string arg = argv[i];
+      const char* value = argv[++i];
+
+      if (arg == "--tasks")
+        params.tasks = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--threads")
+        params.threads = uint32_t(std::strtoul(value, nullptr, 10));
+      else if (arg == "--workers")
+        params.workers = uint32_t(std::strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+
+    return params.threads > 0u && params.workers > 0u
+        && params.tasks >= params.threads;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  TestParameters params;
+
+  if (!parseArgs(argc, argv, params)) {
+    std::fprintf(stderr, "Usage: %s [--tasks <n>] [--threads <n>] [--workers <n>]\n", argv[0]);
+    return 1;
+  }
+
+  testSubmit(params, false);
+  testSubmit(params, true);
+
+  if (g_errors) {
+    std::fprintf(stderr, "%u errors\n", g_errors);
+    return 1;
+  }
+
+  std::printf("%u tasks from %u threads on %u workers passed\n",
+    params.tasks, params.threads, params.workers);
+  return 0;
+}
@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "../spirv/spirv_module.h"
+#include "../spirv/spirv_optimizer.h"
+
+// SPIR-V optimizer pass test
+//
+// Builds small fragment shaders with SpirvModule, runs them through
+// SpirvOptimizer and checks the resulting code for each pass: constant
+// folding, including the cases that must not be folded, removal of dead
+// code, and forwarding of loads and stores of private and function
+// variables. Values that must survive are written to output variables.
+//
+// Usage: dxvk-test-spirv-optimizer
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-test-spirv-optimizer.log");
+}
+
+using namespace dxvk;
+
+namespace {
+
+  uint32_t g_errors = 0u;
+
+  void check(bool condition, const char* test, const char* what) {
+    if (!condition && g_errors++ < 16u)
+      std::fprintf(stderr, "%s: %s\n", test, what);
+  }
+
+
+  /**
+   * \brief Test shader
+   *
+   * Fragment shader with a single entry point function
+   * that consists of one block unless the test adds more.
+   */
+  class TestShader {
+
+  public:
+
+    TestShader()
+    : m_module(spvVersion(1, 6)) {
+      m_module.enableCapability(spv::CapabilityShader);
+      m_module.setMemoryModel(spv::AddressingModelLogical, spv::MemoryModelGLSL450);
+
+      m_entryPointId = m_module.allocateId();
+
+      uint32_t voidType = m_module.defVoidType();
+
+      m_module.functionBegin(voidType, m_entryPointId,
+        m_module.defFunctionType(voidType, 0, nullptr),
+        spv::FunctionControlMaskNone);
+      m_module.opLabel(m_module.allocateId());
+    }
+
+    SpirvModule* operator -> () {
+      return &m_module;
+    }
+
+    uint32_t uintType() {
+      return m_module.defIntType(32, 0);
+    }
+
+    uint32_t intType() {
+      return m_module.defIntType(32, 1);
+    }
+
+    uint32_t floatType() {
+      return m_module.defFloatType(32);
+    }
+
+    uint32_t boolType() {
+      return m_module.defBoolType();
+    }
+
+    uint32_t input(uint32_t typeId) {
+      uint32_t varId = m_module.newVar(
+        m_module.defPointerType(typeId, spv::StorageClassInput),
+        spv::StorageClassInput);
+
+      m_module.decorate(varId, spv::DecorationFlat);
+      m_module.decorateLocation(varId, m_inputCount++);
+      return m_module.opLoad(typeId, varId);
+    }
+
+    uint32_t output(uint32_t typeId) {
+      uint32_t varId = m_module.newVar(
+        m_module.defPointerType(typeId, spv::StorageClassOutput),
+        spv::StorageClassOutput);
+
+      m_module.decorateLocation(varId, m_outputCount++);
+      return varId;
+    }
+
+    uint32_t variable(uint32_t typeId, spv::StorageClass storageClass) {
+      return m_module.newVar(
+        m_module.defPointerType(typeId, storageClass),
+        storageClass);
+    }
+
+    SpirvCodeBuffer compile() {
+      m_module.opReturn();
+      m_module.functionEnd();
+
+      m_module.addEntryPoint(m_entryPointId, spv::ExecutionModelFragment, "main");
+      m_module.setExecutionMode(m_entryPointId, spv::ExecutionModeOriginUpperLeft);
+      return m_module.compile();
+    }
+
+    SpirvCodeBuffer optimize() {
+      return SpirvOptimizer(compile()).optimize();
+    }
+
+  private:
+
+    SpirvModule m_module;
+
+    uint32_t    m_entryPointId  = 0u;
+    uint32_t    m_inputCount    = 0u;
+    uint32_t    m_outputCount   = 0u;
+
+  };
+
+
+  uint32_t countOps(SpirvCodeBuffer& code, spv::Op op) {
+    uint32_t count = 0u;
+
+    for (auto ins : code) {
+      if (ins.opCode() == op)
+        count += 1u;
+    }
+
+    return count;
+  }
+
+
+  /**
+   * \brief Finds the value stored to a variable
+   *
+   * \returns Value ID of the only store to the
+   *    given variable, or 0 if there is none
+   */
+  uint32_t findStoredValue(SpirvCodeBuffer& code, uint32_t varId) {
+    uint32_t valueId = 0u;
+
+    for (auto ins : code) {
+      if (ins.opCode() == spv::OpStore && ins.arg(1) == varId)
+        valueId = valueId ? ~0u : ins.arg(2);
+    }
+
+    return valueId != ~0u ? valueId : 0u;
+  }
+
+
+  /**
+   * \brief Checks whether a value is a scalar constant
+   *
+   * \returns \c true if the value is defined by an \c OpConstant
+   *    of the given type and value, or is \c OpConstantTrue or
+   *    \c OpConstantFalse for \c bool types.
+   */
+  bool isConstant(SpirvCodeBuffer& code, uint32_t id, uint32_t typeId, uint32_t value) {
+    for (auto ins : code) {
+      switch (ins.opCode()) {
+        case spv::OpConstant:
+          if (ins.arg(2) == id)
+            return ins.length() == 4 && ins.arg(1) == typeId && ins.arg(3) == value;
+          break;
+
+        case spv::OpConstantTrue:
+        case spv::OpConstantFalse:
+          if (ins.arg(2) == id)
+            return ins.arg(1) == typeId && value == uint32_t(ins.opCode() == spv::OpConstantTrue);
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    return false;
+  }
+
+
+  bool isDefined(SpirvCodeBuffer& code, spv::Op op, uint32_t id) {
+    for (auto ins : code) {
+      if (ins.opCode() == op && ins.length() > 2 && ins.arg(2) == id)
+        return true;
+    }
+
+    return false;
+  }
+
+
+  void testFoldArithmetic() {
+    constexpr const char* Test = "foldArithmetic";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+    uint32_t i32 = shader.intType();
+
+    uint32_t sum = shader->opIAdd(u32, shader->constu32(3u), shader->constu32(4u));
+    uint32_t product = shader->opIMul(u32, sum, shader->constu32(6u));
+    uint32_t shifted = shader->opShiftRightLogical(u32, product, shader->constu32(2u));
+    uint32_t masked = shader->opBitwiseOr(u32,
+      shader->opBitwiseAnd(u32, shifted, shader->constu32(0xf0u)),
+      shader->opShiftLeftLogical(u32, shader->constu32(1u), shader->constu32(31u)));
+
+    uint32_t quotient = shader->opSDiv(i32, shader->consti32(-7), shader->consti32(2));
+    uint32_t negated = shader->opSNegate(i32, shader->opNot(i32, shader->consti32(5)));
+
+    uint32_t out0 = shader.output(u32);
+    uint32_t out1 = shader.output(i32);
+    uint32_t out2 = shader.output(i32);
+
+    shader->opStore(out0, masked);
+    shader->opStore(out1, quotient);
+    shader->opStore(out2, negated);
+
+    auto code = shader.optimize();
+
+    // (3 + 4) * 6 = 42, 42 >> 2 = 10, (10 & 0xf0) | (1 << 31)
+    check(isConstant(code, findStoredValue(code, out0), u32, 0x80000000u),
+      Test, "unsigned arithmetic not folded to 0x80000000");
+    check(isConstant(code, findStoredValue(code, out1), i32, uint32_t(-3)),
+      Test, "signed division does not round towards zero");
+    check(isConstant(code, findStoredValue(code, out2), i32, 6u),
+      Test, "-~5 not folded to 6");
+
+    check(!countOps(code, spv::OpIAdd) && !countOps(code, spv::OpIMul)
+       && !countOps(code, spv::OpSDiv) && !countOps(code, spv::OpNot)
+       && !countOps(code, spv::OpSNegate) && !countOps(code, spv::OpBitwiseOr),
+      Test, "folded instructions not removed");
+  }
+
+
+  void testFoldUndefined() {
+    constexpr const char* Test = "foldUndefined";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+    uint32_t i32 = shader.intType();
+
+    // Results are undefined, leave them to the driver
+    uint32_t udiv = shader->opUDiv(u32, shader->constu32(5u), shader->constu32(0u));
+    uint32_t shl = shader->opShiftLeftLogical(u32, shader->constu32(1u), shader->constu32(32u));
+    uint32_t sdiv = shader->opSDiv(i32, shader->consti32(INT32_MIN), shader->consti32(-1));
+
+    shader->opStore(shader.output(u32), udiv);
+    shader->opStore(shader.output(u32), shl);
+    shader->opStore(shader.output(i32), sdiv);
+
+    auto code = shader.optimize();
+
+    check(countOps(code, spv::OpUDiv) == 1u, Test, "division by zero folded");
+    check(countOps(code, spv::OpShiftLeftLogical) == 1u, Test, "shift by 32 folded");
+    check(countOps(code, spv::OpSDiv) == 1u, Test, "INT32_MIN / -1 folded");
+  }
+
+
+  void testFoldFloat() {
+    constexpr const char* Test = "foldFloat";
+
+    TestShader shader;
+    uint32_t f32 = shader.floatType();
+    uint32_t u32 = shader.uintType();
+
+    uint32_t sum = shader->opFAdd(f32, shader->constf32(1.0f), shader->constf32(2.0f));
+    uint32_t bits = shader->opBitcast(u32, shader->constf32(1.0f));
+
+    uint32_t out0 = shader.output(f32);
+    uint32_t out1 = shader.output(u32);
+
+    shader->opStore(out0, sum);
+    shader->opStore(out1, bits);
+
+    auto code = shader.optimize();
+
+    check(countOps(code, spv::OpFAdd) == 1u, Test, "float arithmetic folded");
+    check(isConstant(code, findStoredValue(code, out1), u32, 0x3f800000u),
+      Test, "bitcast of 1.0f not folded to 0x3f800000");
+  }
+
+
+  void testFoldCompareSelect() {
+    constexpr const char* Test = "foldCompareSelect";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+    uint32_t i32 = shader.intType();
+    uint32_t boolType = shader.boolType();
+
+    // -1 is less than 0 when signed, but not when unsigned
+    uint32_t slt = shader->opSLessThan(boolType, shader->consti32(-1), shader->consti32(0));
+    uint32_t ult = shader->opULessThan(boolType, shader->consti32(-1), shader->consti32(0));
+    uint32_t cond = shader->opLogicalAnd(boolType, slt, shader->opLogicalNot(boolType, ult));
+
+    uint32_t x = shader.input(u32);
+    uint32_t y = shader.input(u32);
+
+    uint32_t out0 = shader.output(u32);
+    uint32_t out1 = shader.output(u32);
+
+    shader->opStore(out0, shader->opSelect(u32, cond, x, y));
+    shader->opStore(out1, shader->opSelect(u32, ult, x, y));
+
+    auto code = shader.optimize();
+
+    check(findStoredValue(code, out0) == x, Test, "select with true condition not folded");
+    check(findStoredValue(code, out1) == y, Test, "select with false condition not folded");
+    check(!countOps(code, spv::OpSelect) && !countOps(code, spv::OpSLessThan)
+       && !countOps(code, spv::OpULessThan) && !countOps(code, spv::OpLogicalAnd),
+      Test, "folded instructions not removed");
+  }
+
+
+  void testFoldComposite() {
+    constexpr const char* Test = "foldComposite";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    std::array<uint32_t, 3> members = {
+      shader->constu32(7u),
+      shader->constu32(9u),
+      shader->constu32(11u) };
+
+    uint32_t vector = shader->constComposite(
+      shader->defVectorType(u32, members.size()),
+      members.size(), members.data());
+
+    uint32_t index = 1u;
+    uint32_t out0 = shader.output(u32);
+    shader->opStore(out0, shader->opCompositeExtract(u32, vector, 1, &index));
+
+    auto code = shader.optimize();
+
+    check(isConstant(code, findStoredValue(code, out0), u32, 9u),
+      Test, "extract from constant vector not folded");
+    check(!countOps(code, spv::OpCompositeExtract), Test, "extract not removed");
+  }
+
+
+  void testFoldIdentities() {
+    constexpr const char* Test = "foldIdentities";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+    uint32_t i32 = shader.intType();
+
+    uint32_t x = shader.input(u32);
+
+    uint32_t out0 = shader.output(u32);
+    uint32_t out1 = shader.output(u32);
+    uint32_t out2 = shader.output(i32);
+
+    shader->opStore(out0, shader->opIAdd(u32, shader->constu32(0u), x));
+    shader->opStore(out1, shader->opBitwiseAnd(u32,
+      shader->opIMul(u32, x, shader->constu32(1u)),
+      shader->constu32(~0u)));
+
+    // Folding this would change the type of the stored value
+    shader->opStore(out2, shader->opIAdd(i32, x, shader->consti32(0)));
+
+    auto code = shader.optimize();
+
+    check(findStoredValue(code, out0) == x, Test, "0 + x not folded to x");
+    check(findStoredValue(code, out1) == x, Test, "(x * 1) & ~0 not folded to x");
+    check(countOps(code, spv::OpIAdd) == 1u, Test, "identity folded across types");
+    check(!countOps(code, spv::OpIMul) && !countOps(code, spv::OpBitwiseAnd),
+      Test, "folded instructions not removed");
+  }
+
+
+  void testFoldDecorated() {
+    constexpr const char* Test = "foldDecorated";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    uint32_t sum = shader->opIAdd(u32, shader->constu32(1u), shader->constu32(2u));
+    shader->decorate(sum, spv::DecorationNoContraction);
+    shader->opStore(shader.output(u32), sum);
+
+    auto code = shader.optimize();
+
+    check(countOps(code, spv::OpIAdd) == 1u, Test, "decorated result folded");
+    check(isDefined(code, spv::OpIAdd, sum), Test, "decorated result removed");
+  }
+
+
+  void testDeadCode() {
+    constexpr const char* Test = "deadCode";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    uint32_t x = shader.input(u32);
+    shader->opStore(shader.output(u32), x);
+
+    // Unused chain, must be removed as a whole
+    uint32_t a = shader->opIAdd(u32, x, shader->constu32(1u));
+    uint32_t b = shader->opIMul(u32, a, a);
+    shader->opBitwiseXor(u32, b, x);
+
+    // Volatile loads may have side effects
+    uint32_t var = shader->newVar(
+      shader->defPointerType(u32, spv::StorageClassInput),
+      spv::StorageClassInput);
+    shader->decorate(var, spv::DecorationFlat);
+    shader->decorateLocation(var, 8u);
+
+    SpirvMemoryOperands memOps;
+    memOps.flags = spv::MemoryAccessVolatileMask;
+    uint32_t volatileLoad = shader->opLoad(u32, var, memOps);
+    uint32_t plainLoad = shader->opLoad(u32, var);
+
+    auto code = shader.optimize();
+
+    check(!countOps(code, spv::OpIAdd) && !countOps(code, spv::OpIMul)
+       && !countOps(code, spv::OpBitwiseXor), Test, "unused instructions not removed");
+    check(isDefined(code, spv::OpLoad, x), Test, "used load removed");
+    check(isDefined(code, spv::OpLoad, volatileLoad), Test, "volatile load removed");
+    check(!isDefined(code, spv::OpLoad, plainLoad), Test, "unused load not removed");
+  }
+
+
+  void testForwardStore() {
+    constexpr const char* Test = "forwardStore";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    uint32_t x = shader.input(u32);
+
+    // Register-style temporaries, which are only ever
+    // loaded and stored as a whole within one block
+    uint32_t r0 = shader.variable(u32, spv::StorageClassPrivate);
+    uint32_t r1 = shader.variable(u32, spv::StorageClassPrivate);
+
+    shader->opStore(r0, shader->constu32(5u));
+    shader->opStore(r1, x);
+    shader->opStore(r0, shader->opIAdd(u32,
+      shader->opLoad(u32, r0),
+      shader->constu32(3u)));
+
+    uint32_t out0 = shader.output(u32);
+    uint32_t out1 = shader.output(u32);
+
+    shader->opStore(out0, shader->opLoad(u32, r0));
+    shader->opStore(out1, shader->opLoad(u32, r1));
+
+    auto code = shader.optimize();
+
+    check(isConstant(code, findStoredValue(code, out0), u32, 8u),
+      Test, "forwarded store not folded to 8");
+    check(findStoredValue(code, out1) == x, Test, "stored value not forwarded");
+    check(!isDefined(code, spv::OpVariable, r0) && !isDefined(code, spv::OpVariable, r1), Test, "unread variables not removed");
+    check(!findStoredValue(code, r0) && !findStoredValue(code, r1),
+      Test, "stores to unread variables not removed");
+
+    for (auto ins : code) {
+      if (ins.opCode() != spv::OpEntryPoint)
+        continue;
+
+      for (uint32_t i = 3; i < ins.length(); i++) {
+        check(ins.arg(i) != r0 && ins.arg(i) != r1,
+          Test, "removed variable still in entry point interface");
+      }
+    }
+  }
+
+
+  void testForwardLoad() {
+    constexpr const char* Test = "forwardLoad";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    uint32_t r0 = shader.variable(u32, spv::StorageClassFunction);
+    shader->opStore(r0, shader.input(u32));
+
+    uint32_t label = shader->allocateId();
+    shader->opBranch(label);
+    shader->opLabel(label);
+
+    // The first load in a block must stay, any
+    // further loads of the variable can reuse it
+    uint32_t a = shader->opLoad(u32, r0);
+    uint32_t b = shader->opLoad(u32, r0);
+
+    uint32_t out0 = shader.output(u32);
+    shader->opStore(out0, shader->opIAdd(u32, a, b));
+
+    auto code = shader.optimize();
+
+    check(countOps(code, spv::OpLoad) == 2u, Test, "expected one input and one variable load");
+    check(isDefined(code, spv::OpLoad, a) && !isDefined(code, spv::OpLoad, b), Test, "second load not replaced by first");
+    check(findStoredValue(code, r0) != 0u, Test, "store in previous block removed");
+  }
+
+
+  void testForwardBlocked() {
+    constexpr const char* Test = "forwardBlocked";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+    uint32_t vec2 = shader->defVectorType(u32, 2u);
+    uint32_t voidType = shader->defVoidType();
+
+    // Variables accessed through access chains must be left alone
+    uint32_t v0 = shader.variable(vec2, spv::StorageClassPrivate);
+    uint32_t r0 = shader.variable(u32, spv::StorageClassPrivate);
+
+    std::array<uint32_t, 2> members = { shader->constu32(1u), shader->constu32(2u) };
+    shader->opStore(v0, shader->constComposite(vec2, members.size(), members.data()));
+
+    uint32_t index = shader->constu32(1u);
+    uint32_t ptr = shader->opAccessChain(
+      shader->defPointerType(u32, spv::StorageClassPrivate), v0, 1, &index);
+    shader->opStore(ptr, shader->constu32(3u));
+
+    uint32_t out0 = shader.output(vec2);
+    shader->opStore(out0, shader->opLoad(vec2, v0));
+
+    // Function calls may write private variables
+    uint32_t functionId = shader->allocateId();
+
+    shader->opStore(r0, shader->constu32(4u));
+    shader->opFunctionCall(voidType, functionId, 0, nullptr);
+
+    uint32_t out1 = shader.output(u32);
+    uint32_t value = shader->opLoad(u32, r0);
+    shader->opStore(out1, value);
+    shader->opReturn();
+    shader->functionEnd();
+
+    shader->functionBegin(voidType, functionId,
+      shader->defFunctionType(voidType, 0, nullptr),
+      spv::FunctionControlMaskNone);
+    shader->opLabel(shader->allocateId());
+    shader->opStore(r0, shader->constu32(5u));
+
+    auto code = shader.optimize();
+
+    check(countOps(code, spv::OpAccessChain) == 1u, Test, "access chain removed");
+    check(countOps(code, spv::OpLoad) == 2u, Test, "loads forwarded past access chain or call");
+    check(findStoredValue(code, out1) == value, Test, "load after function call forwarded");
+    check(isDefined(code, spv::OpVariable, v0) && isDefined(code, spv::OpVariable, r0), Test, "variables removed");
+  }
+
+
+  void testUnknownInstruction() {
+    constexpr const char* Test = "unknownInstruction";
+
+    TestShader shader;
+    uint32_t u32 = shader.uintType();
+
+    shader->opStore(shader.output(u32),
+      shader->opIAdd(u32, shader->constu32(1u), shader->constu32(2u)));
+
+    auto input = shader.compile();
+
+    // Insert an instruction with an unknown opcode before OpReturn,
+    // the optimizer cannot know which of its operands are IDs.
+    std::vector<uint32_t> words(input.data(), input.data() + input.dwords());
+
+    for (size_t i = 5; i < words.size(); i += words[i] >> spv::WordCountShift) {
+      if ((words[i] & spv::OpCodeMask) == spv::OpReturn) {
+        words.insert(words.begin() + i, { (2u << spv::WordCountShift) | 0xfffeu, 1u });
+        break;
+      }
+    }
+
+    auto code = SpirvOptimizer(SpirvCodeBuffer(words.size(), words.data())).optimize();
+
+    check(code.dwords() == words.size()
+       && std::equal(words.begin(), words.end(), code.data()),
+      Test, "module with unknown instruction modified");
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  testFoldArithmetic();
+  testFoldUndefined();
+  testFoldFloat();
+  testFoldCompareSelect();
+  testFoldComposite();
+  testFoldIdentities();
+  testFoldDecorated();
+  testDeadCode();
+  testForwardStore();
+  testForwardLoad();
+  testForwardBlocked();
+  testUnknownInstruction();
+
+  if (g_errors) {
+    std::fprintf(stderr, "%u errors\n", g_errors);
+    return 1;
+  }
+
+  std::printf("All tests passed\n");
+  return 0;
+}
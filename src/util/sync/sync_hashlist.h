@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <utility>
+
+namespace dxvk::sync {
+
+  /**
+   * \brief Lock-free append-only hash list
+   *
+   * Stores objects in a fixed number of buckets, each of
+   * which is a lock-free single-linked list. Objects are
+   * never moved or removed until the container itself is
+   * destroyed, so lookups can safely run concurrently with
+   * insertions without taking any locks.
+   *
+   * Since buckets are never rehashed, the bucket count
+   * should be chosen based on the expected number of
+   * objects. The hash is stored alongside each object so
+   * that full comparisons only happen on hash matches.
+   * \tparam T Object type
+   * \tparam BucketCount Number of buckets, power of two
+   */
+  template<typename T, size_t BucketCount>
+  class HashList {
+    static_assert(BucketCount && !(BucketCount & (BucketCount - 1)));
+
+    struct Entry {
+      template<typename... Args>
+      Entry(size_t hash_, Args&&... args)
+      : data(std::forward<Args>(args)...), hash(hash_) { }
+
+      T      data;
+      size_t hash;
+      Entry* nextInBucket = nullptr;
+      Entry* next         = nullptr;
+    };
+
+  public:
+
+    class Iterator {
+
+    public:
+
+      using iterator_category = std::forward_iterator_tag;
+      using difference_type   = std::ptrdiff_t;
+      using value_type        = T;
+      using pointer           = T*;
+      using reference         = T&;
+
+      Iterator()
+      : m_entry(nullptr) { }
+
+      Iterator(Entry* e)
+      : m_entry(e) { }
+
+      reference operator * () const {
+        return m_entry->data;
+      }
+
+      pointer operator -> () const {
+        return &m_entry->data;
+      }
+
+      Iterator& operator ++ () {
+        m_entry = m_entry->next;
+        return *this;
+      }
+
+      Iterator operator ++ (int) {
+        Iterator tmp(m_entry);
+        m_entry = m_entry->next;
+        return tmp;
+      }
+
+      bool operator == (const Iterator& other) const { return m_entry == other.m_entry; }
+      bool operator != (const Iterator& other) const { return m_entry != other.m_entry; }
+
+    private:
+
+      Entry* m_entry;
+
+    };
+
+    using iterator = Iterator;
+
+    HashList() { }
+
+    HashList             (const HashList&) = delete;
+    HashList& operator = (const HashList&) = delete;
+
+    ~HashList() {
+      Entry* e = m_head.load();
+
+      while (e) {
+        Entry* next = e->next;
+        delete e;
+        e = next;
+      }
+    }
+
+    auto begin() const { return Iterator(m_head.load(std::memory_order_acquire)); }
+    auto end() const { return Iterator(nullptr); }
+
+    /**
+     * \brief Looks up an object
+     *
+     * Only objects with a matching hash are passed
+     * to the predicate for a full comparison.
+     * \param [in] hash Hash of the object to look up
+     * \param [in] pred Object comparison function
+     * \returns Pointer to object, or \c nullptr
+     */
+    template<typename Pred>
+    T* find(size_t hash, const Pred& pred) const {
+      Entry* e = m_buckets[hash & (BucketCount - 1)].load(std::memory_order_acquire);
+
+      while (e) {
+        if (e->hash == hash && pred(e->data))
+          return &e->data;
+
+        e = e->nextInBucket;
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * \brief Inserts an object
+     *
+     * Does not check whether an equal object already
+     * exists, this must be done by the caller if needed.
+     * \param [in] hash Object hash
+     * \param [in] args Constructor arguments
+     * \returns Pointer to the newly inserted object
+     */
+    template<typename... Args>
+    T* emplace(size_t hash, Args&&... args) {
+      Entry* e = new Entry(hash, std::forward<Args>(args)...);
+
+      // Link into the global list first so that the
+      // object is visible to iterators once found
+      insertEntry(m_head, e, &Entry::next);
+      insertEntry(m_buckets[hash & (BucketCount - 1)], e, &Entry::nextInBucket);
+      return &e->data;
+    }
+
+  private:
+
+    std::atomic<Entry*> m_head = { nullptr };
+    std::array<std::atomic<Entry*>, BucketCount> m_buckets = { };
+
+    static void insertEntry(std::atomic<Entry*>& head, Entry* e, Entry* Entry::*link) {
+      Entry* next = head.load(std::memory_order_acquire);
+
+      do {
+        e->*link = next;
+      } while (!head.compare_exchange_weak(next, e,
+        std::memory_order_release,
+        std::memory_order_acquire));
+    }
+
+  };
+
+}
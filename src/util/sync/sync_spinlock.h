@@ -9,6 +9,22 @@
 
 namespace dxvk::sync {
 
+  /**
+   * \brief Spin-wait hint
+   *
+   * Tells the CPU that the calling thread is
+   * busy-waiting for another thread.
+   */
+  inline void pause() {
+    #if defined(DXVK_ARCH_X86)
+    _mm_pause();
+    #elif defined(DXVK_ARCH_ARM64)
+    __asm__ __volatile__ ("yield");
+    #else
+    #error "Pause/Yield not implemented for this architecture."
+    #endif
+  }
+
   /**
    * \brief Generic spin function
    *
@@ -21,13 +37,7 @@ namespace dxvk::sync {
   void spin(uint32_t spinCount, const Fn& fn) {
     while (unlikely(!fn())) {
       for (uint32_t i = 1; i < spinCount; i++) {
-        #if defined(DXVK_ARCH_X86)
-        _mm_pause();
-        #elif defined(DXVK_ARCH_ARM64)
-        __asm__ __volatile__ ("yield");
-        #else
-        #error "Pause/Yield not implemented for this architecture."
-        #endif
+        pause();
         if (fn())
           return;
       }
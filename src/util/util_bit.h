@@ -304,6 +304,38 @@ namespace dxvk::bit {
     #endif
   }
 
+
+  /**
+   * \brief Hashes an aligned struct bit by bit
+   *
+   * Any padding bytes must be initialized, same
+   * as for structs compared with \c bcmpeq.
+   * \param [in] a Struct to hash
+   * \returns Hash of the raw struct data
+   */
+  template<typename T>
+  size_t bhash(const T* a) {
+    static_assert(alignof(T) >= 16);
+    auto words = reinterpret_cast<const uint64_t*>(a);
+
+    // Two interleaved FNV-style lanes on 64-bit words,
+    // followed by a finalizer to mix the high bits back
+    // down since we mask the result for table lookups.
+    uint64_t h0 = 0xcbf29ce484222325ull;
+    uint64_t h1 = 0x84222325cbf29ce4ull;
+
+    for (size_t i = 0; i < sizeof(T) / 8; i += 2) {
+      h0 = (h0 ^ words[i + 0]) * 0x100000001b3ull;
+      h1 = (h1 ^ words[i + 1]) * 0x100000001b3ull;
+    }
+
+    uint64_t h = h0 ^ ((h1 << 31) | (h1 >> 33));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return size_t(h);
+  }
+
   template <size_t Bits>
   class bitset {
     static constexpr size_t Dwords = align(Bits, 32) / 32;
@@ -146,5 +146,25 @@ namespace dxvk::env {
     return std::filesystem::create_directories(path);
 #endif
   }
+
+
+  std::string getIndexedFilePath(const std::string& path, uint32_t index) {
+    if (!index)
+      return path;
+
+    std::string suffix = "_" + std::to_string(index);
+
+    // Only consider dots in the file name itself, and
+    // ignore the leading dot of hidden files
+    size_t nameStart = path.find_last_of("/\\");
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+
+    size_t extStart = path.find_last_of('.');
+
+    if (extStart == std::string::npos || extStart <= nameStart)
+      return path + suffix;
+
+    return path.substr(0, extStart) + suffix + path.substr(extStart);
+  }
   
 }
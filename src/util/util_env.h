@@ -75,5 +75,17 @@ namespace dxvk::env {
    * \returns \c true on success
    */
   bool createDirectory(const std::string& path);
+
+  /**
+   * \brief Adds an instance index to a file path
+   *
+   * Inserts \c _<index> before the file extension, so that
+   * multiple objects writing to the same configured path use
+   * distinct files. The path is returned as-is for index 0.
+   * \param [in] path File path
+   * \param [in] index Instance index
+   * \returns Path with the index applied
+   */
+  std::string getIndexedFilePath(const std::string& path, uint32_t index);
   
 }
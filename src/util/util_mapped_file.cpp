@@ -0,0 +1,135 @@
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util_mapped_file.h"
+
+#include "./com/com_include.h"
+
+namespace dxvk {
+
+  MappedFile::MappedFile() { }
+
+
+  MappedFile::MappedFile(const str::path_string& path) {
+#ifdef _WIN32
+    HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+
+    LARGE_INTEGER size = { };
+
+    if (!::GetFileSizeEx(file, &size)) {
+      ::CloseHandle(file);
+      return;
+    }
+
+    m_file   = file;
+    m_isOpen = true;
+    m_size   = size_t(size.QuadPart);
+
+    // Empty files cannot be mapped
+    if (!m_size)
+      return;
+
+    m_mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (m_mapping)
+      m_data = reinterpret_cast<const uint8_t*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (!m_data)
+      close();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+      return;
+
+    struct stat st = { };
+
+    if (::fstat(fd, &st)) {
+      ::close(fd);
+      return;
+    }
+
+    m_isOpen = true;
+    m_size   = size_t(st.st_size);
+
+    if (m_size) {
+      void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data != MAP_FAILED)
+        m_data = reinterpret_cast<const uint8_t*>(data);
+      else
+        close();
+    }
+
+    // The mapping remains valid after closing the descriptor
+    ::close(fd);
+#endif
+  }
+
+
+  MappedFile::MappedFile(MappedFile&& other) {
+    moveFrom(std::move(other));
+  }
+
+
+  MappedFile& MappedFile::operator = (MappedFile&& other) {
+    if (this != &other) {
+      close();
+      moveFrom(std::move(other));
+    }
+
+    return *this;
+  }
+
+
+  MappedFile::~MappedFile() {
+    close();
+  }
+
+
+  void MappedFile::close() {
+#ifdef _WIN32
+    if (m_data)
+      ::UnmapViewOfFile(m_data);
+
+    if (m_mapping)
+      ::CloseHandle(m_mapping);
+
+    if (m_file)
+      ::CloseHandle(m_file);
+
+    m_file    = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data)
+      ::munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+
+    m_isOpen  = false;
+    m_data    = nullptr;
+    m_size    = 0;
+  }
+
+
+  void MappedFile::moveFrom(MappedFile&& other) {
+    m_isOpen  = std::exchange(other.m_isOpen,  false);
+    m_data    = std::exchange(other.m_data,    nullptr);
+    m_size    = std::exchange(other.m_size,    0);
+#ifdef _WIN32
+    m_file    = std::exchange(other.m_file,    nullptr);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+  }
+
+}
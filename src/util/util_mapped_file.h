@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "util_string.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Read-only file mapping
+   *
+   * Maps an entire file into the address space of the
+   * process. The file may be appended to while it is
+   * mapped, however such data will not be visible
+   * through the mapping.
+   */
+  class MappedFile {
+
+  public:
+
+    MappedFile();
+
+    MappedFile(const str::path_string& path);
+
+    MappedFile(MappedFile&& other);
+
+    MappedFile& operator = (MappedFile&& other);
+
+    ~MappedFile();
+
+    /**
+     * \brief Checks whether the file is open
+     * \returns \c true if the file was opened
+     */
+    bool isOpen() const {
+      return m_isOpen;
+    }
+
+    /**
+     * \brief Queries mapped data
+     * \returns Pointer to file contents
+     */
+    const uint8_t* data() const {
+      return m_data;
+    }
+
+    /**
+     * \brief Queries mapped size
+     * \returns File size at the time of mapping
+     */
+    size_t size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Unmaps and closes the file
+     */
+    void close();
+
+  private:
+
+    bool            m_isOpen  = false;
+    const uint8_t*  m_data    = nullptr;
+    size_t          m_size    = 0;
+
+#ifdef _WIN32
+    void*           m_file    = nullptr;
+    void*           m_mapping = nullptr;
+#endif
+
+    void moveFrom(MappedFile&& other);
+
+  };
+
+}
@@ -372,6 +372,14 @@ namespace dxvk::vk {
     VULKAN_FN(vkSetDebugUtilsObjectTagEXT);
     #endif
 
+    #ifdef VK_EXT_descriptor_buffer
+    VULKAN_FN(vkGetDescriptorSetLayoutSizeEXT);
+    VULKAN_FN(vkGetDescriptorSetLayoutBindingOffsetEXT);
+    VULKAN_FN(vkGetDescriptorEXT);
+    VULKAN_FN(vkCmdBindDescriptorBuffersEXT);
+    VULKAN_FN(vkCmdSetDescriptorBufferOffsetsEXT);
+    #endif
+
     #ifdef VK_EXT_extended_dynamic_state3
     VULKAN_FN(vkCmdSetTessellationDomainOriginEXT);
     VULKAN_FN(vkCmdSetDepthClampEnableEXT);